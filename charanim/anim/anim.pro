@@ -61,11 +61,30 @@ HEADERS += \
     charanim.hpp \
     vec_helper.hpp \
     terrain/terrain.hpp \
+    terrain/binary_map.hpp \
     definitions.hpp \
     terrain/regular_grid.hpp \
+    terrain/grid_search.hpp \
+    terrain/search_policy.hpp \
+    terrain/navmesh.hpp \
+    terrain/visibility_graph.hpp \
+    terrain/medial_axis.hpp \
+    terrain/spatial_index.hpp \
+    terrain/simplify_segments.hpp \
+    terrain/map_generator.hpp \
+    terrain/visibility_cache.hpp \
+    terrain/ray_batch.hpp \
+    terrain/streamed_grid.hpp \
+    terrain/cooperative_planner.hpp \
+    terrain/density_grid.hpp \
     terrain/ray_rasterize.hpp \
     terrain/ray_rasterize_4_way.hpp \
+    terrain/grid_traversal.hpp \
     utils/utils.hpp \
+    utils/bitmask.hpp \
+    utils/batch_queue.hpp \
+    utils/mapped_file.hpp \
+    utils/file_watcher.hpp \
     utils/indexed_minheap.hpp \
     utils/indexed_minheap.cpp \
     sim_1xx.hpp
@@ -75,11 +94,31 @@ SOURCES += main.cpp \
     charanim_render.cpp \
     terrain/terrain.cpp \
     terrain/regular_grid.cpp \
+    terrain/grid_search.cpp \
+    terrain/navmesh.cpp \
+    terrain/visibility_graph.cpp \
+    terrain/medial_axis.cpp \
+    terrain/spatial_index.cpp \
+    terrain/simplify_segments.cpp \
+    terrain/map_generator.cpp \
+    terrain/visibility_cache.cpp \
+    terrain/ray_batch.cpp \
+    terrain/streamed_grid.cpp \
+    terrain/cooperative_planner.cpp \
+    terrain/density_grid.cpp \
     terrain/ray_rasterize.cpp \
     terrain/ray_rasterize_4_way.cpp \
     charanim_init.cpp \
     utils/utils.cpp \
+    utils/bitmask.cpp \
+    utils/mapped_file.cpp \
+    utils/file_watcher.cpp \
     sim_000.cpp \
+    sim_001.cpp \
+    sim_002.cpp \
+    sim_003.cpp \
+    sim_004.cpp \
+    sim_005.cpp \
     sim_100.cpp \
     sim_101.cpp \
     sim_102.cpp \
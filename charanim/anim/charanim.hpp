@@ -37,6 +37,8 @@
 #include <render/shader/shader.hpp>
 #include <render/character/rendered_character.hpp>
 #include <anim/terrain/regular_grid.hpp>
+#include <anim/terrain/navmesh.hpp>
+#include <anim/terrain/medial_axis.hpp>
 #include <anim/utils/utils.hpp>
 #include <anim/definitions.hpp>
 
@@ -134,5 +136,7 @@ namespace charanim {
 
 	/* render non-GLUT */
 	void render_regular_grid(const regular_grid *r);
+	void render_navmesh(const navmesh *n);
+	void render_medial_axis(const medial_axis *m);
 
 } // -- namespace charanim
@@ -456,6 +456,65 @@ namespace charanim {
 		}
 	}
 
+	void render_navmesh(const navmesh *n) {
+		const vector<vec2>& verts = n->get_vertices();
+		const vector<navmesh::triangle>& tris = n->get_triangles();
+
+		const float dX = n->get_dimX();
+		const float dY = n->get_dimY();
+
+		glColor3f(0.2f,0.2f,0.2f);
+		glBegin(GL_QUADS);
+			glVertex3f(0.0f, 0.0f, 0.0f);
+			glVertex3f(dX, 0.0f, 0.0f);
+			glVertex3f(dX, 0.0f, dY);
+			glVertex3f(0.0f, 0.0f, dY);
+		glEnd();
+
+		if (render_grid) {
+			// edges of the triangulation: constrained
+			// edges in red, the others in grey
+			glBegin(GL_LINES);
+			for (const navmesh::triangle& t : tris) {
+				for (int e = 0; e < 3; ++e) {
+					const vec2& p = verts[t.v[e]];
+					const vec2& q = verts[t.v[(e + 1)%3]];
+					if (t.constrained[e]) {
+						glColor3f(1.0f, 0.0f, 0.0f);
+					}
+					else {
+						glColor3f(0.7f, 0.7f, 0.7f);
+					}
+					glVertex3f(p.x, 0.2f, p.y);
+					glVertex3f(q.x, 0.2f, q.y);
+				}
+			}
+			glEnd();
+		}
+	}
+
+	void render_medial_axis(const medial_axis *m) {
+		const vector<size_t>& nodes = m->get_nodes();
+		const vector<medial_axis::edge>& edges = m->get_edges();
+
+		// chains of cells of the skeleton
+		glColor3f(1.0f, 0.0f, 1.0f);
+		glBegin(GL_LINES);
+		for (const medial_axis::edge& e : edges) {
+			vec2 p = m->get_cell_centre(nodes[e.from]);
+			for (size_t c : e.cells) {
+				vec2 q = m->get_cell_centre(c);
+				glVertex3f(p.x, 0.3f, p.y);
+				glVertex3f(q.x, 0.3f, q.y);
+				p = q;
+			}
+			vec2 q = m->get_cell_centre(nodes[e.to]);
+			glVertex3f(p.x, 0.3f, p.y);
+			glVertex3f(q.x, 0.3f, q.y);
+		}
+		glEnd();
+	}
+
 	/* Write a png file */
 	void write_png(const string& name, unsigned char *data, uint w, uint h) {
 		FILE *fp;
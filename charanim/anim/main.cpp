@@ -30,6 +30,11 @@ namespace charanim {
 namespace study_cases {
 
 	void sim_000(int argc, char *argv[]);
+	void sim_001(int argc, char *argv[]);
+	void sim_002(int argc, char *argv[]);
+	void sim_003(int argc, char *argv[]);
+	void sim_004(int argc, char *argv[]);
+	void sim_005(int argc, char *argv[]);
 
 	void sim_100(int argc, char *argv[]);
 	void sim_101(int argc, char *argv[]);
@@ -51,6 +56,16 @@ void list_all_cases() {
 	cout << endl;
 	cout << "    * 000 : visualise any map passed as parameter." << endl;
 	cout << "            Find a path in this map." << endl;
+	cout << "    * 001 : benchmark of the path finders on any map passed as parameter."
+		<< endl;
+	cout << "    * 002 : conversion of the map passed as parameter to binary format."
+		<< endl;
+	cout << "    * 003 : streaming of a region map around moving agents."
+		<< endl;
+	cout << "    * 004 : procedural generation of maps for benchmarking."
+		<< endl;
+	cout << "    * 005 : crowds avoiding congestion with a density cost."
+		<< endl;
 	cout << "    * 100 : validation of seek steering behaviour." << endl;
 	cout << "    * 101 : validation of flee steering behaviour." << endl;
 	cout << "    * 102 : validation of arrival steering behaviour." << endl;
@@ -87,6 +102,21 @@ int main(int argc, char *argv[]) {
 	if (strcmp(argv[1], "000") == 0) {
 		charanim::study_cases::sim_000(argc, argv);
 	}
+	else if (strcmp(argv[1], "001") == 0) {
+		charanim::study_cases::sim_001(argc, argv);
+	}
+	else if (strcmp(argv[1], "002") == 0) {
+		charanim::study_cases::sim_002(argc, argv);
+	}
+	else if (strcmp(argv[1], "003") == 0) {
+		charanim::study_cases::sim_003(argc, argv);
+	}
+	else if (strcmp(argv[1], "004") == 0) {
+		charanim::study_cases::sim_004(argc, argv);
+	}
+	else if (strcmp(argv[1], "005") == 0) {
+		charanim::study_cases::sim_005(argc, argv);
+	}
 	else if (strcmp(argv[1], "100") == 0) {
 		charanim::study_cases::sim_100(argc, argv);
 	}
@@ -23,6 +23,7 @@
 
 // C includes
 #include <string.h>
+#include <stdlib.h>
 
 // C++ includes
 #include <iostream>
@@ -70,6 +71,8 @@ namespace study_cases {
 	static vector<vec2> sim_000_astar_path;
 	// grid's smoothed path (the one supposed to be followed)
 	static vector<vec2> sim_000_smoothed_path;
+	// reload the map file when it is modified
+	static bool sim_000_watch = false;
 
 	// render stuff
 	static bool sim_000_render_circles = false;
@@ -81,6 +84,16 @@ namespace study_cases {
 		cout << "Specify a map file as parameter to visualise it." << endl;
 		cout << "    --help : show the usage." << endl;
 		cout << "    --map f: specify map file." << endl;
+		cout << "    --policy p: search policy of the regular grid, one of:" << endl;
+		cout << "        clearance: heuristic with clearance, no bound (default)." << endl;
+		cout << "        weighted: weighted A*." << endl;
+		cout << "        focal: focal search preferring clearance." << endl;
+		cout << "    --epsilon e: suboptimality factor of the weighted and" << endl;
+		cout << "        focal searches: paths cost at most e times the" << endl;
+		cout << "        optimum (default: 1.5)." << endl;
+		cout << "    --watch: reload the map file every time it is saved." << endl;
+		cout << "        Only the segments that changed are applied to the" << endl;
+		cout << "        grid, and the path is removed if it crosses them." << endl;
 		cout << endl;
 		cout << "Keyboard keys:" << endl;
 		cout << "    h: show the usage." << endl;
@@ -174,7 +187,17 @@ namespace study_cases {
 
 		// render path finder (on the xy plane)
 		const regular_grid *rg = sim_000_T.get_regular_grid();
-		render_regular_grid(rg);
+		if (rg != nullptr) {
+			render_regular_grid(rg);
+		}
+		const navmesh *nm = sim_000_T.get_navmesh();
+		if (nm != nullptr) {
+			render_navmesh(nm);
+		}
+		const medial_axis *ma = sim_000_T.get_medial_axis();
+		if (ma != nullptr) {
+			render_medial_axis(ma);
+		}
 
 		if (sim_000_astar_path.size() > 1) {
 			sim_000_render_a_path
@@ -195,23 +218,6 @@ namespace study_cases {
 		}
 	}
 
-	void sim_000_timed_refresh(int v) {
-		sim_000_render();
-
-		++fps_count;
-		timing::time_point here = timing::now();
-		double elapsed = timing::elapsed_seconds(sec, here);
-		if (elapsed >= 1.0) {
-			if (display_fps) {
-				cout << "fps= " << fps_count << " (" << FPS << ")" << endl;
-			}
-			fps_count = 0;
-			sec = timing::now();
-		}
-
-		glutTimerFunc(1000/FPS, sim_000_timed_refresh, v);
-	}
-
 	void sim_000_init_geometry() {
 		// add the geometry read from the map
 
@@ -236,8 +242,65 @@ namespace study_cases {
 		}
 	}
 
+	void sim_000_reload_map() {
+		bitmask changed;
+		timing::time_point begin = timing::now();
+		if (not sim_000_T.reload_map(changed)) {
+			cerr << "Error: the map could not be reloaded" << endl;
+			return;
+		}
+		timing::time_point end = timing::now();
+
+		size_t n_changed = 0;
+		for (size_t y = 0; y < changed.get_height(); ++y) {
+			for (size_t x = 0; x < changed.get_width(); ++x) {
+				n_changed += changed.get(x, y);
+			}
+		}
+		cout << "Map reloaded in " << timing::elapsed_milliseconds(begin, end)
+			 << " ms (" << n_changed << " cells changed)" << endl;
+
+		if (sim_000_T.path_touches(sim_000_astar_path, sim_000_R, changed) or
+			sim_000_T.path_touches(sim_000_smoothed_path, sim_000_R, changed))
+		{
+			cout << "The path crosses the changes: removed" << endl;
+			sim_000_astar_path.clear();
+			sim_000_smoothed_path.clear();
+		}
+
+		// the walls of the map
+		for (rgeom *r : geometry) {
+			r->clear();
+			delete r;
+		}
+		geometry.clear();
+		sim_000_init_geometry();
+	}
+
+	void sim_000_timed_refresh(int v) {
+		if (sim_000_watch and sim_000_T.map_modified()) {
+			sim_000_reload_map();
+		}
+		sim_000_render();
+
+		++fps_count;
+		timing::time_point here = timing::now();
+		double elapsed = timing::elapsed_seconds(sec, here);
+		if (elapsed >= 1.0) {
+			if (display_fps) {
+				cout << "fps= " << fps_count << " (" << FPS << ")" << endl;
+			}
+			fps_count = 0;
+			sec = timing::now();
+		}
+
+		glutTimerFunc(1000/FPS, sim_000_timed_refresh, v);
+	}
+
 	int sim_000_parse_arguments(int argc, char *argv[]) {
 		string map_file = "none";
+		string policy_name = "clearance";
+		float epsilon = 1.5f;
 
 		for (int i = 1; i < argc; ++i) {
 			if (parsing::is_help(argv[i])) {
@@ -248,6 +311,17 @@ namespace study_cases {
 				map_file = string(argv[i + 1]);
 				++i;
 			}
+			else if (strcmp(argv[i], "--policy") == 0) {
+				policy_name = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--epsilon") == 0) {
+				epsilon = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--watch") == 0) {
+				sim_000_watch = true;
+			}
 		}
 
 		if (map_file == "none") {
@@ -261,6 +335,21 @@ namespace study_cases {
 		if (not r) {
 			return 1;
 		}
+		cout << "Number of segments: " << sim_000_T.get_segments().size()
+			 << " (" << sim_000_T.get_n_removed_segments()
+			 << " removed by the simplification)" << endl;
+
+		search_policy policy;
+		if (not search_policy::from_name(policy_name, epsilon, policy)) {
+			cerr << "Error: invalid search policy '" << policy_name << "'" << endl;
+			return 1;
+		}
+		if (sim_000_T.get_regular_grid() != nullptr) {
+			sim_000_T.get_regular_grid()->set_search_policy(policy);
+		}
+		if (sim_000_watch and not sim_000_T.watch_map()) {
+			return 1;
+		}
 		return 0;
 	}
 
@@ -352,12 +441,23 @@ namespace study_cases {
 		vec2 A, B;
 		input_2_points(A,B);
 
-		segment s(A,B);
 		regular_grid *rg = sim_000_T.get_regular_grid();
+		if (rg == nullptr) {
+			cerr << "Error: segments can only be added to a regular grid" << endl;
+			return;
+		}
+
+		segment s(A,B);
 		rg->rasterise_segment(s);
 		rg->expand_function_distance(s);
 		rg->make_final_state();
 
+		// the skeleton depends on the distance function
+		medial_axis *ma = sim_000_T.get_medial_axis();
+		if (ma != nullptr) {
+			ma->init(rg);
+		}
+
 		rplane *pl = new rplane();
 
 		glm_vec3 p1( A.x, 0.0f,  A.y);
@@ -384,9 +484,8 @@ namespace study_cases {
 
 		sim_000_astar_path.clear();
 		sim_000_smoothed_path.clear();
-		regular_grid *rg = sim_000_T.get_regular_grid();
 		timing::time_point begin = timing::now();
-		rg->find_path(
+		sim_000_T.find_path(
 			start, goal, sim_000_R,
 			sim_000_astar_path, sim_000_smoothed_path
 		);
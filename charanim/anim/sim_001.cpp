@@ -0,0 +1,954 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+// C includes
+#include <string.h>
+#include <stdlib.h>
+
+// C++ includes
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <set>
+#include <vector>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+// charanim includes
+#include <anim/terrain/cooperative_planner.hpp>
+#include <anim/terrain/ray_rasterize_4_way.hpp>
+#include <anim/terrain/map_generator.hpp>
+#include <anim/terrain/visibility_cache.hpp>
+#include <anim/terrain/grid_traversal.hpp>
+#include <anim/terrain/terrain.hpp>
+#include <anim/utils/utils.hpp>
+
+namespace charanim {
+namespace study_cases {
+
+	// Terrain of the benchmark. Loaded from file or generated.
+	static terrain sim_001_T;
+
+	// radius of the hypothetic agent
+	static float sim_001_R = 1.0f;
+	// number of queries
+	static size_t sim_001_queries = 100;
+	// seed of the random number generator
+	static size_t sim_001_seed = 0;
+	// number of goals in the multi-goal queries
+	static size_t sim_001_goals = 8;
+	// number of levels of the clearance pyramid
+	static size_t sim_001_levels = 2;
+	// search policy of the regular grid
+	static search_policy sim_001_policy;
+	// connectivity of the cells of the regular grid
+	static int sim_001_connectivity = 8;
+	// number of threads of the parallel search
+	static size_t sim_001_threads = 8;
+	// number of rays of the raycast benchmark
+	static size_t sim_001_rays = 10000;
+	// number of agents of the cooperative path finding
+	static size_t sim_001_agents = 200;
+	// window of the cooperative path finding
+	static size_t sim_001_window = 16;
+	// distance in cells between the samples of the visibility cache
+	static size_t sim_001_visibility = 0;
+	// maximum distance between visible samples
+	static float sim_001_visibility_dist = numeric_limits<float>::max();
+	// file of the visibility cache
+	static string sim_001_visibility_file = "none";
+
+	void sim_001_usage() {
+		cout << "Simulation 001: benchmark of path finders" << endl;
+		cout << endl;
+		cout << "Finds paths between random pairs of points of a map with" << endl;
+		cout << "every path finder, and reports the time spent in building" << endl;
+		cout << "the path finders and in finding the paths. No window is opened." << endl;
+		cout << endl;
+		cout << "Parameters:" << endl;
+		cout << "    --help : show the usage." << endl;
+		cout << "    --map f: specify map file." << endl;
+		cout << "    --generate k: generate the map instead of reading it" << endl;
+		cout << "        (see simulation 004). k is one of:" << endl;
+		cout << "        maze, rooms, clutter, warehouse" << endl;
+		cout << "        The seed of the map is the one given in --seed." << endl;
+		cout << "    --resolution n: the generated map has n x n cells," << endl;
+		cout << "        each of size 1 (default: 512)." << endl;
+		cout << "    --segments m: the generated map has about m segments" << endl;
+		cout << "        (default: 1000)." << endl;
+		cout << "    --policy p: search policy of the regular grid, one of:" << endl;
+		cout << "        clearance: heuristic with clearance, no bound (default)." << endl;
+		cout << "        weighted: weighted A*." << endl;
+		cout << "        focal: focal search preferring clearance." << endl;
+		cout << "    --epsilon e: suboptimality factor of the weighted and" << endl;
+		cout << "        focal searches: paths cost at most e times the" << endl;
+		cout << "        optimum (default: 1.5)." << endl;
+		cout << "    --queries n: number of queries (default: 100)." << endl;
+		cout << "    --radius R: radius of the agent (default: 1)." << endl;
+		cout << "    --seed s: seed of the random generator (default: 0)." << endl;
+		cout << "    --goals n: number of goals of the multi-goal queries" << endl;
+		cout << "        (default: 8)." << endl;
+		cout << "    --levels n: number of levels of the clearance pyramid" << endl;
+		cout << "        of the regular grid (default: 2)." << endl;
+		cout << "    --connectivity c: connectivity of the cells of the" << endl;
+		cout << "        regular grid, 4 or 8 (default: 8)." << endl;
+		cout << "    --threads n: number of threads of the parallel weighted" << endl;
+		cout << "        A* search of the regular grid (default: 8)." << endl;
+		cout << "    --rays n: number of rays of the raycast, ray traversal" << endl;
+		cout << "        and feeler benchmarks." << endl;
+		cout << "        Use 0 to skip them (default: 10000)." << endl;
+		cout << "    --agents n: number of agents of the cooperative path" << endl;
+		cout << "        finding. Use 0 to skip it (default: 200)." << endl;
+		cout << "    --window w: number of steps of the plans of the" << endl;
+		cout << "        cooperative path finding (default: 16)." << endl;
+		cout << "    --visibility k: build a visibility cache with a sample" << endl;
+		cout << "        every k cells. Use 0 to skip it (default: 0)." << endl;
+		cout << "    --visibility-dist d: maximum distance between visible" << endl;
+		cout << "        samples of the cache (default: no maximum)." << endl;
+		cout << "    --visibility-file f: read the visibility cache from f," << endl;
+		cout << "        or build it and write it into f if it can't be read." << endl;
+		cout << endl;
+		cout << "The map must contain a 'resolution' line so that the" << endl;
+		cout << "regular grid can be built." << endl;
+		cout << endl;
+	}
+
+	int sim_001_parse_arguments(int argc, char *argv[]) {
+		string map_file = "none";
+		string map_kind = "none";
+		size_t resolution = 512;
+		size_t segments = 1000;
+		string policy_name = "clearance";
+		float epsilon = 1.5f;
+
+		for (int i = 1; i < argc; ++i) {
+			if (parsing::is_help(argv[i])) {
+				sim_001_usage();
+				return 2;
+			}
+			else if (strcmp(argv[i], "--map") == 0) {
+				map_file = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--generate") == 0) {
+				map_kind = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--resolution") == 0) {
+				resolution = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--segments") == 0) {
+				segments = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--policy") == 0) {
+				policy_name = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--epsilon") == 0) {
+				epsilon = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--queries") == 0) {
+				sim_001_queries = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--radius") == 0) {
+				sim_001_R = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--seed") == 0) {
+				sim_001_seed = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--goals") == 0) {
+				sim_001_goals = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--levels") == 0) {
+				sim_001_levels = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--connectivity") == 0) {
+				sim_001_connectivity = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--threads") == 0) {
+				sim_001_threads = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--rays") == 0) {
+				sim_001_rays = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--agents") == 0) {
+				sim_001_agents = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--window") == 0) {
+				sim_001_window = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--visibility") == 0) {
+				sim_001_visibility = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--visibility-dist") == 0) {
+				sim_001_visibility_dist = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--visibility-file") == 0) {
+				sim_001_visibility_file = string(argv[i + 1]);
+				++i;
+			}
+		}
+
+		if (map_file == "none" and map_kind == "none") {
+			cerr << "Error: no map file specified. Use" << endl;
+			cerr << "    ./anim 001 --help" << endl;
+			cerr << "to see the usage" << endl;
+			return 1;
+		}
+		if (not search_policy::from_name(policy_name, epsilon, sim_001_policy)) {
+			cerr << "Error: invalid search policy '" << policy_name << "'" << endl;
+			return 1;
+		}
+
+		if (map_kind != "none") {
+			const float d = static_cast<float>(resolution);
+			vector<segment> segs;
+			timing::time_point begin = timing::now();
+			bool g = map_generator::generate
+				(map_kind, d, d, segments, sim_001_seed, segs);
+			timing::time_point end = timing::now();
+			if (not g) {
+				cerr << "Error: invalid kind of map '" << map_kind << "'" << endl;
+				return 1;
+			}
+			// no path finder is built yet: all are built in the benchmark
+			sim_001_T.init
+				(path_finder_type::none, resolution, resolution, d, d, segs);
+			cout << "Map generated in: " << timing::elapsed_milliseconds(begin, end)
+				 << " ms" << endl;
+			return 0;
+		}
+
+		timing::time_point begin = timing::now();
+		bool r = sim_001_T.read_map(map_file);
+		timing::time_point end = timing::now();
+		if (not r) {
+			return 1;
+		}
+		cout << "Map read in: " << timing::elapsed_milliseconds(begin, end)
+			 << " ms (includes building its path finder)" << endl;
+		return 0;
+	}
+
+	static inline
+	float sim_001_path_length(const vector<vec2>& path) {
+		float l = 0.0f;
+		for (size_t i = 1; i < path.size(); ++i) {
+			l += physim::math::dist(path[i - 1], path[i]);
+		}
+		return l;
+	}
+
+	// make random pairs of points far enough from the obstacles
+	void sim_001_make_queries(size_t n, vector<pair<vec2,vec2> >& queries) {
+		const regular_grid *rg = sim_001_T.get_regular_grid();
+		const float dX = sim_001_T.get_dimX();
+		const float dY = sim_001_T.get_dimY();
+
+		mt19937 gen(sim_001_seed);
+		uniform_real_distribution<float> UX(1.0f, dX - 2.0f);
+		uniform_real_distribution<float> UY(1.0f, dY - 2.0f);
+
+		auto is_free =
+		[&](const vec2& p) {
+			size_t cx = static_cast<size_t>(p.x/(dX/rg->get_resX()));
+			size_t cy = static_cast<size_t>(p.y/(dY/rg->get_resY()));
+			return rg->get_grid()[cy*rg->get_resX() + cx] > sim_001_R;
+		};
+
+		while (queries.size() < n) {
+			vec2 s(UX(gen), UY(gen));
+			vec2 t(UX(gen), UY(gen));
+			if (is_free(s) and is_free(t)) {
+				queries.push_back(make_pair(s,t));
+			}
+		}
+	}
+
+	bool sim_001_build(path_finder_type type, const string& name) {
+		if (sim_001_T.get_path_finder_type() == type) {
+			// built when reading the map
+			return true;
+		}
+		timing::time_point begin = timing::now();
+		bool built = sim_001_T.make_path_finder(type);
+		timing::time_point end = timing::now();
+		if (built) {
+			cout << name << " built in: "
+				 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		}
+		return built;
+	}
+
+	void sim_001_run_queries
+	(path_finder_type type, const string& name,
+	 const vector<pair<vec2,vec2> >& queries)
+	{
+		sim_001_T.set_path_finder_type(type);
+		cout << name << ":" << endl;
+
+		timing::time_point begin, end;
+		double total_time = 0.0;
+		double total_length = 0.0;
+		size_t found = 0;
+		vector<vec2> path, smoothed_path;
+		for (const pair<vec2,vec2>& q : queries) {
+			path.clear();
+			smoothed_path.clear();
+
+			begin = timing::now();
+			sim_001_T.find_path(q.first, q.second, sim_001_R, path, smoothed_path);
+			end = timing::now();
+
+			total_time += timing::elapsed_milliseconds(begin, end);
+			if (smoothed_path.size() > 0) {
+				total_length += sim_001_path_length(smoothed_path);
+				++found;
+			}
+		}
+
+		cout << "    paths found: " << found << "/" << queries.size() << endl;
+		cout << "    average query time: "
+			 << total_time/queries.size() << " ms" << endl;
+		if (found > 0) {
+			cout << "    average path length: " << total_length/found << endl;
+		}
+	}
+
+	// Compares the multi-goal queries of the regular grid against
+	// one query per goal. The queries are split into groups of
+	// 'sim_001_goals' queries: the first point of the first query
+	// is the source, the second points are the goals.
+	void sim_001_run_multi_goal_queries(const vector<pair<vec2,vec2> >& queries) {
+		const regular_grid *rg = sim_001_T.get_regular_grid();
+		const size_t n_groups = queries.size()/sim_001_goals;
+		if (n_groups == 0) {
+			return;
+		}
+
+		timing::time_point begin, end;
+		double separate_time = 0.0;
+		double single_time = 0.0;
+		double reverse_time = 0.0;
+		size_t same_goal = 0;
+
+		vector<vec2> path, smoothed_path;
+		vector<vector<vec2> > paths, smoothed_paths;
+		for (size_t g = 0; g < n_groups; ++g) {
+			const vec2& source = queries[g*sim_001_goals].first;
+			vector<vec2> goals;
+			for (size_t i = 0; i < sim_001_goals; ++i) {
+				goals.push_back(queries[g*sim_001_goals + i].second);
+			}
+
+			// one query per goal, keep the shortest path
+			int best_goal = -1;
+			size_t best_size = 0;
+			begin = timing::now();
+			for (size_t i = 0; i < goals.size(); ++i) {
+				path.clear();
+				smoothed_path.clear();
+				rg->find_path(source, goals[i], sim_001_R, path, smoothed_path);
+				if (path.size() > 0 and (best_goal == -1 or path.size() < best_size)) {
+					best_goal = static_cast<int>(i);
+					best_size = path.size();
+				}
+			}
+			end = timing::now();
+			separate_time += timing::elapsed_milliseconds(begin, end);
+
+			// a single query
+			path.clear();
+			smoothed_path.clear();
+			begin = timing::now();
+			int reached = rg->find_path_to_any
+			(source, goals, sim_001_R, path, smoothed_path);
+			end = timing::now();
+			single_time += timing::elapsed_milliseconds(begin, end);
+			same_goal += (reached == best_goal);
+
+			// many sources to one goal
+			begin = timing::now();
+			rg->find_paths_from_any
+			(goals, source, sim_001_R, paths, smoothed_paths);
+			end = timing::now();
+			reverse_time += timing::elapsed_milliseconds(begin, end);
+		}
+
+		cout << "Regular grid, nearest of " << sim_001_goals << " goals:" << endl;
+		cout << "    queries: " << n_groups << endl;
+		cout << "    average time (one query per goal): "
+			 << separate_time/n_groups << " ms" << endl;
+		cout << "    average time (single query): "
+			 << single_time/n_groups << " ms" << endl;
+		cout << "    average time (single query, " << sim_001_goals
+			 << " sources to one goal): " << reverse_time/n_groups << " ms" << endl;
+		cout << "    same goal chosen: " << same_goal << "/" << n_groups << endl;
+	}
+
+	// Distance travelled by a ray that steps through every cell with
+	// the 4-way traversal until it finds a cell closer than R to an
+	// obstacle. Used as a reference for the sphere-traced raycasts.
+	float sim_001_step_ray
+	(const regular_grid *rg, const vec2& o, const vec2& d, float max_len, float R)
+	{
+		const float dX = rg->get_dimX();
+		const float dY = rg->get_dimY();
+		const float lX = dX/rg->get_resX();
+		const float lY = dY/rg->get_resY();
+
+		// the ray ends at max_len or where it leaves the grid
+		float len = max_len;
+		if (d.x > 0.0f) { len = std::min(len, (dX - o.x)/d.x); }
+		if (d.x < 0.0f) { len = std::min(len, -o.x/d.x); }
+		if (d.y > 0.0f) { len = std::min(len, (dY - o.y)/d.y); }
+		if (d.y < 0.0f) { len = std::min(len, -o.y/d.y); }
+		const vec2 e = o + d*std::max(0.0f, 0.999f*len);
+
+		float hit = len;
+		const size_t rX = rg->get_resX();
+		const size_t rY = rg->get_resY();
+		grid_traversal::for_each_cell(
+			latticePoint(o.x/lX, o.y/lY), latticePoint(e.x/lX, e.y/lY),
+			[&](int x, int y) -> bool {
+				if (x < 0 or y < 0 or x >= int(rX) or y >= int(rY)) {
+					return false;
+				}
+				if (rg->get_grid()[y*rX + x] <= R) {
+					const vec2 centre(lX*x + lX/2.0f, lY*y + lY/2.0f);
+					hit = std::min(max_len, physim::math::dist(o, centre));
+					return false;
+				}
+				return true;
+			}
+		);
+		return hit;
+	}
+
+	// Compares sphere-traced raycasts against stepping through the
+	// cells, on rays from random points in random directions.
+	void sim_001_run_raycasts() {
+		const regular_grid *rg = sim_001_T.get_regular_grid();
+		const float max_len = std::max(rg->get_dimX(), rg->get_dimY());
+
+		vector<pair<vec2,vec2> > points;
+		sim_001_make_queries(sim_001_rays, points);
+		vector<vec2> origins, dirs;
+		for (const pair<vec2,vec2>& p : points) {
+			const float L = physim::math::dist(p.first, p.second);
+			if (L > 0.0f) {
+				origins.push_back(p.first);
+				dirs.push_back((p.second - p.first)*(1.0f/L));
+			}
+		}
+		const size_t n = origins.size();
+
+		timing::time_point begin, end;
+		vector<float> stepped(n), traced(n), batched;
+
+		begin = timing::now();
+		for (size_t i = 0; i < n; ++i) {
+			stepped[i] = sim_001_step_ray(rg, origins[i], dirs[i], max_len, sim_001_R);
+		}
+		end = timing::now();
+		const double step_time = timing::elapsed_milliseconds(begin, end);
+
+		begin = timing::now();
+		for (size_t i = 0; i < n; ++i) {
+			traced[i] = rg->raycast(origins[i], dirs[i], max_len, sim_001_R);
+		}
+		end = timing::now();
+		const double trace_time = timing::elapsed_milliseconds(begin, end);
+
+		begin = timing::now();
+		rg->raycast(origins, dirs, max_len, sim_001_R, batched);
+		end = timing::now();
+		const double batch_time = timing::elapsed_milliseconds(begin, end);
+
+		double length = 0.0;
+		double difference = 0.0;
+		for (size_t i = 0; i < n; ++i) {
+			length += stepped[i];
+			difference += std::abs(stepped[i] - traced[i]);
+		}
+
+		cout << "Raycasts (" << n << " rays):" << endl;
+		cout << "    average hit distance: " << length/n << endl;
+		cout << "    average difference between methods: " << difference/n << endl;
+		cout << "    cell stepping: " << step_time << " ms ("
+			 << n/(step_time/1000.0) << " rays/s)" << endl;
+		cout << "    sphere tracing: " << trace_time << " ms ("
+			 << n/(trace_time/1000.0) << " rays/s)" << endl;
+		cout << "    sphere tracing (batched): " << batch_time << " ms ("
+			 << n/(batch_time/1000.0) << " rays/s)" << endl;
+	}
+
+	// Feelers of agents: rays cast against the segments of the map
+	// (not the grid). Every segment against every ray, and the
+	// batches of rays against the segments of the spatial index.
+	void sim_001_run_feelers() {
+		const spatial_index& si = sim_001_T.get_spatial_index();
+		const vector<segment>& sgs = si.get_segments();
+		const size_t feelers = 16;
+		const float length = 10.0f;
+
+		vector<pair<vec2,vec2> > points;
+		sim_001_make_queries(sim_001_rays/feelers, points);
+		ray_batch rays;
+		for (size_t i = 0; i < points.size(); ++i) {
+			rays.add_fan(points[i].first, 0.1f*i, feelers, length);
+		}
+		const size_t n = rays.size();
+
+		timing::time_point begin, end;
+
+		// every ray against every segment
+		vector<float> all_dist(n);
+		vector<int32_t> all_seg(n, -1);
+		begin = timing::now();
+		for (size_t r = 0; r < n; ++r) {
+			all_dist[r] = rays.max_len[r];
+			for (size_t i = 0; i < sgs.size(); ++i) {
+				const float ax = sgs[i].first.x;
+				const float ay = sgs[i].first.y;
+				const float ex = sgs[i].second.x - ax;
+				const float ey = sgs[i].second.y - ay;
+				const float denom = rays.dx[r]*ey - rays.dy[r]*ex;
+				const float wx = ax - rays.ox[r];
+				const float wy = ay - rays.oy[r];
+				const float t = (wx*ey - wy*ex)/denom;
+				const float s = (wx*rays.dy[r] - wy*rays.dx[r])/denom;
+				if (t >= 0.0f and t < all_dist[r] and s >= 0.0f and s <= 1.0f) {
+					all_dist[r] = t;
+					all_seg[r] = static_cast<int32_t>(i);
+				}
+			}
+		}
+		end = timing::now();
+		const double all_time = timing::elapsed_milliseconds(begin, end);
+
+		begin = timing::now();
+		si.raycast(rays, false);
+		end = timing::now();
+		const double scalar_time = timing::elapsed_milliseconds(begin, end);
+		vector<int32_t> scalar_seg = rays.hit_segment;
+
+		begin = timing::now();
+		si.raycast(rays, true);
+		end = timing::now();
+		const double simd_time = timing::elapsed_milliseconds(begin, end);
+
+		size_t hits = 0;
+		size_t different = 0;
+		for (size_t r = 0; r < n; ++r) {
+			hits += (rays.hit_segment[r] != -1);
+			different +=
+				(rays.hit_segment[r] != all_seg[r] or
+				 scalar_seg[r] != all_seg[r] or
+				 rays.hit_dist[r] != all_dist[r]);
+		}
+
+		cout << "Feelers (" << points.size() << " agents, " << feelers
+			 << " rays of length " << length << " each):" << endl;
+		cout << "    rays that hit a segment: " << hits << endl;
+		cout << "    rays with different results: " << different << endl;
+		cout << "    all segments: " << all_time << " ms ("
+			 << n/(all_time/1000.0) << " rays/s)" << endl;
+		cout << "    spatial index: " << scalar_time << " ms ("
+			 << n/(scalar_time/1000.0) << " rays/s)" << endl;
+		cout << "    spatial index (SIMD): " << simd_time << " ms ("
+			 << n/(simd_time/1000.0) << " rays/s)" << endl;
+	}
+
+	// Visibility between pairs of points: with the visibility cache
+	// and with a ray cast through the grid.
+	void sim_001_run_visibility() {
+		const regular_grid *rg = sim_001_T.get_regular_grid();
+		visibility_cache vc;
+		timing::time_point begin, end;
+
+		begin = timing::now();
+		bool read = sim_001_visibility_file != "none" and
+					vc.read(sim_001_visibility_file, rg) and
+					vc.get_stride() == sim_001_visibility and
+					vc.get_radius() == sim_001_R and
+					vc.get_max_dist() == sim_001_visibility_dist;
+		end = timing::now();
+		if (read) {
+			cout << "Visibility cache read in: "
+				 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		}
+		else {
+			begin = timing::now();
+			vc.init(rg, sim_001_visibility, sim_001_R, sim_001_visibility_dist);
+			end = timing::now();
+			cout << "Visibility cache built in: "
+				 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+			if (sim_001_visibility_file != "none") {
+				vc.write(sim_001_visibility_file);
+			}
+		}
+		cout << "    samples: " << vc.n_samples()
+			 << ", blocks: " << vc.get_n_blocks() << endl;
+		cout << "    bytes: " << vc.get_bytes()
+			 << " (" << vc.get_dense_bytes() << " without compression)" << endl;
+
+		// visible from a to b: a ray through the grid
+		const float lX = rg->get_dimX()/rg->get_resX();
+		const float lY = rg->get_dimY()/rg->get_resY();
+		auto cast =
+		[&](const vec2& a, const vec2& b) -> bool {
+			const float L = physim::math::dist(a, b);
+			if (L > sim_001_visibility_dist) {
+				return false;
+			}
+			if (L == 0.0f) {
+				size_t cx = static_cast<size_t>(a.x/lX);
+				size_t cy = static_cast<size_t>(a.y/lY);
+				return rg->get_grid()[cy*rg->get_resX() + cx] > sim_001_R;
+			}
+			return rg->raycast(a, (b - a)*(1.0f/L), L, sim_001_R) >= L;
+		};
+
+		vector<pair<vec2,vec2> > points;
+		sim_001_make_queries(sim_001_rays, points);
+		const size_t n = points.size();
+
+		// between samples: the cache must give the same answers
+		const size_t m = vc.n_samples();
+		mt19937 gen(sim_001_seed);
+		uniform_int_distribution<size_t> U(0, m - 1);
+		vector<pair<size_t,size_t> > pairs(n);
+		for (size_t i = 0; i < n; ++i) {
+			pairs[i] = make_pair(U(gen), U(gen));
+			if (pairs[i].first > pairs[i].second) {
+				swap(pairs[i].first, pairs[i].second);
+			}
+		}
+
+		size_t cast_visible = 0;
+		begin = timing::now();
+		for (const pair<size_t,size_t>& p : pairs) {
+			cast_visible += cast(vc.get_sample(p.first), vc.get_sample(p.second));
+		}
+		end = timing::now();
+		const double cast_time = timing::elapsed_milliseconds(begin, end);
+
+		size_t cache_visible = 0;
+		begin = timing::now();
+		for (const pair<size_t,size_t>& p : pairs) {
+			cache_visible += vc.visible(p.first, p.second);
+		}
+		end = timing::now();
+		const double cache_time = timing::elapsed_milliseconds(begin, end);
+
+		size_t different = 0;
+		for (const pair<size_t,size_t>& p : pairs) {
+			const vec2& a = vc.get_sample(p.first);
+			const vec2& b = vc.get_sample(p.second);
+			different += (cast(a, b) != vc.visible(p.first, p.second));
+		}
+
+		// between any two points: approximated with the samples
+		size_t wrong = 0;
+		for (const pair<vec2,vec2>& p : points) {
+			wrong += (cast(p.first, p.second) != vc.visible(p.first, p.second));
+		}
+
+		cout << "Visibility (" << n << " pairs):" << endl;
+		cout << "    between samples, visible: " << cast_visible
+			 << " (grid), " << cache_visible << " (cache)" << endl;
+		cout << "    between samples, different answers: " << different << endl;
+		cout << "    between points, different answers: " << wrong
+			 << " (" << 100.0*wrong/n << "%)" << endl;
+		cout << "    raycasts: " << cast_time << " ms ("
+			 << n/(cast_time/1000.0) << " queries/s)" << endl;
+		cout << "    cache: " << cache_time << " ms ("
+			 << n/(cache_time/1000.0) << " queries/s)" << endl;
+	}
+
+	// Number of cells per second visited by the traversals of the
+	// cells of a ray: through the virtual ray rasteriser, and through
+	// the templated functions.
+	void sim_001_run_traversals() {
+		const regular_grid *rg = sim_001_T.get_regular_grid();
+		const float lX = rg->get_dimX()/rg->get_resX();
+		const float lY = rg->get_dimY()/rg->get_resY();
+
+		vector<pair<vec2,vec2> > points;
+		sim_001_make_queries(sim_001_rays, points);
+		vector<pair<latticePoint,latticePoint> > rays;
+		for (const pair<vec2,vec2>& p : points) {
+			rays.push_back(make_pair(
+				latticePoint(p.first.x/lX, p.first.y/lY),
+				latticePoint(p.second.x/lX, p.second.y/lY)
+			));
+		}
+
+		timing::time_point begin, end;
+		// the sum of the coordinates keeps the loops from being removed
+		size_t checksum = 0;
+
+		size_t n_virtual = 0;
+		ray_rasterize *ray = new ray_rasterize_4_way();
+		latticePoint c;
+		begin = timing::now();
+		for (const pair<latticePoint,latticePoint>& r : rays) {
+			ray->init(r.first, r.second);
+			while (not ray->is_last()) {
+				ray->get_advance(c);
+				checksum += c.x() + c.y();
+				++n_virtual;
+			}
+		}
+		end = timing::now();
+		delete ray;
+		const double virtual_time = timing::elapsed_milliseconds(begin, end);
+
+		size_t n_4way = 0;
+		begin = timing::now();
+		for (const pair<latticePoint,latticePoint>& r : rays) {
+			grid_traversal::for_each_cell(r.first, r.second,
+				[&](int x, int y) { checksum += x + y; ++n_4way; }
+			);
+		}
+		end = timing::now();
+		const double template_time = timing::elapsed_milliseconds(begin, end);
+
+		size_t n_super = 0;
+		begin = timing::now();
+		for (const pair<latticePoint,latticePoint>& r : rays) {
+			grid_traversal::for_each_cell_supercover(r.first, r.second,
+				[&](int x, int y) { checksum += x + y; ++n_super; }
+			);
+		}
+		end = timing::now();
+		const double super_time = timing::elapsed_milliseconds(begin, end);
+
+		cout << "Ray traversals (" << rays.size() << " rays, checksum "
+			 << checksum << "):" << endl;
+		cout << "    virtual 4-way rasteriser: " << n_virtual << " cells in "
+			 << virtual_time << " ms (" << n_virtual/(virtual_time/1000.0)
+			 << " cells/s)" << endl;
+		cout << "    templated 4-way: " << n_4way << " cells in "
+			 << template_time << " ms (" << n_4way/(template_time/1000.0)
+			 << " cells/s)" << endl;
+		cout << "    templated supercover: " << n_super << " cells in "
+			 << super_time << " ms (" << n_super/(super_time/1000.0)
+			 << " cells/s)" << endl;
+	}
+
+	// Moves 'sim_001_agents' agents between random pairs of points
+	// with the cooperative planner, reserving their paths or not.
+	void sim_001_run_cooperative(bool cooperative) {
+		const regular_grid *rg = sim_001_T.get_regular_grid();
+		const float lX = sim_001_T.get_dimX()/rg->get_resX();
+		const float lY = sim_001_T.get_dimY()/rg->get_resY();
+
+		// agents start and end in different cells
+		auto cell =
+		[&](const vec2& p) -> size_t {
+			return static_cast<size_t>(p.y/lY)*rg->get_resX() +
+				   static_cast<size_t>(p.x/lX);
+		};
+		vector<pair<vec2,vec2> > points;
+		sim_001_make_queries(4*sim_001_agents, points);
+		set<size_t> starts, goals;
+
+		cooperative_planner P;
+		P.init(rg, sim_001_window);
+		P.set_cooperative(cooperative);
+		for (size_t i = 0; i < points.size() and P.n_agents() < sim_001_agents; ++i) {
+			const size_t s = cell(points[i].first);
+			const size_t g = cell(points[i].second);
+			if (starts.find(s) == starts.end() and goals.find(g) == goals.end()) {
+				starts.insert(s);
+				goals.insert(g);
+				P.add_agent(points[i].first, points[i].second, sim_001_R);
+			}
+		}
+
+		const size_t max_steps = 4*(rg->get_resX() + rg->get_resY());
+		timing::time_point begin, end;
+		double total_time = 0.0;
+		double max_time = 0.0;
+		size_t conflicts = 0;
+		size_t arrived = 0;
+		while (P.get_time() < max_steps and arrived < P.n_agents()) {
+			begin = timing::now();
+			P.step();
+			end = timing::now();
+
+			const double t = timing::elapsed_milliseconds(begin, end);
+			total_time += t;
+			max_time = std::max(max_time, t);
+			conflicts += P.n_conflicts();
+
+			arrived = 0;
+			for (size_t a = 0; a < P.n_agents(); ++a) {
+				arrived += P.has_arrived(a);
+			}
+		}
+
+		cout << "Cooperative path finding ("
+			 << (cooperative ? "reserving paths" : "independent paths")
+			 << ", window: " << sim_001_window << "):" << endl;
+		cout << "    agents: " << P.n_agents() << endl;
+		cout << "    steps: " << P.get_time() << endl;
+		cout << "    agents at their goal: " << arrived << "/" << P.n_agents() << endl;
+		cout << "    agents sharing a cell (sum over steps): " << conflicts << endl;
+		cout << "    average time per step: "
+			 << total_time/std::max(P.get_time(), size_t(1)) << " ms" << endl;
+		cout << "    maximum time per step: " << max_time << " ms" << endl;
+	}
+
+	void sim_001(int argc, char *argv[]) {
+		int r = sim_001_parse_arguments(argc, argv);
+		if (r != 0) {
+			if (r == 1) {
+				cerr << "Error in initialisation of simulation 001" << endl;
+			}
+			return;
+		}
+
+		cout << "Map dimensions: " << sim_001_T.get_dimX() << " x "
+			 << sim_001_T.get_dimY() << endl;
+		cout << "Number of segments: " << sim_001_T.get_segments().size()
+			 << " (" << sim_001_T.get_n_removed_segments()
+			 << " removed by the simplification)" << endl;
+		cout << "Radius: " << sim_001_R << endl;
+
+		// the queries are made with the regular grid
+		if (not sim_001_build(path_finder_type::regular_grid, "Regular grid")) {
+			return;
+		}
+		sim_001_T.get_regular_grid()->set_search_policy(sim_001_policy);
+		sim_001_T.get_regular_grid()->set_connectivity(sim_001_connectivity);
+		cout << "Search policy of the regular grid: bound on the path cost: "
+			 << sim_001_policy.get_bound() << endl;
+		sim_001_build(path_finder_type::navmesh, "Navigation mesh");
+		sim_001_build(path_finder_type::visibility_graph, "Visibility graph");
+		if (sim_001_build(path_finder_type::medial_axis, "Medial axis")) {
+			const medial_axis *ma = sim_001_T.get_medial_axis();
+			cout << "    nodes: " << ma->get_nodes().size()
+				 << ", edges: " << ma->get_edges().size() << endl;
+		}
+
+		vector<pair<vec2,vec2> > queries;
+		sim_001_make_queries(sim_001_queries, queries);
+		cout << "Queries: " << queries.size() << endl;
+
+		sim_001_run_queries(path_finder_type::regular_grid, "Regular grid", queries);
+
+		// the same queries with bit-packed neighbour tests
+		regular_grid *rg = sim_001_T.get_regular_grid();
+		timing::time_point begin = timing::now();
+		rg->make_traversability_mask(sim_001_R);
+		timing::time_point end = timing::now();
+		cout << "Traversability mask built in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms ("
+			 << rg->get_traversability_mask(sim_001_R)->get_bytes()
+			 << " bytes)" << endl;
+		sim_001_run_queries
+		(path_finder_type::regular_grid, "Regular grid (traversability mask)", queries);
+
+		// the same cells blocked, from the segments only
+		bitmask occupancy;
+		begin = timing::now();
+		rg->make_inflated_obstacles(sim_001_T.get_segments(), sim_001_R, occupancy);
+		end = timing::now();
+		const bitmask *mask = rg->get_traversability_mask(sim_001_R);
+		size_t blocked = 0;
+		size_t missed = 0;
+		for (size_t y = 0; y < rg->get_resY(); ++y) {
+			for (size_t x = 0; x < rg->get_resX(); ++x) {
+				blocked += occupancy.get(x, y);
+				missed += (not mask->get(x, y) and not occupancy.get(x, y));
+			}
+		}
+		cout << "Inflated obstacles built in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		cout << "    blocked cells: " << blocked << endl;
+		cout << "    non-traversable cells of the mask not blocked: "
+			 << missed << endl;
+		rg->clear_traversability_masks();
+
+		// the same queries from coarse to fine resolution
+		begin = timing::now();
+		rg->make_clearance_pyramid(sim_001_levels);
+		end = timing::now();
+		cout << "Clearance pyramid (" << sim_001_levels << " levels) built in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		sim_001_run_queries
+		(path_finder_type::regular_grid, "Regular grid (coarse to fine)", queries);
+		rg->clear_clearance_pyramid();
+
+		// the same queries with weighted A*, in one and in many threads
+		rg->set_search_policy(search_policy::weighted_astar(sim_001_policy.epsilon));
+		sim_001_run_queries
+		(path_finder_type::regular_grid, "Regular grid (weighted A*, 1 thread)", queries);
+		rg->set_search_threads(sim_001_threads);
+		sim_001_run_queries
+		(path_finder_type::regular_grid,
+		 "Regular grid (weighted A*, " + std::to_string(sim_001_threads) + " threads)",
+		 queries);
+		rg->set_search_threads(1);
+		rg->set_search_policy(sim_001_policy);
+		sim_001_run_queries(path_finder_type::navmesh, "Navigation mesh", queries);
+		sim_001_run_queries(path_finder_type::visibility_graph, "Visibility graph", queries);
+		sim_001_run_queries(path_finder_type::medial_axis, "Medial axis", queries);
+
+		sim_001_run_multi_goal_queries(queries);
+
+		if (sim_001_rays > 0) {
+			sim_001_run_raycasts();
+			sim_001_run_traversals();
+			sim_001_run_feelers();
+		}
+		if (sim_001_rays > 0 and sim_001_visibility > 0) {
+			sim_001_run_visibility();
+		}
+		if (sim_001_agents > 0) {
+			sim_001_run_cooperative(false);
+			sim_001_run_cooperative(true);
+		}
+	}
+
+} // -- namespace study_cases
+} // -- namespace charanim
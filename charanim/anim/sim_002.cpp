@@ -0,0 +1,196 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+// C includes
+#include <string.h>
+#include <stdlib.h>
+
+// C++ includes
+#include <iostream>
+#include <string>
+using namespace std;
+
+// charanim includes
+#include <anim/terrain/terrain.hpp>
+#include <anim/utils/utils.hpp>
+
+namespace charanim {
+namespace study_cases {
+
+	// file with the map in text format
+	static string sim_002_map_file = "none";
+	// file with the map in binary format
+	static string sim_002_out_file = "none";
+	// write the state of the regular grid
+	static bool sim_002_grid = false;
+	// number of cells of the side of the regions, 0 for a binary map
+	static size_t sim_002_regions = 0;
+
+	void sim_002_usage() {
+		cout << "Simulation 002: conversion of maps to the binary format" << endl;
+		cout << endl;
+		cout << "Reads a map in text format and writes it in binary format." << endl;
+		cout << "Then, reports the time spent in reading both files." << endl;
+		cout << "No window is opened." << endl;
+		cout << endl;
+		cout << "Parameters:" << endl;
+		cout << "    --help : show the usage." << endl;
+		cout << "    --map f: specify the map file, in text format." << endl;
+		cout << "    --out f: specify the output file." << endl;
+		cout << "    --grid: write the state of the regular grid in the" << endl;
+		cout << "        output file so that it is not built when reading it." << endl;
+		cout << "        The map must contain a 'resolution' line." << endl;
+		cout << "    --regions c: write a region map instead, with regions" << endl;
+		cout << "        of c x c cells, to be streamed (see simulation 003)." << endl;
+		cout << "        The map must contain a 'resolution' line." << endl;
+		cout << endl;
+	}
+
+	int sim_002_parse_arguments(int argc, char *argv[]) {
+		for (int i = 1; i < argc; ++i) {
+			if (parsing::is_help(argv[i])) {
+				sim_002_usage();
+				return 2;
+			}
+			else if (strcmp(argv[i], "--map") == 0) {
+				sim_002_map_file = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--out") == 0) {
+				sim_002_out_file = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--grid") == 0) {
+				sim_002_grid = true;
+			}
+			else if (strcmp(argv[i], "--regions") == 0) {
+				sim_002_regions = atoi(argv[i + 1]);
+				++i;
+			}
+		}
+
+		if (sim_002_map_file == "none" or sim_002_out_file == "none") {
+			cerr << "Error: no input or output file specified. Use" << endl;
+			cerr << "    ./anim 002 --help" << endl;
+			cerr << "to see the usage" << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// reads the map and reports the time spent
+	static inline
+	bool sim_002_read(terrain& T, const string& file, const string& name) {
+		timing::time_point begin = timing::now();
+		bool r = T.read_map(file);
+		timing::time_point end = timing::now();
+		if (not r) {
+			return false;
+		}
+		cout << name << " read in: "
+			 << timing::elapsed_milliseconds(begin, end)
+			 << " ms (includes building its path finder)" << endl;
+		return true;
+	}
+
+	// reads every cell of the regular grid and reports the time spent.
+	// The cells of a mapped grid are loaded from the file at this point.
+	static inline
+	float sim_002_touch(const terrain& T) {
+		const regular_grid *rg = T.get_regular_grid();
+		if (rg == nullptr) {
+			return 0.0f;
+		}
+		const size_t N = rg->get_resX()*rg->get_resY();
+		const float *cells = rg->get_grid();
+
+		timing::time_point begin = timing::now();
+		float s = 0.0f;
+		for (size_t i = 0; i < N; ++i) {
+			s += cells[i];
+		}
+		timing::time_point end = timing::now();
+		cout << "    all cells read in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		return s;
+	}
+
+	void sim_002(int argc, char *argv[]) {
+		int r = sim_002_parse_arguments(argc, argv);
+		if (r != 0) {
+			if (r == 1) {
+				cerr << "Error in initialisation of simulation 002" << endl;
+			}
+			return;
+		}
+
+		terrain text;
+		if (not sim_002_read(text, sim_002_map_file, "Text map")) {
+			return;
+		}
+		if (sim_002_grid and
+			not text.make_path_finder(path_finder_type::regular_grid))
+		{
+			return;
+		}
+		float text_sum = sim_002_touch(text);
+
+		if (sim_002_regions > 0) {
+			timing::time_point begin = timing::now();
+			bool w = text.write_region_map(sim_002_out_file, sim_002_regions);
+			timing::time_point end = timing::now();
+			if (w) {
+				cout << "Region map written in: "
+					 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+			}
+			return;
+		}
+
+		timing::time_point begin = timing::now();
+		bool w = text.write_binary_map(sim_002_out_file, sim_002_grid);
+		timing::time_point end = timing::now();
+		if (not w) {
+			return;
+		}
+		cout << "Binary map written in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		text.clear();
+
+		terrain binary;
+		if (not sim_002_read(binary, sim_002_out_file, "Binary map")) {
+			return;
+		}
+		if (sim_002_grid and
+			not binary.make_path_finder(path_finder_type::regular_grid))
+		{
+			return;
+		}
+		float binary_sum = sim_002_touch(binary);
+
+		cout << "Number of segments: " << binary.get_segments().size() << endl;
+		if (sim_002_grid) {
+			cout << "Cells are equal: "
+				 << (text_sum == binary_sum ? "yes" : "no") << endl;
+		}
+	}
+
+} // -- namespace study_cases
+} // -- namespace charanim
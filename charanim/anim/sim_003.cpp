@@ -0,0 +1,229 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+// C includes
+#include <string.h>
+#include <stdlib.h>
+
+// C++ includes
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+// charanim includes
+#include <anim/terrain/streamed_grid.hpp>
+#include <anim/utils/utils.hpp>
+
+namespace charanim {
+namespace study_cases {
+
+	// Grid of the simulation. Streamed from file.
+	static streamed_grid sim_003_G;
+
+	// maximum number of regions in memory
+	static size_t sim_003_budget = 16;
+	// distance around the agents whose regions are loaded
+	static float sim_003_radius = 20.0f;
+	// radius of the agents
+	static float sim_003_R = 1.0f;
+	// number of agents
+	static size_t sim_003_agents = 4;
+	// number of steps of the simulation
+	static size_t sim_003_steps = 500;
+	// seed of the random number generator
+	static size_t sim_003_seed = 0;
+
+	void sim_003_usage() {
+		cout << "Simulation 003: streaming of region maps" << endl;
+		cout << "Agents walk along paths between random points of a region" << endl;
+		cout << "map, which is streamed around them, and replan their paths" << endl;
+		cout << "every 50 steps. Reports the statistics of the streaming." << endl;
+		cout << "No window is opened." << endl;
+		cout << endl;
+		cout << "Parameters:" << endl;
+		cout << "    --help : show the usage." << endl;
+		cout << "    --map f: specify the region map file (see simulation 002)." << endl;
+		cout << "    --budget n: maximum number of regions in memory (default: 16)." << endl;
+		cout << "    --distance d: regions within distance d of the agents" << endl;
+		cout << "        are loaded (default: 20)." << endl;
+		cout << "    --radius R: radius of the agents (default: 1)." << endl;
+		cout << "    --agents n: number of agents (default: 4)." << endl;
+		cout << "    --steps n: number of steps (default: 500)." << endl;
+		cout << "    --seed s: seed of the random generator (default: 0)." << endl;
+		cout << endl;
+	}
+
+	int sim_003_parse_arguments(int argc, char *argv[]) {
+		string map_file = "none";
+
+		for (int i = 1; i < argc; ++i) {
+			if (parsing::is_help(argv[i])) {
+				sim_003_usage();
+				return 2;
+			}
+			else if (strcmp(argv[i], "--map") == 0) {
+				map_file = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--budget") == 0) {
+				sim_003_budget = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--distance") == 0) {
+				sim_003_radius = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--radius") == 0) {
+				sim_003_R = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--agents") == 0) {
+				sim_003_agents = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--steps") == 0) {
+				sim_003_steps = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--seed") == 0) {
+				sim_003_seed = atoi(argv[i + 1]);
+				++i;
+			}
+		}
+
+		if (map_file == "none") {
+			cerr << "Error: no map file specified. Use" << endl;
+			cerr << "    ./anim 003 --help" << endl;
+			cerr << "to see the usage" << endl;
+			return 1;
+		}
+		if (not sim_003_G.open(map_file)) {
+			return 1;
+		}
+		sim_003_G.set_budget(sim_003_budget);
+		return 0;
+	}
+
+	static inline
+	void sim_003_log(const string& when) {
+		streamed_grid::statistics s = sim_003_G.get_statistics();
+		cout << when << endl;
+		cout << "    resident regions: " << s.resident
+			 << " (peak: " << s.peak_resident << ")" << endl;
+		cout << "    requests: " << s.requests
+			 << ", cancelled: " << s.cancelled << endl;
+		cout << "    loads: " << s.loads << " (" << s.load_time << " ms)"
+			 << ", unloads: " << s.unloads << endl;
+		cout << "    blocking loads: " << s.blocking_loads
+			 << " (" << s.wait_time << " ms waiting)" << endl;
+	}
+
+	void sim_003(int argc, char *argv[]) {
+		int r = sim_003_parse_arguments(argc, argv);
+		if (r != 0) {
+			if (r == 1) {
+				cerr << "Error in initialisation of simulation 003" << endl;
+			}
+			return;
+		}
+
+		const size_t full_bytes =
+			sim_003_G.get_resX()*sim_003_G.get_resY()*sizeof(float);
+		cout << "Map dimensions: " << sim_003_G.get_dimX() << " x "
+			 << sim_003_G.get_dimY() << endl;
+		cout << "Regions: " << sim_003_G.n_regions() << " of "
+			 << sim_003_G.get_region_bytes() << " bytes" << endl;
+		cout << "Budget: " << sim_003_budget << " regions ("
+			 << sim_003_budget*sim_003_G.get_region_bytes() << " bytes, "
+			 << full_bytes << " bytes for the whole grid)" << endl;
+
+		// Random free points: the regions
+		// of the candidates are loaded.
+		mt19937 gen(sim_003_seed);
+		uniform_real_distribution<float> X(0.0f, sim_003_G.get_dimX());
+		uniform_real_distribution<float> Y(0.0f, sim_003_G.get_dimY());
+		auto free_point =
+		[&]() {
+			vec2 p;
+			do {
+				p = vec2(X(gen), Y(gen));
+			}
+			while (sim_003_G.get_value(p) <= sim_003_R);
+			return p;
+		};
+
+		vector<vec2> goals(sim_003_agents);
+		vector<vector<vec2> > paths(sim_003_agents);
+		vector<size_t> next(sim_003_agents, 0);
+		vector<vec2> positions(sim_003_agents);
+		for (size_t a = 0; a < sim_003_agents; ++a) {
+			positions[a] = free_point();
+			goals[a] = free_point();
+		}
+		sim_003_log("After choosing the points:");
+
+		timing::time_point begin = timing::now();
+		for (size_t step = 0; step < sim_003_steps; ++step) {
+			// replan the paths
+			if (step%50 == 0) {
+				for (size_t a = 0; a < sim_003_agents; ++a) {
+					paths[a].clear();
+					next[a] = 0;
+					sim_003_G.find_path(positions[a], goals[a], sim_003_R, paths[a]);
+				}
+			}
+
+			// move every agent to the next cell of its path
+			for (size_t a = 0; a < sim_003_agents; ++a) {
+				if (next[a] < paths[a].size()) {
+					positions[a] = paths[a][next[a]];
+					++next[a];
+				}
+			}
+			sim_003_G.update(positions, sim_003_radius);
+
+			if ((step + 1)%100 == 0) {
+				sim_003_log("Step " + std::to_string(step + 1) + ":");
+			}
+		}
+		timing::time_point end = timing::now();
+
+		size_t arrived = 0;
+		for (size_t a = 0; a < sim_003_agents; ++a) {
+			arrived += (next[a] == paths[a].size() and paths[a].size() > 0);
+		}
+		cout << "Simulation time: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		cout << "Agents that arrived: " << arrived << "/" << sim_003_agents << endl;
+		cout << "Peak memory of the regions: "
+			 << sim_003_G.get_statistics().peak_resident*sim_003_G.get_region_bytes()
+			 << " bytes" << endl;
+
+		sim_003_G.close();
+	}
+
+} // -- namespace study_cases
+} // -- namespace charanim
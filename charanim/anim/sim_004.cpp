@@ -0,0 +1,200 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+// C includes
+#include <string.h>
+#include <stdlib.h>
+
+// C++ includes
+#include <iostream>
+#include <string>
+using namespace std;
+
+// charanim includes
+#include <anim/terrain/map_generator.hpp>
+#include <anim/terrain/terrain.hpp>
+#include <anim/utils/utils.hpp>
+
+namespace charanim {
+namespace study_cases {
+
+	// kind of map generated
+	static string sim_004_kind = "none";
+	// number of cells (and dimension) of each side of the map
+	static size_t sim_004_resolution = 0;
+	// number of segments (approximately)
+	static size_t sim_004_segments = 0;
+	// seed of the random number generator
+	static size_t sim_004_seed = 1;
+	// base name of the output files
+	static string sim_004_out_file = "none";
+	// write the state of the regular grid in the binary map
+	static bool sim_004_grid = false;
+	// number of cells of the side of the regions, 0 for no region map
+	static size_t sim_004_regions = 0;
+
+	void sim_004_usage() {
+		cout << "Simulation 004: procedural generation of maps" << endl;
+		cout << endl;
+		cout << "Generates a map and writes it in text format (f.txt) and" << endl;
+		cout << "in binary format (f.bin). The same parameters always give" << endl;
+		cout << "the same map, so the maps can be used to compare the path" << endl;
+		cout << "finders (see simulation 001). No window is opened." << endl;
+		cout << endl;
+		cout << "Parameters:" << endl;
+		cout << "    --help : show the usage." << endl;
+		cout << "    --kind k: kind of map. One of:" << endl;
+		cout << "        maze, rooms, clutter, warehouse" << endl;
+		cout << "    --resolution n: the map has n x n cells, each of size 1." << endl;
+		cout << "    --segments m: the map has about m segments." << endl;
+		cout << "    --seed s: seed of the random number generator." << endl;
+		cout << "        Default: 1." << endl;
+		cout << "    --out f: base name of the output files." << endl;
+		cout << "    --grid: write the state of the regular grid in the" << endl;
+		cout << "        binary map (see simulation 002)." << endl;
+		cout << "    --regions c: also write a region map (f.reg), with" << endl;
+		cout << "        regions of c x c cells (see simulation 003)." << endl;
+		cout << endl;
+	}
+
+	int sim_004_parse_arguments(int argc, char *argv[]) {
+		for (int i = 1; i < argc; ++i) {
+			if (parsing::is_help(argv[i])) {
+				sim_004_usage();
+				return 2;
+			}
+			else if (strcmp(argv[i], "--kind") == 0) {
+				sim_004_kind = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--resolution") == 0) {
+				sim_004_resolution = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--segments") == 0) {
+				sim_004_segments = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--seed") == 0) {
+				sim_004_seed = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--out") == 0) {
+				sim_004_out_file = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--grid") == 0) {
+				sim_004_grid = true;
+			}
+			else if (strcmp(argv[i], "--regions") == 0) {
+				sim_004_regions = atoi(argv[i + 1]);
+				++i;
+			}
+		}
+
+		if (sim_004_kind == "none" or sim_004_out_file == "none") {
+			cerr << "Error: no kind of map or output file specified. Use" << endl;
+			cerr << "    ./anim 004 --help" << endl;
+			cerr << "to see the usage" << endl;
+			return 1;
+		}
+		if (sim_004_resolution < 4 or sim_004_segments == 0) {
+			cerr << "Error: resolution must be at least 4, and the number" << endl;
+			cerr << "of segments at least 1" << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	void sim_004(int argc, char *argv[]) {
+		int r = sim_004_parse_arguments(argc, argv);
+		if (r != 0) {
+			if (r == 1) {
+				cerr << "Error in initialisation of simulation 004" << endl;
+			}
+			return;
+		}
+
+		const size_t n = sim_004_resolution;
+		const float d = static_cast<float>(n);
+
+		vector<segment> segs;
+		timing::time_point begin = timing::now();
+		bool g = map_generator::generate
+			(sim_004_kind, d, d, sim_004_segments, sim_004_seed, segs);
+		timing::time_point end = timing::now();
+		if (not g) {
+			cerr << "Error: invalid kind of map '" << sim_004_kind << "'" << endl;
+			return;
+		}
+		cout << "Map generated in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		cout << "    segments: " << segs.size() << endl;
+
+		terrain T;
+		T.init(path_finder_type::regular_grid, n, n, d, d, segs);
+		segs.clear();
+		cout << "    segments removed by the simplification: "
+			 << T.get_n_removed_segments() << endl;
+
+		begin = timing::now();
+		bool w = T.write_map(sim_004_out_file + ".txt");
+		end = timing::now();
+		if (not w) {
+			return;
+		}
+		cout << "Text map written in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+
+		if (sim_004_grid) {
+			begin = timing::now();
+			bool m = T.make_path_finder(path_finder_type::regular_grid);
+			end = timing::now();
+			if (not m) {
+				return;
+			}
+			cout << "Regular grid built in: "
+				 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		}
+
+		begin = timing::now();
+		w = T.write_binary_map(sim_004_out_file + ".bin", sim_004_grid);
+		end = timing::now();
+		if (not w) {
+			return;
+		}
+		cout << "Binary map written in: "
+			 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+
+		if (sim_004_regions > 0) {
+			begin = timing::now();
+			w = T.write_region_map(sim_004_out_file + ".reg", sim_004_regions);
+			end = timing::now();
+			if (not w) {
+				return;
+			}
+			cout << "Region map written in: "
+				 << timing::elapsed_milliseconds(begin, end) << " ms" << endl;
+		}
+	}
+
+} // -- namespace study_cases
+} // -- namespace charanim
@@ -0,0 +1,396 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+// C includes
+#include <string.h>
+#include <stdlib.h>
+
+// C++ includes
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// charanim includes
+#include <anim/terrain/map_generator.hpp>
+#include <anim/terrain/density_grid.hpp>
+#include <anim/terrain/terrain.hpp>
+#include <anim/utils/utils.hpp>
+
+namespace charanim {
+namespace study_cases {
+
+	// Terrain of the simulation. Loaded from file or generated.
+	static terrain sim_005_T;
+	// Density of the crowd.
+	static density_grid sim_005_D;
+
+	// radius of the agents
+	static float sim_005_R = 0.3f;
+	// number of agents
+	static size_t sim_005_agents = 300;
+	// number of steps of the simulation
+	static size_t sim_005_steps = 1000;
+	// steps between two plannings of the path of an agent
+	static size_t sim_005_replan = 20;
+	// steps between two updates of the density
+	static size_t sim_005_interval = 5;
+	// decay factor of the density
+	static float sim_005_decay = 0.9f;
+	// weight of the density in the cost of the paths
+	static float sim_005_weight = 2.0f;
+	// radius of the footprint of an agent in the density, 0 for the default
+	static float sim_005_footprint = 0.0f;
+	// seed of the random number generator
+	static size_t sim_005_seed = 0;
+
+	void sim_005_usage() {
+		cout << "Simulation 005: crowds avoiding congestion" << endl;
+		cout << endl;
+		cout << "Agents start at random cells of the left side of a map and" << endl;
+		cout << "walk, cell by cell, to random cells of its right side. An" << endl;
+		cout << "agent waits when the next cell of its path is occupied, and" << endl;
+		cout << "replans its path every few steps. The simulation is run" << endl;
+		cout << "twice: once with paths of minimum length, and once with the" << endl;
+		cout << "density of the crowd as an additional cost of the paths." << endl;
+		cout << "Reports the congestion of both runs. No window is opened." << endl;
+		cout << endl;
+		cout << "Parameters:" << endl;
+		cout << "    --help : show the usage." << endl;
+		cout << "    --map f: use the map in file f." << endl;
+		cout << "    --generate k: generate a map of kind k instead. One of:" << endl;
+		cout << "        maze, rooms, clutter, warehouse" << endl;
+		cout << "    --resolution n: the generated map has n x n cells," << endl;
+		cout << "        each of size 1 (default: 128)." << endl;
+		cout << "    --segments m: the generated map has about m segments" << endl;
+		cout << "        (default: 200)." << endl;
+		cout << "    --seed s: seed of the random generator (default: 0)." << endl;
+		cout << "    --radius R: radius of the agents (default: 0.3)." << endl;
+		cout << "    --agents n: number of agents (default: 300)." << endl;
+		cout << "    --steps n: number of steps (default: 1000)." << endl;
+		cout << "    --replan n: steps between two plannings of the path" << endl;
+		cout << "        of an agent (default: 20)." << endl;
+		cout << "    --interval n: steps between two updates of the density" << endl;
+		cout << "        (default: 5)." << endl;
+		cout << "    --decay d: decay factor of the density, in [0,1]" << endl;
+		cout << "        (default: 0.9)." << endl;
+		cout << "    --weight w: weight of the density in the cost of the" << endl;
+		cout << "        paths (default: 2)." << endl;
+		cout << "    --footprint r: radius of the footprint of an agent in" << endl;
+		cout << "        the density (default: twice the length of a cell)." << endl;
+		cout << endl;
+	}
+
+	int sim_005_parse_arguments(int argc, char *argv[]) {
+		string map_file = "none";
+		string map_kind = "none";
+		size_t resolution = 128;
+		size_t segments = 200;
+
+		for (int i = 1; i < argc; ++i) {
+			if (parsing::is_help(argv[i])) {
+				sim_005_usage();
+				return 2;
+			}
+			else if (strcmp(argv[i], "--map") == 0) {
+				map_file = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--generate") == 0) {
+				map_kind = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--resolution") == 0) {
+				resolution = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--segments") == 0) {
+				segments = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--seed") == 0) {
+				sim_005_seed = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--radius") == 0) {
+				sim_005_R = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--agents") == 0) {
+				sim_005_agents = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--steps") == 0) {
+				sim_005_steps = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--replan") == 0) {
+				sim_005_replan = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--interval") == 0) {
+				sim_005_interval = atoi(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--decay") == 0) {
+				sim_005_decay = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--weight") == 0) {
+				sim_005_weight = atof(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--footprint") == 0) {
+				sim_005_footprint = atof(argv[i + 1]);
+				++i;
+			}
+		}
+
+		if (map_file == "none" and map_kind == "none") {
+			cerr << "Error: no map file or kind of map specified. Use" << endl;
+			cerr << "    ./anim 005 --help" << endl;
+			cerr << "to see the usage" << endl;
+			return 1;
+		}
+		if (sim_005_replan == 0) {
+			cerr << "Error: the steps between plannings must be at least 1" << endl;
+			return 1;
+		}
+
+		if (map_kind != "none") {
+			const float d = static_cast<float>(resolution);
+			vector<segment> segs;
+			bool g = map_generator::generate
+				(map_kind, d, d, segments, sim_005_seed, segs);
+			if (not g) {
+				cerr << "Error: invalid kind of map '" << map_kind << "'" << endl;
+				return 1;
+			}
+			sim_005_T.init
+				(path_finder_type::regular_grid, resolution, resolution, d, d, segs);
+			if (not sim_005_T.make_path_finder(path_finder_type::regular_grid)) {
+				return 1;
+			}
+			return 0;
+		}
+
+		if (not sim_005_T.read_map(map_file)) {
+			return 1;
+		}
+		if (sim_005_T.get_regular_grid() == nullptr) {
+			cerr << "Error: the map '" << map_file << "' does not use" << endl;
+			cerr << "a regular grid" << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// Runs the simulation with the density weighted by 'w'. The
+	// starting cells and the goals are the same in every run.
+	static inline
+	void sim_005_run
+	(float w, const vector<vec2>& sources, const vector<vec2>& goals)
+	{
+		regular_grid *rg = sim_005_T.get_regular_grid();
+		const size_t resX = rg->get_resX();
+		const size_t resY = rg->get_resY();
+		const float lenX = rg->get_dimX()/resX;
+		const float lenY = rg->get_dimY()/resY;
+		auto cell_of =
+		[&](const vec2& p) -> size_t {
+			const size_t x = std::min(static_cast<size_t>(p.x/lenX), resX - 1);
+			const size_t y = std::min(static_cast<size_t>(p.y/lenY), resY - 1);
+			return y*resX + x;
+		};
+
+		sim_005_D.init(resX, resY, rg->get_dimX(), rg->get_dimY());
+		sim_005_D.set_decay(sim_005_decay);
+		sim_005_D.set_interval(sim_005_interval);
+		if (sim_005_footprint > 0.0f) {
+			sim_005_D.set_radius(sim_005_footprint);
+		}
+		rg->set_density((w > 0.0f ? &sim_005_D : nullptr), w);
+
+		const size_t N = sources.size();
+		vector<vec2> positions(sources);
+		vector<vector<vec2> > paths(N);
+		vector<size_t> next(N, 0);
+		vector<bool> arrived(N, false);
+		// number of agents in every cell
+		vector<int> occupied(resX*resY, 0);
+		for (const vec2& p : positions) {
+			++occupied[cell_of(p)];
+		}
+
+		// positions of the agents walking
+		vector<vec2> walking;
+		vector<vec2> smoothed;
+
+		size_t n_arrived = 0;
+		size_t arrival_steps = 0;
+		size_t waits = 0;
+		size_t peak_waiting = 0;
+		double max_density = 0.0;
+		double plan_time = 0.0;
+		double density_time = 0.0;
+		size_t n_plans = 0;
+		size_t n_updates = 0;
+
+		for (size_t step = 0; step < sim_005_steps and n_arrived < N; ++step) {
+			// replan the paths, a few agents at every step
+			timing::time_point begin = timing::now();
+			for (size_t a = 0; a < N; ++a) {
+				if (arrived[a] or (step + a)%sim_005_replan != 0) {
+					continue;
+				}
+				paths[a].clear();
+				next[a] = 1;
+				rg->find_path(positions[a], goals[a], sim_005_R, paths[a], smoothed);
+				++n_plans;
+			}
+			timing::time_point end = timing::now();
+			plan_time += timing::elapsed_milliseconds(begin, end);
+
+			// move every agent to the next cell of its path, if free
+			size_t waiting = 0;
+			for (size_t a = 0; a < N; ++a) {
+				if (arrived[a] or next[a] >= paths[a].size()) {
+					continue;
+				}
+				const size_t c = cell_of(positions[a]);
+				const size_t d = cell_of(paths[a][next[a]]);
+				if (d != c and occupied[d] > 0) {
+					++waiting;
+					continue;
+				}
+				--occupied[c];
+				++occupied[d];
+				positions[a] = paths[a][next[a]];
+				++next[a];
+
+				if (d == cell_of(goals[a])) {
+					arrived[a] = true;
+					--occupied[d];
+					++n_arrived;
+					arrival_steps += step + 1;
+				}
+			}
+			waits += waiting;
+			peak_waiting = std::max(peak_waiting, waiting);
+
+			// splat the agents still walking
+			walking.clear();
+			for (size_t a = 0; a < N; ++a) {
+				if (not arrived[a]) {
+					walking.push_back(positions[a]);
+				}
+			}
+			begin = timing::now();
+			if (sim_005_D.step(walking)) {
+				end = timing::now();
+				density_time += timing::elapsed_milliseconds(begin, end);
+				++n_updates;
+
+				const float *D = sim_005_D.get_density();
+				max_density =
+					std::max(max_density, double(*std::max_element(D, D + resX*resY)));
+			}
+		}
+		rg->set_density(nullptr, 0.0f);
+
+		cout << "    agents that arrived: " << n_arrived << "/" << N << endl;
+		if (n_arrived > 0) {
+			cout << "    average arrival step: "
+				 << double(arrival_steps)/n_arrived << endl;
+		}
+		cout << "    steps waited: " << waits
+			 << " (peak of agents waiting: " << peak_waiting << ")" << endl;
+		cout << "    maximum density: " << max_density << endl;
+		cout << "    plannings: " << n_plans << " ("
+			 << (n_plans > 0 ? plan_time/n_plans : 0.0) << " ms each)" << endl;
+		cout << "    density updates: " << n_updates << " ("
+			 << (n_updates > 0 ? density_time/n_updates : 0.0) << " ms each)" << endl;
+	}
+
+	void sim_005(int argc, char *argv[]) {
+		int r = sim_005_parse_arguments(argc, argv);
+		if (r != 0) {
+			if (r == 1) {
+				cerr << "Error in initialisation of simulation 005" << endl;
+			}
+			return;
+		}
+
+		const regular_grid *rg = sim_005_T.get_regular_grid();
+		const size_t resX = rg->get_resX();
+		const size_t resY = rg->get_resY();
+		const float lenX = rg->get_dimX()/resX;
+		const float lenY = rg->get_dimY()/resY;
+		cout << "Map dimensions: " << rg->get_dimX() << " x "
+			 << rg->get_dimY() << endl;
+		cout << "Cells: " << resX << " x " << resY << endl;
+
+		// Free cells of the left and right
+		// fifths of the map, by their centres.
+		vector<vec2> left, right;
+		for (size_t y = 0; y < resY; ++y) {
+			for (size_t x = 0; x < resX; ++x) {
+				if (rg->get_grid()[y*resX + x] <= sim_005_R) {
+					continue;
+				}
+				const vec2 c(lenX*x + lenX/2.0f, lenY*y + lenY/2.0f);
+				if (5*x < resX) {
+					left.push_back(c);
+				}
+				else if (5*x >= 4*resX) {
+					right.push_back(c);
+				}
+			}
+		}
+		if (left.size() < sim_005_agents or right.size() == 0) {
+			cerr << "Error: not enough free cells for " << sim_005_agents
+				 << " agents" << endl;
+			return;
+		}
+
+		// every agent starts at a different cell
+		mt19937 gen(sim_005_seed);
+		shuffle(left.begin(), left.end(), gen);
+		vector<vec2> sources(left.begin(), left.begin() + sim_005_agents);
+		vector<vec2> goals(sim_005_agents);
+		uniform_int_distribution<size_t> G(0, right.size() - 1);
+		for (vec2& g : goals) {
+			g = right[G(gen)];
+		}
+
+		cout << "Agents: " << sim_005_agents << endl;
+		cout << "Paths of minimum length:" << endl;
+		sim_005_run(0.0f, sources, goals);
+		cout << "Paths avoiding the crowd (weight " << sim_005_weight << "):" << endl;
+		sim_005_run(sim_005_weight, sources, goals);
+
+		sim_005_D.clear();
+	}
+
+} // -- namespace study_cases
+} // -- namespace charanim
@@ -23,6 +23,7 @@
 
 // C includes
 #include <string.h>
+#include <stdlib.h>
 
 // C++ includes
 #include <iostream>
@@ -76,8 +77,12 @@ namespace study_cases {
 	// only agent in the simulation
 	static size_t sim_200_what_target;
 
+	// feelers of the agent
+	static ray_batch sim_200_feelers;
+
 	// render stuff
 	static bool sim_200_render_circles = false;
+	static bool sim_200_render_feelers = false;
 	static GLUquadric *sim_200_disk = nullptr;
 
 	void sim_200_usage() {
@@ -86,12 +91,20 @@ namespace study_cases {
 		cout << "Specify a map file as parameter to visualise it." << endl;
 		cout << "    --help : show the usage." << endl;
 		cout << "    --map f: specify map file." << endl;
+		cout << "    --policy p: search policy of the regular grid, one of:" << endl;
+		cout << "        clearance: heuristic with clearance, no bound (default)." << endl;
+		cout << "        weighted: weighted A*." << endl;
+		cout << "        focal: focal search preferring clearance." << endl;
+		cout << "    --epsilon e: suboptimality factor of the weighted and" << endl;
+		cout << "        focal searches: paths cost at most e times the" << endl;
+		cout << "        optimum (default: 1.5)." << endl;
 		cout << endl;
 		cout << "Keyboard keys:" << endl;
 		cout << "    h: show the usage." << endl;
 		cout << "    r: reset simulation." << endl;
 		cout << "    p: find path between two 2d points." << endl;
 		cout << "    c: render circles around path vertices." << endl;
+		cout << "    f: render feelers of the agent" << endl;
 		cout << "    d: render distance function for obstacle avoidance" << endl;
 		cout << "    g: render grid for path finding" << endl;
 		cout << "    v: render velocity vector" << endl;
@@ -125,6 +138,37 @@ namespace study_cases {
 		}
 	}
 
+	// Casts 16 feelers around the agent against the segments of the
+	// map. Called after every simulation step.
+	void sim_200_cast_agent_feelers() {
+		const agent_particle& a = S.get_agent_particle(0);
+
+		sim_200_feelers.clear();
+		sim_200_feelers.add_fan
+		(vec2(a.cur_pos.x, a.cur_pos.z), 0.0f, 16, 2.0f*a.coll_distance);
+		sim_200_T.get_spatial_index().raycast(sim_200_feelers);
+	}
+
+	// Renders the feelers cast last up to the closest segment hit.
+	void sim_200_render_agent_feelers() {
+		glBegin(GL_LINES);
+		for (size_t i = 0; i < sim_200_feelers.size(); ++i) {
+			if (sim_200_feelers.hit_segment[i] != -1) {
+				glColor3f(1.0f, 0.0f, 0.0f);
+			}
+			else {
+				glColor3f(0.0f, 1.0f, 0.0f);
+			}
+			const float d = sim_200_feelers.hit_dist[i];
+			glVertex3f(sim_200_feelers.ox[i], 1.0f, sim_200_feelers.oy[i]);
+			glVertex3f(
+				sim_200_feelers.ox[i] + d*sim_200_feelers.dx[i], 1.0f,
+				sim_200_feelers.oy[i] + d*sim_200_feelers.dy[i]
+			);
+		}
+		glEnd();
+	}
+
 	void sim_200_render() {
 		glClearColor(bgd_color.x, bgd_color.y, bgd_color.z, 1.0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -148,7 +192,17 @@ namespace study_cases {
 
 		// render path finder (on the xy plane)
 		const regular_grid *rg = sim_200_T.get_regular_grid();
-		render_regular_grid(rg);
+		if (rg != nullptr) {
+			render_regular_grid(rg);
+		}
+		const navmesh *nm = sim_200_T.get_navmesh();
+		if (nm != nullptr) {
+			render_navmesh(nm);
+		}
+		const medial_axis *ma = sim_200_T.get_medial_axis();
+		if (ma != nullptr) {
+			render_medial_axis(ma);
+		}
 
 		if (sim_200_astar_path.size() > 1) {
 			sim_200_render_a_path
@@ -166,6 +220,9 @@ namespace study_cases {
 			for (int i = 0; i < 100; ++i) {
 				S.simulate_agent_particles();
 			}
+			if (sim_200_render_feelers) {
+				sim_200_cast_agent_feelers();
+			}
 
 			agent_particle& sim_200_agent = S.get_agent_particle(0);
 
@@ -203,6 +260,10 @@ namespace study_cases {
 			}
 		}
 
+		if (sim_200_render_feelers) {
+			sim_200_render_agent_feelers();
+		}
+
 		if (window_id != -1) {
 			if (record) {
 				record_screen();
@@ -301,6 +362,8 @@ namespace study_cases {
 
 	int sim_200_parse_arguments(int argc, char *argv[]) {
 		string map_file = "none";
+		string policy_name = "clearance";
+		float epsilon = 1.5f;
 
 		for (int i = 1; i < argc; ++i) {
 			if (strcmp(argv[i], "--help") == 0) {
@@ -311,6 +374,14 @@ namespace study_cases {
 				map_file = string(argv[i + 1]);
 				++i;
 			}
+			else if (strcmp(argv[i], "--policy") == 0) {
+				policy_name = string(argv[i + 1]);
+				++i;
+			}
+			else if (strcmp(argv[i], "--epsilon") == 0) {
+				epsilon = atof(argv[i + 1]);
+				++i;
+			}
 		}
 
 		if (map_file == "none") {
@@ -325,6 +396,18 @@ namespace study_cases {
 		if (not r) {
 			return 1;
 		}
+		cout << "Number of segments: " << sim_200_T.get_segments().size()
+			 << " (" << sim_200_T.get_n_removed_segments()
+			 << " removed by the simplification)" << endl;
+
+		search_policy policy;
+		if (not search_policy::from_name(policy_name, epsilon, policy)) {
+			cerr << "Error: invalid search policy '" << policy_name << "'" << endl;
+			return 1;
+		}
+		if (sim_200_T.get_regular_grid() != nullptr) {
+			sim_200_T.get_regular_grid()->set_search_policy(policy);
+		}
 		return 0;
 	}
 
@@ -335,9 +418,8 @@ namespace study_cases {
 
 		sim_200_astar_path.clear();
 		sim_200_smoothed_path.clear();
-		regular_grid *rg = sim_200_T.get_regular_grid();
 		timing::time_point begin = timing::now();
-		rg->find_path(
+		sim_200_T.find_path(
 			start, goal, sim_200_R,
 			sim_200_astar_path, sim_200_smoothed_path
 		);
@@ -489,6 +571,12 @@ namespace study_cases {
 		case 'r': sim_200_exit(); sim_200_init(false); break;
 		case 'p': sim_200_compute_path(); break;
 		case 'c': sim_200_render_circles = not sim_200_render_circles; break;
+		case 'f':
+			sim_200_render_feelers = not sim_200_render_feelers;
+			if (sim_200_render_feelers) {
+				sim_200_cast_agent_feelers();
+			}
+			break;
 		case 'd': render_dist_func = not render_dist_func; break;
 		case 'g': render_grid = not render_grid; break;
 		}
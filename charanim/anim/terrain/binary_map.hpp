@@ -0,0 +1,227 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstdint>
+#include <cstddef>
+
+namespace charanim {
+namespace binary_map {
+
+/*
+ * Binary map format.
+ *
+ * A file made of a header followed by sections. Every section starts at
+ * a multiple of @ref alignment bytes, at the offset given in the header.
+ * Numbers are stored with the byte order of the machine that wrote the
+ * file (see @ref header::byte_order).
+ *
+ * Sections:
+ * - segments: @e n_segments segments of the terrain, as 4 floats each
+ * (x and y of the first point, x and y of the second point). They include
+ * the edges of the polygons and the walls enclosing the terrain.
+ * - polygons: the polygonal obstacles of the terrain.
+ *   - starts: n_polygons + 1 64-bit integers, the index of the first
+ *   vertex of every polygon, and the total number of vertices.
+ *   - vertices: the vertices of all the polygons, 2 floats each.
+ * - grid (optional): the state of the regular grid built on the terrain.
+ *   - grid segments: @e n_grid_segments segments, 4 floats each (see
+ *   @ref regular_grid::get_segments).
+ *   - cells: resX*resY floats (see @ref regular_grid::get_grid).
+ *   - labels: resX*resY 32-bit integers (see
+ *   @ref regular_grid::get_labels).
+ */
+
+/// First bytes of every binary map.
+static const char magic[8] = {'C','A','N','I','M','M','A','P'};
+/// Version of the format.
+static const uint32_t version = 2;
+/// Value of @ref header::byte_order when read with the right byte order.
+static const uint32_t byte_order = 0x01020304;
+/// Alignment of the sections.
+static const uint64_t alignment = 64;
+
+/// Header of a binary map.
+struct header {
+	/// Must be equal to @ref binary_map::magic.
+	char magic[8];
+	/// Version of the format.
+	uint32_t version;
+	/// Must be equal to @ref binary_map::byte_order.
+	uint32_t byte_order;
+
+	/// Path finder type (see @ref path_finder_type).
+	uint32_t type;
+	/// Thickness of the walls rasterised in the regular grid.
+	float wall_thickness;
+	/// Number of cells in the x-axis.
+	uint64_t resX;
+	/// Number of cells in the y-axis.
+	uint64_t resY;
+	/// Dimension in the x-axis.
+	float dimX;
+	/// Dimension in the y-axis.
+	float dimY;
+
+	/// Number of segments.
+	uint64_t n_segments;
+	/// Offset of the segments.
+	uint64_t segments_offset;
+
+	/// Maximum value of the cells of the grid.
+	float max_dist;
+	/// Padding.
+	uint32_t unused;
+	/// Number of segments of the grid.
+	uint64_t n_grid_segments;
+	/// Offset of the segments of the grid.
+	uint64_t grid_segments_offset;
+	/// Offset of the cells of the grid, 0 if there is no grid section.
+	uint64_t cells_offset;
+	/// Offset of the labels of the grid.
+	uint64_t labels_offset;
+
+	/// Number of polygons.
+	uint64_t n_polygons;
+	/// Offset of the index of the first vertex of every polygon.
+	uint64_t polygon_starts_offset;
+	/// Offset of the vertices of the polygons.
+	uint64_t polygon_vertices_offset;
+};
+
+/*
+ * Region map format.
+ *
+ * The cells of a map split into square regions of @e region_cells x
+ * @e region_cells cells, so that every region can be read on its own.
+ * A file made of a header (@ref region_header) followed by a table with
+ * one entry per region (@ref region_entry), by rows of regions. Every
+ * region has:
+ * - segments: the segments of the terrain near the region, 4 floats each.
+ * - tile: region_cells*region_cells floats, the values of the cells of
+ * the region in a regular grid of the whole map (see
+ * @ref regular_grid::get_grid), by rows. Cells out of the map have
+ * value 0.
+ * Every section starts at a multiple of @ref alignment bytes.
+ */
+
+/// First bytes of every region map.
+static const char region_magic[8] = {'C','A','N','I','M','R','E','G'};
+
+/// Header of a region map.
+struct region_header {
+	/// Must be equal to @ref binary_map::region_magic.
+	char magic[8];
+	/// Version of the format.
+	uint32_t version;
+	/// Must be equal to @ref binary_map::byte_order.
+	uint32_t byte_order;
+
+	/// Number of cells in the x-axis.
+	uint64_t resX;
+	/// Number of cells in the y-axis.
+	uint64_t resY;
+	/// Dimension in the x-axis.
+	float dimX;
+	/// Dimension in the y-axis.
+	float dimY;
+
+	/// Number of cells of the side of every region.
+	uint64_t region_cells;
+	/// Number of regions in the x-axis.
+	uint64_t regionsX;
+	/// Number of regions in the y-axis.
+	uint64_t regionsY;
+	/// Offset of the table of regions.
+	uint64_t table_offset;
+};
+
+/// Entry of the table of regions of a region map.
+struct region_entry {
+	/// Number of segments of the region.
+	uint64_t n_segments;
+	/// Offset of the segments of the region.
+	uint64_t segments_offset;
+	/// Offset of the tile of the region.
+	uint64_t tile_offset;
+};
+
+/*
+ * Visibility cache format.
+ *
+ * The visibility between sample points of a regular grid (see
+ * @ref visibility_cache). A file made of a header
+ * (@ref visibility_header) followed by:
+ * - samples: @e n_samples points, 2 floats each.
+ * - index: n_samples*blocks_per_row 32-bit integers, the block of
+ * every piece of every row of the visibility matrix.
+ * - pool: @e n_blocks blocks of 8 64-bit words each.
+ * Every section starts at a multiple of @ref alignment bytes.
+ */
+
+/// First bytes of every visibility cache.
+static const char visibility_magic[8] = {'C','A','N','I','M','V','I','S'};
+
+/// Header of a visibility cache.
+struct visibility_header {
+	/// Must be equal to @ref binary_map::visibility_magic.
+	char magic[8];
+	/// Version of the format.
+	uint32_t version;
+	/// Must be equal to @ref binary_map::byte_order.
+	uint32_t byte_order;
+
+	/// Number of cells in the x-axis of the grid.
+	uint64_t resX;
+	/// Number of cells in the y-axis of the grid.
+	uint64_t resY;
+	/// Dimension in the x-axis.
+	float dimX;
+	/// Dimension in the y-axis.
+	float dimY;
+
+	/// Radius of the agents.
+	float R;
+	/// Maximum distance between visible samples.
+	float max_dist;
+	/// Distance in cells between samples, 0 if the samples were given.
+	uint64_t stride;
+	/// Number of samples.
+	uint64_t n_samples;
+	/// Number of blocks of the pool.
+	uint64_t n_blocks;
+	/// Offset of the samples.
+	uint64_t samples_offset;
+	/// Offset of the index.
+	uint64_t index_offset;
+	/// Offset of the pool.
+	uint64_t pool_offset;
+};
+
+/// Returns the first multiple of @ref alignment not smaller than @e o.
+inline uint64_t align(uint64_t o) {
+	return (o + alignment - 1)/alignment*alignment;
+}
+
+} // -- namespace binary_map
+} // -- namespace charanim
@@ -0,0 +1,420 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/cooperative_planner.hpp>
+
+// C++ includes
+#include <algorithm>
+#include <limits>
+#include <cmath>
+using namespace std;
+
+#define MAX_DINF numeric_limits<double>::max()
+#define global_xy(x,y) static_cast<size_t>(y)*resX + static_cast<size_t>(x)
+#define global_latpoint(p) global_xy(p.x(), p.y())
+
+namespace charanim {
+
+// PRIVATE
+
+latticePoint cooperative_planner::cell_of(const vec2& p) const {
+	int x = static_cast<int>(std::max(0.0f, p.x/lenX));
+	int y = static_cast<int>(std::max(0.0f, p.y/lenY));
+	x = std::min(x, static_cast<int>(resX) - 1);
+	y = std::min(y, static_cast<int>(resY) - 1);
+	return latticePoint(x,y);
+}
+
+double cooperative_planner::octile
+(const latticePoint& a, const latticePoint& b) const
+{
+	const int nx = std::abs(a.x() - b.x());
+	const int ny = std::abs(a.y() - b.y());
+	const int m = std::min(nx, ny);
+	const double diag = std::sqrt(lenX*lenX + lenY*lenY);
+	return m*diag + (nx - m)*lenX + (ny - m)*lenY;
+}
+
+bool cooperative_planner::is_reserved(size_t cell, size_t t, size_t a) const {
+	auto it = reservations.find(key(cell, t));
+	return it != reservations.end() and it->second != a;
+}
+
+bool cooperative_planner::is_free(int x, int y, size_t a) const {
+	if (x < 0 or y < 0) {
+		return false;
+	}
+	if (x >= static_cast<int>(resX) or y >= static_cast<int>(resY)) {
+		return false;
+	}
+	return cells[global_xy(x,y)] >= agents[a].R;
+}
+
+double cooperative_planner::goal_distance(size_t a, const latticePoint& c) {
+	distance_search& s = agents[a].distance;
+	const size_t cc = global_latpoint(c);
+	if (s.closed.find(cc) != s.closed.end()) {
+		return s.dist[cc];
+	}
+
+	while (not s.open.empty()) {
+		const size_t u = s.open.top().second;
+		s.open.pop();
+		if (s.closed.find(u) != s.closed.end()) {
+			continue;
+		}
+		s.closed.insert(u);
+
+		const double du = s.dist[u];
+		const int ux = static_cast<int>(u%resX);
+		const int uy = static_cast<int>(u/resX);
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if ((dx == 0 and dy == 0) or not is_free(ux + dx, uy + dy, a)) {
+					continue;
+				}
+				const latticePoint v(ux + dx, uy + dy);
+				const size_t vv = global_latpoint(v);
+				if (s.closed.find(vv) != s.closed.end()) {
+					continue;
+				}
+
+				const double dv = du + octile(latticePoint(ux,uy), v);
+				auto it = s.dist.find(vv);
+				if (it == s.dist.end() or dv < it->second) {
+					s.dist[vv] = dv;
+					s.open.push(make_pair(dv + octile(v, s.target), vv));
+				}
+			}
+		}
+
+		if (u == cc) {
+			return du;
+		}
+	}
+	return MAX_DINF;
+}
+
+void cooperative_planner::init_distance(size_t a) {
+	agent& ag = agents[a];
+	distance_search& s = ag.distance;
+
+	s.origin = ag.goal;
+	s.target = ag.cell;
+	s.dist.clear();
+	s.closed.clear();
+	s.open = decltype(s.open)();
+
+	if (is_free(s.origin.x(), s.origin.y(), a)) {
+		const size_t o = global_latpoint(s.origin);
+		s.dist[o] = 0.0;
+		s.open.push(make_pair(octile(s.origin, s.target), o));
+	}
+}
+
+void cooperative_planner::plan(size_t a) {
+	agent& ag = agents[a];
+
+	// release the pairs reserved in the previous plan
+	for (uint64_t k : ag.reserved) {
+		auto it = reservations.find(k);
+		if (it != reservations.end() and it->second == a) {
+			reservations.erase(it);
+		}
+	}
+	ag.reserved.clear();
+
+	const size_t t0 = time;
+	const size_t W = window;
+	const size_t start = global_latpoint(ag.cell);
+	const size_t goal = global_latpoint(ag.goal);
+	const double wait_cost = std::min(lenX, lenY);
+
+	// states of the space-time search: cell*(W + 1) + step
+	auto state = [W](size_t c, size_t dt) -> uint64_t {
+		return static_cast<uint64_t>(c)*(W + 1) + dt;
+	};
+
+	unordered_map<uint64_t, double> g;
+	unordered_map<uint64_t, uint64_t> parent;
+	unordered_set<uint64_t> closed;
+	priority_queue<
+		pair<double, uint64_t>,
+		vector<pair<double, uint64_t> >,
+		greater<pair<double, uint64_t> >
+	> open;
+
+	const uint64_t s0 = state(start, 0);
+	g[s0] = 0.0;
+	parent[s0] = s0;
+	open.push(make_pair(goal_distance(a, ag.cell), s0));
+
+	// the goal is final if no other agent passes through it later on
+	auto final_goal =
+	[&](size_t dt) -> bool {
+		for (size_t k = dt; k <= W; ++k) {
+			if (is_reserved(goal, t0 + k, a)) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	bool found = false;
+	uint64_t last = s0;
+	while (not open.empty()) {
+		const uint64_t u = open.top().second;
+		open.pop();
+		if (closed.find(u) != closed.end()) {
+			continue;
+		}
+		closed.insert(u);
+
+		const size_t c = static_cast<size_t>(u/(W + 1));
+		const size_t dt = static_cast<size_t>(u%(W + 1));
+		if (dt == W or (c == goal and (not cooperative or final_goal(dt)))) {
+			found = true;
+			last = u;
+			break;
+		}
+
+		const double gu = g[u];
+		const int cx = static_cast<int>(c%resX);
+		const int cy = static_cast<int>(c/resX);
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (not is_free(cx + dx, cy + dy, a)) {
+					continue;
+				}
+				const latticePoint v(cx + dx, cy + dy);
+				const size_t vc = global_latpoint(v);
+
+				if (cooperative) {
+					if (is_reserved(vc, t0 + dt + 1, a)) {
+						continue;
+					}
+					// the agent that will leave vc to enter c
+					if (vc != c) {
+						auto it = reservations.find(key(vc, t0 + dt));
+						if (it != reservations.end() and it->second != a) {
+							auto jt = reservations.find(key(c, t0 + dt + 1));
+							if (jt != reservations.end() and jt->second == it->second) {
+								continue;
+							}
+						}
+					}
+				}
+
+				const double h = goal_distance(a, v);
+				if (h == MAX_DINF) {
+					continue;
+				}
+
+				double cost;
+				if (vc == c) {
+					cost = (c == goal ? 0.0 : wait_cost);
+				}
+				else {
+					cost = octile(latticePoint(cx,cy), v);
+				}
+
+				const uint64_t sv = state(vc, dt + 1);
+				const double gv = gu + cost;
+				auto it = g.find(sv);
+				if (it == g.end() or gv < it->second) {
+					g[sv] = gv;
+					parent[sv] = u;
+					open.push(make_pair(gv + h, sv));
+				}
+			}
+		}
+	}
+
+	// build the plan backwards
+	vector<size_t> path;
+	if (found) {
+		uint64_t u = last;
+		while (parent[u] != u) {
+			path.push_back(static_cast<size_t>(u/(W + 1)));
+			u = parent[u];
+		}
+	}
+	path.push_back(start);
+	reverse(path.begin(), path.end());
+
+	// the agent waits at the end of the plan
+	while (path.size() < W + 1) {
+		path.push_back(path.back());
+	}
+
+	ag.plan_time = t0;
+	ag.plan.resize(path.size());
+	for (size_t k = 0; k < path.size(); ++k) {
+		ag.plan[k] = latticePoint(path[k]%resX, path[k]/resX);
+	}
+
+	if (cooperative) {
+		ag.reserved.resize(path.size());
+		for (size_t k = 0; k < path.size(); ++k) {
+			ag.reserved[k] = key(path[k], t0 + k);
+			reservations[ag.reserved[k]] = a;
+		}
+	}
+}
+
+// PUBLIC
+
+cooperative_planner::cooperative_planner() {
+	rg = nullptr;
+	cells = nullptr;
+	resX = resY = 0;
+	lenX = lenY = 0.0f;
+	window = 16;
+	cooperative = true;
+	time = 0;
+}
+
+cooperative_planner::~cooperative_planner() {
+	clear();
+}
+
+// MODIFIERS
+
+void cooperative_planner::init(const regular_grid *_rg, size_t w) {
+	clear();
+
+	rg = _rg;
+	cells = rg->get_grid();
+	resX = rg->get_resX();
+	resY = rg->get_resY();
+	lenX = rg->get_dimX()/resX;
+	lenY = rg->get_dimY()/resY;
+	window = std::max(w, static_cast<size_t>(2));
+}
+
+void cooperative_planner::clear() {
+	rg = nullptr;
+	cells = nullptr;
+	resX = resY = 0;
+	lenX = lenY = 0.0f;
+	time = 0;
+	agents.clear();
+	reservations.clear();
+}
+
+size_t cooperative_planner::add_agent
+(const vec2& pos, const vec2& goal, float R)
+{
+	agents.push_back(agent());
+	agent& ag = agents.back();
+	ag.R = R;
+	ag.cell = cell_of(pos);
+	ag.goal = cell_of(goal);
+	ag.plan_time = time;
+
+	const size_t a = agents.size() - 1;
+	init_distance(a);
+	return a;
+}
+
+void cooperative_planner::set_goal(size_t a, const vec2& goal) {
+	agents[a].goal = cell_of(goal);
+	agents[a].plan.clear();
+	init_distance(a);
+}
+
+void cooperative_planner::step() {
+	// agents re-plan every half window, each at a different step
+	const size_t interval = window/2;
+
+	for (size_t a = 0; a < agents.size(); ++a) {
+		const agent& ag = agents[a];
+		if (ag.plan.empty() or
+			time + 1 >= ag.plan_time + ag.plan.size() or
+			(time + a)%interval == 0)
+		{
+			plan(a);
+		}
+	}
+
+	++time;
+	for (agent& ag : agents) {
+		ag.cell = ag.plan[time - ag.plan_time];
+	}
+}
+
+// SETTERS
+
+void cooperative_planner::set_cooperative(bool c) {
+	cooperative = c;
+	if (not cooperative) {
+		reservations.clear();
+		for (agent& ag : agents) {
+			ag.reserved.clear();
+		}
+	}
+}
+
+// GETTERS
+
+size_t cooperative_planner::n_agents() const {
+	return agents.size();
+}
+
+vec2 cooperative_planner::get_position(size_t a) const {
+	const latticePoint& c = agents[a].cell;
+	return vec2(lenX*c.x() + lenX/2.0f, lenY*c.y() + lenY/2.0f);
+}
+
+vec2 cooperative_planner::get_next_position(size_t a) const {
+	const agent& ag = agents[a];
+	latticePoint c = ag.cell;
+	if (time + 1 < ag.plan_time + ag.plan.size()) {
+		c = ag.plan[time + 1 - ag.plan_time];
+	}
+	return vec2(lenX*c.x() + lenX/2.0f, lenY*c.y() + lenY/2.0f);
+}
+
+bool cooperative_planner::has_arrived(size_t a) const {
+	return agents[a].cell == agents[a].goal;
+}
+
+size_t cooperative_planner::get_time() const {
+	return time;
+}
+
+size_t cooperative_planner::n_reservations() const {
+	return reservations.size();
+}
+
+size_t cooperative_planner::n_conflicts() const {
+	unordered_map<size_t, size_t> count;
+	for (const agent& ag : agents) {
+		++count[global_latpoint(ag.cell)];
+	}
+	size_t c = 0;
+	for (const auto& p : count) {
+		c += p.second*(p.second - 1)/2;
+	}
+	return c;
+}
+
+} // -- namespace charanim
@@ -0,0 +1,239 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <queue>
+
+// charanim includes
+#include <anim/definitions.hpp>
+#include <anim/terrain/regular_grid.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Cooperative path finding for many agents on a regular grid.
+ *
+ * Windowed Hierarchical Cooperative A* (WHCA*). Time is discretised in
+ * steps: at every step each agent stays in its cell or moves to one of
+ * its 8 neighbours. Agents plan, one after the other, paths of @ref window
+ * steps in space-time, and reserve the (cell, time) pairs of their paths
+ * in a reservation table, so that the agents planning afterwards avoid
+ * them. Beyond the window, the cost of a path is estimated with the true
+ * distance to the goal ignoring the other agents, computed on demand with
+ * a Reverse Resumable A* search from the goal of each agent.
+ *
+ * Agents re-plan every half window. The re-planning of the agents is
+ * spread over the steps: at each step only a fraction of the agents
+ * re-plan.
+ */
+class cooperative_planner {
+	private:
+		/**
+		 * @brief Reverse Resumable A* search.
+		 *
+		 * Search from the goal of an agent towards its starting cell. It
+		 * is resumed whenever the distance to a cell not yet closed is
+		 * needed.
+		 */
+		struct distance_search {
+			/// Cell where the search starts: the goal of the agent.
+			latticePoint origin;
+			/// Cell guiding the search: the start of the agent.
+			latticePoint target;
+			/// Distance to the origin of the cells visited.
+			std::unordered_map<size_t, double> dist;
+			/// Cells whose distance is final.
+			std::unordered_set<size_t> closed;
+			/// Open list.
+			std::priority_queue<
+				std::pair<double, size_t>,
+				std::vector<std::pair<double, size_t> >,
+				std::greater<std::pair<double, size_t> >
+			> open;
+		};
+
+		/// An agent.
+		struct agent {
+			/// Radius of the agent.
+			float R;
+			/// Current cell.
+			latticePoint cell;
+			/// Goal cell.
+			latticePoint goal;
+			/// Cells of the plan: the @e i-th at time @ref plan_time + i.
+			std::vector<latticePoint> plan;
+			/// Time at which the plan was made.
+			size_t plan_time;
+			/// Keys of the reservations made by this agent.
+			std::vector<uint64_t> reserved;
+			/// Distance to the goal.
+			distance_search distance;
+		};
+
+	private:
+		/// Grid on which agents move.
+		const regular_grid *rg;
+		/// Number of cells in the x-axis.
+		size_t resX;
+		/// Number of cells in the y-axis.
+		size_t resY;
+		/// Length of every cell in the x-axis.
+		float lenX;
+		/// Length of every cell in the y-axis.
+		float lenY;
+		/// Distance to the closest segment of every cell of @ref rg.
+		const float *cells;
+
+		/// Number of steps of the plans.
+		size_t window;
+		/// Do agents reserve their paths?
+		bool cooperative;
+		/// Current time.
+		size_t time;
+
+		/// The agents.
+		std::vector<agent> agents;
+
+		/**
+		 * @brief Reservation table.
+		 *
+		 * Maps the key of a (cell, time) pair to the agent that reserved
+		 * it.
+		 */
+		std::unordered_map<uint64_t, size_t> reservations;
+
+	private:
+		/// Returns the cell containing point @e p.
+		latticePoint cell_of(const vec2& p) const;
+		/// Length of the shortest 8-connected path between two cells.
+		double octile(const latticePoint& a, const latticePoint& b) const;
+
+		/// Key of a (cell, time) pair in @ref reservations.
+		inline uint64_t key(size_t cell, size_t t) const {
+			return (static_cast<uint64_t>(t) << 32) | static_cast<uint64_t>(cell);
+		}
+
+		/// Is the pair (cell, time) reserved by an agent other than @e a?
+		bool is_reserved(size_t cell, size_t t, size_t a) const;
+
+		/// Can agent @e a be in cell (x,y)?
+		bool is_free(int x, int y, size_t a) const;
+
+		/**
+		 * @brief Distance from a cell to the goal of an agent.
+		 *
+		 * Resumes the search of the agent until @e c is closed.
+		 * @return Returns infinity if the goal can't be reached from @e c.
+		 */
+		double goal_distance(size_t a, const latticePoint& c);
+
+		/// Starts the distance search of agent @e a.
+		void init_distance(size_t a);
+
+		/**
+		 * @brief Makes a new plan for agent @e a.
+		 *
+		 * Space-time A* search of at most @ref window steps, avoiding the
+		 * pairs reserved by other agents and the swaps of cells with
+		 * them. The pairs of the new plan are reserved.
+		 */
+		void plan(size_t a);
+
+	public:
+		/// Default constructor.
+		cooperative_planner();
+		/// Destructor.
+		~cooperative_planner();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Initialises the planner.
+		 * @param rg Grid on which agents move. Must outlive this object.
+		 * @param window Number of steps of the plans.
+		 */
+		void init(const regular_grid *rg, size_t window);
+
+		/// Clears the memory occupied by this object.
+		void clear();
+
+		/**
+		 * @brief Adds an agent.
+		 * @param pos Position of the agent.
+		 * @param goal Goal of the agent.
+		 * @param R Radius of the agent.
+		 * @return Returns the index of the agent.
+		 */
+		size_t add_agent(const vec2& pos, const vec2& goal, float R);
+
+		/// Changes the goal of agent @e a.
+		void set_goal(size_t a, const vec2& goal);
+
+		/**
+		 * @brief Advances one step of time.
+		 *
+		 * The agents whose turn it is (and those without plan) re-plan.
+		 * Then every agent moves to the next cell of its plan.
+		 */
+		void step();
+
+		// SETTERS
+
+		/**
+		 * @brief Sets whether agents reserve their paths.
+		 *
+		 * If not, every agent plans independently (useful for comparing).
+		 */
+		void set_cooperative(bool c);
+
+		// GETTERS
+
+		/// Returns the number of agents.
+		size_t n_agents() const;
+		/// Returns the current position (centre of its cell) of agent @e a.
+		vec2 get_position(size_t a) const;
+		/**
+		 * @brief Returns the next position of agent @e a.
+		 *
+		 * The centre of the next cell in its plan, to be used as target
+		 * of the steering behaviours.
+		 */
+		vec2 get_next_position(size_t a) const;
+		/// Returns whether agent @e a is at its goal.
+		bool has_arrived(size_t a) const;
+
+		/// Returns the current time.
+		size_t get_time() const;
+		/// Returns the number of reservations.
+		size_t n_reservations() const;
+		/// Returns the number of pairs of agents in the same cell.
+		size_t n_conflicts() const;
+};
+
+} // -- namespace charanim
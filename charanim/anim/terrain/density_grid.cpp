@@ -0,0 +1,202 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/density_grid.hpp>
+
+// C++ includes
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+namespace charanim {
+
+// default decay factor of the densities
+#define DENSITY_DECAY 0.9f
+
+// PUBLIC
+
+density_grid::density_grid() {
+	front = 0;
+	resX = resY = 0;
+	lenX = lenY = 0.0f;
+	radius = 0.0f;
+	decay = DENSITY_DECAY;
+	interval = 1;
+	steps = 0;
+}
+
+density_grid::~density_grid() {
+	clear();
+}
+
+// MODIFIERS
+
+void density_grid::init(size_t cellsx, size_t cellsy, float dx, float dy) {
+	resX = cellsx;
+	resY = cellsy;
+	lenX = dx/resX;
+	lenY = dy/resY;
+	radius = 2.0f*std::max(lenX, lenY);
+	steps = 0;
+	buffers[0].assign(resX*resY, 0.0f);
+	buffers[1].assign(resX*resY, 0.0f);
+	front = 0;
+}
+
+void density_grid::clear() {
+	buffers[0].clear();
+	buffers[1].clear();
+	row_start.clear();
+	sorted.clear();
+	front = 0;
+	resX = resY = 0;
+	steps = 0;
+}
+
+bool density_grid::step(const vector<vec2>& positions) {
+	++steps;
+	if (steps < interval) {
+		return false;
+	}
+	steps = 0;
+	update(positions);
+	return true;
+}
+
+void density_grid::update(const vector<vec2>& positions) {
+	if (resX == 0 or resY == 0) {
+		return;
+	}
+
+	const int b = 1 - front.load();
+	const float *in = &buffers[1 - b][0];
+	float *out = &buffers[b][0];
+
+	auto row_of =
+	[&](const vec2& p) -> size_t {
+		const int y = static_cast<int>(std::floor(p.y/lenY));
+		return static_cast<size_t>(std::min(std::max(y, 0), static_cast<int>(resY) - 1));
+	};
+
+	// bucket the agents by rows (counting sort)
+	row_start.assign(resY + 1, 0);
+	for (const vec2& p : positions) {
+		++row_start[row_of(p) + 1];
+	}
+	for (size_t y = 0; y < resY; ++y) {
+		row_start[y + 1] += row_start[y];
+	}
+	sorted.resize(positions.size());
+	vector<size_t> next(row_start.begin(), row_start.end() - 1);
+	for (const vec2& p : positions) {
+		sorted[next[row_of(p)]++] = p;
+	}
+
+	// rows of cells reached by the footprint of an agent
+	const int ry = static_cast<int>(std::ceil(radius/lenY));
+	const int _resX = static_cast<int>(resX);
+	const int _resY = static_cast<int>(resY);
+
+	#pragma omp parallel for
+	for (int y = 0; y < _resY; ++y) {
+		float *row = out + size_t(y)*resX;
+		const float *prev = in + size_t(y)*resX;
+		for (size_t x = 0; x < resX; ++x) {
+			row[x] = decay*prev[x];
+		}
+
+		const float cy = lenY*y + lenY/2.0f;
+		const size_t r0 = static_cast<size_t>(std::max(y - ry, 0));
+		const size_t r1 = static_cast<size_t>(std::min(y + ry, _resY - 1));
+		for (size_t i = row_start[r0]; i < row_start[r1 + 1]; ++i) {
+			const vec2& p = sorted[i];
+			const int x0 = std::max(0, static_cast<int>(std::floor((p.x - radius)/lenX)));
+			const int x1 = std::min(_resX - 1, static_cast<int>(std::floor((p.x + radius)/lenX)));
+			for (int x = x0; x <= x1; ++x) {
+				const float d = physim::math::dist(p, vec2(lenX*x + lenX/2.0f, cy));
+				if (d < radius) {
+					row[x] += 1.0f - d/radius;
+				}
+			}
+		}
+	}
+
+	front = b;
+}
+
+// SETTERS
+
+void density_grid::set_radius(float r) {
+	radius = r;
+}
+
+void density_grid::set_decay(float d) {
+	decay = std::min(std::max(d, 0.0f), 1.0f);
+}
+
+void density_grid::set_interval(size_t n) {
+	interval = std::max(n, static_cast<size_t>(1));
+}
+
+// GETTERS
+
+const float *density_grid::get_density() const {
+	if (resX == 0 or resY == 0) {
+		return nullptr;
+	}
+	return &buffers[front.load()][0];
+}
+
+float density_grid::get_density(const vec2& p) const {
+	const int x = static_cast<int>(std::floor(p.x/lenX));
+	const int y = static_cast<int>(std::floor(p.y/lenY));
+	if (resX == 0 or x < 0 or y < 0 or
+		x >= static_cast<int>(resX) or y >= static_cast<int>(resY))
+	{
+		return 0.0f;
+	}
+	return buffers[front.load()][size_t(y)*resX + size_t(x)];
+}
+
+size_t density_grid::get_resX() const {
+	return resX;
+}
+
+size_t density_grid::get_resY() const {
+	return resY;
+}
+
+float density_grid::get_radius() const {
+	return radius;
+}
+
+float density_grid::get_decay() const {
+	return decay;
+}
+
+size_t density_grid::get_interval() const {
+	return interval;
+}
+
+} // -- namespace charanim
@@ -0,0 +1,162 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+#include <atomic>
+#include <vector>
+
+// charanim includes
+#include <anim/definitions.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Density of agents on the cells of a regular grid.
+ *
+ * Every cell holds a measure of how crowded it is, made from the
+ * positions of the agents: every agent adds \f$1 - d/r\f$ to the cells
+ * whose centre is at a distance \f$d < r\f$ from it, where @e r is the
+ * radius of its footprint. At every update the previous densities are
+ * multiplied by a decay factor before the agents are added, so that the
+ * density is an exponential moving average of the positions.
+ *
+ * The densities are double-buffered: updates write the buffer not read
+ * by the searches (see @ref regular_grid::set_density) and then swap
+ * the buffers. A search only has to read @ref get_density once, and the
+ * buffer it gets stays valid until the next update after it.
+ *
+ * Updates are parallel: the agents are bucketed by rows and every row of
+ * the grid is written by one thread.
+ */
+class density_grid {
+	private:
+		/// The buffer read and the buffer written.
+		std::vector<float> buffers[2];
+		/// Index of the buffer read (see @ref get_density).
+		std::atomic<int> front;
+
+		/// Number of cells in the x-axis.
+		size_t resX;
+		/// Number of cells in the y-axis.
+		size_t resY;
+		/// Length of every cell in the x-axis.
+		float lenX;
+		/// Length of every cell in the y-axis.
+		float lenY;
+
+		/// Radius of the footprint of every agent.
+		float radius;
+		/// Factor applied to the densities at every update.
+		float decay;
+		/// Number of calls to @ref step between updates.
+		size_t interval;
+		/// Calls to @ref step since the last update.
+		size_t steps;
+
+		/// Index in @ref sorted of the first agent of every row.
+		std::vector<size_t> row_start;
+		/// Positions of the agents sorted by row.
+		std::vector<vec2> sorted;
+
+	public:
+		/// Default constructor.
+		density_grid();
+		/// Destructor.
+		~density_grid();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Initialises the densities to 0.
+		 *
+		 * The grid must have the same cells as the regular grid it is
+		 * used with. The radius of the footprints is set to twice the
+		 * length of a cell.
+		 * @param cellsx Number of cells in the x-axis.
+		 * @param cellsy Number of cells in the y-axis.
+		 * @param dx Continuous dimension in the x-axis.
+		 * @param dy Continuous dimension in the y-axis.
+		 */
+		void init(size_t cellsx, size_t cellsy, float dx, float dy);
+
+		/// Clears the memory occupied by this grid.
+		void clear();
+
+		/**
+		 * @brief Advances one step of the simulation.
+		 *
+		 * Every @ref interval steps, calls @ref update.
+		 * @param positions Positions of the agents.
+		 * @return Returns true if the densities were updated.
+		 */
+		bool step(const std::vector<vec2>& positions);
+
+		/**
+		 * @brief Updates the densities.
+		 *
+		 * Writes the decayed densities plus the footprints of the agents
+		 * into the buffer not read, and swaps the buffers.
+		 * @param positions Positions of the agents.
+		 */
+		void update(const std::vector<vec2>& positions);
+
+		// SETTERS
+
+		/// Sets the radius of the footprint of every agent.
+		void set_radius(float r);
+		/**
+		 * @brief Sets the decay factor, in [0,1].
+		 *
+		 * The densities of @e k updates ago are weighted by
+		 * \f$decay^k\f$. With 0 only the last positions count. By
+		 * default, 0.9.
+		 */
+		void set_decay(float d);
+		/// Sets the number of steps between updates (at least 1).
+		void set_interval(size_t n);
+
+		// GETTERS
+
+		/**
+		 * @brief Returns the densities of the cells.
+		 *
+		 * The buffer read, resX*resY values by rows.
+		 */
+		const float *get_density() const;
+		/// Returns the density of the cell of point @e p (0 outside).
+		float get_density(const vec2& p) const;
+
+		/// Returns the number of cells in the x-axis.
+		size_t get_resX() const;
+		/// Returns the number of cells in the y-axis.
+		size_t get_resY() const;
+		/// Returns the radius of the footprint of every agent.
+		float get_radius() const;
+		/// Returns the decay factor.
+		float get_decay() const;
+		/// Returns the number of steps between updates.
+		size_t get_interval() const;
+};
+
+} // -- namespace charanim
@@ -0,0 +1,161 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/grid_search.hpp>
+
+// C++ includes
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <queue>
+using namespace std;
+
+namespace charanim {
+namespace grid_search {
+
+template<int N, class cost_function, class heuristic_function, class node_storage>
+bool astar(
+	const float *cells, size_t resX, size_t resY,
+	float R, const bitmask *mask,
+	size_t start, size_t goal,
+	const cost_function& cost, const heuristic_function& h,
+	node_storage& S,
+	vector<size_t>& path
+)
+{
+	static_assert(N == 4 or N == 8, "Connectivity must be 4 or 8");
+
+	// offsets of the neighbours in the order
+	// of the bits of bitmask::neighbours
+	static const int dx[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+	static const int dy[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+	// neighbours used with each connectivity
+	const uint32_t used = (N == 8 ? 0xff : 0x5a);
+
+	const int _resX = static_cast<int>(resX);
+	const int _resY = static_cast<int>(resY);
+
+	S.init(resX*resY);
+
+	// OPEN: (priority, cell), stale entries are skipped
+	priority_queue<
+		pair<double, size_t>,
+		vector<pair<double, size_t> >,
+		greater<pair<double, size_t> >
+	> OPEN;
+
+	S.set(start, 0.0, start);
+	OPEN.push(make_pair(0.0, start));
+
+	bool reached_goal = false;
+	while (not OPEN.empty()) {
+		const size_t cur = OPEN.top().second;
+		OPEN.pop();
+		if (S.is_closed(cur)) {
+			continue;
+		}
+		if (cur == goal) {
+			reached_goal = true;
+			break;
+		}
+		S.close(cur);
+
+		const int cx = static_cast<int>(cur%resX);
+		const int cy = static_cast<int>(cur/resX);
+		const double cur_cost = S.get_cost(cur);
+
+		uint32_t bits = 0;
+		if (mask != nullptr) {
+			bits = mask->neighbours(cx, cy) & used;
+		}
+		else {
+			for (int i = 0; i < 8; ++i) {
+				if ((used & (1 << i)) == 0) {
+					continue;
+				}
+				const int nx = cx + dx[i];
+				const int ny = cy + dy[i];
+				if (0 <= nx and nx < _resX and 0 <= ny and ny < _resY and
+					cells[static_cast<size_t>(ny)*resX + nx] >= R)
+				{
+					bits |= (1 << i);
+				}
+			}
+		}
+
+		while (bits != 0) {
+			const int i = __builtin_ctz(bits);
+			bits &= bits - 1;
+
+			const int nx = cx + dx[i];
+			const int ny = cy + dy[i];
+			const size_t n = static_cast<size_t>(ny)*resX + nx;
+
+			const double g = cur_cost + cost(dx[i], dy[i], n);
+			if (g < S.get_cost(n)) {
+				// closed cells are reopened
+				S.set(n, g, cur);
+				OPEN.push(make_pair(g + h(nx, ny, n), n));
+			}
+		}
+	}
+
+	if (not reached_goal) {
+		return false;
+	}
+
+	// make path from goal to start and reverse
+	size_t c = goal;
+	while (c != start) {
+		path.push_back(c);
+		c = S.get_parent(c);
+	}
+	std::reverse(path.begin(), path.end());
+	return true;
+}
+
+// INSTANTIATIONS
+
+#define instantiate_astar(N, C, H, S)						\
+	template bool astar<N, C, H, S>(						\
+		const float *, size_t, size_t, float, const bitmask *,	\
+		size_t, size_t, const C&, const H&, S&, vector<size_t>&	\
+	);
+
+instantiate_astar(4, euclidean_cost, clearance_heuristic, dense_storage)
+instantiate_astar(4, euclidean_cost, clearance_heuristic, hashed_storage)
+instantiate_astar(4, euclidean_cost, euclidean_heuristic, dense_storage)
+instantiate_astar(4, euclidean_cost, euclidean_heuristic, hashed_storage)
+instantiate_astar(8, euclidean_cost, clearance_heuristic, dense_storage)
+instantiate_astar(8, euclidean_cost, clearance_heuristic, hashed_storage)
+instantiate_astar(8, euclidean_cost, euclidean_heuristic, dense_storage)
+instantiate_astar(8, euclidean_cost, euclidean_heuristic, hashed_storage)
+instantiate_astar(4, density_cost, clearance_heuristic, dense_storage)
+instantiate_astar(4, density_cost, clearance_heuristic, hashed_storage)
+instantiate_astar(4, density_cost, euclidean_heuristic, dense_storage)
+instantiate_astar(4, density_cost, euclidean_heuristic, hashed_storage)
+instantiate_astar(8, density_cost, clearance_heuristic, dense_storage)
+instantiate_astar(8, density_cost, clearance_heuristic, hashed_storage)
+instantiate_astar(8, density_cost, euclidean_heuristic, dense_storage)
+instantiate_astar(8, density_cost, euclidean_heuristic, hashed_storage)
+
+} // -- namespace grid_search
+} // -- namespace charanim
@@ -0,0 +1,240 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <cmath>
+
+// charanim includes
+#include <anim/definitions.hpp>
+#include <anim/utils/bitmask.hpp>
+
+namespace charanim {
+namespace grid_search {
+
+/*
+ * Building blocks of the A* searches on the cells of a regular grid.
+ *
+ * The search core (@ref astar) is a template on the connectivity of the
+ * cells, the cost of the moves, the heuristic and the storage of the
+ * nodes, so that the compiler can inline all of them and unroll the loop
+ * over the neighbours of a cell. It is explicitly instantiated for the
+ * combinations of the classes below.
+ */
+
+// COSTS
+
+/// Cost of a move: euclidean distance between the cells.
+struct euclidean_cost {
+	inline double operator() (int dx, int dy, size_t) const {
+		return (dx != 0 and dy != 0 ? M_SQRT2 : 1.0);
+	}
+};
+
+/**
+ * @brief Euclidean distance plus the crowd density of the cell entered.
+ *
+ * \f$l_2 + w \cdot d\f$ where @e d is the density of the cell moved to
+ * (see @ref density_grid). The term is never negative, so the euclidean
+ * heuristics are still admissible.
+ */
+struct density_cost {
+	/// Densities of the cells.
+	const float *density;
+	/// Weight of the density.
+	double w;
+
+	inline double operator() (int dx, int dy, size_t idx) const {
+		return (dx != 0 and dy != 0 ? M_SQRT2 : 1.0) + w*density[idx];
+	}
+};
+
+// HEURISTICS
+
+/**
+ * @brief Heuristic preferring cells far from the obstacles.
+ *
+ * \f$a \cdot l_2 - b \cdot c\f$ where \f$l_2\f$ is the euclidean distance
+ * to the goal and @e c is the value of the cell. Not admissible.
+ */
+struct clearance_heuristic {
+	/// Values of the cells.
+	const float *cells;
+	/// Number of cells in the x-axis.
+	size_t resX;
+	/// Goal cell.
+	int gx, gy;
+	/// Weight of the distance to the goal.
+	double a;
+	/// Weight of the value of the cell.
+	double b;
+
+	inline double operator() (int x, int y, size_t idx) const {
+		const double dx = x - gx;
+		const double dy = y - gy;
+		return a*std::sqrt(dx*dx + dy*dy) - b*cells[idx];
+	}
+};
+
+/**
+ * @brief Weighted euclidean distance to the goal.
+ *
+ * With weight \f$\epsilon \ge 1\f$ the cost of the paths found is at
+ * most \f$\epsilon\f$ times the optimum.
+ */
+struct euclidean_heuristic {
+	/// Goal cell.
+	int gx, gy;
+	/// Weight \f$\epsilon\f$.
+	double eps;
+
+	inline double operator() (int x, int y, size_t) const {
+		const double dx = x - gx;
+		const double dy = y - gy;
+		return eps*std::sqrt(dx*dx + dy*dy);
+	}
+};
+
+// NODE STORAGE
+
+/**
+ * @brief Nodes stored in arrays with one entry per cell.
+ *
+ * Initialising it takes time linear in the number of cells: it is best
+ * for searches that visit a large part of the grid.
+ */
+class dense_storage {
+	private:
+		/// Cost of the best path to every cell.
+		std::vector<double> g;
+		/// Previous cell in the best path to every cell.
+		std::vector<size_t> parent;
+		/// Is the cell closed?
+		std::vector<char> closed;
+
+	public:
+		/// Makes room for @e n cells.
+		inline void init(size_t n) {
+			g.assign(n, std::numeric_limits<double>::max());
+			parent.resize(n);
+			closed.assign(n, 0);
+		}
+
+		inline double get_cost(size_t i) const { return g[i]; }
+		inline size_t get_parent(size_t i) const { return parent[i]; }
+		inline bool is_closed(size_t i) const { return closed[i] != 0; }
+
+		inline void set(size_t i, double c, size_t p) {
+			g[i] = c;
+			parent[i] = p;
+			closed[i] = 0;
+		}
+		inline void close(size_t i) { closed[i] = 1; }
+};
+
+/**
+ * @brief Nodes stored in a hash table.
+ *
+ * Only the cells visited take memory: it is best for short searches on
+ * large grids.
+ */
+class hashed_storage {
+	private:
+		/// A visited cell.
+		struct record {
+			double g;
+			size_t parent;
+			bool closed;
+		};
+		/// The visited cells.
+		std::unordered_map<size_t, record> nodes;
+
+	public:
+		/// Removes all nodes.
+		inline void init(size_t) {
+			nodes.clear();
+		}
+
+		inline double get_cost(size_t i) const {
+			auto it = nodes.find(i);
+			return (it == nodes.end() ? std::numeric_limits<double>::max() : it->second.g);
+		}
+		inline size_t get_parent(size_t i) const { return nodes.find(i)->second.parent; }
+		inline bool is_closed(size_t i) const {
+			auto it = nodes.find(i);
+			return it != nodes.end() and it->second.closed;
+		}
+
+		inline void set(size_t i, double c, size_t p) {
+			record& r = nodes[i];
+			r.g = c;
+			r.parent = p;
+			r.closed = false;
+		}
+		inline void close(size_t i) { nodes[i].closed = true; }
+};
+
+// SEARCH
+
+/**
+ * @brief A* search on the cells of a grid.
+ *
+ * A cell is traversable if its value is at least @e R or, if @e mask is
+ * not null, if its bit in @e mask is set. Closed cells reached again with
+ * a lower cost are reopened, so the heuristic need not be consistent.
+ * @tparam N Connectivity of the cells: 4 or 8.
+ * @tparam cost_function Cost of a move to cell @e idx:
+ * double(int dx, int dy, size_t idx).
+ * @tparam heuristic_function Estimated cost to the goal:
+ * double(int x, int y, size_t idx).
+ * @tparam node_storage Storage of the nodes, like @ref dense_storage.
+ * @param[in] cells Values of the cells.
+ * @param[in] resX Number of cells in the x-axis.
+ * @param[in] resY Number of cells in the y-axis.
+ * @param[in] R Minimum value of the cells of the path.
+ * @param[in] mask Traversability mask for @e R, or nullptr.
+ * @param[in] start Index of the starting cell.
+ * @param[in] goal Index of the goal cell.
+ * @param[in] cost Cost function.
+ * @param[in] h Heuristic function.
+ * @param[in] S Storage of the nodes.
+ * @param[out] path Indices of the cells of the path, from the cell after
+ * @e start to @e goal.
+ * @return Returns false if @e goal was not reached.
+ */
+template<int N, class cost_function, class heuristic_function, class node_storage>
+bool astar(
+	const float *cells, size_t resX, size_t resY,
+	float R, const bitmask *mask,
+	size_t start, size_t goal,
+	const cost_function& cost, const heuristic_function& h,
+	node_storage& S,
+	std::vector<size_t>& path
+);
+
+} // -- namespace grid_search
+} // -- namespace charanim
@@ -0,0 +1,387 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <cmath>
+
+// charanim includes
+#include <anim/definitions.hpp>
+
+namespace charanim {
+namespace grid_traversal {
+
+/*
+ * Traversal of the cells of a grid crossed by segments. The cells are
+ * passed to a callback, f(x,y). If the callback returns a bool,
+ * the traversal stops as soon as it returns false.
+ *
+ * These functions are templates so that the callback is inlined: there
+ * is no virtual call per cell as in @ref ray_rasterize.
+ */
+
+namespace detail {
+
+	// calls f(x,y), returns its value
+	template<typename F>
+	inline typename std::enable_if<
+		std::is_same<typename std::result_of<F&(int,int)>::type, bool>::value, bool
+	>::type
+	visit(F& f, int x, int y) {
+		return f(x,y);
+	}
+
+	// calls f(x,y), returns true
+	template<typename F>
+	inline typename std::enable_if<
+		not std::is_same<typename std::result_of<F&(int,int)>::type, bool>::value, bool
+	>::type
+	visit(F& f, int x, int y) {
+		f(x,y);
+		return true;
+	}
+
+} // -- namespace detail
+
+/**
+ * @brief Squared distance from point (x,y) to the box [x0,x1]x[y0,y1].
+ *
+ * It is 0 if the point is inside the box.
+ */
+inline float point_box_dist2
+(float x, float y, float x0, float y0, float x1, float y1)
+{
+	const float dx = std::max(std::max(x0 - x, 0.0f), x - x1);
+	const float dy = std::max(std::max(y0 - y, 0.0f), y - y1);
+	return dx*dx + dy*dy;
+}
+
+/// Squared distance from point (x,y) to the segment @e pq.
+inline float point_segment_dist2(float x, float y, const vec2& p, const vec2& q) {
+	const float ux = q.x - p.x;
+	const float uy = q.y - p.y;
+	const float uu = ux*ux + uy*uy;
+	float t = 0.0f;
+	if (uu > 0.0f) {
+		t = std::min(1.0f, std::max(0.0f, ((x - p.x)*ux + (y - p.y)*uy)/uu));
+	}
+	const float dx = p.x + t*ux - x;
+	const float dy = p.y + t*uy - y;
+	return dx*dx + dy*dy;
+}
+
+/**
+ * @brief Does the segment @e pq intersect the box [x0,x1]x[y0,y1]?
+ *
+ * The segment is clipped against the slabs of the box (Liang-Barsky).
+ */
+inline bool segment_meets_box
+(const vec2& p, const vec2& q, float x0, float y0, float x1, float y1)
+{
+	const float d[2] = {q.x - p.x, q.y - p.y};
+	const float lo[2] = {x0 - p.x, y0 - p.y};
+	const float hi[2] = {x1 - p.x, y1 - p.y};
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+	for (int k = 0; k < 2; ++k) {
+		if (d[k] == 0.0f) {
+			if (lo[k] > 0.0f or hi[k] < 0.0f) {
+				return false;
+			}
+			continue;
+		}
+		float a = lo[k]/d[k];
+		float b = hi[k]/d[k];
+		if (a > b) {
+			std::swap(a, b);
+		}
+		t0 = std::max(t0, a);
+		t1 = std::min(t1, b);
+		if (t0 > t1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Squared distance from the segment @e pq to the box [x0,x1]x[y0,y1].
+inline float segment_box_dist2
+(const vec2& p, const vec2& q, float x0, float y0, float x1, float y1)
+{
+	if (segment_meets_box(p, q, x0, y0, x1, y1)) {
+		return 0.0f;
+	}
+	// otherwise the distance is attained at an end point
+	// of the segment or at a corner of the box
+	float d = std::min(
+		point_box_dist2(p.x, p.y, x0, y0, x1, y1),
+		point_box_dist2(q.x, q.y, x0, y0, x1, y1)
+	);
+	d = std::min(d, point_segment_dist2(x0, y0, p, q));
+	d = std::min(d, point_segment_dist2(x1, y0, p, q));
+	d = std::min(d, point_segment_dist2(x0, y1, p, q));
+	d = std::min(d, point_segment_dist2(x1, y1, p, q));
+	return d;
+}
+
+/**
+ * @brief Iterates through the cells from @e ini to @e fin, 4-way.
+ *
+ * Consecutive cells share an edge. At every step, the traversal moves
+ * along the axis whose cell boundary the segment crosses first. When the
+ * segment crosses a corner of a cell exactly, only one of the two cells
+ * next to the corner is visited.
+ * @param ini First cell.
+ * @param fin Last cell.
+ * @param f Callback, called with the coordinates of each cell.
+ * @return Returns false if the callback stopped the traversal.
+ */
+template<typename F>
+bool for_each_cell(const latticePoint& ini, const latticePoint& fin, F&& f) {
+	const int64_t nx = std::abs(fin.x() - ini.x());
+	const int64_t ny = std::abs(fin.y() - ini.y());
+	const int sx = (fin.x() > ini.x() ? 1 : -1);
+	const int sy = (fin.y() > ini.y() ? 1 : -1);
+
+	int x = ini.x();
+	int y = ini.y();
+	if (not detail::visit(f, x, y)) {
+		return false;
+	}
+
+	int64_t ix = 0;
+	int64_t iy = 0;
+	while (ix < nx or iy < ny) {
+		// the boundaries in x are crossed at (1 + 2*ix)/(2*nx)
+		// of the segment, those in y at (1 + 2*iy)/(2*ny)
+		if ((1 + 2*ix)*ny < (1 + 2*iy)*nx) {
+			x += sx;
+			++ix;
+		}
+		else {
+			y += sy;
+			++iy;
+		}
+		if (not detail::visit(f, x, y)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Iterates through the cells from @e ini to @e fin, supercover.
+ *
+ * Like @ref for_each_cell, but when the segment crosses a corner of a
+ * cell exactly the traversal steps diagonally, visiting first the two
+ * cells next to the corner. Then, every cell touched by the segment is
+ * visited, so the cells visited block the segment both for 4-way and
+ * 8-way movements.
+ * @param ini First cell.
+ * @param fin Last cell.
+ * @param f Callback, called with the coordinates of each cell.
+ * @return Returns false if the callback stopped the traversal.
+ */
+template<typename F>
+bool for_each_cell_supercover(const latticePoint& ini, const latticePoint& fin, F&& f) {
+	const int64_t nx = std::abs(fin.x() - ini.x());
+	const int64_t ny = std::abs(fin.y() - ini.y());
+	const int sx = (fin.x() > ini.x() ? 1 : -1);
+	const int sy = (fin.y() > ini.y() ? 1 : -1);
+
+	int x = ini.x();
+	int y = ini.y();
+	if (not detail::visit(f, x, y)) {
+		return false;
+	}
+
+	int64_t ix = 0;
+	int64_t iy = 0;
+	while (ix < nx or iy < ny) {
+		const int64_t cx = (1 + 2*ix)*ny;
+		const int64_t cy = (1 + 2*iy)*nx;
+		if (cx < cy) {
+			x += sx;
+			++ix;
+		}
+		else if (cx > cy) {
+			y += sy;
+			++iy;
+		}
+		else {
+			// the segment crosses a corner
+			if (not detail::visit(f, x + sx, y)) {
+				return false;
+			}
+			if (not detail::visit(f, x, y + sy)) {
+				return false;
+			}
+			x += sx;
+			y += sy;
+			++ix;
+			++iy;
+		}
+		if (not detail::visit(f, x, y)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Iterates through the cells touched by a thick segment.
+ *
+ * Conservative rasterisation of the capsule made of the points at
+ * distance at most @e r from the segment @e pq: every cell of the grid
+ * that has a point in the capsule is visited, row by row. With @e r = 0
+ * these are all the cells the segment touches, including both cells
+ * when it runs along the boundary between them.
+ * @param p First end point of the segment, in continuous coordinates.
+ * @param q Second end point of the segment, in continuous coordinates.
+ * @param r Radius of the capsule (half the thickness of the segment).
+ * @param lenX Length of every cell in the x-axis.
+ * @param lenY Length of every cell in the y-axis.
+ * @param resX Number of cells in the x-axis.
+ * @param resY Number of cells in the y-axis.
+ * @param f Callback, called with the coordinates of each cell.
+ * @return Returns false if the callback stopped the traversal.
+ */
+template<typename F>
+bool for_each_cell_capsule(
+	const vec2& p, const vec2& q, float r,
+	float lenX, float lenY, int resX, int resY,
+	F&& f
+)
+{
+	const float r2 = r*r;
+	const int y_min = std::max(0, static_cast<int>(std::floor((std::min(p.y, q.y) - r)/lenY)));
+	const int y_max = std::min(resY - 1, static_cast<int>(std::floor((std::max(p.y, q.y) + r)/lenY)));
+
+	for (int cy = y_min; cy <= y_max; ++cy) {
+		const float y0 = cy*lenY;
+		const float y1 = y0 + lenY;
+
+		// part of the segment within distance r of the row
+		float t0 = 0.0f;
+		float t1 = 1.0f;
+		const float dy = q.y - p.y;
+		if (dy != 0.0f) {
+			float a = (y0 - r - p.y)/dy;
+			float b = (y1 + r - p.y)/dy;
+			if (a > b) {
+				std::swap(a, b);
+			}
+			t0 = std::max(t0, a);
+			t1 = std::min(t1, b);
+			if (t0 > t1) {
+				continue;
+			}
+		}
+		const float xa = p.x + t0*(q.x - p.x);
+		const float xb = p.x + t1*(q.x - p.x);
+		const int x_min = std::max(0, static_cast<int>(std::floor((std::min(xa, xb) - r)/lenX)));
+		const int x_max = std::min(resX - 1, static_cast<int>(std::floor((std::max(xa, xb) + r)/lenX)));
+
+		for (int cx = x_min; cx <= x_max; ++cx) {
+			const float x0 = cx*lenX;
+			if (segment_box_dist2(p, q, x0, y0, x0 + lenX, y1) > r2) {
+				continue;
+			}
+			if (not detail::visit(f, cx, cy)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Iterates through the cells inside a polygon.
+ *
+ * Scanline filling: every cell whose centre is inside the polygon
+ * (even-odd rule) is visited, row by row. The polygon is closed: its
+ * last vertex is joined to the first.
+ * @param poly Vertices of the polygon, in continuous coordinates.
+ * @param lenX Length of every cell in the x-axis.
+ * @param lenY Length of every cell in the y-axis.
+ * @param resX Number of cells in the x-axis.
+ * @param resY Number of cells in the y-axis.
+ * @param f Callback, called with the coordinates of each cell.
+ * @return Returns false if the callback stopped the traversal.
+ */
+template<typename F>
+bool for_each_cell_polygon(
+	const std::vector<vec2>& poly,
+	float lenX, float lenY, int resX, int resY,
+	F&& f
+)
+{
+	if (poly.size() < 3) {
+		return true;
+	}
+
+	float lo = poly[0].y;
+	float hi = poly[0].y;
+	for (const vec2& v : poly) {
+		lo = std::min(lo, v.y);
+		hi = std::max(hi, v.y);
+	}
+	const int y_min = std::max(0, static_cast<int>(std::floor(lo/lenY)));
+	const int y_max = std::min(resY - 1, static_cast<int>(std::floor(hi/lenY)));
+
+	// abscissae of the edges crossing the centre line of a row
+	std::vector<float> xs;
+	for (int cy = y_min; cy <= y_max; ++cy) {
+		const float y = lenY*cy + lenY/2.0f;
+
+		xs.clear();
+		for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++) {
+			const vec2& p = poly[j];
+			const vec2& q = poly[i];
+			// half-open in y so that vertices are not counted twice
+			if ((p.y <= y) != (q.y <= y)) {
+				xs.push_back(p.x + (y - p.y)*(q.x - p.x)/(q.y - p.y));
+			}
+		}
+		std::sort(xs.begin(), xs.end());
+
+		for (size_t k = 0; k + 1 < xs.size(); k += 2) {
+			// cells whose centre is in [xs[k], xs[k+1]]
+			const int x_min = std::max(0, static_cast<int>(std::ceil(xs[k]/lenX - 0.5f)));
+			const int x_max = std::min(resX - 1, static_cast<int>(std::floor(xs[k + 1]/lenX - 0.5f)));
+			for (int cx = x_min; cx <= x_max; ++cx) {
+				if (not detail::visit(f, cx, cy)) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+} // -- namespace grid_traversal
+} // -- namespace charanim
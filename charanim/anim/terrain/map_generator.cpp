@@ -0,0 +1,343 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/map_generator.hpp>
+
+// C++ includes
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <queue>
+#include <cmath>
+using namespace std;
+
+namespace charanim {
+namespace map_generator {
+
+// The distributions of the standard library are implementation-defined:
+// the numbers are made from the output of mt19937 directly, so that the
+// same seed gives the same map with any standard library.
+
+// Uniform real number in [lo,hi], from the 24 high bits of 'gen'.
+static inline
+float uniform_real(mt19937& gen, float lo, float hi) {
+	const float u = static_cast<float>(gen() >> 8)*(1.0f/16777216.0f);
+	return lo + (hi - lo)*u;
+}
+
+// Uniform integer in [0,n), n > 0. The values of 'gen' past the
+// largest multiple of n are rejected so that there is no bias.
+static inline
+size_t uniform_index(mt19937& gen, size_t n) {
+	const uint64_t range = uint64_t(1) << 32;
+	const uint64_t limit = range - range%n;
+	uint64_t r;
+	do {
+		r = static_cast<uint64_t>(gen());
+	}
+	while (r >= limit);
+	return static_cast<size_t>(r%n);
+}
+
+// Adds the wall from 'a' to 'b' with a door of width 'door' at a
+// random position. The wall is split into (at most) two segments.
+// Walls not longer than the door are not added: the whole wall is
+// the door. Returns the distance from 'a' to the door.
+static inline
+float wall_with_door
+(const vec2& a, const vec2& b, float door, mt19937& gen, vector<segment>& segs)
+{
+	const float L = std::sqrt((b.x - a.x)*(b.x - a.x) + (b.y - a.y)*(b.y - a.y));
+	if (L <= door) {
+		return 0.0f;
+	}
+	const vec2 u((b.x - a.x)/L, (b.y - a.y)/L);
+	const float t = uniform_real(gen, 0.0f, L - door);
+	if (t > 0.0f) {
+		segs.push_back(segment(a, a + u*t));
+	}
+	if (t + door < L) {
+		segs.push_back(segment(a + u*(t + door), b));
+	}
+	return t;
+}
+
+void maze(float dimX, float dimY, size_t n, size_t seed, vector<segment>& segs) {
+	segs.clear();
+	mt19937 gen(seed);
+
+	// A perfect maze of kx x ky cells has about kx*ky walls. Its
+	// border is made of the walls enclosing the terrain.
+	const float W = dimX - 1.0f;
+	const float H = dimY - 1.0f;
+	const float side = std::sqrt(W*H/std::max(n, size_t(1)));
+	const size_t kx = std::max(size_t(1), static_cast<size_t>(std::round(W/side)));
+	const size_t ky = std::max(size_t(1), static_cast<size_t>(std::round(H/side)));
+	const float cx = W/kx;
+	const float cy = H/ky;
+
+	// right[y*kx + x]: wall between (x,y) and (x+1,y)
+	// top[y*kx + x]: wall between (x,y) and (x,y+1)
+	vector<char> right(kx*ky, 1);
+	vector<char> top(kx*ky, 1);
+	vector<char> visited(kx*ky, 0);
+
+	// randomised depth-first search
+	vector<size_t> stack;
+	stack.push_back(0);
+	visited[0] = 1;
+	while (stack.size() > 0) {
+		const size_t c = stack.back();
+		const size_t x = c%kx;
+		const size_t y = c/kx;
+
+		size_t ns[4];
+		size_t k = 0;
+		if (x > 0 and not visited[c - 1]) ns[k++] = c - 1;
+		if (x + 1 < kx and not visited[c + 1]) ns[k++] = c + 1;
+		if (y > 0 and not visited[c - kx]) ns[k++] = c - kx;
+		if (y + 1 < ky and not visited[c + kx]) ns[k++] = c + kx;
+		if (k == 0) {
+			stack.pop_back();
+			continue;
+		}
+
+		const size_t next = ns[uniform_index(gen, k)];
+		if (next == c - 1) right[c - 1] = 0;
+		else if (next == c + 1) right[c] = 0;
+		else if (next == c - kx) top[c - kx] = 0;
+		else top[c] = 0;
+
+		visited[next] = 1;
+		stack.push_back(next);
+	}
+
+	// coordinates of the corners of the cells: the last ones are
+	// exactly on the walls enclosing the terrain
+	auto X = [&](size_t x) -> float { return (x == kx ? W : x*cx); };
+	auto Y = [&](size_t y) -> float { return (y == ky ? H : y*cy); };
+
+	for (size_t y = 0; y < ky; ++y) {
+		for (size_t x = 0; x < kx; ++x) {
+			if (x + 1 < kx and right[y*kx + x]) {
+				segs.push_back(segment(
+					vec2(X(x + 1), Y(y)), vec2(X(x + 1), Y(y + 1))
+				));
+			}
+			if (y + 1 < ky and top[y*kx + x]) {
+				segs.push_back(segment(
+					vec2(X(x), Y(y + 1)), vec2(X(x + 1), Y(y + 1))
+				));
+			}
+		}
+	}
+}
+
+void rooms(float dimX, float dimY, size_t n, size_t seed, vector<segment>& segs) {
+	segs.clear();
+	mt19937 gen(seed);
+
+	// A room: [x0,x1] x [y0,y1]. Each side of a room has at most one
+	// door: the one of the wall the side lies on. 'door' is where the
+	// door starts (the coordinate along the side), or -1.
+	// Sides: 0 -> y=y0, 1 -> y=y1, 2 -> x=x0, 3 -> x=x1
+	struct room {
+		float x0, y0, x1, y1;
+		float door[4];
+		inline float area() const { return (x1 - x0)*(y1 - y0); }
+		inline bool operator< (const room& r) const { return area() < r.area(); }
+	};
+
+	// every split adds about 2 segments: n/2 rooms
+	const float W = dimX - 1.0f;
+	const float H = dimY - 1.0f;
+	const float side = std::sqrt(2.0f*W*H/std::max(n, size_t(1)));
+	const float door = std::max(3.0f, side/3.0f);
+
+	priority_queue<room> Q;
+	Q.push(room{0.0f, 0.0f, W, H, {-1.0f, -1.0f, -1.0f, -1.0f}});
+
+	// does a wall at 'p' block the door starting at 'd'?
+	auto blocks =
+	[&](float p, float d) -> bool {
+		return d >= 0.0f and d - 0.5f <= p and p <= d + door + 0.5f;
+	};
+	// keeps the door 'd' of the side of a child room, if it is in
+	// the range [lo,hi] of the side
+	auto inherit =
+	[](float d, float lo, float hi) -> float {
+		return (lo <= d and d <= hi ? d : -1.0f);
+	};
+
+	while (segs.size() < n and Q.size() > 0) {
+		room r = Q.top();
+		Q.pop();
+
+		const bool vertical = (r.x1 - r.x0 >= r.y1 - r.y0);
+		const float lo = (vertical ? r.x0 : r.y0);
+		const float len = (vertical ? r.x1 - r.x0 : r.y1 - r.y0);
+		if (len < 3.0f*door) {
+			// the largest room is too small
+			break;
+		}
+
+		// large rooms are split with a corridor
+		const float corridor = (len > 8.0f*side ? door : 0.0f);
+		// the sides crossed by the new walls
+		const float d0 = (vertical ? r.door[0] : r.door[2]);
+		const float d1 = (vertical ? r.door[1] : r.door[3]);
+
+		// new walls must not block the doors of the room
+		float p = 0.0f;
+		bool found = false;
+		for (int k = 0; k < 16 and not found; ++k) {
+			p = lo + uniform_real(gen, 0.3f, 0.7f)*(len - corridor);
+			found = not blocks(p, d0) and not blocks(p, d1) and
+					not blocks(p + corridor, d0) and not blocks(p + corridor, d1);
+		}
+		if (not found) {
+			continue;
+		}
+
+		room a = r;
+		room b = r;
+		if (vertical) {
+			a.x1 = p;
+			b.x0 = p + corridor;
+			a.door[0] = inherit(r.door[0], r.x0, p);
+			a.door[1] = inherit(r.door[1], r.x0, p);
+			b.door[0] = inherit(r.door[0], p + corridor, r.x1);
+			b.door[1] = inherit(r.door[1], p + corridor, r.x1);
+			a.door[3] = r.y0 + wall_with_door(vec2(p, r.y0), vec2(p, r.y1), door, gen, segs);
+			b.door[2] = a.door[3];
+			if (corridor > 0.0f) {
+				b.door[2] = r.y0 + wall_with_door
+					(vec2(p + corridor, r.y0), vec2(p + corridor, r.y1), door, gen, segs);
+			}
+		}
+		else {
+			a.y1 = p;
+			b.y0 = p + corridor;
+			a.door[2] = inherit(r.door[2], r.y0, p);
+			a.door[3] = inherit(r.door[3], r.y0, p);
+			b.door[2] = inherit(r.door[2], p + corridor, r.y1);
+			b.door[3] = inherit(r.door[3], p + corridor, r.y1);
+			a.door[1] = r.x0 + wall_with_door(vec2(r.x0, p), vec2(r.x1, p), door, gen, segs);
+			b.door[0] = a.door[1];
+			if (corridor > 0.0f) {
+				b.door[0] = r.x0 + wall_with_door
+					(vec2(r.x0, p + corridor), vec2(r.x1, p + corridor), door, gen, segs);
+			}
+		}
+		Q.push(a);
+		Q.push(b);
+	}
+}
+
+void clutter(float dimX, float dimY, size_t n, size_t seed, vector<segment>& segs) {
+	segs.clear();
+	mt19937 gen(seed);
+
+	const float W = dimX - 1.0f;
+	const float H = dimY - 1.0f;
+	const float side = std::sqrt(W*H/std::max(n, size_t(1)));
+
+	auto clamp =
+	[&](const vec2& p) {
+		return vec2(
+			std::min(std::max(p.x, 1.0f), W - 1.0f),
+			std::min(std::max(p.y, 1.0f), H - 1.0f)
+		);
+	};
+
+	segs.reserve(n);
+	for (size_t i = 0; i < n; ++i) {
+		// the order of evaluation of arguments is unspecified
+		const float x = uniform_real(gen, 1.0f, W - 1.0f);
+		const float y = uniform_real(gen, 1.0f, H - 1.0f);
+		const vec2 c(x, y);
+		const float a = uniform_real(gen, 0.0f, 2.0f*float(M_PI));
+		const float l = 0.5f*uniform_real(gen, 0.25f*side, 0.75f*side);
+		const vec2 u(std::cos(a)*l, std::sin(a)*l);
+		segs.push_back(segment(clamp(c - u), clamp(c + u)));
+	}
+}
+
+void warehouse(float dimX, float dimY, size_t n, size_t seed, vector<segment>& segs) {
+	segs.clear();
+	mt19937 gen(seed);
+
+	// n/4 shelves, each in a box 4 times longer than wide
+	const float W = dimX - 3.0f;
+	const float H = dimY - 3.0f;
+	const size_t m = std::max(size_t(1), n/4);
+	const float py0 = std::sqrt(W*H/(4.0f*m));
+	const size_t cols = std::max(size_t(1), static_cast<size_t>(W/(4.0f*py0)));
+	const size_t rows = std::max(size_t(1), static_cast<size_t>(H/py0));
+	const float px = W/cols;
+	const float py = H/rows;
+
+	segs.reserve(4*cols*rows);
+	for (size_t r = 0; r < rows; ++r) {
+		for (size_t c = 0; c < cols; ++c) {
+			// some shelves (5%) are missing
+			if (uniform_real(gen, 0.0f, 1.0f) < 0.05f) {
+				continue;
+			}
+			// the shelf takes 80% of the length and 40% of the
+			// width of its box: the rest are the aisles
+			const float x0 = 1.0f + c*px + 0.1f*px;
+			const float x1 = 1.0f + c*px + 0.9f*px;
+			const float y0 = 1.0f + r*py + 0.3f*py;
+			const float y1 = 1.0f + r*py + 0.7f*py;
+			segs.push_back(segment(vec2(x0, y0), vec2(x1, y0)));
+			segs.push_back(segment(vec2(x1, y0), vec2(x1, y1)));
+			segs.push_back(segment(vec2(x1, y1), vec2(x0, y1)));
+			segs.push_back(segment(vec2(x0, y1), vec2(x0, y0)));
+		}
+	}
+}
+
+bool generate(
+	const string& kind, float dimX, float dimY,
+	size_t n, size_t seed, vector<segment>& segs
+)
+{
+	if (kind == "maze") {
+		maze(dimX, dimY, n, seed, segs);
+	}
+	else if (kind == "rooms") {
+		rooms(dimX, dimY, n, seed, segs);
+	}
+	else if (kind == "clutter") {
+		clutter(dimX, dimY, n, seed, segs);
+	}
+	else if (kind == "warehouse") {
+		warehouse(dimX, dimY, n, seed, segs);
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+} // -- namespace map_generator
+} // -- namespace charanim
@@ -0,0 +1,96 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// charanim includes
+#include <anim/definitions.hpp>
+
+namespace charanim {
+namespace map_generator {
+
+/*
+ * Procedural generation of the segments of maps.
+ *
+ * Every generator places about @e n segments in the rectangle
+ * [0, dimX-1] x [0, dimY-1], leaving free the border of the terrain
+ * (the walls enclosing it are added by @ref terrain). The same seed
+ * gives the same segments, with any implementation of the standard
+ * library.
+ */
+
+/**
+ * @brief Perfect maze.
+ *
+ * A grid of square cells, with walls between neighbouring cells, from
+ * which walls are removed until every cell can be reached from any other
+ * in exactly one way (randomised depth-first search).
+ */
+void maze(float dimX, float dimY, size_t n, size_t seed, std::vector<segment>& segs);
+
+/**
+ * @brief Rooms and corridors.
+ *
+ * The terrain is split recursively, the largest room first, with walls
+ * with a door. Large rooms are split with a corridor between two walls,
+ * each with its own door.
+ */
+void rooms(float dimX, float dimY, size_t n, size_t seed, std::vector<segment>& segs);
+
+/**
+ * @brief Random clutter.
+ *
+ * Segments at random positions, with random orientations and lengths
+ * proportional to the mean distance between segments. Some parts of the
+ * terrain may not be reachable.
+ */
+void clutter(float dimX, float dimY, size_t n, size_t seed, std::vector<segment>& segs);
+
+/**
+ * @brief Warehouse aisles.
+ *
+ * Rectangular shelves (4 segments each) in rows separated by aisles, and
+ * in columns separated by cross aisles. Random shelves are missing.
+ */
+void warehouse(float dimX, float dimY, size_t n, size_t seed, std::vector<segment>& segs);
+
+/**
+ * @brief Generates a map of the given kind.
+ * @param kind One of "maze", "rooms", "clutter", "warehouse".
+ * @param dimX Dimension in the x-axis.
+ * @param dimY Dimension in the y-axis.
+ * @param n Number of segments (approximately).
+ * @param seed Seed of the random number generator.
+ * @param[out] segs Segments generated.
+ * @return Returns false if @e kind is not valid.
+ */
+bool generate(
+	const std::string& kind, float dimX, float dimY,
+	size_t n, size_t seed, std::vector<segment>& segs
+);
+
+} // -- namespace map_generator
+} // -- namespace charanim
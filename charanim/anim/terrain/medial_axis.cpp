@@ -0,0 +1,697 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/medial_axis.hpp>
+
+// C++ includes
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <cmath>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+namespace charanim {
+
+#define MAX_DINF numeric_limits<double>::max()
+#define global_xy(x,y) static_cast<size_t>(y)*resX + static_cast<size_t>(x)
+#define vec2_out(c) "(" << c.x << "," << c.y << ")"
+
+typedef pair<double, size_t> dist_cell;
+typedef priority_queue<dist_cell, vector<dist_cell>, greater<dist_cell> > min_queue;
+
+// PRIVATE
+
+void medial_axis::make_ridges() {
+	const float *cells = rg->get_grid();
+	// cells too close to the obstacles are never part of the skeleton
+	const float min_clearance = std::max(lenX, lenY);
+
+	const int _resX = static_cast<int>(resX);
+	const int _resY = static_cast<int>(resY);
+
+	// horizontal, vertical, and both diagonals
+	const int dirs[4][2] = {{1,0}, {0,1}, {1,1}, {1,-1}};
+
+	auto value_at =
+	[&](int x, int y) -> float {
+		if (x < 0 or y < 0 or x >= _resX or y >= _resY) {
+			return 0.0f;
+		}
+		return cells[global_xy(x,y)];
+	};
+
+	#pragma omp parallel for
+	for (int y = 0; y < _resY; ++y) {
+		for (int x = 0; x < _resX; ++x) {
+			const float d = cells[global_xy(x,y)];
+			if (d <= min_clearance) {
+				continue;
+			}
+
+			for (int k = 0; k < 4; ++k) {
+				const float da = value_at(x - dirs[k][0], y - dirs[k][1]);
+				const float db = value_at(x + dirs[k][0], y + dirs[k][1]);
+				if (d >= da and d >= db and (d > da or d > db)) {
+					skeleton[global_xy(x,y)] = 1;
+					break;
+				}
+			}
+		}
+	}
+}
+
+void medial_axis::thin_ridges() {
+	const int _resX = static_cast<int>(resX);
+	const int _resY = static_cast<int>(resY);
+
+	auto at =
+	[&](int x, int y) -> int {
+		if (x < 0 or y < 0 or x >= _resX or y >= _resY) {
+			return 0;
+		}
+		return skeleton[global_xy(x,y)];
+	};
+
+	// only the cells of the ridges can be removed
+	vector<size_t> candidates;
+	for (size_t i = 0; i < resX*resY; ++i) {
+		if (skeleton[i] == 1) {
+			candidates.push_back(i);
+		}
+	}
+
+	vector<size_t> to_remove;
+	bool changed = true;
+	while (changed) {
+		changed = false;
+
+		for (int step = 0; step < 2; ++step) {
+			to_remove.clear();
+
+			for (size_t c : candidates) {
+				if (skeleton[c] == 0) {
+					continue;
+				}
+				const int x = static_cast<int>(c%resX);
+				const int y = static_cast<int>(c/resX);
+
+				// neighbours in clockwise order, starting
+				// at the one above the cell
+				const int p[8] = {
+					at(x, y - 1), at(x + 1, y - 1), at(x + 1, y), at(x + 1, y + 1),
+					at(x, y + 1), at(x - 1, y + 1), at(x - 1, y), at(x - 1, y - 1)
+				};
+
+				int B = 0;
+				int A = 0;
+				for (int k = 0; k < 8; ++k) {
+					B += p[k];
+					A += (p[k] == 0 and p[(k + 1)%8] == 1);
+				}
+				if (B < 2 or B > 6 or A != 1) {
+					continue;
+				}
+
+				if (step == 0) {
+					if (p[0]*p[2]*p[4] != 0 or p[2]*p[4]*p[6] != 0) {
+						continue;
+					}
+				}
+				else {
+					if (p[0]*p[2]*p[6] != 0 or p[0]*p[4]*p[6] != 0) {
+						continue;
+					}
+				}
+				to_remove.push_back(c);
+			}
+
+			for (size_t c : to_remove) {
+				skeleton[c] = 0;
+			}
+			changed = changed or to_remove.size() > 0;
+		}
+	}
+}
+
+void medial_axis::make_graph() {
+	const float *grid = rg->get_grid();
+	size_t ns[8];
+
+	// junctions and ends of the skeleton
+	for (size_t c = 0; c < resX*resY; ++c) {
+		if (skeleton[c] == 1 and skeleton_neighbours(c, ns) != 2) {
+			node_of_cell[c] = nodes.size();
+			nodes.push_back(c);
+		}
+	}
+	node_edges.resize(nodes.size());
+
+	// follows the chain of cells that starts at node
+	// 'n' and continues through cell 'first'
+	auto trace =
+	[&](size_t n, size_t first) {
+		edge e;
+		e.from = n;
+		e.length = cell_dist(nodes[n], first);
+		e.clearance = std::min(grid[nodes[n]], grid[first]);
+
+		size_t prev = nodes[n];
+		size_t cur = first;
+		while (node_of_cell.find(cur) == node_of_cell.end()) {
+			edge_of_cell[cur] = make_pair(edges.size(), e.cells.size());
+			e.cells.push_back(cur);
+
+			// the cells of a chain have exactly two neighbours
+			skeleton_neighbours(cur, ns);
+			size_t next = (ns[0] == prev ? ns[1] : ns[0]);
+
+			e.length += cell_dist(cur, next);
+			e.clearance = std::min(e.clearance, grid[next]);
+			prev = cur;
+			cur = next;
+		}
+		e.to = node_of_cell[cur];
+
+		node_edges[e.from].push_back(edges.size());
+		if (e.to != e.from) {
+			node_edges[e.to].push_back(edges.size());
+		}
+		edges.push_back(e);
+	};
+
+	for (size_t n = 0; n < nodes.size(); ++n) {
+		size_t k = skeleton_neighbours(nodes[n], ns);
+		// 'ns' is modified by 'trace'
+		vector<size_t> neighs(ns, ns + k);
+
+		for (size_t c : neighs) {
+			auto it = node_of_cell.find(c);
+			if (it != node_of_cell.end()) {
+				// two adjacent nodes: add the edge only once
+				if (n < it->second) {
+					trace(n, c);
+				}
+			}
+			else if (edge_of_cell.find(c) == edge_of_cell.end()) {
+				trace(n, c);
+			}
+		}
+	}
+
+	// closed chains without junctions: one of
+	// their cells is made a node
+	for (size_t c = 0; c < resX*resY; ++c) {
+		if (skeleton[c] == 1 and
+			node_of_cell.find(c) == node_of_cell.end() and
+			edge_of_cell.find(c) == edge_of_cell.end())
+		{
+			size_t n = nodes.size();
+			node_of_cell[c] = n;
+			nodes.push_back(c);
+			node_edges.push_back(vector<size_t>());
+
+			skeleton_neighbours(c, ns);
+			trace(n, ns[0]);
+		}
+	}
+}
+
+size_t medial_axis::skeleton_neighbours(size_t c, size_t ns[8]) const {
+	const int _resX = static_cast<int>(resX);
+	const int _resY = static_cast<int>(resY);
+	const int x = static_cast<int>(c%resX);
+	const int y = static_cast<int>(c/resX);
+
+	auto in_skeleton =
+	[&](int i, int j) -> bool {
+		if (i < 0 or j < 0 or i >= _resX or j >= _resY) {
+			return false;
+		}
+		return skeleton[global_xy(i,j)] == 1;
+	};
+
+	size_t n = 0;
+	for (int dy = -1; dy <= 1; ++dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			if (dx == 0 and dy == 0) {
+				continue;
+			}
+			if (not in_skeleton(x + dx, y + dy)) {
+				continue;
+			}
+			if (dx != 0 and dy != 0 and
+				(in_skeleton(x + dx, y) or in_skeleton(x, y + dy)))
+			{
+				continue;
+			}
+			ns[n] = global_xy(x + dx, y + dy);
+			++n;
+		}
+	}
+	return n;
+}
+
+bool medial_axis::connect
+(size_t c, size_t stop, float R, vector<size_t>& cells) const
+{
+	const float *grid = rg->get_grid();
+	const int _resX = static_cast<int>(resX);
+	const int _resY = static_cast<int>(resY);
+
+	unordered_map<size_t, double> dist;
+	unordered_map<size_t, size_t> parent;
+
+	min_queue Q;
+	dist[c] = 0.0;
+	Q.push(make_pair(0.0, c));
+
+	bool found = false;
+	size_t reached = c;
+	while (not Q.empty()) {
+		const double d = Q.top().first;
+		const size_t u = Q.top().second;
+		Q.pop();
+		if (d > dist[u]) {
+			continue;
+		}
+		if (u == stop or (skeleton[u] == 1 and grid[u] >= R)) {
+			found = true;
+			reached = u;
+			break;
+		}
+
+		const int x = static_cast<int>(u%resX);
+		const int y = static_cast<int>(u/resX);
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				const int nx = x + dx;
+				const int ny = y + dy;
+				if (nx < 0 or ny < 0 or nx >= _resX or ny >= _resY) {
+					continue;
+				}
+				const size_t v = global_xy(nx, ny);
+				if (v == u or grid[v] < R) {
+					continue;
+				}
+
+				const double nd = d + cell_dist(u, v);
+				auto it = dist.find(v);
+				if (it == dist.end() or nd < it->second) {
+					dist[v] = nd;
+					parent[v] = u;
+					Q.push(make_pair(nd, v));
+				}
+			}
+		}
+	}
+
+	if (not found) {
+		return false;
+	}
+
+	cells.clear();
+	for (size_t u = reached; u != c; u = parent[u]) {
+		cells.push_back(u);
+	}
+	cells.push_back(c);
+	std::reverse(cells.begin(), cells.end());
+	return true;
+}
+
+bool medial_axis::skeleton_path
+(size_t a, size_t b, float R, vector<size_t>& cells) const
+{
+	const float *grid = rg->get_grid();
+
+	// Ways of reaching a node from a cell of the skeleton: from
+	// a node, the node itself; from the inner cell of an edge,
+	// both ends of the edge.
+	struct entry {
+		size_t node;
+		double cost;
+		// cells from the cell to the node (both included)
+		vector<size_t> cells;
+	};
+
+	auto make_entries =
+	[&](size_t c, vector<entry>& E) {
+		auto nit = node_of_cell.find(c);
+		if (nit != node_of_cell.end()) {
+			entry en;
+			en.node = nit->second;
+			en.cost = 0.0;
+			en.cells.push_back(c);
+			E.push_back(en);
+			return;
+		}
+
+		const pair<size_t,size_t>& ep = edge_of_cell.at(c);
+		const edge& e = edges[ep.first];
+
+		for (int side = 0; side < 2; ++side) {
+			entry en;
+			en.node = (side == 0 ? e.from : e.to);
+			en.cells.push_back(c);
+
+			if (side == 0) {
+				for (size_t i = ep.second; i > 0; --i) {
+					en.cells.push_back(e.cells[i - 1]);
+				}
+			}
+			else {
+				for (size_t i = ep.second + 1; i < e.cells.size(); ++i) {
+					en.cells.push_back(e.cells[i]);
+				}
+			}
+			en.cells.push_back(nodes[en.node]);
+
+			float length = 0.0f;
+			float clearance = grid[c];
+			for (size_t i = 1; i < en.cells.size(); ++i) {
+				length += cell_dist(en.cells[i - 1], en.cells[i]);
+				clearance = std::min(clearance, grid[en.cells[i]]);
+			}
+			if (clearance >= R) {
+				en.cost = chain_cost(length, clearance);
+				E.push_back(en);
+			}
+		}
+	};
+
+	vector<entry> from_a, from_b;
+	make_entries(a, from_a);
+	make_entries(b, from_b);
+
+	// both cells in the same edge: the cells in
+	// between are a path between them
+	double best = MAX_DINF;
+	vector<size_t> direct;
+	if (a == b) {
+		best = 0.0;
+		direct.push_back(a);
+	}
+	else {
+		auto ait = edge_of_cell.find(a);
+		auto bit = edge_of_cell.find(b);
+		if (ait != edge_of_cell.end() and bit != edge_of_cell.end() and
+			ait->second.first == bit->second.first)
+		{
+			const edge& e = edges[ait->second.first];
+			const size_t i = ait->second.second;
+			const size_t j = bit->second.second;
+			if (i < j) {
+				direct.assign(e.cells.begin() + i, e.cells.begin() + j + 1);
+			}
+			else {
+				direct.assign(e.cells.rbegin() + (e.cells.size() - 1 - i),
+							  e.cells.rbegin() + (e.cells.size() - j));
+			}
+
+			float length = 0.0f;
+			float clearance = grid[direct[0]];
+			for (size_t k = 1; k < direct.size(); ++k) {
+				length += cell_dist(direct[k - 1], direct[k]);
+				clearance = std::min(clearance, grid[direct[k]]);
+			}
+			if (clearance >= R) {
+				best = chain_cost(length, clearance);
+			}
+			else {
+				direct.clear();
+			}
+		}
+	}
+
+	// Dijkstra's search over the nodes, from all the entries
+	// of 'a' to all the entries of 'b'
+	vector<double> dist(nodes.size(), MAX_DINF);
+	vector<int> parent_edge(nodes.size(), -1);
+	vector<int> source_entry(nodes.size(), -1);
+	vector<int> sink_entry(nodes.size(), -1);
+
+	min_queue Q;
+	for (size_t i = 0; i < from_a.size(); ++i) {
+		const entry& en = from_a[i];
+		if (en.cost < dist[en.node]) {
+			dist[en.node] = en.cost;
+			source_entry[en.node] = static_cast<int>(i);
+			Q.push(make_pair(en.cost, en.node));
+		}
+	}
+	for (size_t i = 0; i < from_b.size(); ++i) {
+		const entry& en = from_b[i];
+		if (sink_entry[en.node] == -1 or
+			en.cost < from_b[sink_entry[en.node]].cost)
+		{
+			sink_entry[en.node] = static_cast<int>(i);
+		}
+	}
+
+	int best_node = -1;
+	while (not Q.empty()) {
+		const double d = Q.top().first;
+		const size_t u = Q.top().second;
+		Q.pop();
+		if (d > dist[u]) {
+			continue;
+		}
+		if (d >= best) {
+			break;
+		}
+
+		if (sink_entry[u] != -1) {
+			double total = d + from_b[sink_entry[u]].cost;
+			if (total < best) {
+				best = total;
+				best_node = static_cast<int>(u);
+			}
+		}
+
+		for (size_t ei : node_edges[u]) {
+			const edge& e = edges[ei];
+			if (e.clearance < R) {
+				continue;
+			}
+			const size_t v = (e.from == u ? e.to : e.from);
+			const double nd = d + chain_cost(e.length, e.clearance);
+			if (nd < dist[v]) {
+				dist[v] = nd;
+				parent_edge[v] = static_cast<int>(ei);
+				source_entry[v] = -1;
+				Q.push(make_pair(nd, v));
+			}
+		}
+	}
+
+	if (best == MAX_DINF) {
+		return false;
+	}
+	if (best_node == -1) {
+		cells = direct;
+		return true;
+	}
+
+	// make path from 'b' to 'a' and reverse
+	cells = from_b[sink_entry[best_node]].cells;
+	size_t u = static_cast<size_t>(best_node);
+	while (parent_edge[u] != -1) {
+		const edge& e = edges[parent_edge[u]];
+		if (e.to == u) {
+			cells.insert(cells.end(), e.cells.rbegin(), e.cells.rend());
+			u = e.from;
+		}
+		else {
+			cells.insert(cells.end(), e.cells.begin(), e.cells.end());
+			u = e.to;
+		}
+		cells.push_back(nodes[u]);
+	}
+	const vector<size_t>& first = from_a[source_entry[u]].cells;
+	cells.insert(cells.end(), first.rbegin(), first.rend());
+
+	std::reverse(cells.begin(), cells.end());
+	cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+	return true;
+}
+
+double medial_axis::chain_cost(float length, float clearance) const {
+	const float M = rg->get_max_dist();
+	return length*(1.0 + clearance_weight*(1.0 - clearance/M));
+}
+
+size_t medial_axis::cell_of(const vec2& p) const {
+	size_t x = static_cast<size_t>(std::max(0.0f, p.x/lenX));
+	size_t y = static_cast<size_t>(std::max(0.0f, p.y/lenY));
+	x = std::min(x, resX - 1);
+	y = std::min(y, resY - 1);
+	return global_xy(x,y);
+}
+
+float medial_axis::cell_dist(size_t a, size_t b) const {
+	const float dx = (float(a%resX) - float(b%resX))*lenX;
+	const float dy = (float(a/resX) - float(b/resX))*lenY;
+	return std::sqrt(dx*dx + dy*dy);
+}
+
+// PUBLIC
+
+medial_axis::medial_axis() {
+	rg = nullptr;
+	resX = resY = 0;
+	lenX = lenY = 0.0f;
+	clearance_weight = 1.0f;
+}
+
+medial_axis::~medial_axis() {
+	clear();
+}
+
+// MODIFIERS
+
+void medial_axis::init(const regular_grid *_rg) {
+	clear();
+
+	rg = _rg;
+	resX = rg->get_resX();
+	resY = rg->get_resY();
+	lenX = rg->get_dimX()/resX;
+	lenY = rg->get_dimY()/resY;
+
+	skeleton.assign(resX*resY, 0);
+	make_ridges();
+	thin_ridges();
+	make_graph();
+}
+
+void medial_axis::clear() {
+	rg = nullptr;
+	resX = resY = 0;
+	lenX = lenY = 0.0f;
+	skeleton.clear();
+	nodes.clear();
+	edges.clear();
+	node_edges.clear();
+	node_of_cell.clear();
+	edge_of_cell.clear();
+}
+
+// SETTERS
+
+void medial_axis::set_clearance_weight(float w) {
+	clearance_weight = w;
+}
+
+// GETTERS
+
+void medial_axis::find_path(
+	const vec2& source, const vec2& sink,
+	float R,
+	vector<vec2>& path,
+	vector<vec2>& smoothed_path
+) const
+{
+	const float *grid = rg->get_grid();
+	const size_t s = cell_of(source);
+	const size_t t = cell_of(sink);
+
+	if (grid[s] <= R) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't start at " << vec2_out(source) << endl;
+		cerr << "    This position is at a distance from a static obstacle"
+			 << " of: " << grid[s] << endl;
+		return;
+	}
+	if (grid[t] <= R) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't finish at " << vec2_out(sink) << endl;
+		cerr << "    This position is at a distance from a static obstacle"
+			 << " of: " << grid[t] << endl;
+		return;
+	}
+
+	// cells from the source to the skeleton, and from the sink
+	// to the skeleton. Either search may reach the other end.
+	vector<size_t> to_s, to_t, chain;
+	vector<size_t> cells;
+
+	if (not connect(s, t, R, to_s)) {
+		cerr << "medial_axis::find_path - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not reach the skeleton from "
+			 << vec2_out(source) << endl;
+		return;
+	}
+
+	if (to_s.back() == t) {
+		cells = to_s;
+	}
+	else {
+		if (not connect(t, s, R, to_t)) {
+			cerr << "medial_axis::find_path - Error (" << __LINE__ << "):" << endl;
+			cerr << "    Could not reach the skeleton from "
+				 << vec2_out(sink) << endl;
+			return;
+		}
+
+		if (to_t.back() == s) {
+			cells.assign(to_t.rbegin(), to_t.rend());
+		}
+		else if (skeleton_path(to_s.back(), to_t.back(), R, chain)) {
+			cells = to_s;
+			cells.insert(cells.end(), chain.begin(), chain.end());
+			cells.insert(cells.end(), to_t.rbegin(), to_t.rend());
+			cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+		}
+		else {
+			// the source and the sink are in different
+			// components of the skeleton
+			rg->find_path(source, sink, R, path, smoothed_path);
+			return;
+		}
+	}
+
+	for (size_t c : cells) {
+		path.push_back(get_cell_centre(c));
+	}
+	rg->smooth_path(path, smoothed_path);
+}
+
+const vector<char>& medial_axis::get_skeleton() const {
+	return skeleton;
+}
+
+const vector<size_t>& medial_axis::get_nodes() const {
+	return nodes;
+}
+
+const vector<medial_axis::edge>& medial_axis::get_edges() const {
+	return edges;
+}
+
+vec2 medial_axis::get_cell_centre(size_t c) const {
+	return vec2(lenX*(c%resX) + lenX/2.0f, lenY*(c/resX) + lenY/2.0f);
+}
+
+} // -- namespace charanim
@@ -0,0 +1,228 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+#include <vector>
+
+// charanim includes
+#include <anim/definitions.hpp>
+#include <anim/terrain/regular_grid.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Medial axis of the free space of a regular grid.
+ *
+ * The medial axis (also, Voronoi skeleton) is the set of points of the
+ * free space that are equidistant to at least two obstacles. It is
+ * extracted from the distance function of a @ref regular_grid: the ridge
+ * cells of the function are thinned into a skeleton one cell wide, and
+ * the skeleton is compressed into a graph whose nodes are the junctions
+ * and the ends of the skeleton and whose edges are the chains of cells
+ * between them.
+ *
+ * Paths are found by connecting the source and the sink to the skeleton
+ * with a small search on the grid, and then searching the graph. Since
+ * the skeleton is as far as possible from the obstacles, the paths found
+ * have maximum clearance.
+ */
+class medial_axis {
+	public:
+		/// An edge of the skeleton: a chain of cells between two nodes.
+		struct edge {
+			/// First node of the edge.
+			size_t from;
+			/// Second node of the edge.
+			size_t to;
+			/// Length of the chain of cells.
+			float length;
+			/// Minimum value of the distance function along the chain.
+			float clearance;
+			/// Inner cells of the chain, sorted from @e from to @e to.
+			std::vector<size_t> cells;
+		};
+
+	private:
+		/// Grid from which the skeleton was extracted.
+		const regular_grid *rg;
+
+		/// Number of cells in the x-axis.
+		size_t resX;
+		/// Number of cells in the y-axis.
+		size_t resY;
+		/// Length of every cell in the x-axis.
+		float lenX;
+		/// Length of every cell in the y-axis.
+		float lenY;
+
+		/// skeleton[i] is 1 if the i-th cell is in the skeleton.
+		std::vector<char> skeleton;
+
+		/// Cell of every node.
+		std::vector<size_t> nodes;
+		/// Edges of the graph.
+		std::vector<edge> edges;
+		/// Edges incident to every node.
+		std::vector<std::vector<size_t> > node_edges;
+
+		/// Node of a cell, for the cells of the skeleton that are nodes.
+		std::unordered_map<size_t, size_t> node_of_cell;
+		/**
+		 * @brief Edge of a cell, for the cells of the skeleton that are
+		 * not nodes.
+		 *
+		 * Maps a cell to its edge and its position in @ref edge::cells.
+		 */
+		std::unordered_map<size_t, std::pair<size_t,size_t> > edge_of_cell;
+
+		/**
+		 * @brief Weight of the clearance in the cost of the edges.
+		 *
+		 * The cost of traversing an edge is
+		 *
+		 * \f$l \cdot (1 + w \cdot (1 - c/M))\f$
+		 *
+		 * where \f$l\f$ is its length, \f$c\f$ its clearance, \f$M\f$ the
+		 * maximum value of the distance function, and \f$w\f$ this weight.
+		 */
+		float clearance_weight;
+
+	private:
+
+		/**
+		 * @brief Marks the ridge cells of the distance function.
+		 *
+		 * A cell is a ridge cell if it is a local maximum of the distance
+		 * function in, at least, one of the four directions of the grid
+		 * (horizontal, vertical and both diagonals).
+		 */
+		void make_ridges();
+		/// Thins the ridges (Zhang-Suen) into a skeleton one cell wide.
+		void thin_ridges();
+		/// Compresses the skeleton into a graph.
+		void make_graph();
+
+		/**
+		 * @brief Finds the neighbours of cell @e c in the skeleton.
+		 *
+		 * A diagonal neighbour is ignored if one of the two cells
+		 * adjacent to both is in the skeleton, so that the staircases of
+		 * the skeleton are chains and not triangles.
+		 * @return Returns the amount of neighbours in @e ns.
+		 */
+		size_t skeleton_neighbours(size_t c, size_t ns[8]) const;
+
+		/**
+		 * @brief Connects a cell to the skeleton.
+		 *
+		 * Dijkstra's search on the grid from cell @e c until a cell of the
+		 * skeleton, or the cell @e stop, is reached. Only cells at a
+		 * distance larger than @e R from the obstacles are used.
+		 * @param[in] c Starting cell.
+		 * @param[in] stop Cell that also ends the search.
+		 * @param[in] R Radius of the agent.
+		 * @param[out] cells Path from @e c to the cell reached (included).
+		 * @return Returns false if neither the skeleton nor @e stop could
+		 * be reached.
+		 */
+		bool connect
+		(size_t c, size_t stop, float R, std::vector<size_t>& cells) const;
+
+		/**
+		 * @brief Finds a path between two cells of the skeleton.
+		 * @param[in] a First cell, in the skeleton.
+		 * @param[in] b Second cell, in the skeleton.
+		 * @param[in] R Radius of the agent.
+		 * @param[out] cells Cells of the skeleton from @e a to @e b.
+		 * @return Returns false if there is no such path.
+		 */
+		bool skeleton_path
+		(size_t a, size_t b, float R, std::vector<size_t>& cells) const;
+
+		/// Cost of traversing a chain (see @ref clearance_weight).
+		double chain_cost(float length, float clearance) const;
+
+		/// Converts a point to its cell.
+		size_t cell_of(const vec2& p) const;
+		/// Distance between the centres of two cells.
+		float cell_dist(size_t a, size_t b) const;
+
+	public:
+		/// Default constructor.
+		medial_axis();
+		/// Destructor.
+		~medial_axis();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Extracts the skeleton of the grid.
+		 * @param rg Regular grid with its distance function already
+		 * computed (see @ref regular_grid::make_final_state). The grid
+		 * must outlive this object.
+		 */
+		void init(const regular_grid *rg);
+
+		/// Clears the memory occupied by this object.
+		void clear();
+
+		// SETTERS
+
+		/// Sets the weight of the clearance (see @ref clearance_weight).
+		void set_clearance_weight(float w);
+
+		// GETTERS
+
+		/**
+		 * @brief Fins a path between two points.
+		 *
+		 * If the sink can be reached before the skeleton the path does
+		 * not go through the skeleton.
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Non-refined path: centres of the cells.
+		 * @param[out] smooth_path Refined path.
+		 */
+		void find_path(
+			const vec2& source, const vec2& sink,
+			float R,
+			std::vector<vec2>& path,
+			std::vector<vec2>& smoothed_path
+		) const;
+
+		/// Returns the cells of the skeleton.
+		const std::vector<char>& get_skeleton() const;
+		/// Returns the cell of every node of the graph.
+		const std::vector<size_t>& get_nodes() const;
+		/// Returns the edges of the graph.
+		const std::vector<edge>& get_edges() const;
+
+		/// Returns the centre of a cell of the grid.
+		vec2 get_cell_centre(size_t c) const;
+};
+
+} // -- namespace charanim
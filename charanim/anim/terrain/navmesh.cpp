@@ -0,0 +1,1177 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/navmesh.hpp>
+
+// C++ includes
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <queue>
+#include <cmath>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+namespace charanim {
+
+#define MAX_DINF numeric_limits<double>::max()
+#define EPS 1e-9
+// distance under which an endpoint of a segment is on another
+// segment. The coordinates are floats: an endpoint lying on another
+// segment (a T-junction) may be off by a few ulps.
+#define DIST_EPS 1e-4
+#define vec2_out(c) "(" << c.x << "," << c.y << ")"
+
+// amount of samples on an edge to estimate its clearance
+#define CLEARANCE_SAMPLES 16
+// cells of the side of the grid of the Hilbert curve
+#define HILBERT_SIDE 65536
+
+static inline
+uint64_t edge_key(size_t a, size_t b) {
+	return (static_cast<uint64_t>(std::min(a,b)) << 32) |
+			static_cast<uint64_t>(std::max(a,b));
+}
+
+// position of cell (x,y) along the Hilbert curve
+// over a grid of HILBERT_SIDE x HILBERT_SIDE cells
+static inline
+uint64_t hilbert_index(uint32_t x, uint32_t y) {
+	uint64_t d = 0;
+	for (uint32_t s = HILBERT_SIDE/2; s > 0; s /= 2) {
+		const uint32_t rx = (x & s) > 0;
+		const uint32_t ry = (y & s) > 0;
+		d += uint64_t(s)*s*((3*rx) ^ ry);
+		// rotate the quadrant
+		if (ry == 0) {
+			if (rx == 1) {
+				x = HILBERT_SIDE - 1 - x;
+				y = HILBERT_SIDE - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+// > 0 if c is to the left of the line through a and b
+static inline
+double cross(const vec2& a, const vec2& b, const vec2& c) {
+	return (double(b.x) - a.x)*(double(c.y) - a.y) -
+		   (double(b.y) - a.y)*(double(c.x) - a.x);
+}
+
+// > 0 if p is inside the circle through a, b, c
+static inline
+bool in_circle(const vec2& a, const vec2& b, const vec2& c, const vec2& p) {
+	double adx = double(a.x) - p.x, ady = double(a.y) - p.y;
+	double bdx = double(b.x) - p.x, bdy = double(b.y) - p.y;
+	double cdx = double(c.x) - p.x, cdy = double(c.y) - p.y;
+	double det =
+		(adx*adx + ady*ady)*(bdx*cdy - cdx*bdy) -
+		(bdx*bdx + bdy*bdy)*(adx*cdy - cdx*ady) +
+		(cdx*cdx + cdy*cdy)*(adx*bdy - bdx*ady);
+	// det is positive for counter-clockwise triangles
+	return (cross(a,b,c) > 0.0 ? det : -det) > EPS;
+}
+
+// do the interiors of segments ab and cd intersect?
+static inline
+bool proper_intersection
+(const vec2& a, const vec2& b, const vec2& c, const vec2& d)
+{
+	double o1 = cross(a,b,c);
+	double o2 = cross(a,b,d);
+	double o3 = cross(c,d,a);
+	double o4 = cross(c,d,b);
+	return ((o1 > EPS and o2 < -EPS) or (o1 < -EPS and o2 > EPS)) and
+		   ((o3 > EPS and o4 < -EPS) or (o3 < -EPS and o4 > EPS));
+}
+
+static inline
+float dist_point_to_segment(const vec2& p, const vec2& a, const vec2& b) {
+	vec2 u = b - a;
+	float uu = physim::math::dot(u,u);
+	if (uu == 0.0f) {
+		return physim::math::dist(p, a);
+	}
+	float l = physim::math::dot(p - a, u)/uu;
+	l = std::max(0.0f, std::min(1.0f, l));
+	return physim::math::dist(p, a + u*l);
+}
+
+// PRIVATE
+
+void navmesh::delaunay_triangulation() {
+	// triangles under construction
+	struct bw_triangle {
+		size_t v[3];
+		int n[3];
+		double cx, cy, r2;
+		bool alive;
+	};
+
+	auto make_triangle =
+	[&](size_t a, size_t b, size_t c) {
+		const vec2& A = vertices[a];
+		const vec2& B = vertices[b];
+		const vec2& C = vertices[c];
+		double d = 2.0*(A.x*(double(B.y) - C.y) +
+						B.x*(double(C.y) - A.y) +
+						C.x*(double(A.y) - B.y));
+		double a2 = double(A.x)*A.x + double(A.y)*A.y;
+		double b2 = double(B.x)*B.x + double(B.y)*B.y;
+		double c2 = double(C.x)*C.x + double(C.y)*C.y;
+
+		bw_triangle t;
+		t.v[0] = a; t.v[1] = b; t.v[2] = c;
+		t.n[0] = t.n[1] = t.n[2] = -1;
+		t.cx = (a2*(double(B.y) - C.y) + b2*(double(C.y) - A.y) +
+				c2*(double(A.y) - B.y))/d;
+		t.cy = (a2*(double(C.x) - B.x) + b2*(double(A.x) - C.x) +
+				c2*(double(B.x) - A.x))/d;
+		t.r2 = (t.cx - A.x)*(t.cx - A.x) + (t.cy - A.y)*(t.cy - A.y);
+		t.alive = true;
+		return t;
+	};
+
+	const size_t N = vertices.size();
+	vector<bw_triangle> tris;
+	tris.push_back(make_triangle(N - 3, N - 2, N - 1));
+
+	// Insertion order: the points are shuffled and split into rounds
+	// of doubling size, and the points of every round are sorted along
+	// a Hilbert curve. Consecutive points are close, so the walks are
+	// short, and the triangulation grows evenly, so the cavities are
+	// small (biased randomised insertion order).
+	float minx = vertices[0].x, maxx = vertices[0].x;
+	float miny = vertices[0].y, maxy = vertices[0].y;
+	for (size_t i = 0; i < N - 3; ++i) {
+		minx = std::min(minx, vertices[i].x); maxx = std::max(maxx, vertices[i].x);
+		miny = std::min(miny, vertices[i].y); maxy = std::max(maxy, vertices[i].y);
+	}
+	const float side = std::max(std::max(maxx - minx, maxy - miny), 1e-3f);
+	vector<pair<uint64_t,size_t> > order(N - 3);
+	for (size_t i = 0; i < N - 3; ++i) {
+		uint32_t x = uint32_t((vertices[i].x - minx)/side*HILBERT_SIDE);
+		uint32_t y = uint32_t((vertices[i].y - miny)/side*HILBERT_SIDE);
+		order[i] = make_pair(hilbert_index(
+			std::min(x, uint32_t(HILBERT_SIDE - 1)),
+			std::min(y, uint32_t(HILBERT_SIDE - 1))
+		), i);
+	}
+	std::shuffle(order.begin(), order.end(), mt19937(0));
+	for (size_t end = order.size(); end > 0; end /= 2) {
+		std::sort(order.begin() + end/2, order.begin() + end);
+	}
+
+	// triangles of the cavity of the point inserted, and its boundary:
+	// oriented edge and the triangle on the other side of the edge
+	vector<int> cavity;
+	vector<pair<pair<size_t,size_t>, int> > boundary;
+	// triangles made for the point inserted
+	vector<int> made;
+	// point whose cavity contains every triangle
+	vector<size_t> mark(1, N);
+	// slots of dead triangles
+	vector<int> free_slots;
+	int last = 0;
+
+	for (size_t k = 0; k < N - 3; ++k) {
+		const size_t i = order[k].second;
+		const vec2& p = vertices[i];
+
+		// walk to the triangle containing p, starting every
+		// step at a different edge so that the walk never loops
+		int t = last;
+		for (size_t step = 0; ; ++step) {
+			const bw_triangle& T = tris[t];
+			int next = -1;
+			for (int f = 0; f < 3 and next == -1; ++f) {
+				const int e = int((f + step)%3);
+				if (cross(vertices[T.v[e]], vertices[T.v[(e + 1)%3]], p) < 0.0) {
+					next = T.n[e];
+				}
+			}
+			if (next == -1) {
+				break;
+			}
+			t = next;
+		}
+
+		// the cavity: the triangles whose circumcircle contains p,
+		// which are connected to the triangle containing p
+		cavity.clear();
+		boundary.clear();
+		cavity.push_back(t);
+		mark[t] = i;
+		for (size_t c = 0; c < cavity.size(); ++c) {
+			const bw_triangle& T = tris[cavity[c]];
+			for (int e = 0; e < 3; ++e) {
+				const int o = T.n[e];
+				if (o != -1 and mark[o] == i) {
+					continue;
+				}
+				bool inside = false;
+				if (o != -1) {
+					const bw_triangle& O = tris[o];
+					double dx = p.x - O.cx;
+					double dy = p.y - O.cy;
+					inside = dx*dx + dy*dy < O.r2*(1.0 - 1e-12);
+				}
+				if (inside) {
+					mark[o] = i;
+					cavity.push_back(o);
+				}
+				else {
+					boundary.push_back(make_pair(
+						make_pair(T.v[e], T.v[(e + 1)%3]), o
+					));
+				}
+			}
+		}
+		for (int c : cavity) {
+			tris[c].alive = false;
+			free_slots.push_back(c);
+		}
+
+		// fill the cavity with a fan of triangles around p
+		made.clear();
+		for (const auto& E : boundary) {
+			const size_t a = E.first.first;
+			const size_t b = E.first.second;
+			int s;
+			if (free_slots.size() > 0) {
+				s = free_slots.back();
+				free_slots.pop_back();
+				tris[s] = make_triangle(a, b, i);
+			}
+			else {
+				s = int(tris.size());
+				tris.push_back(make_triangle(a, b, i));
+				mark.push_back(N);
+			}
+			tris[s].n[0] = E.second;
+			if (E.second != -1) {
+				bw_triangle& O = tris[E.second];
+				for (int f = 0; f < 3; ++f) {
+					if (O.v[f] == b and O.v[(f + 1)%3] == a) {
+						O.n[f] = s;
+					}
+				}
+			}
+			made.push_back(s);
+		}
+		// neighbours among the triangles of the fan
+		for (int s : made) {
+			for (int r : made) {
+				if (tris[r].v[0] == tris[s].v[1]) {
+					tris[s].n[1] = r;
+					tris[r].n[2] = s;
+				}
+			}
+		}
+		last = made[0];
+	}
+
+	// keep the triangles alive, with their neighbours
+	vector<int> index(tris.size(), -1);
+	size_t n_alive = 0;
+	for (size_t t = 0; t < tris.size(); ++t) {
+		if (tris[t].alive) {
+			index[t] = int(n_alive++);
+		}
+	}
+	triangles.clear();
+	triangles.reserve(n_alive);
+	for (const bw_triangle& t : tris) {
+		if (not t.alive) {
+			continue;
+		}
+		triangle T;
+		for (int e = 0; e < 3; ++e) {
+			T.v[e] = t.v[e];
+			T.n[e] = (t.n[e] == -1 ? -1 : index[t.n[e]]);
+			T.constrained[e] = false;
+			T.clearance[e] = 0.0f;
+		}
+		triangles.push_back(T);
+	}
+}
+
+void navmesh::insert_constraint(size_t a, size_t b, vector<int>& vtri) {
+	const vec2& A = vertices[a];
+	const vec2& B = vertices[b];
+
+	auto warning =
+	[&]() {
+		cerr << "navmesh::insert_constraint - Warning (" << __LINE__ << "):" << endl;
+		cerr << "    Could not recover edge " << vec2_out(A)
+			 << " -> " << vec2_out(B) << endl;
+	};
+
+	// Turn around a to find the triangle (a,u,w) the edge enters.
+	// The first crossed edge is (u,w).
+	int t = vtri[a];
+	int first = -1;
+	size_t u = 0, w = 0;
+	for (size_t step = 0; step < triangles.size(); ++step) {
+		const triangle& T = triangles[t];
+		int i = 0;
+		while (T.v[i] != a) {
+			++i;
+		}
+		u = T.v[(i + 1)%3];
+		w = T.v[(i + 2)%3];
+		if (u == b or w == b) {
+			// the edge is already in the triangulation
+			return;
+		}
+		if (cross(A, vertices[u], B) > 0.0 and cross(A, vertices[w], B) < 0.0) {
+			first = t;
+			break;
+		}
+		t = T.n[(i + 2)%3];
+		if (t == -1 or t == vtri[a]) {
+			break;
+		}
+	}
+	if (first == -1) {
+		warning();
+		return;
+	}
+
+	// walk along the edge to find the triangles crossed
+	vector<int> crossed(1, first);
+	t = first;
+	while (true) {
+		const triangle& T = triangles[t];
+		int e = 0;
+		while (edge_key(T.v[e], T.v[(e + 1)%3]) != edge_key(u,w)) {
+			++e;
+		}
+		t = T.n[e];
+		if (t == -1) {
+			warning();
+			return;
+		}
+		crossed.push_back(t);
+
+		const triangle& N = triangles[t];
+		if (N.v[0] == b or N.v[1] == b or N.v[2] == b) {
+			break;
+		}
+		int next = -1;
+		for (int f = 0; f < 3; ++f) {
+			size_t x = N.v[f];
+			size_t y = N.v[(f + 1)%3];
+			if (edge_key(x,y) != edge_key(u,w) and
+				proper_intersection(A,B, vertices[x],vertices[y]))
+			{
+				next = f;
+			}
+		}
+		if (next == -1) {
+			// the edge goes through a vertex
+			warning();
+			return;
+		}
+		u = N.v[next];
+		w = N.v[(next + 1)%3];
+	}
+
+	// boundary of the polygon formed by the crossed triangles,
+	// with the triangle on the other side of every edge
+	unordered_map<uint64_t, size_t> count;
+	for (int c : crossed) {
+		const triangle& T = triangles[c];
+		for (int e = 0; e < 3; ++e) {
+			++count[edge_key(T.v[e], T.v[(e + 1)%3])];
+		}
+	}
+	// next[u] = w <-> (u,w) is an edge of the boundary
+	// in counter-clockwise order
+	unordered_map<size_t, size_t> next;
+	unordered_map<uint64_t, int> outer;
+	for (int c : crossed) {
+		const triangle& T = triangles[c];
+		for (int e = 0; e < 3; ++e) {
+			size_t x = T.v[e];
+			size_t y = T.v[(e + 1)%3];
+			if (count[edge_key(x,y)] == 1) {
+				next[x] = y;
+				outer[edge_key(x,y)] = T.n[e];
+			}
+		}
+	}
+
+	// the two chains of vertices from a to b
+	vector<size_t> chain1, chain2;
+	for (size_t x = next[a]; x != b; x = next[x]) {
+		chain1.push_back(x);
+	}
+	for (size_t x = next[b]; x != a; x = next[x]) {
+		chain2.push_back(x);
+	}
+	std::reverse(chain2.begin(), chain2.end());
+
+	// triangulate the pseudo-polygons at each side of the segment
+	vector<triangle> made;
+	function<void (size_t, size_t, const vector<size_t>&)> triangulate =
+	[&](size_t s, size_t t, const vector<size_t>& P) {
+		if (P.size() == 0) {
+			return;
+		}
+		size_t ci = 0;
+		for (size_t i = 1; i < P.size(); ++i) {
+			if (in_circle(vertices[s], vertices[t],
+						  vertices[P[ci]], vertices[P[i]]))
+			{
+				ci = i;
+			}
+		}
+		size_t c = P[ci];
+		triangulate(s, c, vector<size_t>(P.begin(), P.begin() + ci));
+		triangulate(c, t, vector<size_t>(P.begin() + ci + 1, P.end()));
+
+		triangle T;
+		T.v[0] = s;
+		if (cross(vertices[s], vertices[t], vertices[c]) > 0.0) {
+			T.v[1] = t; T.v[2] = c;
+		}
+		else {
+			T.v[1] = c; T.v[2] = t;
+		}
+		for (int e = 0; e < 3; ++e) {
+			T.n[e] = -1;
+			T.constrained[e] = false;
+			T.clearance[e] = 0.0f;
+		}
+		made.push_back(T);
+	};
+
+	triangulate(a, b, chain1);
+	triangulate(a, b, chain2);
+
+	// a polygon of k triangles is always triangulated again with k
+	// triangles, unless the boundary was not a simple polygon
+	if (made.size() != crossed.size()) {
+		warning();
+		return;
+	}
+
+	// replace the crossed triangles and link the new
+	// ones with each other and with the outer triangles
+	unordered_map<uint64_t, pair<int,int> > inner;
+	for (size_t k = 0; k < made.size(); ++k) {
+		const int s = crossed[k];
+		triangles[s] = made[k];
+		for (int e = 0; e < 3; ++e) {
+			const size_t x = made[k].v[e];
+			const uint64_t key = edge_key(x, made[k].v[(e + 1)%3]);
+			vtri[x] = s;
+
+			auto o = outer.find(key);
+			if (o != outer.end()) {
+				triangles[s].n[e] = o->second;
+				if (o->second != -1) {
+					triangle& O = triangles[o->second];
+					for (int f = 0; f < 3; ++f) {
+						if (edge_key(O.v[f], O.v[(f + 1)%3]) == key) {
+							O.n[f] = s;
+						}
+					}
+				}
+				continue;
+			}
+			auto it = inner.find(key);
+			if (it == inner.end()) {
+				inner[key] = make_pair(s, e);
+			}
+			else {
+				triangles[s].n[e] = it->second.first;
+				triangles[it->second.first].n[it->second.second] = s;
+			}
+		}
+	}
+}
+
+void navmesh::mark_constrained(const unordered_set<uint64_t>& cons) {
+	for (triangle& T : triangles) {
+		for (int e = 0; e < 3; ++e) {
+			uint64_t key = edge_key(T.v[e], T.v[(e + 1)%3]);
+			T.constrained[e] = cons.find(key) != cons.end();
+		}
+	}
+}
+
+void navmesh::remove_outer_triangles(size_t first_super) {
+	// flood the triangles that can be reached from the
+	// enclosing triangle without crossing any segment
+	vector<bool> outer(triangles.size(), false);
+	vector<size_t> Q;
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		const triangle& T = triangles[t];
+		if (T.v[0] >= first_super or T.v[1] >= first_super or
+			T.v[2] >= first_super)
+		{
+			outer[t] = true;
+			Q.push_back(t);
+		}
+	}
+	while (Q.size() > 0) {
+		const triangle& T = triangles[Q.back()];
+		Q.pop_back();
+		for (int e = 0; e < 3; ++e) {
+			if (T.n[e] != -1 and not T.constrained[e] and not outer[T.n[e]]) {
+				outer[T.n[e]] = true;
+				Q.push_back(T.n[e]);
+			}
+		}
+	}
+
+	// keep the inner triangles, with their neighbours
+	vector<int> index(triangles.size(), -1);
+	size_t k = 0;
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		if (not outer[t]) {
+			index[t] = int(k++);
+		}
+	}
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		if (outer[t]) {
+			continue;
+		}
+		triangle& T = triangles[index[t]];
+		T = triangles[t];
+		for (int e = 0; e < 3; ++e) {
+			T.n[e] = (T.n[e] == -1 ? -1 : index[T.n[e]]);
+		}
+	}
+	triangles.resize(k);
+	vertices.resize(first_super);
+}
+
+void navmesh::make_clearance(const spatial_index& index) {
+	// the clearance of every edge is computed by the
+	// triangle with the smallest index of the two
+	#pragma omp parallel for schedule(dynamic, 256)
+	for (int t = 0; t < int(triangles.size()); ++t) {
+		triangle& T = triangles[t];
+		vector<size_t> ids;
+		for (int e = 0; e < 3; ++e) {
+			if (T.constrained[e] or T.n[e] == -1) {
+				T.clearance[e] = 0.0f;
+				continue;
+			}
+			if (T.n[e] < t) {
+				continue;
+			}
+
+			// obstacles around the edge: the vertices of
+			// the two triangles and their constrained edges
+			vector<vec2> points;
+			vector<segment> walls;
+			for (const triangle *n : {&T, &triangles[T.n[e]]}) {
+				for (int f = 0; f < 3; ++f) {
+					points.push_back(vertices[n->v[f]]);
+					if (n->constrained[f]) {
+						walls.push_back(segment(
+							vertices[n->v[f]], vertices[n->v[(f + 1)%3]]
+						));
+					}
+				}
+			}
+
+			// distance from the samples of the edge to those obstacles
+			const vec2& p = vertices[T.v[e]];
+			const vec2& q = vertices[T.v[(e + 1)%3]];
+			vec2 x[CLEARANCE_SAMPLES];
+			float d[CLEARANCE_SAMPLES];
+			float bound = 0.0f;
+			for (int s = 1; s < CLEARANCE_SAMPLES; ++s) {
+				x[s] = p + (q - p)*(float(s)/CLEARANCE_SAMPLES);
+				d[s] = numeric_limits<float>::max();
+				for (const vec2& o : points) {
+					d[s] = std::min(d[s], physim::math::dist(x[s], o));
+				}
+				for (const segment& w : walls) {
+					d[s] = std::min(d[s], dist_point_to_segment(x[s], w.first, w.second));
+				}
+				bound = std::max(bound, d[s]);
+			}
+
+			// Every vertex lies on a segment, so the segments closer to
+			// the samples than the obstacles are within 'bound' of the edge.
+			ids.clear();
+			index.query_aabb(
+				vec2(std::min(p.x, q.x) - bound, std::min(p.y, q.y) - bound),
+				vec2(std::max(p.x, q.x) + bound, std::max(p.y, q.y) + bound),
+				ids
+			);
+			const vector<segment>& segs = index.get_segments();
+			float best = 0.0f;
+			for (int s = 1; s < CLEARANCE_SAMPLES; ++s) {
+				for (size_t i : ids) {
+					d[s] = std::min(d[s],
+						dist_point_to_segment(x[s], segs[i].first, segs[i].second));
+				}
+				best = std::max(best, d[s]);
+			}
+			T.clearance[e] = best;
+		}
+	}
+
+	// copy the clearance to the other triangle of every edge
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		triangle& T = triangles[t];
+		for (int e = 0; e < 3; ++e) {
+			if (T.n[e] == -1 or T.n[e] >= int(t)) {
+				continue;
+			}
+			const triangle& N = triangles[T.n[e]];
+			for (int f = 0; f < 3; ++f) {
+				if (N.n[f] == int(t)) {
+					T.clearance[e] = N.clearance[f];
+				}
+			}
+		}
+	}
+}
+
+void navmesh::make_seeds() {
+	// about one bucket for every two triangles
+	const float dmax = std::max(dimX, dimY);
+	const float n = std::ceil(std::sqrt(triangles.size()/2.0f));
+	bucket_size = std::max(dmax/std::max(n, 1.0f), 1e-3f);
+	bucketsX = static_cast<int>(std::ceil(dimX/bucket_size)) + 1;
+	bucketsY = static_cast<int>(std::ceil(dimY/bucket_size)) + 1;
+	seeds.assign(bucketsX*bucketsY, -1);
+
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		const triangle& T = triangles[t];
+		const vec2 c =
+			(vertices[T.v[0]] + vertices[T.v[1]] + vertices[T.v[2]])/3.0f;
+		const int x = std::min(std::max(int(c.x/bucket_size), 0), bucketsX - 1);
+		const int y = std::min(std::max(int(c.y/bucket_size), 0), bucketsY - 1);
+		seeds[y*bucketsX + x] = int(t);
+	}
+
+	// empty buckets take the seed of the previous bucket
+	int prev = (triangles.size() > 0 ? 0 : -1);
+	for (int& s : seeds) {
+		if (s == -1) {
+			s = prev;
+		}
+		prev = s;
+	}
+}
+
+int navmesh::locate(const vec2& p) const {
+	if (seeds.size() == 0) {
+		return -1;
+	}
+	const int bx = std::min(std::max(int(p.x/bucket_size), 0), bucketsX - 1);
+	const int by = std::min(std::max(int(p.y/bucket_size), 0), bucketsY - 1);
+
+	// walk towards p, starting every step at a different edge
+	int t = seeds[by*bucketsX + bx];
+	for (size_t step = 0; step <= triangles.size(); ++step) {
+		const triangle& T = triangles[t];
+		int next = t;
+		for (int f = 0; f < 3 and next == t; ++f) {
+			const int e = int((f + step)%3);
+			if (cross(vertices[T.v[e]], vertices[T.v[(e + 1)%3]], p) < -EPS) {
+				next = T.n[e];
+			}
+		}
+		if (next == t) {
+			return t;
+		}
+		if (next == -1) {
+			// the mesh is convex: p is out of it
+			return -1;
+		}
+		t = next;
+	}
+
+	// the walk did not end: try every triangle
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		const triangle& T = triangles[t];
+		const vec2& a = vertices[T.v[0]];
+		const vec2& b = vertices[T.v[1]];
+		const vec2& c = vertices[T.v[2]];
+		if (cross(a,b,p) >= -EPS and cross(b,c,p) >= -EPS and
+			cross(c,a,p) >= -EPS)
+		{
+			return int(t);
+		}
+	}
+	return -1;
+}
+
+void navmesh::funnel(
+	const vec2& source, const vec2& sink, float R,
+	const vector<int>& tris,
+	vector<vec2>& smoothed_path
+) const
+{
+	// Distance at which a portal has to be shrunk at vertex 'p' so
+	// that the shrunk end is at distance R of the segments incident
+	// to 'p' in triangles T and N. 'u' is the unit direction of the
+	// portal, pointing away from 'p'.
+	auto shrink_distance =
+	[&](size_t p, const vec2& u, const triangle& T, const triangle& N) {
+		float d = R;
+		for (const triangle *t : {&T, &N}) {
+			for (int f = 0; f < 3; ++f) {
+				size_t a = t->v[f];
+				size_t b = t->v[(f + 1)%3];
+				if (not t->constrained[f] or (a != p and b != p)) {
+					continue;
+				}
+				vec2 w = physim::math::normalise(
+					(a == p ? vertices[b] : vertices[a]) - vertices[p]
+				);
+				float cos = physim::math::dot(u, w);
+				if (cos > 0.0f) {
+					float sin = std::sqrt(std::max(0.0f, 1.0f - cos*cos));
+					d = std::max(d, R/std::max(sin, 1e-3f));
+				}
+			}
+		}
+		return d;
+	};
+
+	// make the portals: left and right ends of the
+	// edges crossed, as seen walking along the path
+	vector<vec2> left, right;
+
+	left.push_back(source);
+	right.push_back(source);
+	for (size_t i = 0; i + 1 < tris.size(); ++i) {
+		const triangle& T = triangles[tris[i]];
+		const triangle& N = triangles[tris[i + 1]];
+		int e = 0;
+		while (T.n[e] != tris[i + 1]) {
+			++e;
+		}
+		size_t li = T.v[(e + 1)%3];
+		size_t ri = T.v[e];
+		vec2 l = vertices[li];
+		vec2 r = vertices[ri];
+
+		// shrink the portal so that the path keeps away from corners
+		vec2 u = l - r;
+		float len = physim::math::norm(u);
+		u = u/len;
+		float dl = shrink_distance(li, -u, T, N);
+		float dr = shrink_distance(ri, u, T, N);
+		if (len > dl + dr) {
+			l = l - u*dl;
+			r = r + u*dr;
+		}
+		else {
+			l = r = r + u*(len*dr/(dl + dr));
+		}
+		left.push_back(l);
+		right.push_back(r);
+	}
+	left.push_back(sink);
+	right.push_back(sink);
+
+	// twice the signed area of the triangle abc
+	// (negative if c is to the left of ab)
+	auto triarea2 =
+	[](const vec2& a, const vec2& b, const vec2& c) {
+		return -cross(a,b,c);
+	};
+	auto equal =
+	[](const vec2& a, const vec2& b) {
+		return physim::math::dist(a,b) < 1e-6f;
+	};
+
+	vec2 apex = left[0];
+	vec2 portal_left = left[0];
+	vec2 portal_right = right[0];
+	size_t apex_idx = 0, left_idx = 0, right_idx = 0;
+
+	smoothed_path.push_back(apex);
+
+	for (size_t i = 1; i < left.size(); ++i) {
+		const vec2& l = left[i];
+		const vec2& r = right[i];
+
+		// update the right side of the funnel
+		if (triarea2(apex, portal_right, r) <= 0.0) {
+			if (equal(apex, portal_right) or triarea2(apex, portal_left, r) > 0.0) {
+				// tighten the funnel
+				portal_right = r;
+				right_idx = i;
+			}
+			else {
+				// right over left: left is a corner of the path
+				apex = portal_left;
+				apex_idx = left_idx;
+				smoothed_path.push_back(apex);
+
+				portal_left = portal_right = apex;
+				left_idx = right_idx = apex_idx;
+				i = apex_idx;
+				continue;
+			}
+		}
+
+		// update the left side of the funnel
+		if (triarea2(apex, portal_left, l) >= 0.0) {
+			if (equal(apex, portal_left) or triarea2(apex, portal_right, l) < 0.0) {
+				// tighten the funnel
+				portal_left = l;
+				left_idx = i;
+			}
+			else {
+				// left over right: right is a corner of the path
+				apex = portal_right;
+				apex_idx = right_idx;
+				smoothed_path.push_back(apex);
+
+				portal_left = portal_right = apex;
+				left_idx = right_idx = apex_idx;
+				i = apex_idx;
+				continue;
+			}
+		}
+	}
+
+	if (not equal(smoothed_path.back(), sink)) {
+		smoothed_path.push_back(sink);
+	}
+}
+
+// PUBLIC
+
+navmesh::navmesh() {
+	dimX = dimY = 0.0f;
+	bucket_size = 1.0f;
+	bucketsX = bucketsY = 0;
+}
+
+navmesh::~navmesh() {
+	clear();
+}
+
+// MODIFIERS
+
+void navmesh::init(float dx, float dy, const vector<segment>& segs) {
+	clear();
+	dimX = dx;
+	dimY = dy;
+
+	si.init(dimX, dimY, segs);
+
+	// vertices are identified by their coordinates
+	// (rounded) so that no vertex is repeated
+	unordered_map<uint64_t, size_t> vertex_index;
+	auto add_vertex =
+	[&](const vec2& p) {
+		int64_t kx = static_cast<int64_t>(std::llround(double(p.x)*1e4));
+		int64_t ky = static_cast<int64_t>(std::llround(double(p.y)*1e4));
+		uint64_t key = (static_cast<uint64_t>(kx) << 32) ^
+						static_cast<uint64_t>(ky & 0xffffffff);
+		auto it = vertex_index.find(key);
+		if (it != vertex_index.end()) {
+			return it->second;
+		}
+		vertices.push_back(p);
+		vertex_index[key] = vertices.size() - 1;
+		return vertices.size() - 1;
+	};
+
+	// Split the segments at their intersections, so
+	// that no two constrained edges cross each other
+	// and no vertex falls in the interior of an edge.
+	unordered_set<uint64_t> cons;
+	vector<pair<size_t,size_t> > cons_edges;
+	vector<size_t> nearby;
+	for (size_t i = 0; i < segs.size(); ++i) {
+		const vec2& a = segs[i].first;
+		const vec2& b = segs[i].second;
+		vec2 u = b - a;
+		double uu = physim::math::dot(u,u);
+		if (uu < EPS) {
+			continue;
+		}
+
+		// the segments that may touch this one
+		nearby.clear();
+		si.query_aabb(
+			vec2(std::min(a.x, b.x) - DIST_EPS, std::min(a.y, b.y) - DIST_EPS),
+			vec2(std::max(a.x, b.x) + DIST_EPS, std::max(a.y, b.y) + DIST_EPS),
+			nearby
+		);
+
+		// points where the segment is split, with their parameter
+		vector<pair<double,vec2> > ts;
+		for (size_t j : nearby) {
+			if (i == j) {
+				continue;
+			}
+			const vec2& c = segs[j].first;
+			const vec2& d = segs[j].second;
+
+			// The differences of the coordinates are exact in doubles,
+			// not in floats: with float directions the parameters of a
+			// T-junction on a long segment could fall out of tolerance.
+			const double ux = double(b.x) - a.x, uy = double(b.y) - a.y;
+			const double vx = double(d.x) - c.x, vy = double(d.y) - c.y;
+			double den = ux*vy - uy*vx;
+			if (std::abs(den) > EPS) {
+				// segments are not parallel
+				double t = ((double(c.x) - a.x)*vy - (double(c.y) - a.y)*vx)/den;
+				double s = ((double(c.x) - a.x)*uy - (double(c.y) - a.y)*ux)/den;
+				// tolerances of the parameters
+				const double te = DIST_EPS/std::sqrt(ux*ux + uy*uy);
+				const double se = DIST_EPS/std::sqrt(vx*vx + vy*vy);
+				if (-te <= t and t <= 1.0 + te and -se <= s and s <= 1.0 + se) {
+					// an endpoint of the other segment (a T-junction)
+					// is used as is, so that the vertex is shared
+					if (s <= se) {
+						ts.push_back(make_pair(t, c));
+					}
+					else if (s >= 1.0 - se) {
+						ts.push_back(make_pair(t, d));
+					}
+					else {
+						ts.push_back(make_pair(t, a + u*float(t)));
+					}
+				}
+			}
+			else {
+				// parallel segments: split at the endpoints
+				// of the other that lie on this segment
+				for (const vec2& p : {c, d}) {
+					if (dist_point_to_segment(p, a, b) < 1e-4f) {
+						ts.push_back(make_pair(physim::math::dot(p - a, u)/uu, p));
+					}
+				}
+			}
+		}
+
+		std::sort(ts.begin(), ts.end(),
+			[](const pair<double,vec2>& p, const pair<double,vec2>& q) {
+				return p.first < q.first;
+			}
+		);
+		size_t prev = add_vertex(a);
+		for (const pair<double,vec2>& t : ts) {
+			if (t.first <= EPS or t.first > 1.0 - EPS) {
+				continue;
+			}
+			size_t cur = add_vertex(t.second);
+			if (cur != prev and cons.find(edge_key(prev,cur)) == cons.end()) {
+				cons.insert(edge_key(prev,cur));
+				cons_edges.push_back(make_pair(prev,cur));
+			}
+			prev = cur;
+		}
+		size_t last = add_vertex(b);
+		if (last != prev and cons.find(edge_key(prev,last)) == cons.end()) {
+			cons.insert(edge_key(prev,last));
+			cons_edges.push_back(make_pair(prev,last));
+		}
+	}
+
+	if (vertices.size() < 3) {
+		cerr << "navmesh::init - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Not enough segments to build a triangulation" << endl;
+		clear();
+		return;
+	}
+
+	// triangle enclosing all vertices
+	float minx = 0.0f, miny = 0.0f, maxx = dimX, maxy = dimY;
+	for (const vec2& p : vertices) {
+		minx = std::min(minx, p.x); maxx = std::max(maxx, p.x);
+		miny = std::min(miny, p.y); maxy = std::max(maxy, p.y);
+	}
+	float M = std::max(maxx - minx, maxy - miny);
+	float cx = (minx + maxx)/2.0f;
+	float cy = (miny + maxy)/2.0f;
+	const size_t first_super = vertices.size();
+	vertices.push_back(vec2(cx - 20.0f*M, cy - 10.0f*M));
+	vertices.push_back(vec2(cx + 20.0f*M, cy - 10.0f*M));
+	vertices.push_back(vec2(cx, cy + 20.0f*M));
+
+	delaunay_triangulation();
+
+	vector<int> vtri(vertices.size(), -1);
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		for (int e = 0; e < 3; ++e) {
+			vtri[triangles[t].v[e]] = int(t);
+		}
+	}
+	for (const pair<size_t,size_t>& e : cons_edges) {
+		insert_constraint(e.first, e.second, vtri);
+	}
+	mark_constrained(cons);
+	remove_outer_triangles(first_super);
+	make_clearance(si);
+	make_seeds();
+}
+
+void navmesh::clear() {
+	vertices.clear();
+	triangles.clear();
+	seeds.clear();
+	si.clear();
+	bucketsX = bucketsY = 0;
+}
+
+// GETTERS
+
+void navmesh::find_path(
+	const vec2& source, const vec2& sink,
+	float R,
+	vector<vec2>& path,
+	vector<vec2>& smoothed_path
+) const
+{
+	const int start = locate(source);
+	const int goal = locate(sink);
+
+	if (start == -1) {
+		cerr << "Error: point " << vec2_out(source)
+			 << " is not inside the navigation mesh" << endl;
+		return;
+	}
+	if (goal == -1) {
+		cerr << "Error: point " << vec2_out(sink)
+			 << " is not inside the navigation mesh" << endl;
+		return;
+	}
+
+	float d;
+	if (si.nearest_segment(source, d) != -1 and d <= R) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't start at " << vec2_out(source) << endl;
+		cerr << "    This position is at a distance from a static obstacle"
+			 << " of: " << d << endl;
+		return;
+	}
+	if (si.nearest_segment(sink, d) != -1 and d <= R) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't finish at " << vec2_out(sink) << endl;
+		cerr << "    This position is at a distance from a static obstacle"
+			 << " of: " << d << endl;
+		return;
+	}
+
+	// A* over the triangles. Every triangle is entered through
+	// the midpoint of one of its edges, and the cost of moving
+	// between triangles is the distance between entry points.
+	const size_t T = triangles.size();
+	vector<double> cost_so_far(T, MAX_DINF);
+	vector<int> parent(T, -1);
+	vector<vec2> entry(T);
+	vector<bool> closed(T, false);
+
+	typedef pair<double,int> pq_elem;
+	priority_queue<pq_elem, vector<pq_elem>, greater<pq_elem> > OPEN;
+
+	cost_so_far[start] = 0.0;
+	entry[start] = source;
+	OPEN.push(make_pair(physim::math::dist(source, sink), start));
+
+	while (OPEN.size() > 0) {
+		int cur = OPEN.top().second;
+		OPEN.pop();
+		if (closed[cur]) {
+			continue;
+		}
+		closed[cur] = true;
+		if (cur == goal) {
+			break;
+		}
+
+		const triangle& C = triangles[cur];
+		for (int e = 0; e < 3; ++e) {
+			int neigh = C.n[e];
+			if (neigh == -1 or C.constrained[e] or closed[neigh] or
+				C.clearance[e] < R)
+			{
+				continue;
+			}
+
+			vec2 m = (vertices[C.v[e]] + vertices[C.v[(e + 1)%3]])/2.0f;
+			double neigh_cost = cost_so_far[cur] + physim::math::dist(entry[cur], m);
+			if (neigh_cost < cost_so_far[neigh]) {
+				cost_so_far[neigh] = neigh_cost;
+				parent[neigh] = cur;
+				entry[neigh] = m;
+				OPEN.push(make_pair(neigh_cost + physim::math::dist(m, sink), neigh));
+			}
+		}
+	}
+
+	if (not closed[goal]) {
+		cerr << "Error: no path for a particle of radius " << R
+			 << " from " << vec2_out(source) << " to " << vec2_out(sink)
+			 << endl;
+		return;
+	}
+
+	// sequence of triangles from start to goal
+	vector<int> tris;
+	for (int t = goal; t != -1; t = parent[t]) {
+		tris.push_back(t);
+	}
+	std::reverse(tris.begin(), tris.end());
+
+	path.push_back(source);
+	for (size_t i = 1; i < tris.size(); ++i) {
+		path.push_back(entry[tris[i]]);
+	}
+	path.push_back(sink);
+
+	funnel(source, sink, R, tris, smoothed_path);
+}
+
+const vector<vec2>& navmesh::get_vertices() const {
+	return vertices;
+}
+
+const vector<navmesh::triangle>& navmesh::get_triangles() const {
+	return triangles;
+}
+
+float navmesh::get_dimX() const {
+	return dimX;
+}
+float navmesh::get_dimY() const {
+	return dimY;
+}
+
+} // -- namespace charanim
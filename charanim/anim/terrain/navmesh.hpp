@@ -0,0 +1,227 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// charanim includes
+#include <anim/terrain/spatial_index.hpp>
+#include <anim/definitions.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Navigation mesh for path finding.
+ *
+ * The free space of the terrain is represented with a constrained
+ * Delaunay triangulation of the segments of the terrain: every segment
+ * is an edge (or a chain of edges) of the triangulation. Paths are found
+ * with an A* search over the triangles, and are then refined with the
+ * funnel algorithm.
+ *
+ * The cost of building and querying this structure depends on the
+ * amount of segments of the map, not on its resolution. Points are
+ * located by walking over the triangles, so building the mesh takes
+ * about O(n log n) time for n segments.
+ */
+class navmesh {
+	public:
+		/**
+		 * @brief A triangle of the triangulation.
+		 *
+		 * The vertices are sorted in counter-clockwise order. The @e i-th
+		 * edge of the triangle goes from vertex @e v[i] to vertex
+		 * @e v[(i+1)%3].
+		 */
+		struct triangle {
+			/// Indices of the vertices.
+			size_t v[3];
+			/// Neighbouring triangle through each edge (-1 if none).
+			int n[3];
+			/// Is the @e i-th edge part of a segment of the terrain?
+			bool constrained[3];
+			/**
+			 * @brief Clearance of each edge.
+			 *
+			 * Radius of the largest agent that can cross the edge: the
+			 * largest distance to the segments of the terrain among
+			 * some samples of the edge. It is 0 for constrained edges.
+			 */
+			float clearance[3];
+		};
+
+	private:
+		/// Vertices of the triangulation.
+		std::vector<vec2> vertices;
+		/// Triangles of the triangulation.
+		std::vector<triangle> triangles;
+
+		/// Spatial index over the segments of the terrain.
+		spatial_index si;
+
+		/// Continuous dimension in the x-axis
+		float dimX;
+		/// Continuous dimension in the y-axis
+		float dimY;
+
+		/// Length of the side of the buckets of @ref seeds.
+		float bucket_size;
+		/// Number of buckets in the x-axis.
+		int bucketsX;
+		/// Number of buckets in the y-axis.
+		int bucketsY;
+		/**
+		 * @brief A triangle of every bucket, or -1.
+		 *
+		 * @ref locate starts walking from the triangle of the bucket of
+		 * the point located.
+		 */
+		std::vector<int> seeds;
+
+	private:
+
+		/**
+		 * @brief Triangulates the points in @ref vertices (Bowyer-Watson).
+		 *
+		 * The last three vertices must be those of a triangle enclosing
+		 * all the other vertices. The points are inserted in an order
+		 * that keeps consecutive points close, and every point is
+		 * located by walking from the last triangle made. The triangles
+		 * made have their neighbours set.
+		 */
+		void delaunay_triangulation();
+		/**
+		 * @brief Makes sure that the edge (a,b) is in the triangulation.
+		 *
+		 * The triangles crossed by the edge are found by walking along
+		 * it from the triangle around @e a it enters. They are replaced
+		 * by a triangulation of the two polygons left at each side of
+		 * the edge, and the neighbours of the triangles are updated.
+		 * @param a First vertex of the edge.
+		 * @param b Second vertex of the edge.
+		 * @param vtri A triangle incident to every vertex, updated.
+		 */
+		void insert_constraint(size_t a, size_t b, std::vector<int>& vtri);
+		/**
+		 * @brief Marks the constrained edges of every triangle.
+		 * @param cons Keys of the constrained edges.
+		 */
+		void mark_constrained(const std::unordered_set<uint64_t>& cons);
+		/**
+		 * @brief Removes the triangles not enclosed by constrained edges.
+		 *
+		 * Also removes the vertices of the enclosing triangle.
+		 * @param first_super First vertex of the enclosing triangle.
+		 */
+		void remove_outer_triangles(size_t first_super);
+		/**
+		 * @brief Computes the clearance of every edge.
+		 *
+		 * The distance from a sample of an edge to the vertices and the
+		 * constrained edges of its two triangles bounds its distance to
+		 * the segments, so only the segments within that bound are
+		 * queried.
+		 * @param index Spatial index over the segments of the terrain.
+		 */
+		void make_clearance(const spatial_index& index);
+		/// Fills the buckets of @ref seeds.
+		void make_seeds();
+
+		/**
+		 * @brief Returns the triangle containing point @e p.
+		 *
+		 * Walks over the triangles from the seed of the bucket of @e p.
+		 * @return Returns -1 if no triangle contains @e p.
+		 */
+		int locate(const vec2& p) const;
+
+		/**
+		 * @brief Refines a sequence of triangles into a polyline.
+		 *
+		 * Simple stupid funnel algorithm. Portals are shrunk at both ends
+		 * so that the path keeps (approximately) a distance @e R to the
+		 * corners of the segments.
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Radius of the agent.
+		 * @param[in] tris Sequence of triangles from @e source to @e sink.
+		 * @param[out] smoothed_path Refined path.
+		 */
+		void funnel(
+			const vec2& source, const vec2& sink, float R,
+			const std::vector<int>& tris,
+			std::vector<vec2>& smoothed_path
+		) const;
+
+	public:
+		/// Default constructor.
+		navmesh();
+		/// Destructor.
+		~navmesh();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Builds the triangulation.
+		 * @param dimX Continuous dimension in the x-axis.
+		 * @param dimY Continuous dimension in the y-axis.
+		 * @param segs Segments of the terrain, including the walls
+		 * enclosing it.
+		 */
+		void init(float dimX, float dimY, const std::vector<segment>& segs);
+
+		/// Clears the memory occupied by this navigation mesh.
+		void clear();
+
+		// GETTERS
+
+		/**
+		 * @brief Fins a path between two points.
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Non-refined path: midpoints of the edges crossed.
+		 * @param[out] smooth_path Refined path.
+		 */
+		void find_path(
+			const vec2& source, const vec2& sink,
+			float R,
+			std::vector<vec2>& path,
+			std::vector<vec2>& smoothed_path
+		) const;
+
+		/// Returns the vertices of the triangulation.
+		const std::vector<vec2>& get_vertices() const;
+		/// Returns the triangles of the triangulation.
+		const std::vector<triangle>& get_triangles() const;
+
+		/// Returns the continuous dimension in the x-axis
+		float get_dimX() const;
+		/// Returns the continuous dimension in the y-axis
+		float get_dimY() const;
+};
+
+} // -- namespace charanim
@@ -0,0 +1,76 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/ray_batch.hpp>
+
+// C++ includes
+#include <cmath>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+namespace charanim {
+
+void ray_batch::clear() {
+	ox.clear();
+	oy.clear();
+	dx.clear();
+	dy.clear();
+	max_len.clear();
+	hit_dist.clear();
+	hit_segment.clear();
+}
+
+void ray_batch::add_ray(const vec2& o, const vec2& d, float len) {
+	const float n = physim::math::norm(d);
+	ox.push_back(o.x);
+	oy.push_back(o.y);
+	if (n > 0.0f) {
+		dx.push_back(d.x/n);
+		dy.push_back(d.y/n);
+		max_len.push_back(len);
+	}
+	else {
+		// no direction: a ray of length 0 that hits nothing
+		dx.push_back(1.0f);
+		dy.push_back(0.0f);
+		max_len.push_back(0.0f);
+	}
+}
+
+void ray_batch::add_fan(const vec2& o, float angle, size_t n, float len) {
+	const float step = 2.0f*float(M_PI)/n;
+	for (size_t i = 0; i < n; ++i) {
+		const float a = angle + i*step;
+		ox.push_back(o.x);
+		oy.push_back(o.y);
+		dx.push_back(std::cos(a));
+		dy.push_back(std::sin(a));
+		max_len.push_back(len);
+	}
+}
+
+size_t ray_batch::size() const {
+	return ox.size();
+}
+
+} // -- namespace charanim
@@ -0,0 +1,91 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// charanim includes
+#include <anim/definitions.hpp>
+
+namespace charanim {
+
+/**
+ * @brief A batch of rays, stored as a structure of arrays.
+ *
+ * The rays are cast against the segments of a terrain with
+ * @ref spatial_index::raycast, which fills the results of every ray:
+ * the distance to the closest segment hit and the index of that
+ * segment.
+ *
+ * Rays are cast in groups of consecutive rays. The rays of a group
+ * are tested against the segments near all of them, so batches are
+ * faster when consecutive rays are close to each other, for example,
+ * the feelers of one agent.
+ */
+struct ray_batch {
+	/// x-coordinate of the origin of every ray.
+	std::vector<float> ox;
+	/// y-coordinate of the origin of every ray.
+	std::vector<float> oy;
+	/// x-coordinate of the (unit) direction of every ray.
+	std::vector<float> dx;
+	/// y-coordinate of the (unit) direction of every ray.
+	std::vector<float> dy;
+	/// Length of every ray.
+	std::vector<float> max_len;
+
+	/**
+	 * @brief Distance to the closest segment hit by every ray.
+	 *
+	 * It is the length of the ray if no segment is hit.
+	 */
+	std::vector<float> hit_dist;
+	/// Index of the closest segment hit by every ray, or -1.
+	std::vector<int32_t> hit_segment;
+
+	/// Removes all rays.
+	void clear();
+
+	/**
+	 * @brief Adds a ray.
+	 * @param o Origin.
+	 * @param d Direction, not necessarily of unit length. A null
+	 * direction gives a ray of length 0.
+	 * @param len Length of the ray.
+	 */
+	void add_ray(const vec2& o, const vec2& d, float len);
+
+	/**
+	 * @brief Adds @e n rays of length @e len evenly spread around @e o.
+	 *
+	 * The first ray has angle @e angle (in radians) with the x-axis.
+	 */
+	void add_fan(const vec2& o, float angle, size_t n, float len);
+
+	/// Returns the number of rays.
+	size_t size() const;
+};
+
+} // -- namespace charanim
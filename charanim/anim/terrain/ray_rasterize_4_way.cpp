@@ -21,99 +21,14 @@
 
 #include <anim/terrain/ray_rasterize_4_way.hpp>
 
-// Non-class private
-
-const static double _r_90 = M_PI/2.0;
-const static double _r_180 = M_PI;
-const static double _r_270 = 3.0*M_PI/2.0;
-const static double _r_360 = 2.0*M_PI;
-
 namespace charanim {
 
-// alpha: rad
-void locate_point(const latticePoint& ini, size_t d, double phi, latticePoint& fin) {
-	double alpha;
-	
-	if (0 <= phi and phi < _r_90) alpha = phi;
-	else if (_r_90 <= phi and phi < _r_180) alpha = _r_180 - phi;
-	else if (_r_180 <= phi and phi < _r_270) alpha = phi - _r_180;
-	else alpha = _r_360 - phi;
-	
-	double dx = d*cos(alpha);
-	double dy = d*sin(alpha);
-	
-	if (0 <= phi and phi <= _r_90) { fin.x() = ini.x() + dx; fin.y() = ini.y() + dy; }
-	else if (_r_90 < phi and phi <= _r_180) { fin.x() = ini.x() - dx; fin.y() = ini.y() + dy; }
-	else if (_r_180 < phi and phi <= _r_270) { fin.x() = ini.x() - dx; fin.y() = ini.y() - dy; }
-	else { fin.x() = ini.x() + dx; fin.y() = ini.y() - dy; }
-}
-
-/// Private
-
-void ray_rasterize_4_way::advance_pos_slope() {
-	// slope > 0
-	if (slope < 1.0) {
-		if (int(x) == fin.x()) last = true;
-		x += ix;
-		y += iy*slope;
-	}
-	else {
-		if (int(y) == fin.y()) last = true;
-		x += ix*inv_slope;
-		y += iy;
-	}
-}
-
-void ray_rasterize_4_way::advance_neg_slope() {
-	// slope < 0
-	if (abs(slope) < 1.0) {
-		if (int(x) == fin.x()) last = true;
-		x += ix;
-		y -= iy*slope;
-	}
-	else {
-		if (int(y) == fin.y()) last = true;
-		x -= ix*inv_slope;
-		y += iy;
-	}
-}
-
-void ray_rasterize_4_way::retreat_pos_slope() {
-	// slope > 0
-	if (slope < 1.0) {
-		x -= ix;
-		y -= iy*slope;
-		if (int(x) == ini.x()) first = true;
-	}
-	else {
-		x -= ix*inv_slope;
-		y -= iy;
-		if (int(y) == ini.y()) first = true;
-	}
-}
-
-void ray_rasterize_4_way::retreat_neg_slope() {
-	// slope < 0
-	if (abs(slope) < 1.0) {
-		x -= ix;
-		y += iy*slope;
-		if (int(x) == ini.x()) first = true;
-	}
-	else {
-		x += ix*inv_slope;
-		y -= iy;
-		if (int(y) == ini.y()) first = true;
-	}
-}
-
 /// Public
 
 ray_rasterize_4_way::ray_rasterize_4_way() : ray_rasterize() {
 	ini.x() = ini.y() = 0;
 	fin.x() = fin.y() = 0;
-	ix = iy = 0;
-	x = y = 0.0;
-	slope = inv_slope = 0.0;
+	idx = 0;
 	first = true;
 	last = false;
 }
@@ -125,30 +40,15 @@ ray_rasterize_4_way::ray_rasterize_4_way(const ray_rasterize_4_way& r) : ray_ras
 ray_rasterize_4_way::~ray_rasterize_4_way() { }
 
 void ray_rasterize_4_way::init(const latticePoint& _ini, const latticePoint& _fin) {
-	ini.x() = _ini.x(); fin.x() = _fin.x();
-	ini.y() = _ini.y(); fin.y() = _fin.y();
-	
-	int dx = _fin.x() - _ini.x();
-	int dy = _fin.y() - _ini.y();
-	
-	if (dx != 0) {
-		slope = (1.0*dy)/dx;
-		if (slope != 0.0) inv_slope = 1.0/slope;
-	}
-	else {
-		slope = 99999.0; // infinite (in this case, this is not used)
-		inv_slope = 0.0;
-	}
-	
-	if (dx > 0) ix = 1;
-	else ix = -1;
+	ini = _ini;
+	fin = _fin;
 	
-	if (dy > 0) iy = 1;
-	else iy = -1;
-	
-	x = ini.x();
-	y = ini.y();
+	cells.clear();
+	grid_traversal::for_each_cell(ini, fin,
+		[&](int x, int y) { cells.push_back(latticePoint(x,y)); }
+	);
 	
+	idx = 0;
 	first = true;
 	last = false;
 }
@@ -156,14 +56,8 @@ void ray_rasterize_4_way::init(const latticePoint& _ini, const latticePoint& _fi
 ray_rasterize_4_way& ray_rasterize_4_way::operator= (const ray_rasterize_4_way& r) {
 	ini = r.ini;
 	fin = r.fin;
-	ix = r.ix;
-	iy = r.iy;
-	
-	x = r.x;
-	y = r.y;
-	
-	slope = r.slope;
-	inv_slope = r.inv_slope;
+	cells = r.cells;
+	idx = r.idx;
 	
 	first = r.first;
 	last = r.last;
@@ -175,151 +69,56 @@ ray_rasterize_4_way *ray_rasterize_4_way::clone() const {
 }
 
 void ray_rasterize_4_way::current_cell(latticePoint& current) const {
-	if (ini.x() == fin.x() or ini.y() == fin.y()) {
-		current.x() = x;
-		current.y() = y;
-	}
-	else if (abs(slope) < 1.0) {
-		current.x() = x;
-		
-		current.y() = y;
-		if (y >= 0) current.y() += 0.5;
-		else current.y() -= 0.5;
-	}
-	else {
-		current.x() = x;
-		if (x >= 0) current.x() += 0.5;
-		else current.x() -= 0.5;
-		
-		current.y() = y;
-	}
+	current = cells[idx];
 }
 
 void ray_rasterize_4_way::advance() {
-	if (first) first = false;
-	
-	if (ini.x() == fin.x()) {
-		// vertical ray (m = infty)
-		if (uint(y) == fin.y()) last = true;
-		y += iy;
-	}
-	else if (slope >= 0.0) advance_pos_slope();
-	else advance_neg_slope();
+	first = false;
+	if (idx + 1 == cells.size()) last = true;
+	else ++idx;
 }
 
 void ray_rasterize_4_way::retreat() {
-	if (last) last = false;
-	
-	if (ini.x() == fin.x()) {
-		// vertical ray (m = infty)
-		if (uint(y) == ini.y()) first = true;
-		y -= iy;
-	}
-	else if (slope >= 0.0) retreat_pos_slope();
-	else retreat_neg_slope();
+	last = false;
+	if (idx > 0) --idx;
+	if (idx == 0) first = true;
 }
 
 void ray_rasterize_4_way::place_at(const latticePoint& p) {
-	// Cell on a vertical or horizontal ray
-	if (ini.x() == fin.x() or ini.y() == fin.y()) { x = p.x(); y = p.y(); return; }
-	
-	int k;
-	
-	if (slope >= 0.0) {
-		if (slope < 1.0) {
-			k = (p.x() - ini.x())/ix;
-			x = ini.x() + k*ix;
-			y = ini.y() + k*iy*slope;
-		}
-		else {
-			k = (p.y() - ini.y())/iy;
-			x = ini.x() + k*ix*inv_slope;
-			y = ini.y() + k*iy;
-		}
-	}
-	else {
-		if (abs(slope) < 1.0) {
-			k = (p.x() - ini.x())/ix;
-			x = ini.x() + k*ix;
-			y = ini.y() - k*iy*slope;
-		}
-		else {
-			k = (p.y() - ini.y())/iy;
-			x = ini.x() - k*ix*inv_slope;
-			y = ini.y() + k*iy;
+	for (size_t i = 0; i < cells.size(); ++i) {
+		if (cells[i] == p) {
+			idx = i;
+			break;
 		}
 	}
 	
-	if (x == ini.x() and y == ini.y()) { first = true; last = false; }
-	else if (x == fin.x() and y == fin.y()) { first = false; last = true; }
-	else { first = last = false; }
+	first = (idx == 0);
+	last = false;
 }
 
 bool ray_rasterize_4_way::is_first() const { return first; }
 bool ray_rasterize_4_way::is_last() const { return last; }
 
-#define is_on_ray ((expr_x == c.x()) and (expr_y == c.y()))
 bool ray_rasterize_4_way::on_ray(const latticePoint& c) const {
-	// Base cases
-	
-	// Cell on a vertical ray
-	if (ini.x() == fin.x()) {
-		if (c.x() == ini.x()) return true;
-		return false;
-	}
-	
-	// Cell on a horizontal ray
-	if (ini.y() == fin.y()) {
-		if (c.y() == ini.y()) return true;
-		return false;
-	}
-	
-	int k, expr_x, expr_y;
-	
-	if (slope >= 0.0) {
-		if (slope < 1.0) {
-			k = (c.x() - ini.x())/ix;
-			
-			expr_x = ini.x() + k*ix;
-			expr_y = ini.y() + k*iy*slope;
-			
-			if (expr_y >= 0) expr_y += 0.5;
-			else expr_y -= 0.5;
-			
-			return is_on_ray;
+	const double dx = fin.x() - ini.x();
+	const double dy = fin.y() - ini.y();
+	if (dx == 0.0 and dy == 0.0) {
+		return c == ini;
+	}
+	
+	// the line through the centres of ini and fin crosses the cell
+	// iff its corners are not all strictly at the same side of it
+	bool neg = false, pos = false;
+	for (int i = -1; i <= 1; i += 2) {
+		for (int j = -1; j <= 1; j += 2) {
+			const double px = c.x() + 0.5*i - ini.x();
+			const double py = c.y() + 0.5*j - ini.y();
+			const double cross = dx*py - dy*px;
+			if (cross <= 0.0) neg = true;
+			if (cross >= 0.0) pos = true;
 		}
-		
-		k = (c.y() - ini.y())/iy;
-		
-		expr_x = ini.x() + k*ix*inv_slope;
-		expr_y = ini.y() + k*iy;
-		
-		if (expr_x >= 0) expr_x += 0.5;
-		else expr_x -= 0.5;
-		
-		return is_on_ray;
-	}
-	
-	if (abs(slope) < 1.0) {
-		k = (c.x() - ini.x())/ix;
-		
-		expr_x = ini.x() + k*ix;
-		expr_y = ini.y() - k*iy*slope;
-		
-		if (expr_y >= 0) expr_y += 0.5;
-		else expr_y -= 0.5;
-		
-		return is_on_ray;
 	}
-	k = (c.y() - ini.y())/iy;
-	
-	expr_x = ini.x() - k*ix*inv_slope;
-	expr_y = ini.y() + k*iy;
-	
-	if (expr_x >= 0) expr_x += 0.5;
-	else expr_x -= 0.5;
-	
-	return is_on_ray;
+	return neg and pos;
 }
 
 } // -- namespace charanim
@@ -23,34 +23,32 @@
 
 // C++ includes
 #include <iostream>
+#include <vector>
 #include <cmath>
 using namespace std;
 
 // Custom includes
 #include <anim/terrain/ray_rasterize.hpp>
+#include <anim/terrain/grid_traversal.hpp>
 #include <anim/definitions.hpp>
 
 namespace charanim {
 
 /// Class to compute the rasterization of a ray from a starting to an ending
 /// point using the method 4-way step with midpoint.
+/// Adapter of @ref grid_traversal::for_each_cell: the cells of the ray are
+/// computed when initialised. Prefer the function, which has no virtual
+/// calls per cell.
 class ray_rasterize_4_way : public ray_rasterize {
 	private:
 		latticePoint ini, fin;
-		int ix, iy;  // step advance
 		
-		bool first, last; // reached last cell
-		double x, y; // current cell
+		// cells of the ray, from ini to fin
+		std::vector<latticePoint> cells;
+		// position of the current cell
+		size_t idx;
 		
-		// slope of the line between ini and fin
-		double slope, inv_slope;
-	
-	private:
-		void advance_pos_slope();
-		void advance_neg_slope();
-		
-		void retreat_pos_slope();
-		void retreat_neg_slope();
+		bool first, last; // reached first/last cell
 		
 	public:
 		
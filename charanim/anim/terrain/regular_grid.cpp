@@ -25,17 +25,23 @@
 #include <stdlib.h>
 
 // C++ includes
+#include <unordered_map>
+#include <functional>
 #include <algorithm>
 #include <utility>
+#include <atomic>
+#include <thread>
+#include <tuple>
 #include <queue>
+#include <set>
 using namespace std;
 
 // physim includes
 #include <physim/math/vec2.hpp>
 
 // charanim includes
-#include <anim/terrain/ray_rasterize_4_way.hpp>
-#include <anim/utils/indexed_minheap.hpp>
+#include <anim/terrain/grid_traversal.hpp>
+#include <anim/utils/batch_queue.hpp>
 
 namespace charanim {
 
@@ -44,6 +50,8 @@ namespace charanim {
 #define NO_LIST		0x00
 #define OPEN_LIST	0x01
 #define CLOSED_LIST 0x02
+// maximum amount of targets for which searches use a heuristic
+#define MAX_HEURISTIC_TARGETS 16
 #define global_xy(x,y) static_cast<size_t>(y)*resX + static_cast<size_t>(x)
 #define global_latpoint(C) static_cast<size_t>(C.y())*resX + static_cast<size_t>(C.x())
 #define vec2_out(c) "(" << c.x << "," << c.y << ")"
@@ -63,45 +71,6 @@ namespace charanim {
 		ns[i].x() = cx; ns[i].y() = cy; ++i;	\
 	}
 
-struct node {
-	latticePoint latpoint;
-	double priority;
-	char LIST;
-
-	node() {
-		LIST = NO_LIST;
-	}
-	node(char l, double p, const latticePoint& lp) {
-		LIST = l;
-		priority = p;
-		latpoint = lp;
-	}
-
-	inline bool in_none() const {
-		return LIST == NO_LIST;
-	}
-	inline bool in_closed() const {
-		return (LIST & CLOSED_LIST) != 0;
-	}
-	inline bool in_open() const {
-		return (LIST & OPEN_LIST) != 0;
-	}
-
-	inline bool operator< (const node& n) const {
-		// if this node is not the queue it should have lowest priority
-		if (not in_open()) {
-			return false;
-		}
-		// if parameter node is not the queue it should have lowest priority
-		if (not n.in_open()) {
-			return true;
-		}
-
-		// if both nodes are in the queue then compare priorities
-		return priority < n.priority;
-	}
-};
-
 static inline
 float dist_point_to_rect(const vec2& p1, const vec2& p2, const vec2& pm) {
 	float x1 = p1.x;
@@ -132,10 +101,54 @@ vec2 regular_grid::from_latPoint_to_vec2(size_t x, size_t y) const {
 	return vec2(lenX*x + lenX/2.0f, lenY*y + lenY/2.0f);
 }
 
-size_t regular_grid::make_neighbours
-(const latticePoint& p, float R, latticePoint ns[8]) const
+const float *regular_grid::search_density() const {
+	if (density == nullptr or density_weight <= 0.0f) {
+		return nullptr;
+	}
+	return density->get_density();
+}
+
+void regular_grid::fill_traversability_mask(float R, bitmask& mask) const {
+	const int _resY = static_cast<int>(resY);
+
+	#pragma omp parallel for
+	for (int cy = 0; cy < _resY; ++cy) {
+		for (size_t cx = 0; cx < resX; ++cx) {
+			if (grid_cells[global_xy(cx,cy)] >= R) {
+				mask.set(cx, cy);
+			}
+			else {
+				mask.unset(cx, cy);
+			}
+		}
+	}
+}
+
+size_t regular_grid::make_neighbours(
+	const latticePoint& p, float R, const bitmask *mask,
+	latticePoint ns[8]
+) const
 {
 	size_t it = 0;
+
+	if (mask != nullptr) {
+		// offsets of the neighbours in the order
+		// of the bits of bitmask::neighbours
+		static const int dx[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+		static const int dy[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+		// iterate through the set bits only
+		uint32_t bits = mask->neighbours(p.x(), p.y());
+		while (bits != 0) {
+			int b = __builtin_ctz(bits);
+			bits &= bits - 1;
+			ns[it].x() = p.x() + dx[b];
+			ns[it].y() = p.y() + dy[b];
+			++it;
+		}
+		return it;
+	}
+
 	int _resX = static_cast<int>(resX);
 	int _resY = static_cast<int>(resY);
 
@@ -144,7 +157,7 @@ size_t regular_grid::make_neighbours
 			make_neighbour(it, p.x() - 1, p.y() - 1)
 		}
 		make_neighbour(it, p.x(), p.y() - 1)
-		if (p.x() < _resX) {
+		if (p.x() + 1 < _resX) {
 			make_neighbour(it, p.x() + 1, p.y() - 1)
 		}
 	}
@@ -152,16 +165,16 @@ size_t regular_grid::make_neighbours
 	if (p.x() > 0) {
 		make_neighbour(it, p.x() - 1, p.y())
 	}
-	if (p.x() < _resX) {
+	if (p.x() + 1 < _resX) {
 		make_neighbour(it, p.x() + 1, p.y())
 	}
 
-	if (p.y() < _resY) {
+	if (p.y() + 1 < _resY) {
 		if (p.x() > 0) {
 			make_neighbour(it, p.x() - 1, p.y() + 1)
 		}
 		make_neighbour(it, p.x(), p.y() + 1)
-		if (p.x() < _resX) {
+		if (p.x() + 1 < _resX) {
 			make_neighbour(it, p.x() + 1, p.y() + 1)
 		}
 	}
@@ -169,6 +182,683 @@ size_t regular_grid::make_neighbours
 	return it;
 }
 
+bool regular_grid::segment_less::operator()
+(const segment& a, const segment& b) const
+{
+	return make_tuple(a.first.x, a.first.y, a.second.x, a.second.y) <
+		   make_tuple(b.first.x, b.first.y, b.second.x, b.second.y);
+}
+
+int32_t regular_grid::segment_index(const segment& s) {
+	auto it = label_of.lower_bound(s);
+	if (it != label_of.end() and not segment_less()(s, it->first)) {
+		return it->second;
+	}
+
+	int32_t l;
+	if (free_labels.size() > 0) {
+		l = free_labels.back();
+		free_labels.pop_back();
+		segments[l] = s;
+	}
+	else {
+		l = static_cast<int32_t>(segments.size());
+		segments.push_back(s);
+	}
+	label_of.insert(it, make_pair(s, l));
+	return l;
+}
+
+bool regular_grid::bounded_search(
+	const latticePoint& start, const latticePoint& goal, float R,
+	const search_policy& p,
+	vector<vec2>& path
+) const
+{
+	const double eps = std::max(1.0, double(p.epsilon));
+	const bool focal = (p.type == search_policy::search_type::focal);
+
+	// the heuristic is the euclidean distance to the goal: it is
+	// consistent, so the priority of the cells of OPEN never
+	// falls below the priority of the cell expanded
+	auto heuristic =
+	[&](const latticePoint& cell) {
+		return double(l2(cell, goal));
+	};
+
+	vector<double> cost_so_far(resX*resY, MAX_DINF);
+	// priority of the cell in OPEN
+	vector<double> priority(resX*resY, MAX_DINF);
+	vector<latticePoint> parent(resX*resY);
+	vector<char> which_list(resX*resY, NO_LIST);
+
+	// OPEN: sorted by priority.
+	set<pair<double, size_t> > OPEN;
+	// FOCAL (focal search only): the cells of OPEN with priority at
+	// most eps times the minimum priority in OPEN, sorted by
+	// decreasing (bounded) clearance, then by distance to the goal.
+	typedef tuple<double, double, size_t> focal_key;
+	set<focal_key> FOCAL;
+	// priorities below this bound are in FOCAL
+	double focal_bound = -1.0;
+
+	auto make_focal_key =
+	[&](size_t idx) {
+		const double c = std::min(grid_cells[idx], p.max_clearance);
+		return focal_key(-c, priority[idx] - cost_so_far[idx], idx);
+	};
+	auto add_to_open =
+	[&](size_t idx, const latticePoint& cell) {
+		const double h = heuristic(cell);
+		priority[idx] = cost_so_far[idx] + (focal ? h : eps*h);
+		OPEN.insert(make_pair(priority[idx], idx));
+		if (focal and priority[idx] <= focal_bound) {
+			FOCAL.insert(make_focal_key(idx));
+		}
+		which_list[idx] = OPEN_LIST;
+	};
+	auto remove_from_open =
+	[&](size_t idx) {
+		OPEN.erase(make_pair(priority[idx], idx));
+		if (focal) {
+			FOCAL.erase(make_focal_key(idx));
+		}
+	};
+
+	// array of neighbours of a lattice point
+	latticePoint ns[8];
+	const bitmask *mask = get_traversability_mask(R);
+	const float *D = search_density();
+
+	cost_so_far[ global_latpoint(start) ] = 0.0;
+	add_to_open(global_latpoint(start), start);
+
+	bool reached_goal = false;
+	while (not OPEN.empty()) {
+		size_t cur_idx;
+		if (focal) {
+			// the minimum priority may have increased: add
+			// to FOCAL the cells below the new bound
+			const double bound = eps*OPEN.begin()->first;
+			if (bound > focal_bound) {
+				auto it = OPEN.upper_bound
+				(make_pair(focal_bound, numeric_limits<size_t>::max()));
+				for (; it != OPEN.end() and it->first <= bound; ++it) {
+					FOCAL.insert(make_focal_key(it->second));
+				}
+				focal_bound = bound;
+			}
+			cur_idx = get<2>(*FOCAL.begin());
+		}
+		else {
+			cur_idx = OPEN.begin()->second;
+		}
+
+		remove_from_open(cur_idx);
+		which_list[cur_idx] = CLOSED_LIST;
+
+		latticePoint cur_cell(cur_idx%resX, cur_idx/resX);
+		if (cur_cell == goal) {
+			reached_goal = true;
+			break;
+		}
+		double cur_cost = cost_so_far[cur_idx];
+
+		size_t n = make_neighbours(cur_cell, R, mask, ns);
+		for (size_t i = 0; i < n; ++i) {
+			const latticePoint& neigh = ns[i];
+			size_t neigh_idx = global_latpoint(neigh);
+
+			double neigh_cost = cur_cost + l2(cur_cell, neigh);
+			if (D != nullptr) {
+				neigh_cost += density_weight*D[neigh_idx];
+			}
+			if (neigh_cost < cost_so_far[neigh_idx]) {
+				// closed cells are reopened
+				if (which_list[neigh_idx] == OPEN_LIST) {
+					remove_from_open(neigh_idx);
+				}
+				cost_so_far[neigh_idx] = neigh_cost;
+				parent[neigh_idx] = cur_cell;
+				add_to_open(neigh_idx, neigh);
+			}
+		}
+	}
+
+	if (not reached_goal) {
+		return false;
+	}
+
+	// make path from goal to start and reverse
+	latticePoint lp = goal;
+	while (lp != start) {
+		path.push_back(from_latPoint_to_vec2(lp));
+		lp = parent[global_latpoint(lp)];
+	}
+	std::reverse(path.begin(), path.end());
+	return true;
+}
+
+bool regular_grid::search(
+	const latticePoint& start, const latticePoint& goal, float R,
+	const search_policy& p,
+	vector<vec2>& path
+) const
+{
+	const size_t start_idx = global_latpoint(start);
+	const size_t goal_idx = global_latpoint(goal);
+	const bitmask *mask = get_traversability_mask(R);
+
+	// searches between close cells visit few cells: the
+	// nodes are hashed instead of allocated for all cells
+	const size_t box =
+		static_cast<size_t>(std::abs(start.x() - goal.x()) + 1)*
+		static_cast<size_t>(std::abs(start.y() - goal.y()) + 1);
+	const bool hashed = 16*box < resX*resY;
+
+	grid_search::euclidean_heuristic hw;
+	hw.gx = goal.x();
+	hw.gy = goal.y();
+	hw.eps = std::max(1.0, double(p.epsilon));
+
+	grid_search::clearance_heuristic hc;
+	hc.cells = grid_cells;
+	hc.resX = resX;
+	hc.gx = goal.x();
+	hc.gy = goal.y();
+	hc.a = p.heuristic_weight;
+	hc.b = p.clearance_weight;
+
+	const bool weighted = (p.type == search_policy::search_type::weighted);
+	const float *D = search_density();
+	vector<size_t> cells;
+	bool found;
+
+	if (D == nullptr) {
+		grid_search::euclidean_cost cost;
+		found = (weighted ?
+			search_with(start_idx, goal_idx, R, mask, hashed, cost, hw, cells) :
+			search_with(start_idx, goal_idx, R, mask, hashed, cost, hc, cells));
+	}
+	else {
+		grid_search::density_cost cost;
+		cost.density = D;
+		cost.w = density_weight;
+		found = (weighted ?
+			search_with(start_idx, goal_idx, R, mask, hashed, cost, hw, cells) :
+			search_with(start_idx, goal_idx, R, mask, hashed, cost, hc, cells));
+	}
+
+	if (not found) {
+		return false;
+	}
+	for (size_t c : cells) {
+		path.push_back(from_latPoint_to_vec2(c%resX, c/resX));
+	}
+	return true;
+}
+
+bool regular_grid::parallel_search(
+	const latticePoint& start, const latticePoint& goal, float R,
+	double eps,
+	vector<vec2>& path
+) const
+{
+	const size_t T = search_threads;
+	const size_t start_idx = global_latpoint(start);
+	const size_t goal_idx = global_latpoint(goal);
+	if (start_idx == goal_idx) {
+		return true;
+	}
+
+	// a cell reached with cost 'g' from cell 'parent',
+	// sent to the thread that owns the cell
+	struct message {
+		size_t cell;
+		size_t parent;
+		double g;
+	};
+
+	// blocks of 4x4 cells belong to the same thread, so
+	// that fewer neighbours have to be sent to other threads
+	auto owner =
+	[&](size_t idx) -> size_t {
+		const uint64_t bx = (idx%resX) >> 2;
+		const uint64_t by = (idx/resX) >> 2;
+		uint64_t h = (bx*0x9E3779B97F4A7C15ULL) ^ (by*0xC2B2AE3D27D4EB4FULL);
+		h ^= h >> 29;
+		return static_cast<size_t>(h%T);
+	};
+	auto heuristic =
+	[&](size_t idx) {
+		const latticePoint cell(idx%resX, idx/resX);
+		return double(l2(cell, goal));
+	};
+
+	const bitmask *mask = get_traversability_mask(R);
+	const float *D = search_density();
+
+	// the values of a cell are only read and written by its owner
+	vector<double> cost_so_far(resX*resY, MAX_DINF);
+	vector<size_t> parent(resX*resY, start_idx);
+
+	vector<batch_queue<message> > inbox(T);
+	// cost of the best path to the goal found so far
+	atomic<double> incumbent(MAX_DINF);
+	// messages sent and not yet processed
+	atomic<long long> in_flight(0);
+	// number of times a thread has gone from idle to busy
+	atomic<size_t> epoch(0);
+	vector<atomic<int> > idle(T);
+	for (size_t t = 0; t < T; ++t) {
+		idle[t].store(0);
+	}
+	atomic<bool> done(false);
+
+	auto worker =
+	[&](size_t t) {
+		// OPEN: (priority, cost, cell), stale entries are skipped
+		typedef tuple<double, double, size_t> entry;
+		priority_queue<entry, vector<entry>, greater<entry> > OPEN;
+		vector<vector<message> > outbox(T);
+		latticePoint ns[8];
+
+		auto set_busy =
+		[&]() {
+			if (idle[t].load() == 1) {
+				epoch.fetch_add(1);
+				idle[t].store(0);
+			}
+		};
+		auto receive =
+		[&](const message& m) {
+			if (m.g >= cost_so_far[m.cell]) {
+				return;
+			}
+			// the heuristic is admissible: cells that
+			// can't improve the best path are pruned
+			const double h = heuristic(m.cell);
+			if (m.g + h >= incumbent.load()) {
+				return;
+			}
+			cost_so_far[m.cell] = m.g;
+			parent[m.cell] = m.parent;
+
+			if (m.cell == goal_idx) {
+				double c = incumbent.load();
+				while (m.g < c and not incumbent.compare_exchange_weak(c, m.g))
+				{ }
+				return;
+			}
+			OPEN.push(entry(m.g + eps*h, m.g, m.cell));
+		};
+
+		if (owner(start_idx) == t) {
+			receive(message{start_idx, start_idx, 0.0});
+		}
+
+		while (not done.load()) {
+			typename batch_queue<message>::batch *b = inbox[t].take_all();
+			if (b != nullptr) {
+				// busy before the messages stop being in flight
+				set_busy();
+				long long n = 0;
+				for (auto *c = b; c != nullptr; c = c->next) {
+					for (const message& m : c->msgs) {
+						receive(m);
+					}
+					n += c->msgs.size();
+				}
+				batch_queue<message>::free_batches(b);
+				in_flight.fetch_sub(n);
+			}
+
+			// expand a few cells before looking at the messages again
+			size_t expanded = 0;
+			while (not OPEN.empty() and expanded < 64) {
+				const double f = get<0>(OPEN.top());
+				const double g = get<1>(OPEN.top());
+				const size_t u = get<2>(OPEN.top());
+				if (f >= incumbent.load()) {
+					break;
+				}
+				OPEN.pop();
+				if (g > cost_so_far[u]) {
+					continue;
+				}
+
+				set_busy();
+				++expanded;
+
+				const latticePoint cur_cell(u%resX, u/resX);
+				size_t n = make_neighbours(cur_cell, R, mask, ns);
+				for (size_t i = 0; i < n; ++i) {
+					const size_t v = global_latpoint(ns[i]);
+					const double c = (D == nullptr ? 0.0 : density_weight*D[v]);
+					const message m{v, u, g + l2(cur_cell, ns[i]) + c};
+					const size_t o = owner(v);
+					if (o == t) {
+						receive(m);
+					}
+					else {
+						outbox[o].push_back(m);
+					}
+				}
+			}
+
+			for (size_t o = 0; o < T; ++o) {
+				if (not outbox[o].empty()) {
+					in_flight.fetch_add(outbox[o].size());
+					inbox[o].push(outbox[o]);
+				}
+			}
+			if (b != nullptr or expanded > 0) {
+				continue;
+			}
+
+			// Nothing to do. The search is over if all threads are
+			// idle, no message is in flight and no thread became busy
+			// in the meantime.
+			idle[t].store(1);
+			const size_t e = epoch.load();
+			bool all_idle = true;
+			for (size_t o = 0; o < T and all_idle; ++o) {
+				all_idle = (idle[o].load() == 1);
+			}
+			if (all_idle and in_flight.load() == 0 and epoch.load() == e) {
+				done.store(true);
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	};
+
+	vector<thread> workers;
+	for (size_t t = 0; t < T; ++t) {
+		workers.push_back(thread(worker, t));
+	}
+	for (thread& w : workers) {
+		w.join();
+	}
+
+	if (incumbent.load() == MAX_DINF) {
+		return false;
+	}
+
+	// make path from goal to start and reverse
+	size_t idx = goal_idx;
+	while (idx != start_idx) {
+		path.push_back(from_latPoint_to_vec2(idx%resX, idx/resX));
+		idx = parent[idx];
+	}
+	std::reverse(path.begin(), path.end());
+	return true;
+}
+
+void regular_grid::fill_clearance_pyramid() {
+	for (size_t l = 0; l < pyramid.size(); ++l) {
+		// the level below
+		const float *prev = (l == 0 ? grid_cells : &pyramid[l - 1][0]);
+		const size_t pX = (l == 0 ? resX : pyramid_resX[l - 1]);
+		const size_t pY = (l == 0 ? resY : pyramid_resY[l - 1]);
+
+		const size_t rX = pyramid_resX[l];
+		const int rY = static_cast<int>(pyramid_resY[l]);
+
+		#pragma omp parallel for
+		for (int y = 0; y < rY; ++y) {
+			for (size_t x = 0; x < rX; ++x) {
+				float m = MAX_FINF;
+				for (size_t cy = 2*y; cy < std::min(2*size_t(y) + 2, pY); ++cy) {
+					for (size_t cx = 2*x; cx < std::min(2*x + 2, pX); ++cx) {
+						m = std::min(m, prev[cy*pX + cx]);
+					}
+				}
+				pyramid[l][y*rX + x] = m;
+			}
+		}
+	}
+}
+
+bool regular_grid::search_level(
+	size_t level,
+	const latticePoint& start, const latticePoint& goal, float R,
+	const unordered_set<size_t> *corridor,
+	vector<latticePoint>& cells
+) const
+{
+	const float *values = (level == 0 ? grid_cells : &pyramid[level - 1][0]);
+	const int rX = static_cast<int>(level == 0 ? resX : pyramid_resX[level - 1]);
+	const int rY = static_cast<int>(level == 0 ? resY : pyramid_resY[level - 1]);
+	// number of cells in the x-axis of the level above
+	const size_t cX = (corridor == nullptr ? 0 : pyramid_resX[level]);
+
+	const size_t s_idx = size_t(start.y())*rX + size_t(start.x());
+	const size_t g_idx = size_t(goal.y())*rX + size_t(goal.x());
+	// the coarse levels have no density
+	const float *D = (level == 0 ? search_density() : nullptr);
+
+	auto heuristic =
+	[&](int x, int y) {
+		return charanim_l2(double(x),double(y), double(goal.x()),double(goal.y()));
+	};
+
+	// only the cells visited are stored: the
+	// search is restricted to a small corridor
+	unordered_map<size_t, double> cost_so_far;
+	unordered_map<size_t, size_t> parent;
+	unordered_set<size_t> closed;
+
+	typedef pair<double, size_t> priority_cell;
+	priority_queue
+	<priority_cell, vector<priority_cell>, greater<priority_cell> > OPEN;
+
+	cost_so_far[s_idx] = 0.0;
+	OPEN.push(make_pair(heuristic(start.x(), start.y()), s_idx));
+
+	bool reached_goal = false;
+	while (not OPEN.empty()) {
+		size_t cur = OPEN.top().second;
+		OPEN.pop();
+		if (not closed.insert(cur).second) {
+			continue;
+		}
+		if (cur == g_idx) {
+			reached_goal = true;
+			break;
+		}
+
+		const int x = static_cast<int>(cur%rX);
+		const int y = static_cast<int>(cur/rX);
+		const double cur_cost = cost_so_far[cur];
+
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				const int nx = x + dx;
+				const int ny = y + dy;
+				// 4-connected grids have no diagonal moves
+				if ((dx == 0 and dy == 0) or
+					(connectivity == 4 and dx != 0 and dy != 0) or
+					nx < 0 or ny < 0 or nx >= rX or ny >= rY)
+				{
+					continue;
+				}
+
+				const size_t neigh = size_t(ny)*rX + size_t(nx);
+				if (neigh != g_idx and values[neigh] < R) {
+					continue;
+				}
+				if (corridor != nullptr and
+					corridor->find(size_t(ny/2)*cX + size_t(nx/2)) == corridor->end())
+				{
+					continue;
+				}
+				if (closed.find(neigh) != closed.end()) {
+					continue;
+				}
+
+				double neigh_cost =
+					cur_cost + ((dx != 0 and dy != 0) ? std::sqrt(2.0) : 1.0);
+				if (D != nullptr) {
+					neigh_cost += density_weight*D[neigh];
+				}
+				auto it = cost_so_far.find(neigh);
+				if (it == cost_so_far.end() or neigh_cost < it->second) {
+					cost_so_far[neigh] = neigh_cost;
+					parent[neigh] = cur;
+					OPEN.push(make_pair(neigh_cost + heuristic(nx,ny), neigh));
+				}
+			}
+		}
+	}
+
+	if (not reached_goal) {
+		return false;
+	}
+
+	cells.clear();
+	for (size_t c = g_idx; c != s_idx; c = parent[c]) {
+		cells.push_back(latticePoint(c%rX, c/rX));
+	}
+	cells.push_back(start);
+	std::reverse(cells.begin(), cells.end());
+	return true;
+}
+
+bool regular_grid::coarse_to_fine_path(
+	const latticePoint& start, const latticePoint& goal, float R,
+	vector<vec2>& path
+) const
+{
+	const size_t L = pyramid.size();
+
+	// search the whole coarsest level
+	vector<latticePoint> cells;
+	latticePoint s(start.x() >> L, start.y() >> L);
+	latticePoint g(goal.x() >> L, goal.y() >> L);
+	if (not search_level(L, s, g, R, nullptr, cells)) {
+		return false;
+	}
+
+	for (size_t level = L; level > 0; --level) {
+		// corridor: the cells of the path and their neighbours
+		const int rX = static_cast<int>(pyramid_resX[level - 1]);
+		const int rY = static_cast<int>(pyramid_resY[level - 1]);
+		unordered_set<size_t> corridor;
+		for (const latticePoint& c : cells) {
+			for (int dy = -1; dy <= 1; ++dy) {
+				for (int dx = -1; dx <= 1; ++dx) {
+					const int nx = c.x() + dx;
+					const int ny = c.y() + dy;
+					if (0 <= nx and nx < rX and 0 <= ny and ny < rY) {
+						corridor.insert(size_t(ny)*rX + size_t(nx));
+					}
+				}
+			}
+		}
+
+		// search the level below inside the corridor
+		const size_t shift = level - 1;
+		s = latticePoint(start.x() >> shift, start.y() >> shift);
+		g = latticePoint(goal.x() >> shift, goal.y() >> shift);
+		if (not search_level(level - 1, s, g, R, &corridor, cells)) {
+			return false;
+		}
+	}
+
+	// as in find_path, the starting cell is not in the path
+	for (size_t i = 1; i < cells.size(); ++i) {
+		path.push_back(from_latPoint_to_vec2(cells[i]));
+	}
+	return true;
+}
+
+void regular_grid::expand_to_targets(
+	const latticePoint& start,
+	const vector<latticePoint>& targets, size_t n,
+	float R,
+	vector<latticePoint>& parent,
+	vector<size_t>& reached
+) const
+{
+	// several targets may be in the same cell
+	unordered_multimap<size_t, size_t> target_of_cell;
+	for (size_t i = 0; i < targets.size(); ++i) {
+		target_of_cell.insert(make_pair(global_latpoint(targets[i]), i));
+	}
+
+	// distance to the closest target: it never overestimates
+	// the actual cost, so the cost of the cells closed is minimum
+	const bool use_heuristic = targets.size() <= MAX_HEURISTIC_TARGETS;
+	auto heuristic =
+	[&](const latticePoint& cell) {
+		if (not use_heuristic) {
+			return 0.0;
+		}
+		double h = MAX_DINF;
+		for (const latticePoint& t : targets) {
+			h = std::min(h, double(l2(cell, t)));
+		}
+		return h;
+	};
+
+	typedef pair<double, size_t> priority_cell;
+	priority_queue
+	<priority_cell, vector<priority_cell>, greater<priority_cell> > OPEN;
+
+	parent.assign(resX*resY, latticePoint());
+	vector<double> cost_so_far(resX*resY, MAX_DINF);
+	vector<char> which_list(resX*resY, NO_LIST);
+
+	// array of neighbours of a lattice point
+	latticePoint ns[8];
+	const bitmask *mask = get_traversability_mask(R);
+	const float *D = search_density();
+
+	cost_so_far[ global_latpoint(start) ] = 0.0;
+	OPEN.push(make_pair(heuristic(start), global_latpoint(start)));
+
+	while (not OPEN.empty() and reached.size() < n) {
+		size_t cur_idx = OPEN.top().second;
+		OPEN.pop();
+
+		// a cell may be in the queue more than once
+		if (which_list[cur_idx] == CLOSED_LIST) {
+			continue;
+		}
+		which_list[cur_idx] = CLOSED_LIST;
+
+		auto range = target_of_cell.equal_range(cur_idx);
+		for (auto it = range.first; it != range.second; ++it) {
+			reached.push_back(it->second);
+		}
+
+		latticePoint cur_cell(cur_idx%resX, cur_idx/resX);
+		double cur_cost = cost_so_far[cur_idx];
+
+		size_t k = make_neighbours(cur_cell, R, mask, ns);
+		for (size_t i = 0; i < k; ++i) {
+			const latticePoint& neigh = ns[i];
+			size_t neigh_idx = global_latpoint(neigh);
+			if (which_list[neigh_idx] == CLOSED_LIST) {
+				continue;
+			}
+
+			double neigh_cost = cur_cost + l2(cur_cell, neigh);
+			if (D != nullptr) {
+				neigh_cost += density_weight*D[neigh_idx];
+			}
+			if (neigh_cost < cost_so_far[neigh_idx]) {
+				cost_so_far[neigh_idx] = neigh_cost;
+				parent[neigh_idx] = cur_cell;
+				which_list[neigh_idx] = OPEN_LIST;
+				OPEN.push(make_pair(neigh_cost + heuristic(neigh), neigh_idx));
+			}
+		}
+	}
+}
+
 // PUBLIC
 
 regular_grid::regular_grid() {
@@ -176,6 +866,13 @@ regular_grid::regular_grid() {
 	dimX = dimY = 0.0f;
 	max_dist = 0.0f;
 	grid_cells = nullptr;
+	grid_labels = nullptr;
+	own_cells = true;
+	search_threads = 1;
+	connectivity = 8;
+	wall_thickness = 0.0f;
+	density = nullptr;
+	density_weight = 0.0f;
 }
 
 regular_grid::~regular_grid() {
@@ -192,9 +889,12 @@ void regular_grid::init(size_t cellsx, size_t cellsy, float dx, float dy) {
 	lenX = dimX/resX;
 	lenY = dimY/resY;
 	max_dist = 0.0f;
+	own_cells = true;
 	grid_cells = static_cast<float *>(malloc(resX*resY*sizeof(float)));
+	grid_labels = static_cast<int32_t *>(malloc(resX*resY*sizeof(int32_t)));
 	for (size_t i = 0; i < resX*resY; ++i) {
 		grid_cells[i] = numeric_limits<float>::max();
+		grid_labels[i] = -1;
 	}
 }
 
@@ -205,35 +905,112 @@ void regular_grid::init(const std::vector<segment>& segs) {
 	}
 }
 
+void regular_grid::init(
+	size_t cellsx, size_t cellsy, float dx, float dy,
+	float *cells, int32_t *labels,
+	const vector<segment>& segs, float md
+)
+{
+	resX = cellsx;
+	resY = cellsy;
+	dimX = dx;
+	dimY = dy;
+	lenX = dimX/resX;
+	lenY = dimY/resY;
+	max_dist = md;
+	own_cells = false;
+	grid_cells = cells;
+	grid_labels = labels;
+	segments = segs;
+	label_of.clear();
+	free_labels.clear();
+	for (size_t l = 0; l < segments.size(); ++l) {
+		label_of.insert(make_pair(segments[l], static_cast<int32_t>(l)));
+	}
+}
+
+void regular_grid::init(const spatial_index& index) {
+	const vector<segment>& segs = index.get_segments();
+
+	// label of every segment of the index
+	vector<int32_t> label(segs.size());
+	for (size_t i = 0; i < segs.size(); ++i) {
+		rasterise_segment(segs[i]);
+		label[i] = segment_index(segs[i]);
+	}
+
+	const int _resY = static_cast<int>(resY);
+
+	#pragma omp parallel for
+	for (int cy = 0; cy < _resY; ++cy) {
+		for (size_t cx = 0; cx < resX; ++cx) {
+			float D;
+			int i = index.nearest_segment(from_latPoint_to_vec2(cx,cy), D);
+			if (i != -1 and D < grid_cells[global_xy(cx,cy)]) {
+				grid_cells[global_xy(cx,cy)] = D;
+				grid_labels[global_xy(cx,cy)] = label[i];
+			}
+		}
+	}
+}
+
 void regular_grid::clear() {
 	resX = resY = 0;
 	dimX = dimY = 0.0f;
 	max_dist = 0.0f;
-	if (grid_cells != nullptr) {
+	if (grid_cells != nullptr and own_cells) {
 		free(grid_cells);
-		grid_cells = nullptr;
 	}
+	if (grid_labels != nullptr and own_cells) {
+		free(grid_labels);
+	}
+	grid_cells = nullptr;
+	grid_labels = nullptr;
+	own_cells = true;
+	segments.clear();
+	label_of.clear();
+	free_labels.clear();
+	masks.clear();
+	pyramid.clear();
+	pyramid_resX.clear();
+	pyramid_resY.clear();
 }
 
 void regular_grid::rasterise_segment(const segment& seg) {
 	/* ------------------------------- */
 	/* rasterise segment into the grid */
-	ray_rasterize_4_way ray;
-
 	const vec2& s = seg.first;
 	const vec2& t = seg.second;
 
-	latticePoint lP = from_vec2_to_latPoint(s);
-	latticePoint lQ = from_vec2_to_latPoint(t);
+	// the end points of segments on the boundary of
+	// the terrain fall outside the grid: clamp them
+	auto clamp =
+	[&](latticePoint p) {
+		p.x() = std::min(std::max(p.x(), 0), static_cast<int>(resX) - 1);
+		p.y() = std::min(std::max(p.y(), 0), static_cast<int>(resY) - 1);
+		return p;
+	};
+	const latticePoint lP = clamp(from_vec2_to_latPoint(s));
+	const latticePoint lQ = clamp(from_vec2_to_latPoint(t));
+
+	const int32_t label = segment_index(seg);
 
 	// rasterise the line and set '0' to its grid cells
-	ray.init(lP, lQ);
-	latticePoint grid_cell;
-	size_t g_idx;
-	while (not ray.is_last()) {
-		ray.get_advance(grid_cell);
-		g_idx = global_xy(grid_cell.x(), grid_cell.y());
+	auto set_cell =
+	[&](int x, int y) {
+		const size_t g_idx = global_xy(x,y);
 		grid_cells[g_idx] = 0.0f;
+		grid_labels[g_idx] = label;
+	};
+	if (wall_thickness > 0.0f) {
+		grid_traversal::for_each_cell_capsule(
+			s, t, 0.5f*wall_thickness, lenX, lenY,
+			static_cast<int>(resX), static_cast<int>(resY),
+			set_cell
+		);
+	}
+	else {
+		grid_traversal::for_each_cell(lP, lQ, set_cell);
 	}
 }
 
@@ -245,7 +1022,11 @@ void regular_grid::expand_function_distance(const segment& seg) {
 	vec2 u = t - s;
 	float uu = physim::math::dot(u,u);
 
-	for (size_t cy = 0; cy < resY; ++cy) {
+	const int32_t label = segment_index(seg);
+	const int _resY = static_cast<int>(resY);
+
+	#pragma omp parallel for
+	for (int cy = 0; cy < _resY; ++cy) {
 		for (size_t cx = 0; cx < resX; ++cx) {
 
 			// projection of point (cx, cy) onto line
@@ -266,10 +1047,136 @@ void regular_grid::expand_function_distance(const segment& seg) {
 							 physim::math::dist(p, t));
 			}
 
-			grid_cells[global_xy(cx,cy)] =
-				std::min(grid_cells[global_xy(cx,cy)], D);
+			if (D < grid_cells[global_xy(cx,cy)]) {
+				grid_cells[global_xy(cx,cy)] = D;
+				grid_labels[global_xy(cx,cy)] = label;
+			}
+		}
+	}
+}
+
+void regular_grid::fill_polygon(const vector<vec2>& poly) {
+	grid_traversal::for_each_cell_polygon(
+		poly, lenX, lenY, static_cast<int>(resX), static_cast<int>(resY),
+		[&](int x, int y) {
+			float& v = grid_cells[global_xy(x,y)];
+			// overlapping polygons must not flip the sign back
+			if (v > 0.0f) {
+				v = -v;
+			}
+		}
+	);
+}
+
+void regular_grid::clear_polygon(const vector<vec2>& poly) {
+	grid_traversal::for_each_cell_polygon(
+		poly, lenX, lenY, static_cast<int>(resX), static_cast<int>(resY),
+		[&](int x, int y) {
+			float& v = grid_cells[global_xy(x,y)];
+			v = std::abs(v);
+		}
+	);
+}
+
+void regular_grid::update_segments(
+	const spatial_index& index, const vector<segment>& outer,
+	const vector<segment>& removed, const vector<segment>& added
+)
+{
+	// labels of the segments removed
+	vector<segment> R = removed;
+	std::sort(R.begin(), R.end(), segment_less());
+	vector<char> dead(segments.size(), 0);
+	for (size_t l = 0; l < segments.size(); ++l) {
+		dead[l] = std::binary_search(R.begin(), R.end(), segments[l], segment_less());
+	}
+	// the slots already free keep the segment removed before
+	for (int32_t l : free_labels) {
+		dead[l] = 0;
+	}
+
+	// cells whose closest segment was removed, and their bounding box
+	vector<size_t> dirty;
+	size_t x0 = resX, y0 = resY, x1 = 0, y1 = 0;
+	for (size_t i = 0; i < resX*resY; ++i) {
+		if (grid_labels[i] != -1 and dead[grid_labels[i]]) {
+			dirty.push_back(i);
+			x0 = std::min(x0, i%resX);
+			y0 = std::min(y0, i/resX);
+			x1 = std::max(x1, i%resX);
+			y1 = std::max(y1, i/resX);
+		}
+	}
+
+	// the labels of the segments removed are reused: the cells
+	// labelled with them are relabelled below
+	for (size_t l = 0; l < segments.size(); ++l) {
+		if (dead[l]) {
+			auto it = label_of.find(segments[l]);
+			if (it != label_of.end() and it->second == static_cast<int32_t>(l)) {
+				label_of.erase(it);
+			}
+			free_labels.push_back(static_cast<int32_t>(l));
+		}
+	}
+
+	if (dirty.size() > 0) {
+		// distance to the closest segment left
+		const int n_dirty = static_cast<int>(dirty.size());
+		vector<float> D(dirty.size());
+		vector<int> I(dirty.size());
+		#pragma omp parallel for
+		for (int k = 0; k < n_dirty; ++k) {
+			const vec2 p = from_latPoint_to_vec2(dirty[k]%resX, dirty[k]/resX);
+			I[k] = index.nearest_segment(p, D[k]);
+		}
+
+		const vector<segment>& segs = index.get_segments();
+		vector<int32_t> label(segs.size(), -1);
+		for (size_t k = 0; k < dirty.size(); ++k) {
+			grid_cells[dirty[k]] = MAX_FINF;
+			grid_labels[dirty[k]] = -1;
+			if (I[k] != -1) {
+				if (label[I[k]] == -1) {
+					label[I[k]] = segment_index(segs[I[k]]);
+				}
+				grid_cells[dirty[k]] = D[k];
+				grid_labels[dirty[k]] = label[I[k]];
+			}
+		}
+
+		for (const segment& o : outer) {
+			const vec2 u = o.second - o.first;
+			const float uu = physim::math::dot(u,u);
+			const int32_t l = segment_index(o);
+			for (size_t c : dirty) {
+				const vec2 p = from_latPoint_to_vec2(c%resX, c/resX);
+				float t = (uu > 0.0f ? physim::math::dot(p - o.first, u)/uu : 0.0f);
+				t = std::max(0.0f, std::min(1.0f, t));
+				const float d = physim::math::dist(p, o.first + u*t);
+				if (d < grid_cells[c]) {
+					grid_cells[c] = d;
+					grid_labels[c] = l;
+				}
+			}
+		}
+
+		// the segments left may cross the recomputed cells
+		const vec2 margin(lenX + wall_thickness, lenY + wall_thickness);
+		vector<size_t> ids;
+		index.query_aabb(
+			vec2(x0*lenX, y0*lenY) - margin, vec2((x1 + 1)*lenX, (y1 + 1)*lenY) + margin,
+			ids
+		);
+		for (size_t i : ids) {
+			rasterise_segment(segs[i]);
 		}
 	}
+
+	for (const segment& s : added) {
+		rasterise_segment(s);
+		expand_function_distance(s);
+	}
 }
 
 void regular_grid::make_final_state() {
@@ -279,6 +1186,95 @@ void regular_grid::make_final_state() {
 			max_dist = std::max(max_dist, grid_cells[global_xy(cx,cy)]);
 		}
 	}
+
+	// the values of the cells may have changed
+	for (pair<const float, bitmask>& m : masks) {
+		fill_traversability_mask(m.first, m.second);
+	}
+	fill_clearance_pyramid();
+}
+
+void regular_grid::make_inflated_obstacles
+(const vector<segment>& segs, float R, bitmask& occupancy) const
+{
+	occupancy.init(resX, resY);
+	for (const segment& seg : segs) {
+		grid_traversal::for_each_cell_capsule(
+			seg.first, seg.second, R, lenX, lenY,
+			static_cast<int>(resX), static_cast<int>(resY),
+			[&](int x, int y) { occupancy.set(x, y); }
+		);
+	}
+}
+
+void regular_grid::make_traversability_mask(float R) {
+	if (masks.find(R) != masks.end()) {
+		return;
+	}
+	bitmask& mask = masks[R];
+	mask.init(resX, resY);
+	fill_traversability_mask(R, mask);
+}
+
+void regular_grid::clear_traversability_masks() {
+	masks.clear();
+}
+
+void regular_grid::make_clearance_pyramid(size_t levels) {
+	pyramid.resize(levels);
+	pyramid_resX.resize(levels);
+	pyramid_resY.resize(levels);
+
+	size_t rX = resX;
+	size_t rY = resY;
+	for (size_t l = 0; l < levels; ++l) {
+		rX = (rX + 1)/2;
+		rY = (rY + 1)/2;
+		pyramid_resX[l] = rX;
+		pyramid_resY[l] = rY;
+		pyramid[l].resize(rX*rY);
+	}
+	fill_clearance_pyramid();
+}
+
+void regular_grid::clear_clearance_pyramid() {
+	pyramid.clear();
+	pyramid_resX.clear();
+	pyramid_resY.clear();
+}
+
+// SETTERS
+
+void regular_grid::set_search_policy(const search_policy& p) {
+	policy = p;
+}
+
+void regular_grid::set_connectivity(int c) {
+	if (c != 4 and c != 8) {
+		cerr << "regular_grid::set_connectivity - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Connectivity must be 4 or 8. Received: " << c << endl;
+		return;
+	}
+	connectivity = c;
+}
+
+void regular_grid::set_search_threads(size_t n) {
+	search_threads = std::max(n, static_cast<size_t>(1));
+}
+
+void regular_grid::set_wall_thickness(float w) {
+	wall_thickness = std::max(0.0f, w);
+}
+
+void regular_grid::set_density(const density_grid *d, float w) {
+	if (d != nullptr and (d->get_resX() != resX or d->get_resY() != resY)) {
+		cerr << "regular_grid::set_density - Error (" << __LINE__ << "):" << endl;
+		cerr << "    The density grid has " << d->get_resX() << "x" << d->get_resY()
+			 << " cells. Expected: " << resX << "x" << resY << endl;
+		return;
+	}
+	density = d;
+	density_weight = w;
 }
 
 // GETTERS
@@ -288,7 +1284,17 @@ void regular_grid::find_path(
 	float R,
 	vector<vec2>& path,
 	vector<vec2>& smoothed_path
-)
+) const
+{
+	find_path(source, sink, R, policy, path, smoothed_path);
+}
+
+void regular_grid::find_path(
+	const vec2& source, const vec2& sink,
+	float R, const search_policy& p,
+	vector<vec2>& path,
+	vector<vec2>& smoothed_path
+) const
 {
 	// make sure that the particle can start at
 	// 'source' and finish at 'end'
@@ -310,133 +1316,172 @@ void regular_grid::find_path(
 		return;
 	}
 
-	// function to estimate the cost of going from a
-	// cell 'C' to another cell 'G'
-	auto heuristic =
-	[&](const latticePoint& cell) {
-		// distance to closest obstacle
-		double dist_closest = double(grid_cells[global_xy(cell.x(),cell.y())]);
-		return 0.5*l2(cell, goal) - 2.0*dist_closest;
-	};
-
-	// array of neighbours of a lattice point
-	latticePoint ns[8];
+	// search the levels of the pyramid first, if any, only with the
+	// clearance heuristic: the other policies have a bound to keep
+	if (p.type == search_policy::search_type::clearance_heuristic and
+		pyramid.size() > 0 and coarse_to_fine_path(start, goal, R, path))
+	{
+		smooth_path(path, smoothed_path);
+		return;
+	}
 
-	vector<node> all_nodes(resX*resY);
-	for (size_t x = 0; x < resX; ++x) {
-		for (size_t y = 0; y < resY; ++y) {
-			all_nodes[ global_xy(x,y) ].priority = MAX_DINF;
-			all_nodes[ global_xy(x,y) ].LIST = NO_LIST;
-			all_nodes[ global_xy(x,y) ].latpoint.x() = static_cast<int>(x);
-			all_nodes[ global_xy(x,y) ].latpoint.y() = static_cast<int>(y);
+	if (p.type == search_policy::search_type::weighted and search_threads > 1) {
+		if (parallel_search(start, goal, R, std::max(1.0, double(p.epsilon)), path)) {
+			smooth_path(path, smoothed_path);
 		}
+		return;
 	}
 
-	// priority queue for the lattice points
-	indexed_minheap<node> OPEN;
-	OPEN.make_heap(all_nodes);
-
-	// What is the previous cell in the path to cell i?
-	// parent[i] = (x,y) <-> the shortest path goes
-	// first through (x,y) and then through i.
-	// This is used later to reconstruct the path.
-	vector<latticePoint> parent(resX*resY);
-
-	// Actual path cost of going from start to cell i:
-	// cost_so_far[i] = X <-> the cost of going from start
-	// to cell i is equal to X.
-	vector<double> cost_so_far(resX*resY, MAX_DINF);
-
-	// Although we make the heap with all points of
-	// the lattice, none of them is considered to
-	// actually be in the OPEN list
-	vector<char> which_list(resX*resY, NO_LIST);
-
-	// initialise
-	cost_so_far[ global_latpoint(start) ] = 0.0;
-	OPEN.modify_th( global_latpoint(start), node(OPEN_LIST, 0.0, start) );
-	which_list[ global_latpoint(start) ] = OPEN_LIST;
-
-	bool reached_goal = false;
-
-	while (not reached_goal) {
-		const node& top = OPEN.top();
-
-		// if we have reached the goal then
-		// go to the end of the while loop
-		if (top.latpoint == goal) {
-			reached_goal = true;
-
-			break;
+	if (p.type == search_policy::search_type::focal) {
+		if (bounded_search(start, goal, R, p, path)) {
+			smooth_path(path, smoothed_path);
 		}
+		return;
+	}
 
-		assert(top.LIST == OPEN_LIST);
+	if (search(start, goal, R, p, path)) {
+		smooth_path(path, smoothed_path);
+	}
+}
 
-		latticePoint cur_cell = top.latpoint;
-		size_t cur_idx = global_latpoint(cur_cell);
-		double cur_cost = cost_so_far[cur_idx];
+void regular_grid::find_path(
+	const vec2& source, const vec2& sink,
+	float R,
+	vector<vec2>& path,
+	vector<vec2>& smoothed_path,
+	vector<pair<float,float> >& corridor
+) const
+{
+	find_path(source, sink, R, path, smoothed_path);
+	make_corridor(smoothed_path, corridor);
+}
 
-		// remove current from OPEN
-		which_list[cur_idx] = CLOSED_LIST;
-		OPEN.modify_th(cur_idx, node(CLOSED_LIST, top.priority, cur_cell));
+void regular_grid::make_corridor
+(const vector<vec2>& path, vector<pair<float,float> >& corridor) const
+{
+	corridor.clear();
+
+	// sample the segments at the resolution of the grid
+	const float step = std::min(lenX, lenY);
+
+	for (size_t i = 0; i + 1 < path.size(); ++i) {
+		const vec2& p = path[i];
+		const vec2& q = path[i + 1];
+		const float L = physim::math::dist(p, q);
+
+		float left = max_dist;
+		float right = max_dist;
+		if (L > 0.0f) {
+			const vec2 dir = (q - p)*(1.0f/L);
+			const vec2 normal(-dir.y, dir.x);
+
+			const size_t n_samples = static_cast<size_t>(L/step) + 1;
+			for (size_t k = 0; k <= n_samples; ++k) {
+				const vec2 s = p + dir*(L*k/n_samples);
+				left = std::min(left, raycast(s, normal, max_dist, 0.0f));
+				right = std::min(right, raycast(s, normal*(-1.0f), max_dist, 0.0f));
+			}
+		}
+		corridor.push_back(make_pair(left, right));
+	}
+}
 
-		// obtain the valid neighbours around the current cell
-		size_t n = make_neighbours(cur_cell, R, ns);
+float regular_grid::raycast
+(const vec2& origin, const vec2& dir, float max_len, float R) const
+{
+	// the distance function is sampled at the centres of the
+	// cells: the value at any point of a cell may differ from
+	// the value at the centre by half the diagonal of the cell
+	const float half_diag = 0.5f*std::sqrt(lenX*lenX + lenY*lenY);
+	const float min_step = 0.5f*std::min(lenX, lenY);
+
+	float t = 0.0f;
+	while (t < max_len) {
+		const vec2 q = origin + dir*t;
+		if (q.x < 0.0f or q.y < 0.0f or q.x >= dimX or q.y >= dimY) {
+			return t;
+		}
+		const float d = grid_cells[global_latpoint(from_vec2_to_latPoint(q))] - R;
+		if (d <= 0.0f) {
+			return t;
+		}
+		// close to the obstacles the ray advances half a
+		// cell at a time, so that it can pass next to them
+		t += std::max(d - half_diag, min_step);
+	}
+	return max_len;
+}
 
-		// iterate through the neighbours and add them
-		// to the priority queue if needed
-		for (size_t i = 0; i < n; ++i) {
-			const latticePoint& neigh = ns[i];
-			size_t neigh_idx = global_xy(neigh.x(), neigh.y());
+void regular_grid::raycast(
+	const vector<vec2>& origins, const vector<vec2>& dirs,
+	float max_len, float R,
+	vector<float>& hits
+) const
+{
+	const int n = static_cast<int>(origins.size());
+	hits.resize(origins.size());
 
-			// cost of reaching neighbour
-			// =
-			// cost of going from start to current cell
-			// +
-			// cost of going from current cell to neighbour
-			double neigh_cost = cur_cost + l2(cur_cell, neigh);
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < n; ++i) {
+		hits[i] = raycast(origins[i], dirs[i], max_len, R);
+	}
+}
 
-			// approximate cost of going from the neighbour to the goal
-			double h = heuristic(neigh);
-			// actual priority of neighbour
-			double f = neigh_cost + h;
-
-			if (which_list[neigh_idx] == OPEN_LIST) {
-				// lattice point was added at some point
-				// to the priority queue
-				if (neigh_cost < cost_so_far[neigh_idx]) {
-					// the cost of reaching neighbour via another
-					// path is less than the current cost
-					OPEN.modify_th(neigh_idx, node(NO_LIST, f, neigh));
-					which_list[neigh_idx] = NO_LIST;
-				}
-			}
+void regular_grid::raycast_fan(
+	const vec2& origin, size_t n,
+	float max_len, float R,
+	vector<float>& hits
+) const
+{
+	const int _n = static_cast<int>(n);
+	hits.resize(n);
 
-			if (which_list[neigh_idx] == CLOSED_LIST) {
-				// lattice point is considered candidate for path
-				if (neigh_cost < cost_so_far[neigh_idx]) {
-					// but if the cost of reaching neighbour via
-					// another path is less than the current cost
-					// do not do it
-					OPEN.modify_th(neigh_idx, node(NO_LIST, f, neigh));
-					which_list[neigh_idx] = NO_LIST;
-				}
-			}
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < _n; ++i) {
+		const float a = 2.0f*float(M_PI)*i/_n;
+		hits[i] = raycast(origin, vec2(std::cos(a), std::sin(a)), max_len, R);
+	}
+}
 
-			if (which_list[neigh_idx] == NO_LIST) {
-				// Lattice point was never added to the heap,
-				// or was added and then removed in one of the
-				// two previous steps
+int regular_grid::find_path_to_any(
+	const vec2& source, const vector<vec2>& goals,
+	float R,
+	vector<vec2>& path,
+	vector<vec2>& smoothed_path
+) const
+{
+	const latticePoint start = from_vec2_to_latPoint(source);
+	if (grid_cells[global_latpoint(start)] <= R) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't start at " << latpoint_out(start) << endl;
+		cerr << "    This position is at a distance from a static obstacle"
+			 << " of: " << grid_cells[global_latpoint(start)] << endl;
+		return -1;
+	}
 
-				OPEN.modify_th(neigh_idx, node(OPEN_LIST, f, neigh));
-				cost_so_far[neigh_idx] = neigh_cost;
-				parent[neigh_idx] = cur_cell;
-				which_list[neigh_idx] = OPEN_LIST;
-			}
+	// goals where the particle can finish
+	vector<latticePoint> targets;
+	vector<size_t> goal_of_target;
+	for (size_t i = 0; i < goals.size(); ++i) {
+		latticePoint goal = from_vec2_to_latPoint(goals[i]);
+		if (grid_cells[global_latpoint(goal)] > R) {
+			targets.push_back(goal);
+			goal_of_target.push_back(i);
 		}
 	}
+	if (targets.size() == 0) {
+		return -1;
+	}
+
+	vector<latticePoint> parent;
+	vector<size_t> reached;
+	expand_to_targets(start, targets, 1, R, parent, reached);
+	if (reached.size() == 0) {
+		return -1;
+	}
 
 	// make path from goal to start and reverse
+	const latticePoint& goal = targets[reached[0]];
 	latticePoint lp = goal;
 	while (lp != start) {
 		path.push_back(from_latPoint_to_vec2(lp));
@@ -444,7 +1489,65 @@ void regular_grid::find_path(
 	}
 	std::reverse(path.begin(), path.end());
 
-	// refine path using polylines
+	smooth_path(path, smoothed_path);
+	return static_cast<int>(goal_of_target[reached[0]]);
+}
+
+size_t regular_grid::find_paths_from_any(
+	const vector<vec2>& sources, const vec2& sink,
+	float R,
+	vector<vector<vec2> >& paths,
+	vector<vector<vec2> >& smoothed_paths
+) const
+{
+	paths.assign(sources.size(), vector<vec2>());
+	smoothed_paths.assign(sources.size(), vector<vec2>());
+
+	const latticePoint goal = from_vec2_to_latPoint(sink);
+	if (grid_cells[global_latpoint(goal)] <= R) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't finish at " << latpoint_out(goal) << endl;
+		cerr << "    This position is at a distance from a static obstacle"
+			 << " of: " << grid_cells[global_latpoint(goal)] << endl;
+		return 0;
+	}
+
+	// sources where the particle can start
+	vector<latticePoint> targets;
+	vector<size_t> source_of_target;
+	for (size_t i = 0; i < sources.size(); ++i) {
+		latticePoint start = from_vec2_to_latPoint(sources[i]);
+		if (grid_cells[global_latpoint(start)] > R) {
+			targets.push_back(start);
+			source_of_target.push_back(i);
+		}
+	}
+	if (targets.size() == 0) {
+		return 0;
+	}
+
+	// the costs are symmetric: search from the goal
+	vector<latticePoint> parent;
+	vector<size_t> reached;
+	expand_to_targets(goal, targets, targets.size(), R, parent, reached);
+
+	for (size_t t : reached) {
+		vector<vec2>& path = paths[source_of_target[t]];
+
+		// the parents lead from the source to the goal
+		latticePoint lp = targets[t];
+		while (lp != goal) {
+			lp = parent[global_latpoint(lp)];
+			path.push_back(from_latPoint_to_vec2(lp));
+		}
+		smooth_path(path, smoothed_paths[source_of_target[t]]);
+	}
+	return reached.size();
+}
+
+void regular_grid::smooth_path
+(const vector<vec2>& path, vector<vec2>& smoothed_path) const
+{
 	if (path.size() <= 2) {
 		smoothed_path = path;
 		return;
@@ -488,6 +1591,78 @@ const float *regular_grid::get_grid() const {
 	return grid_cells;
 }
 
+const int32_t *regular_grid::get_labels() const {
+	return grid_labels;
+}
+
+const vector<segment>& regular_grid::get_segments() const {
+	return segments;
+}
+
+int32_t regular_grid::get_closest_segment(const vec2& p) const {
+	latticePoint c = from_vec2_to_latPoint(p);
+	c.x() = std::max(0, std::min(c.x(), static_cast<int>(resX) - 1));
+	c.y() = std::max(0, std::min(c.y(), static_cast<int>(resY) - 1));
+	return grid_labels[global_latpoint(c)];
+}
+
+bool regular_grid::closest_point(const vec2& p, vec2& q) const {
+	const int32_t label = get_closest_segment(p);
+	if (label == -1) {
+		return false;
+	}
+
+	const vec2& s = segments[label].first;
+	const vec2& t = segments[label].second;
+	const vec2 u = t - s;
+	const float uu = physim::math::dot(u,u);
+	if (uu == 0.0f) {
+		q = s;
+		return true;
+	}
+
+	float l0 = physim::math::dot(p - s, u)/uu;
+	l0 = std::max(0.0f, std::min(1.0f, l0));
+	q = s + u*l0;
+	return true;
+}
+
+bool regular_grid::wall_normal(const vec2& p, vec2& n) const {
+	vec2 q;
+	if (not closest_point(p, q)) {
+		return false;
+	}
+
+	const float d = physim::math::dist(p, q);
+	if (d > 0.0f) {
+		n = (p - q)*(1.0f/d);
+		if (inside_obstacle(p)) {
+			n = n*(-1.0f);
+		}
+		return true;
+	}
+
+	// the point is on the wall
+	const segment& seg = segments[get_closest_segment(p)];
+	const vec2 u = seg.second - seg.first;
+	const float l = physim::math::norm(u);
+	if (l == 0.0f) {
+		return false;
+	}
+	n = vec2(-u.y/l, u.x/l);
+	return true;
+}
+
+bool regular_grid::inside_obstacle(const vec2& p) const {
+	const latticePoint c = from_vec2_to_latPoint(p);
+	if (c.x() < 0 or c.y() < 0 or
+		c.x() >= static_cast<int>(resX) or c.y() >= static_cast<int>(resY))
+	{
+		return false;
+	}
+	return grid_cells[global_latpoint(c)] < 0.0f;
+}
+
 size_t regular_grid::get_resX() const {
 	return resX;
 }
@@ -506,6 +1681,38 @@ float regular_grid::get_max_dist() const {
 	return max_dist;
 }
 
+const search_policy& regular_grid::get_search_policy() const {
+	return policy;
+}
+
+int regular_grid::get_connectivity() const {
+	return connectivity;
+}
+
+float regular_grid::get_wall_thickness() const {
+	return wall_thickness;
+}
+
+const density_grid *regular_grid::get_density() const {
+	return density;
+}
+
+float regular_grid::get_density_weight() const {
+	return density_weight;
+}
+
+size_t regular_grid::get_search_threads() const {
+	return search_threads;
+}
+
+const bitmask *regular_grid::get_traversability_mask(float R) const {
+	auto it = masks.find(R);
+	if (it == masks.end()) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
 // OTHERS
 
 } // -- namespace charanim
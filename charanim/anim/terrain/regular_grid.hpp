@@ -22,11 +22,20 @@
 #pragma once
 
 // C++ includes
+#include <unordered_set>
+#include <utility>
+#include <cstdint>
 #include <cstddef>
 #include <vector>
+#include <map>
 
 // charanim includes
 #include <anim/definitions.hpp>
+#include <anim/terrain/search_policy.hpp>
+#include <anim/terrain/grid_search.hpp>
+#include <anim/terrain/spatial_index.hpp>
+#include <anim/terrain/density_grid.hpp>
+#include <anim/utils/bitmask.hpp>
 
 namespace charanim {
 
@@ -43,9 +52,41 @@ class regular_grid {
 		 *
 		 * where \f$d_i\f$ is the distance between the cell and the @e i-th
 		 * segment.
+		 *
+		 * The cells inside polygonal obstacles (see @ref fill_polygon) have
+		 * that value negated, so that the values form a signed distance
+		 * function, negative inside the obstacles.
 		 */
 		float *grid_cells;
 
+		/**
+		 * @brief Closest segment to every cell.
+		 *
+		 * Each cell contains the index, in @ref segments, of the segment
+		 * that gives the value of the cell in @ref grid_cells, or -1 if
+		 * there is no segment yet.
+		 */
+		int32_t *grid_labels;
+		/**
+		 * @brief Was the memory of @ref grid_cells and @ref grid_labels
+		 * allocated by this grid?
+		 *
+		 * False when the grid was initialised with the memory of an
+		 * already built grid, for example, a grid mapped from a file.
+		 */
+		bool own_cells;
+		/// Segments rasterised or expanded into the grid.
+		std::vector<segment> segments;
+
+		/// Lexicographic order of segments on their coordinates.
+		struct segment_less {
+			bool operator() (const segment& a, const segment& b) const;
+		};
+		/// Index in @ref segments of every segment, its label.
+		std::map<segment, int32_t, segment_less> label_of;
+		/// Labels in @ref segments of removed segments, to be reused.
+		std::vector<int32_t> free_labels;
+
 		/// Number of cells in the x-axis.
 		size_t resX;
 		/// Number of cells in the y-axis.
@@ -64,6 +105,47 @@ class regular_grid {
 		/// Maximum value in the cells.
 		float max_dist;
 
+		/**
+		 * @brief Traversability masks.
+		 *
+		 * For each radius R, the bit of a cell is set if the value of
+		 * the cell is at least R.
+		 */
+		std::map<float, bitmask> masks;
+
+		/**
+		 * @brief Min-pooled clearance pyramid.
+		 *
+		 * The @e l-th level (starting at 0) has half the cells of the
+		 * previous level in each axis (the first level has half the cells
+		 * of the grid). Each cell contains the minimum value of its (at
+		 * most) four children, so that a coarse cell is traversable only
+		 * if all the cells it covers are.
+		 */
+		std::vector<std::vector<float> > pyramid;
+		/// Number of cells in the x-axis of every level of the pyramid.
+		std::vector<size_t> pyramid_resX;
+		/// Number of cells in the y-axis of every level of the pyramid.
+		std::vector<size_t> pyramid_resY;
+
+		/// Policy used in @ref find_path when none is given.
+		search_policy policy;
+		/// Number of threads of the weighted A* searches.
+		size_t search_threads;
+		/// Connectivity of the cells in the clearance and weighted searches.
+		int connectivity;
+		/**
+		 * @brief Thickness of the segments rasterised.
+		 *
+		 * If 0, segments are rasterised as 4-way lines. Otherwise, every
+		 * cell touched by the segment thickened this much is rasterised.
+		 */
+		float wall_thickness;
+		/// Crowd density added to the cost of the moves, or null.
+		const density_grid *density;
+		/// Weight of the crowd density in the cost of the moves.
+		float density_weight;
+
 	private:
 
 		/// Convert a vec2 to a lattice point.
@@ -73,16 +155,190 @@ class regular_grid {
 		/// Convert a lattice point to a vec2.
 		vec2 from_latPoint_to_vec2(size_t x, size_t y) const;
 
+		/**
+		 * @brief Returns the densities used by a search.
+		 *
+		 * Null if no density grid was set or its weight is 0. Every
+		 * search reads them once (see @ref density_grid).
+		 */
+		const float *search_density() const;
+
+		/// Sets the bits of the traversability mask of radius @e R.
+		void fill_traversability_mask(float R, bitmask& mask) const;
+
 		/**
 		 * @brief Finds the (at most) 8 neighbours of the grid cell p.
 		 * @param[in] p A valid grid cell.
 		 * @param[in] R The minimum distance between a neighbour and the
 		 * closest obstacle.
+		 * @param[in] mask Traversability mask of radius @e R. If it is
+		 * null the values of the cells are compared against @e R.
 		 * @param[out] ns Valid neighbouring grid cells.
 		 * @return Returns the amount of valid neighbours in @e ns.
 		 */
-		size_t make_neighbours
-		(const latticePoint& p, float R, latticePoint ns[8]) const;
+		size_t make_neighbours(
+			const latticePoint& p, float R, const bitmask *mask,
+			latticePoint ns[8]
+		) const;
+
+		/**
+		 * @brief Returns the index of segment @e s in @ref segments.
+		 *
+		 * The segment is added if it is not in the list, in the slot of
+		 * a removed segment if there is any.
+		 */
+		int32_t segment_index(const segment& s);
+
+		/**
+		 * @brief Weighted A* or focal search on the grid.
+		 *
+		 * See @ref search_policy.
+		 * @param[in] start Starting cell.
+		 * @param[in] goal Goal cell.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[in] p Policy of the search (not the clearance heuristic).
+		 * @param[out] path Non-refined path.
+		 * @return Returns false if @e goal was not reached.
+		 */
+		bool bounded_search(
+			const latticePoint& start, const latticePoint& goal, float R,
+			const search_policy& p,
+			std::vector<vec2>& path
+		) const;
+
+		/**
+		 * @brief Clearance or weighted A* search on the grid.
+		 *
+		 * Runs the instantiation of @ref grid_search::astar for the
+		 * connectivity of the grid, the heuristic of the policy and a
+		 * storage of the nodes suited to the distance between @e start
+		 * and @e goal.
+		 * @param[in] start Starting cell.
+		 * @param[in] goal Goal cell.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[in] p Policy of the search (not focal).
+		 * @param[out] path Non-refined path.
+		 * @return Returns false if @e goal was not reached.
+		 */
+		bool search(
+			const latticePoint& start, const latticePoint& goal, float R,
+			const search_policy& p,
+			std::vector<vec2>& path
+		) const;
+
+		/// Calls @ref grid_search::astar with the connectivity of the grid.
+		template<class cost_function, class heuristic_function>
+		bool search_with(
+			size_t start, size_t goal, float R, const bitmask *mask,
+			bool hashed,
+			const cost_function& cost, const heuristic_function& h,
+			std::vector<size_t>& cells
+		) const
+		{
+			if (hashed) {
+				grid_search::hashed_storage S;
+				return (connectivity == 4 ?
+					grid_search::astar<4>(grid_cells, resX, resY, R, mask, start, goal, cost, h, S, cells) :
+					grid_search::astar<8>(grid_cells, resX, resY, R, mask, start, goal, cost, h, S, cells));
+			}
+			grid_search::dense_storage S;
+			return (connectivity == 4 ?
+				grid_search::astar<4>(grid_cells, resX, resY, R, mask, start, goal, cost, h, S, cells) :
+				grid_search::astar<8>(grid_cells, resX, resY, R, mask, start, goal, cost, h, S, cells));
+		}
+
+		/**
+		 * @brief Weighted A* search distributed among threads.
+		 *
+		 * Hash Distributed A*: every cell is owned by one of the threads,
+		 * chosen by hashing blocks of 4x4 cells. Each thread has its own
+		 * open list and expands only the cells it owns; the neighbours
+		 * owned by other threads are sent to them in batches through
+		 * lock-free queues. The cost of the best path to the goal found
+		 * so far is shared by all threads, and cells that can't improve
+		 * it are pruned. The search ends when no thread has a cell whose
+		 * priority is below that cost and no message is in flight, so the
+		 * cost of the path found is at most \f$\epsilon\f$ times the
+		 * optimum, as in @ref bounded_search.
+		 * @param[in] start Starting cell.
+		 * @param[in] goal Goal cell.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[in] eps Weight of the heuristic.
+		 * @param[out] path Non-refined path.
+		 * @return Returns false if @e goal was not reached.
+		 */
+		bool parallel_search(
+			const latticePoint& start, const latticePoint& goal, float R,
+			double eps,
+			std::vector<vec2>& path
+		) const;
+
+		/// Fills the levels of the pyramid.
+		void fill_clearance_pyramid();
+
+		/**
+		 * @brief A* search on a level of resolution.
+		 *
+		 * Level 0 is the grid itself, level @e l > 0 is the level
+		 * @e l - 1 of @ref pyramid. The cells are connected as set
+		 * with @ref set_connectivity.
+		 * @param[in] level Level of resolution.
+		 * @param[in] start Starting cell, in the cells of the level.
+		 * @param[in] goal Goal cell, in the cells of the level.
+		 * @param[in] R Minimum value of the cells of the path (@e start
+		 * and @e goal excluded).
+		 * @param[in] corridor If not null, only the cells whose parent
+		 * is in this set are used.
+		 * @param[out] cells Path from @e start to @e goal (both included).
+		 * @return Returns false if @e goal was not reached.
+		 */
+		bool search_level(
+			size_t level,
+			const latticePoint& start, const latticePoint& goal, float R,
+			const std::unordered_set<size_t> *corridor,
+			std::vector<latticePoint>& cells
+		) const;
+
+		/**
+		 * @brief Coarse-to-fine path search.
+		 *
+		 * Searches the coarsest level of @ref pyramid, and then every finer
+		 * level inside the corridor of the path found in the level above.
+		 * @param[in] start Starting cell.
+		 * @param[in] goal Goal cell.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Non-refined path.
+		 * @return Returns false if the path could not be found, e.g., if
+		 * the corridors are too narrow at coarse levels.
+		 */
+		bool coarse_to_fine_path(
+			const latticePoint& start, const latticePoint& goal, float R,
+			std::vector<vec2>& path
+		) const;
+
+		/**
+		 * @brief Searches the grid from a cell until reaching some targets.
+		 *
+		 * If there are few targets the search is guided with the distance
+		 * to the closest target (A*), otherwise it is a Dijkstra's search.
+		 * In both cases, the cost of reaching every target is minimum.
+		 * @param[in] start Starting cell.
+		 * @param[in] targets Cells to be reached.
+		 * @param[in] n The search stops after reaching @e n targets.
+		 * @param[in] R The minimum distance between a cell and the
+		 * closest obstacle.
+		 * @param[out] parent Previous cell in the path from @e start to
+		 * every cell.
+		 * @param[out] reached Indices of the targets reached, in the order
+		 * in which they were reached.
+		 */
+		void expand_to_targets(
+			const latticePoint& start,
+			const std::vector<latticePoint>& targets, size_t n,
+			float R,
+			std::vector<latticePoint>& parent,
+			std::vector<size_t>& reached
+		) const;
 
 	public:
 		/// Default constructor.
@@ -97,6 +353,39 @@ class regular_grid {
 		/// Raterises the segments in @e segs and updates the distance
 		/// function in the grid's cells.
 		void init(const std::vector<segment>& segs);
+		/**
+		 * @brief Rasterises the segments of @e index and updates the
+		 * distance function in the grid's cells.
+		 *
+		 * Same as @ref init(const std::vector<segment>&) with the segments
+		 * of the index, but the value of each cell is computed with the
+		 * closest segment found in the index, instead of expanding every
+		 * segment over the whole grid.
+		 */
+		void init(const spatial_index& index);
+		/**
+		 * @brief Initialises the grid with the state of an already built
+		 * grid.
+		 *
+		 * The memory of @e cells and @e labels is used as is, without
+		 * copying it, and is not freed by @ref clear. It must stay valid
+		 * as long as this grid is used. No call to @ref make_final_state
+		 * is needed.
+		 * @param cellsx Number of cells in the x-axis.
+		 * @param cellsy Number of cells in the y-axis.
+		 * @param dimX Continuous dimension in the x-axis.
+		 * @param dimY Continuous dimension in the y-axis.
+		 * @param cells Values of the cells (see @ref get_grid).
+		 * @param labels Labels of the cells (see @ref get_labels). Every
+		 * label must be -1 or an index in @e segs: they are not checked.
+		 * @param segs Segments the labels refer to (see @ref get_segments).
+		 * @param max_dist Maximum value in @e cells.
+		 */
+		void init(
+			size_t cellsx, size_t cellsy, float dimX, float dimY,
+			float *cells, int32_t *labels,
+			const std::vector<segment>& segs, float max_dist
+		);
 
 		/// Clears the memory occupied by this grid.
 		void clear();
@@ -104,28 +393,178 @@ class regular_grid {
 		/**
 		 * @brief Rasterises the segment into the grid.
 		 *
-		 * Each cell of the rasterised segment is assigned value 0.
+		 * Each cell of the rasterised segment is assigned value 0 and
+		 * is labelled with the segment.
 		 */
 		void rasterise_segment(const segment& s);
 
 		/**
 		 * @brief Computes the distance function of every cell.
 		 *
-		 * With respect to a *rasterised* segment @e s.
+		 * With respect to a *rasterised* segment @e s. The cells whose
+		 * value decreases are labelled with the segment.
 		 */
 		void expand_function_distance(const segment& s);
 
+		/**
+		 * @brief Fills the interior of a polygonal obstacle.
+		 *
+		 * The cells whose centre is inside the polygon (see
+		 * @ref grid_traversal::for_each_cell_polygon) get their value
+		 * negated: minus the distance to the closest segment. The cells
+		 * of the rasterised edges keep value 0. Interior cells are then
+		 * never traversable, whatever the radius of the agent.
+		 *
+		 * Call it once the distance function has been computed, and
+		 * before @ref make_final_state. The edges of the polygon must be
+		 * among the segments of the grid.
+		 * @param poly Vertices of the polygon.
+		 */
+		void fill_polygon(const std::vector<vec2>& poly);
+		/**
+		 * @brief Undoes @ref fill_polygon.
+		 *
+		 * The cells whose centre is inside the polygon get back their
+		 * distance to the closest segment.
+		 * @param poly Vertices of the polygon.
+		 */
+		void clear_polygon(const std::vector<vec2>& poly);
+
+		/**
+		 * @brief Removes and adds segments to the grid.
+		 *
+		 * Only the cells affected by the changes are recomputed: those
+		 * whose closest segment was removed get the distance to the
+		 * closest segment in @e index, and those closer to an added
+		 * segment than to their closest segment get the distance to
+		 * it. The segments near the recomputed cells are rasterised
+		 * again, and so are the added ones.
+		 *
+		 * The slots of the removed segments in @ref get_segments are
+		 * reused by the segments added later, and no cell is labelled
+		 * with them in the meantime. The polygons must be cleared before (see
+		 * @ref clear_polygon) and filled again afterwards. Call
+		 * @ref make_final_state afterwards.
+		 * @param index Spatial index over the segments once changed.
+		 * @param outer Segments not in @e index whose distance is also
+		 * taken into account (for example, the walls enclosing the
+		 * terrain from the outside).
+		 * @param removed Segments removed.
+		 * @param added Segments added. They must also be in @e index.
+		 */
+		void update_segments(
+			const spatial_index& index, const std::vector<segment>& outer,
+			const std::vector<segment>& removed, const std::vector<segment>& added
+		);
+
 		/**
 		 * @brief Computes necessary internal data.
 		 *
-		 * Computes the maximum value of the values in the cells.
+		 * Computes the maximum value of the values in the cells, and
+		 * updates the traversability masks.
 		 */
 		void make_final_state();
 
+		/**
+		 * @brief Makes the inflated obstacles for radius @e R.
+		 *
+		 * Sets the bit of every cell that has a point at distance at most
+		 * @e R from a segment (see
+		 * @ref grid_traversal::for_each_cell_capsule), in one pass over
+		 * the segments. Only the dimensions of the grid are used, not the
+		 * values of the cells: it gives binary occupancy grids without
+		 * computing the distance function. The unset bits are
+		 * traversable by agents of radius @e R.
+		 * @param[in] segs Segments.
+		 * @param[in] R Radius of the agents.
+		 * @param[out] occupancy Inflated obstacles.
+		 */
+		void make_inflated_obstacles
+		(const std::vector<segment>& segs, float R, bitmask& occupancy) const;
+
+		/**
+		 * @brief Makes the traversability mask for radius @e R.
+		 *
+		 * The searches for agents of radius @e R use the mask (one bit
+		 * per cell) instead of comparing the values of the cells against
+		 * @e R. The paths found are the same.
+		 */
+		void make_traversability_mask(float R);
+		/// Removes all the traversability masks.
+		void clear_traversability_masks();
+
+		/**
+		 * @brief Makes the min-pooled clearance pyramid.
+		 *
+		 * Once made, @ref find_path searches the levels of the pyramid
+		 * from the coarsest to the finest, and then the grid inside the
+		 * corridor of the path found in the finest level. If this fails
+		 * the whole grid is searched. Only the searches with the
+		 * clearance heuristic use the pyramid: the weighted and focal
+		 * searches ignore it so that their bound holds.
+		 * @param levels Number of levels. The coarsest level has
+		 * 1/4^levels the cells of the grid.
+		 */
+		void make_clearance_pyramid(size_t levels);
+		/// Removes the clearance pyramid.
+		void clear_clearance_pyramid();
+
+		// SETTERS
+
+		/// Sets the policy used in @ref find_path when none is given.
+		void set_search_policy(const search_policy& p);
+		/**
+		 * @brief Sets the connectivity of the cells: 4 or 8.
+		 *
+		 * Used in the searches with the clearance and weighted A*
+		 * policies, also on the levels of the clearance pyramid. By
+		 * default, 8.
+		 */
+		void set_connectivity(int c);
+		/**
+		 * @brief Sets the number of threads of the searches.
+		 *
+		 * If @e n > 1, the searches with the weighted A* policy are
+		 * distributed among @e n threads (see @ref search_policy).
+		 * The other policies always use one thread.
+		 */
+		void set_search_threads(size_t n);
+		/**
+		 * @brief Sets the thickness of the segments rasterised.
+		 *
+		 * Must be called before adding segments. Coarse grids should use
+		 * a thickness larger than 0 so that thin diagonal segments do not
+		 * leave gaps. By default, 0.
+		 */
+		void set_wall_thickness(float w);
+		/**
+		 * @brief Sets the crowd density used by the searches.
+		 *
+		 * The cost of every move becomes the euclidean distance plus
+		 * @e w times the density of the cell moved to, so paths avoid
+		 * crowded cells when the detour is short (see
+		 * @ref grid_search::density_cost). All the searches on the cells
+		 * of the grid use it; the coarse levels of the clearance pyramid
+		 * do not.
+		 *
+		 * The density grid must have the same cells as this grid, or
+		 * it is not set, and must outlive its use by this grid.
+		 * @param d Density grid, or null to ignore the density.
+		 * @param w Weight of the density.
+		 */
+		void set_density(const density_grid *d, float w);
+
 		// GETTERS
 
 		/**
 		 * @brief Fins a path between two points.
+		 *
+		 * The search follows the policy of the grid (see
+		 * @ref set_search_policy). If the clearance pyramid was made (see
+		 * @ref make_clearance_pyramid) and the policy is the clearance
+		 * heuristic, the search goes from coarse to fine levels of
+		 * resolution. Weighted A* searches use the threads set with
+		 * @ref set_search_threads.
 		 * @param[in] source Starting point.
 		 * @param[in] sink Goal point.
 		 * @param[in] R Minimum distance between the path and fixed obstacles.
@@ -137,11 +576,226 @@ class regular_grid {
 			float R,
 			std::vector<vec2>& path,
 			std::vector<vec2>& smoothed_path
-		);
+		) const;
+
+		/**
+		 * @brief Fins a path between two points with a search policy.
+		 *
+		 * Same as the previous function, but the search follows policy
+		 * @e p instead of the policy of the grid. The clearance pyramid is
+		 * only used if @e p is the clearance heuristic, so the bound of
+		 * the weighted and focal searches always holds.
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[in] p Policy of the search.
+		 * @param[out] path Non-refined path.
+		 * @param[out] smooth_path Refined path.
+		 */
+		void find_path(
+			const vec2& source, const vec2& sink,
+			float R, const search_policy& p,
+			std::vector<vec2>& path,
+			std::vector<vec2>& smoothed_path
+		) const;
 
-		/// Returns the cells of the grid.
+		/**
+		 * @brief Fins a path between two points, and its corridor.
+		 *
+		 * Same as the previous function, but also computes the corridor
+		 * of the path (see @ref make_corridor).
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Non-refined path.
+		 * @param[out] smooth_path Refined path.
+		 * @param[out] corridor Free width at each side of every segment
+		 * of @e smoothed_path.
+		 */
+		void find_path(
+			const vec2& source, const vec2& sink,
+			float R,
+			std::vector<vec2>& path,
+			std::vector<vec2>& smoothed_path,
+			std::vector<std::pair<float,float> >& corridor
+		) const;
+
+		/**
+		 * @brief Computes the corridor of a path.
+		 *
+		 * For every segment of the path, the free width at its left and
+		 * at its right: the distance from the segment to the obstacles,
+		 * measured perpendicularly to it with the distance function of
+		 * the grid. An agent of radius @e R following the path may drift
+		 * sideways up to the width minus @e R.
+		 * @param[in] path A path, e.g., a refined path.
+		 * @param[out] corridor corridor[i] contains the free width at the
+		 * left and at the right of the segment (path[i], path[i+1]).
+		 */
+		void make_corridor(
+			const std::vector<vec2>& path,
+			std::vector<std::pair<float,float> >& corridor
+		) const;
+
+		/**
+		 * @brief Casts a ray through the grid.
+		 *
+		 * Sphere tracing: the ray advances, at every step, the value of
+		 * the cell it is in (minus @e R and half the diagonal of a cell,
+		 * the error of the distance function within a cell), so long open
+		 * rays take few steps. Near the obstacles it advances half a cell
+		 * at a time. The ray hits when it reaches a cell whose value is at
+		 * most @e R, or when it leaves the grid.
+		 * @param origin Starting point.
+		 * @param dir Unit direction.
+		 * @param max_len Maximum length of the ray.
+		 * @param R Radius of the disc swept along the ray.
+		 * @return Returns the distance travelled until the disc of radius
+		 * @e R touches an obstacle (approximately, up to the size of a
+		 * cell), or @e max_len if it does not.
+		 */
+		float raycast
+		(const vec2& origin, const vec2& dir, float max_len, float R) const;
+
+		/**
+		 * @brief Casts many rays through the grid.
+		 *
+		 * The rays are cast in parallel.
+		 * @param[in] origins Starting points.
+		 * @param[in] dirs Unit directions, one per starting point.
+		 * @param[in] max_len Maximum length of the rays.
+		 * @param[in] R Radius of the disc swept along the rays.
+		 * @param[out] hits hits[i] is the result of
+		 * @ref raycast(origins[i], dirs[i], max_len, R).
+		 */
+		void raycast(
+			const std::vector<vec2>& origins, const std::vector<vec2>& dirs,
+			float max_len, float R,
+			std::vector<float>& hits
+		) const;
+
+		/**
+		 * @brief Casts rays in all directions from a point.
+		 *
+		 * @e n rays with angles \f$2\pi i/n\f$, cast in parallel.
+		 * @param[in] origin Starting point.
+		 * @param[in] n Number of rays.
+		 * @param[in] max_len Maximum length of the rays.
+		 * @param[in] R Radius of the disc swept along the rays.
+		 * @param[out] hits hits[i] is the result of the @e i-th ray.
+		 */
+		void raycast_fan(
+			const vec2& origin, size_t n,
+			float max_len, float R,
+			std::vector<float>& hits
+		) const;
+
+		/**
+		 * @brief Finds a path to the closest of several goals.
+		 *
+		 * Only one search is made. The goals at which a particle of
+		 * radius @e R can't finish are ignored.
+		 * @param[in] source Starting point.
+		 * @param[in] goals Goal points.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Non-refined path.
+		 * @param[out] smooth_path Refined path.
+		 * @return Returns the index of the goal reached, or -1 if none of
+		 * them can be reached.
+		 */
+		int find_path_to_any(
+			const vec2& source, const std::vector<vec2>& goals,
+			float R,
+			std::vector<vec2>& path,
+			std::vector<vec2>& smoothed_path
+		) const;
+
+		/**
+		 * @brief Finds the paths from several sources to the same goal.
+		 *
+		 * Only one search is made, starting at the goal. The sources at
+		 * which a particle of radius @e R can't start get an empty path.
+		 * @param[in] sources Starting points.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] paths Non-refined path of every source.
+		 * @param[out] smoothed_paths Refined path of every source.
+		 * @return Returns the number of sources that reach the goal.
+		 */
+		size_t find_paths_from_any(
+			const std::vector<vec2>& sources, const vec2& sink,
+			float R,
+			std::vector<std::vector<vec2> >& paths,
+			std::vector<std::vector<vec2> >& smoothed_paths
+		) const;
+
+		/**
+		 * @brief Refines a path made of centres of cells.
+		 *
+		 * Removes the points of @e path that are (almost) aligned with
+		 * their neighbours so that the result is a polyline.
+		 * @param[in] path Non-refined path.
+		 * @param[out] smoothed_path Refined path.
+		 */
+		void smooth_path
+		(const std::vector<vec2>& path, std::vector<vec2>& smoothed_path) const;
+
+		/**
+		 * @brief Returns the cells of the grid.
+		 *
+		 * Distance to the closest segment, negative inside polygonal
+		 * obstacles (see @ref grid_cells).
+		 */
 		const float *get_grid() const;
 
+		/**
+		 * @brief Returns the closest segment to every cell.
+		 *
+		 * The value of each cell is an index in @ref get_segments, or -1.
+		 */
+		const int32_t *get_labels() const;
+		/// Returns the segments rasterised or expanded into the grid.
+		const std::vector<segment>& get_segments() const;
+
+		/**
+		 * @brief Returns the closest segment to point @e p.
+		 *
+		 * The segment that labels the cell of @e p. Near the points
+		 * equidistant to two segments, it may not be the closest one.
+		 * @return Returns an index in @ref get_segments, or -1.
+		 */
+		int32_t get_closest_segment(const vec2& p) const;
+
+		/**
+		 * @brief Computes the closest point to @e p of its closest segment.
+		 * @param[in] p Any point in the grid.
+		 * @param[out] q Closest point to @e p in segment
+		 * @ref get_closest_segment(p).
+		 * @return Returns false if the cell of @e p has no label.
+		 */
+		bool closest_point(const vec2& p, vec2& q) const;
+
+		/**
+		 * @brief Computes the normal of the closest wall at @e p.
+		 *
+		 * Unit vector from the closest point (see @ref closest_point) to
+		 * @e p. If @e p lies on the wall, the normal of the wall's line.
+		 * If @e p is inside a polygonal obstacle the vector is reversed so
+		 * that it always points out of the obstacle.
+		 * @param[in] p Any point in the grid.
+		 * @param[out] n Normal of the closest wall.
+		 * @return Returns false if the cell of @e p has no label.
+		 */
+		bool wall_normal(const vec2& p, vec2& n) const;
+
+		/**
+		 * @brief Is point @e p inside a polygonal obstacle?
+		 *
+		 * The value of the cell of @e p is negative (see
+		 * @ref fill_polygon). Points outside the grid are not.
+		 */
+		bool inside_obstacle(const vec2& p) const;
+
 		/// Returns the number of cells in the x-axis.
 		size_t get_resX() const;
 		/// Returns the number of cells in the y-axis.
@@ -155,6 +809,25 @@ class regular_grid {
 		/// Returns the maximum value in the cells.
 		float get_max_dist() const;
 
+		/// Returns the policy used in @ref find_path when none is given.
+		const search_policy& get_search_policy() const;
+		/// Returns the connectivity of the cells.
+		int get_connectivity() const;
+		/// Returns the thickness of the segments rasterised.
+		float get_wall_thickness() const;
+		/// Returns the crowd density used by the searches, or null.
+		const density_grid *get_density() const;
+		/// Returns the weight of the crowd density.
+		float get_density_weight() const;
+		/// Returns the number of threads of the searches.
+		size_t get_search_threads() const;
+
+		/**
+		 * @brief Returns the traversability mask for radius @e R.
+		 * @return Returns null if it was not made.
+		 */
+		const bitmask *get_traversability_mask(float R) const;
+
 		// OTHERS
 };
 
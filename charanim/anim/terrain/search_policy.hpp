@@ -0,0 +1,148 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace charanim {
+
+/**
+ * @brief Policy of the path searches of a @ref regular_grid.
+ *
+ * Every search is an A* search where @e g is the cost of the path from
+ * the starting cell to a cell, @e h is the euclidean distance from that
+ * cell to the goal, and @e c is the value of the cell (its distance to
+ * the closest obstacle). Let \f$C^*\f$ be the cost of the shortest path.
+ * The policies are:
+ * - @e clearance_heuristic: the priority of a cell is
+ * \f$g + a \cdot h - b \cdot c\f$. Paths keep away from obstacles, but
+ * there is no bound on their cost.
+ * - @e weighted: weighted A*, the priority of a cell is
+ * \f$g + \epsilon \cdot h\f$. Since @e h is consistent, the cost of the
+ * path found is at most \f$\epsilon \cdot C^*\f$.
+ * - @e focal: focal search. The cell expanded is, among the cells of the
+ * open list whose priority \f$f = g + h\f$ is at most \f$\epsilon\f$
+ * times the minimum priority \f$f_{min}\f$ in the open list, the one
+ * with largest \f$min(c, c_{max})\f$ and, among these, the closest to the
+ * goal. Since \f$f_{min} \le C^*\f$ at all times, every
+ * cell expanded has \f$f \le \epsilon \cdot C^*\f$, and so does the goal:
+ * the cost of the path found is at most \f$\epsilon \cdot C^*\f$.
+ *
+ * With \f$\epsilon = 1\f$ both @e weighted and @e focal find shortest
+ * paths. Larger values of \f$\epsilon\f$ expand fewer cells.
+ */
+class search_policy {
+	public:
+		/// The different types of searches.
+		enum class search_type : int8_t {
+			/// Heuristic with a clearance term, without bound.
+			clearance_heuristic = 0,
+			/// Weighted A*.
+			weighted,
+			/// Focal search with clearance as secondary key.
+			focal
+		};
+
+	public:
+		/// Type of search.
+		search_type type;
+		/// Suboptimality factor \f$\epsilon \ge 1\f$.
+		float epsilon;
+		/// Weight @e a of the heuristic in @e clearance_heuristic.
+		float heuristic_weight;
+		/// Weight @e b of the clearance in @e clearance_heuristic.
+		float clearance_weight;
+		/**
+		 * @brief Clearance \f$c_{max}\f$ in @e focal.
+		 *
+		 * The cells with clearance larger than this are all equally
+		 * preferred.
+		 */
+		float max_clearance;
+
+	public:
+		/// Default constructor: the clearance heuristic with a=0.5, b=2.
+		search_policy() {
+			type = search_type::clearance_heuristic;
+			epsilon = 1.0f;
+			heuristic_weight = 0.5f;
+			clearance_weight = 2.0f;
+			max_clearance = 2.0f;
+		}
+
+		/// Returns a weighted A* policy.
+		static search_policy weighted_astar(float eps) {
+			search_policy p;
+			p.type = search_type::weighted;
+			p.epsilon = eps;
+			return p;
+		}
+
+		/// Returns a focal search policy.
+		static search_policy focal_search(float eps) {
+			search_policy p;
+			p.type = search_type::focal;
+			p.epsilon = eps;
+			return p;
+		}
+
+		/**
+		 * @brief Makes a policy from its name.
+		 * @param[in] name One of "clearance", "weighted", "focal".
+		 * @param[in] eps Suboptimality factor (weighted and focal).
+		 * @param[out] p The policy.
+		 * @return Returns false if @e name is not valid.
+		 */
+		static bool from_name(const std::string& name, float eps, search_policy& p) {
+			if (name == "clearance") {
+				p = search_policy();
+			}
+			else if (name == "weighted") {
+				p = weighted_astar(eps);
+			}
+			else if (name == "focal") {
+				p = focal_search(eps);
+			}
+			else {
+				return false;
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Bound on the cost of the paths found.
+		 * @return Returns the factor \f$\epsilon\f$ such that the cost of
+		 * a path is at most \f$\epsilon \cdot C^*\f$, or infinity if
+		 * there is no bound.
+		 */
+		float get_bound() const {
+			if (type == search_type::clearance_heuristic) {
+				return std::numeric_limits<float>::infinity();
+			}
+			return epsilon;
+		}
+};
+
+} // -- namespace charanim
@@ -0,0 +1,206 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/simplify_segments.hpp>
+
+// C++ includes
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+using namespace std;
+
+namespace charanim {
+
+// Replaces every endpoint by the first endpoint found closer than
+// eps. The endpoints are bucketed in cells of side eps.
+static inline
+void snap_endpoints(vector<segment>& segs, float eps) {
+	unordered_map<uint64_t, vector<vec2> > cells;
+	auto key =
+	[](int64_t x, int64_t y) -> uint64_t {
+		return (static_cast<uint64_t>(x) << 32) ^ static_cast<uint64_t>(y & 0xffffffff);
+	};
+
+	auto snap =
+	[&](vec2& p) {
+		const int64_t cx = static_cast<int64_t>(std::floor(p.x/eps));
+		const int64_t cy = static_cast<int64_t>(std::floor(p.y/eps));
+		for (int64_t dy = -1; dy <= 1; ++dy) {
+			for (int64_t dx = -1; dx <= 1; ++dx) {
+				auto it = cells.find(key(cx + dx, cy + dy));
+				if (it == cells.end()) {
+					continue;
+				}
+				for (const vec2& q : it->second) {
+					if ((p.x - q.x)*(p.x - q.x) + (p.y - q.y)*(p.y - q.y) <= eps*eps) {
+						p = q;
+						return;
+					}
+				}
+			}
+		}
+		cells[key(cx,cy)].push_back(p);
+	};
+
+	for (segment& s : segs) {
+		snap(s.first);
+		snap(s.second);
+	}
+}
+
+size_t simplify_segments(vector<segment>& segs, float eps) {
+	const size_t n_before = segs.size();
+	snap_endpoints(segs, eps);
+
+	// extent of the map, to compare directions
+	double extent = 1.0;
+	for (const segment& s : segs) {
+		extent = max(extent, double(std::abs(s.first.x)));
+		extent = max(extent, double(std::abs(s.first.y)));
+		extent = max(extent, double(std::abs(s.second.x)));
+		extent = max(extent, double(std::abs(s.second.y)));
+	}
+	const double angle_eps = eps/extent;
+
+	// line of every (non-degenerate) segment
+	struct line {
+		// angle of the direction, in [-angle_eps, pi - angle_eps)
+		double angle;
+		// signed distance of the line to the origin
+		double offset;
+		// index of the segment
+		size_t s;
+	};
+	vector<line> lines;
+	lines.reserve(segs.size());
+	for (size_t i = 0; i < segs.size(); ++i) {
+		const double dx = double(segs[i].second.x) - segs[i].first.x;
+		const double dy = double(segs[i].second.y) - segs[i].first.y;
+		if (dx*dx + dy*dy <= double(eps)*eps) {
+			// zero-length segment
+			continue;
+		}
+		double a = std::atan2(dy, dx);
+		if (a < -angle_eps) {
+			a += M_PI;
+		}
+		if (a >= M_PI - angle_eps) {
+			a -= M_PI;
+		}
+		const double mx = 0.5*(double(segs[i].first.x) + segs[i].second.x);
+		const double my = 0.5*(double(segs[i].first.y) + segs[i].second.y);
+		lines.push_back(line{a, -std::sin(a)*mx + std::cos(a)*my, i});
+	}
+
+	// groups the lines in [first, last) whose value of 'f' differs
+	// from that of the first line of the group at most 'tol'
+	auto group =
+	[](vector<line>::iterator first, vector<line>::iterator last,
+	   double line::*f, double tol, vector<pair<size_t,size_t> >& groups)
+	{
+		sort(first, last,
+			[&](const line& p, const line& q) { return p.*f < q.*f; }
+		);
+		const size_t n = last - first;
+		size_t g = 0;
+		for (size_t i = 1; i <= n; ++i) {
+			if (i == n or first[i].*f - first[g].*f > tol) {
+				groups.push_back(make_pair(g, i));
+				g = i;
+			}
+		}
+	};
+
+	// merged segments, with the index of the first original segment
+	vector<pair<size_t, segment> > merged;
+
+	vector<pair<size_t,size_t> > by_angle;
+	group(lines.begin(), lines.end(), &line::angle, angle_eps, by_angle);
+	for (const pair<size_t,size_t>& ga : by_angle) {
+		vector<pair<size_t,size_t> > by_offset;
+		group(lines.begin() + ga.first, lines.begin() + ga.second,
+			  &line::offset, eps, by_offset);
+
+		for (const pair<size_t,size_t>& go : by_offset) {
+			const size_t first = ga.first + go.first;
+			const size_t last = ga.first + go.second;
+
+			// intervals of the segments along the line
+			const double a = lines[first].angle;
+			const double ux = std::cos(a);
+			const double uy = std::sin(a);
+			auto proj =
+			[&](const vec2& p) -> double { return ux*p.x + uy*p.y; };
+
+			struct interval {
+				double lo, hi;
+				vec2 plo, phi;
+				size_t s;
+			};
+			vector<interval> I;
+			for (size_t k = first; k < last; ++k) {
+				const segment& s = segs[lines[k].s];
+				const double p = proj(s.first);
+				const double q = proj(s.second);
+				if (p <= q) {
+					I.push_back(interval{p, q, s.first, s.second, lines[k].s});
+				}
+				else {
+					I.push_back(interval{q, p, s.second, s.first, lines[k].s});
+				}
+			}
+			sort(I.begin(), I.end(),
+				[](const interval& p, const interval& q) { return p.lo < q.lo; }
+			);
+
+			interval cur = I[0];
+			for (size_t k = 1; k <= I.size(); ++k) {
+				if (k < I.size() and I[k].lo <= cur.hi + eps) {
+					// overlapping or touching: extend
+					if (I[k].hi > cur.hi) {
+						cur.hi = I[k].hi;
+						cur.phi = I[k].phi;
+					}
+					cur.s = min(cur.s, I[k].s);
+					continue;
+				}
+				merged.push_back(make_pair(cur.s, segment(cur.plo, cur.phi)));
+				if (k < I.size()) {
+					cur = I[k];
+				}
+			}
+		}
+	}
+
+	sort(merged.begin(), merged.end(),
+		[](const pair<size_t,segment>& p, const pair<size_t,segment>& q) {
+			return p.first < q.first;
+		}
+	);
+	segs.resize(merged.size());
+	for (size_t i = 0; i < merged.size(); ++i) {
+		segs[i] = merged[i].second;
+	}
+	return n_before - segs.size();
+}
+
+} // -- namespace charanim
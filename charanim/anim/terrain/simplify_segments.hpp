@@ -0,0 +1,54 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+#include <vector>
+
+// charanim includes
+#include <anim/definitions.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Simplifies the segments of a map.
+ *
+ * The segments are the walls of a map, often split into many pieces
+ * (e.g., the walls of generated maps). This function:
+ * - snaps endpoints closer than @e eps to the same point,
+ * - removes segments shorter than @e eps,
+ * - merges collinear segments that overlap or whose endpoints are
+ * closer than @e eps into a single segment.
+ *
+ * Two segments are collinear if their directions differ less than
+ * @e eps over the extent of the map, and their lines are closer than
+ * @e eps. The endpoints of the merged segments are endpoints of the
+ * original segments. The segments keep the order of the first of the
+ * original segments they were merged from.
+ * @param[in,out] segs Segments to be simplified.
+ * @param[in] eps Tolerance.
+ * @return Returns the number of segments removed.
+ */
+size_t simplify_segments(std::vector<segment>& segs, float eps);
+
+} // -- namespace charanim
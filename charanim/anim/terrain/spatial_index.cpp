@@ -0,0 +1,459 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/spatial_index.hpp>
+
+// C includes
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#include <immintrin.h>
+#define CHARANIM_AVX2_KERNEL
+#endif
+
+// C++ includes
+#include <algorithm>
+#include <limits>
+#include <cmath>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+// charanim includes
+#include <anim/terrain/grid_traversal.hpp>
+
+namespace charanim {
+
+using grid_traversal::point_segment_dist2;
+
+static inline
+float cross(const vec2& a, const vec2& b, const vec2& c) {
+	return (b.x - a.x)*(c.y - a.y) - (b.y - a.y)*(c.x - a.x);
+}
+
+static inline
+float dist_segment_to_segment
+(const vec2& a, const vec2& b, const vec2& c, const vec2& d)
+{
+	float o1 = cross(a,b,c);
+	float o2 = cross(a,b,d);
+	float o3 = cross(c,d,a);
+	float o4 = cross(c,d,b);
+	if (((o1 > 0.0f and o2 < 0.0f) or (o1 < 0.0f and o2 > 0.0f)) and
+		((o3 > 0.0f and o4 < 0.0f) or (o3 < 0.0f and o4 > 0.0f)))
+	{
+		return 0.0f;
+	}
+	return std::sqrt(std::min(
+		std::min(point_segment_dist2(a.x, a.y, c,d), point_segment_dist2(b.x, b.y, c,d)),
+		std::min(point_segment_dist2(c.x, c.y, a,b), point_segment_dist2(d.x, d.y, a,b))
+	));
+}
+
+/*
+ * Ray-segment intersection of 8 rays against a list of segments.
+ *
+ * The ray o + t*d hits the segment a + s*e at
+ *     t = cross(a - o, e)/cross(d, e),  s = cross(a - o, d)/cross(d, e)
+ * when 0 <= t and 0 <= s <= 1. Both kernels make the same operations in
+ * the same order, so that their results are equal. 'best' contains the
+ * length of the rays (negative for unused lanes) and is updated with the
+ * distance to the closest hit, and 'seg' with the index of the segment.
+ */
+
+static inline
+void cast_8_scalar(
+	const float *ox, const float *oy, const float *dx, const float *dy,
+	const vector<segment>& sgs, const vector<size_t>& cand,
+	float *best, int32_t *seg
+)
+{
+	for (size_t i : cand) {
+		const segment& S = sgs[i];
+		const float ax = S.first.x;
+		const float ay = S.first.y;
+		const float ex = S.second.x - ax;
+		const float ey = S.second.y - ay;
+		for (int r = 0; r < 8; ++r) {
+			const float denom = dx[r]*ey - dy[r]*ex;
+			const float wx = ax - ox[r];
+			const float wy = ay - oy[r];
+			const float t = (wx*ey - wy*ex)/denom;
+			const float s = (wx*dy[r] - wy*dx[r])/denom;
+			if (t >= 0.0f and t < best[r] and s >= 0.0f and s <= 1.0f) {
+				best[r] = t;
+				seg[r] = static_cast<int32_t>(i);
+			}
+		}
+	}
+}
+
+#if defined(CHARANIM_AVX2_KERNEL)
+
+__attribute__((target("avx2")))
+static void cast_8_avx2(
+	const float *ox, const float *oy, const float *dx, const float *dy,
+	const vector<segment>& sgs, const vector<size_t>& cand,
+	float *best, int32_t *seg
+)
+{
+	const __m256 Ox = _mm256_loadu_ps(ox);
+	const __m256 Oy = _mm256_loadu_ps(oy);
+	const __m256 Dx = _mm256_loadu_ps(dx);
+	const __m256 Dy = _mm256_loadu_ps(dy);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256 B = _mm256_loadu_ps(best);
+	__m256i I = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(seg));
+
+	for (size_t i : cand) {
+		const segment& S = sgs[i];
+		const __m256 ax = _mm256_set1_ps(S.first.x);
+		const __m256 ay = _mm256_set1_ps(S.first.y);
+		const __m256 ex = _mm256_set1_ps(S.second.x - S.first.x);
+		const __m256 ey = _mm256_set1_ps(S.second.y - S.first.y);
+
+		const __m256 denom =
+			_mm256_sub_ps(_mm256_mul_ps(Dx, ey), _mm256_mul_ps(Dy, ex));
+		const __m256 wx = _mm256_sub_ps(ax, Ox);
+		const __m256 wy = _mm256_sub_ps(ay, Oy);
+		const __m256 t = _mm256_div_ps(
+			_mm256_sub_ps(_mm256_mul_ps(wx, ey), _mm256_mul_ps(wy, ex)), denom);
+		const __m256 s = _mm256_div_ps(
+			_mm256_sub_ps(_mm256_mul_ps(wx, Dy), _mm256_mul_ps(wy, Dx)), denom);
+
+		__m256 hit = _mm256_and_ps(
+			_mm256_cmp_ps(t, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, B, _CMP_LT_OQ));
+		hit = _mm256_and_ps(hit, _mm256_and_ps(
+			_mm256_cmp_ps(s, zero, _CMP_GE_OQ), _mm256_cmp_ps(s, one, _CMP_LE_OQ)));
+
+		B = _mm256_blendv_ps(B, t, hit);
+		I = _mm256_blendv_epi8(
+			I, _mm256_set1_epi32(static_cast<int32_t>(i)), _mm256_castps_si256(hit));
+	}
+
+	_mm256_storeu_ps(best, B);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(seg), I);
+}
+
+#endif
+
+// PRIVATE
+
+int spatial_index::bucket_of(float v, int n) const {
+	int b = static_cast<int>(std::floor(v/cell_size));
+	return std::max(0, std::min(n - 1, b));
+}
+
+void spatial_index::bucket_range
+(const vec2& lo, const vec2& hi, int& x0, int& y0, int& x1, int& y1) const
+{
+	x0 = bucket_of(lo.x, cellsX);
+	y0 = bucket_of(lo.y, cellsY);
+	x1 = bucket_of(hi.x, cellsX);
+	y1 = bucket_of(hi.y, cellsY);
+}
+
+// PUBLIC
+
+spatial_index::spatial_index() {
+	dimX = dimY = 0.0f;
+	cell_size = 1.0f;
+	cellsX = cellsY = 0;
+}
+
+spatial_index::~spatial_index() {
+	clear();
+}
+
+// MODIFIERS
+
+void spatial_index::init(float dx, float dy, const vector<segment>& segs) {
+	clear();
+	dimX = dx;
+	dimY = dy;
+	sgs = segs;
+
+	// about as many buckets as segments
+	float dmax = std::max(dimX, dimY);
+	cell_size = std::max(1.0f, dmax/std::ceil(std::sqrt(float(sgs.size()))));
+	cellsX = static_cast<int>(std::ceil(dimX/cell_size)) + 1;
+	cellsY = static_cast<int>(std::ceil(dimY/cell_size)) + 1;
+
+	// count the segments of each bucket, then place them
+	first.assign(cellsX*cellsY + 1, 0);
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t i = 0; i < sgs.size(); ++i) {
+			const vec2& a = sgs[i].first;
+			const vec2& b = sgs[i].second;
+			int x0, y0, x1, y1;
+			bucket_range(
+				vec2(std::min(a.x, b.x), std::min(a.y, b.y)),
+				vec2(std::max(a.x, b.x), std::max(a.y, b.y)),
+				x0, y0, x1, y1
+			);
+			for (int y = y0; y <= y1; ++y) {
+				for (int x = x0; x <= x1; ++x) {
+					if (pass == 0) {
+						++first[y*cellsX + x + 1];
+					}
+					else {
+						ids[first[y*cellsX + x]++] = i;
+					}
+				}
+			}
+		}
+		if (pass == 0) {
+			for (size_t b = 1; b < first.size(); ++b) {
+				first[b] += first[b - 1];
+			}
+			ids.resize(first.back());
+		}
+	}
+	// the second pass moved the beginning of
+	// each bucket to the beginning of the next
+	for (size_t b = first.size() - 1; b > 0; --b) {
+		first[b] = first[b - 1];
+	}
+	first[0] = 0;
+}
+
+void spatial_index::clear() {
+	sgs.clear();
+	first.clear();
+	ids.clear();
+	cellsX = cellsY = 0;
+}
+
+// GETTERS
+
+void spatial_index::query_aabb
+(const vec2& lo, const vec2& hi, vector<size_t>& segs) const
+{
+	if (sgs.size() == 0) {
+		return;
+	}
+
+	int x0, y0, x1, y1;
+	bucket_range(lo, hi, x0, y0, x1, y1);
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			const size_t b = y*cellsX + x;
+			for (size_t k = first[b]; k < first[b + 1]; ++k) {
+				const segment& s = sgs[ids[k]];
+				const vec2 slo(std::min(s.first.x, s.second.x), std::min(s.first.y, s.second.y));
+				const vec2 shi(std::max(s.first.x, s.second.x), std::max(s.first.y, s.second.y));
+				if (shi.x < lo.x or hi.x < slo.x or shi.y < lo.y or hi.y < slo.y) {
+					continue;
+				}
+				// report the segment only in the first bucket
+				// (bottom-left) shared by it and the box
+				int sx0, sy0, sx1, sy1;
+				bucket_range(slo, shi, sx0, sy0, sx1, sy1);
+				if (std::max(sx0, x0) == x and std::max(sy0, y0) == y) {
+					segs.push_back(ids[k]);
+				}
+			}
+		}
+	}
+}
+
+int spatial_index::nearest_segment(const vec2& p, float& d) const {
+	if (sgs.size() == 0) {
+		d = numeric_limits<float>::max();
+		return -1;
+	}
+
+	const int cx = bucket_of(p.x, cellsX);
+	const int cy = bucket_of(p.y, cellsY);
+	const float inf = numeric_limits<float>::max();
+
+	int best = -1;
+	float best_d2 = inf;
+
+	// visit rings of buckets around the bucket of p
+	for (int k = 0; ; ++k) {
+		const int x0 = cx - k, x1 = cx + k;
+		const int y0 = cy - k, y1 = cy + k;
+		for (int y = std::max(0, y0); y <= std::min(cellsY - 1, y1); ++y) {
+			const bool full_row = (y == y0 or y == y1);
+			for (int x = std::max(0, x0); x <= std::min(cellsX - 1, x1);
+				 x += (full_row or x == x1 ? 1 : x1 - x))
+			{
+				const size_t b = y*cellsX + x;
+				for (size_t j = first[b]; j < first[b + 1]; ++j) {
+					const int i = static_cast<int>(ids[j]);
+					const segment& s = sgs[i];
+					const float d2 = point_segment_dist2(p.x, p.y, s.first, s.second);
+					if (d2 < best_d2 or (d2 == best_d2 and i < best)) {
+						best_d2 = d2;
+						best = i;
+					}
+				}
+			}
+		}
+
+		// The segments not seen yet overlap only buckets out of the
+		// rings visited: they are farther than the border of the rings.
+		// Buckets on the border of the grid also keep the segments
+		// out of the grid, so there is nothing beyond them.
+		float bound = inf;
+		if (x0 > 0) bound = std::min(bound, p.x - x0*cell_size);
+		if (y0 > 0) bound = std::min(bound, p.y - y0*cell_size);
+		if (x1 < cellsX - 1) bound = std::min(bound, (x1 + 1)*cell_size - p.x);
+		if (y1 < cellsY - 1) bound = std::min(bound, (y1 + 1)*cell_size - p.y);
+
+		if (bound == inf or (best != -1 and best_d2 < bound*bound)) {
+			break;
+		}
+	}
+
+	d = std::sqrt(best_d2);
+	return best;
+}
+
+bool spatial_index::segment_intersects(const vec2& a, const vec2& b, float R) const {
+	if (sgs.size() == 0) {
+		return false;
+	}
+
+	int x0, y0, x1, y1;
+	bucket_range(
+		vec2(std::min(a.x, b.x) - R, std::min(a.y, b.y) - R),
+		vec2(std::max(a.x, b.x) + R, std::max(a.y, b.y) + R),
+		x0, y0, x1, y1
+	);
+
+	// direction of the segment, used to skip the buckets
+	// of the bounding box that are far from it
+	const float len = physim::math::norm(b - a);
+	const float half_diag = cell_size*0.7072f;
+
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			const size_t bk = y*cellsX + x;
+			if (first[bk] == first[bk + 1]) {
+				continue;
+			}
+			// buckets on the border may keep segments out of the grid
+			if (len > cell_size and
+				0 < x and x < cellsX - 1 and 0 < y and y < cellsY - 1)
+			{
+				vec2 centre((x + 0.5f)*cell_size, (y + 0.5f)*cell_size);
+				if (std::abs(cross(a,b, centre))/len > R + half_diag) {
+					continue;
+				}
+			}
+			for (size_t k = first[bk]; k < first[bk + 1]; ++k) {
+				const segment& s = sgs[ids[k]];
+				const float d = dist_segment_to_segment(a,b, s.first,s.second);
+				if (d < R or d == 0.0f) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+void spatial_index::raycast(ray_batch& rays, bool simd) const {
+	const size_t n = rays.size();
+	rays.hit_dist = rays.max_len;
+	rays.hit_segment.assign(n, -1);
+	if (sgs.size() == 0) {
+		return;
+	}
+
+#if defined(CHARANIM_AVX2_KERNEL)
+	simd = simd and __builtin_cpu_supports("avx2");
+#else
+	simd = false;
+#endif
+
+	const int groups = static_cast<int>((n + 7)/8);
+
+	#pragma omp parallel if (groups > 8)
+	{
+	vector<size_t> cand;
+
+	#pragma omp for schedule(dynamic, 16)
+	for (int g = 0; g < groups; ++g) {
+		const size_t first_ray = 8*static_cast<size_t>(g);
+		const size_t k = std::min(size_t(8), n - first_ray);
+
+		// the rays of the group, the unused lanes have negative length
+		float ox[8], oy[8], dx[8], dy[8], best[8];
+		int32_t seg[8];
+		vec2 lo(numeric_limits<float>::max(), numeric_limits<float>::max());
+		vec2 hi(-numeric_limits<float>::max(), -numeric_limits<float>::max());
+		for (size_t r = 0; r < 8; ++r) {
+			const size_t j = first_ray + std::min(r, k - 1);
+			ox[r] = rays.ox[j];
+			oy[r] = rays.oy[j];
+			dx[r] = rays.dx[j];
+			dy[r] = rays.dy[j];
+			best[r] = (r < k ? rays.max_len[j] : -1.0f);
+			seg[r] = -1;
+
+			const float ex = ox[r] + dx[r]*rays.max_len[j];
+			const float ey = oy[r] + dy[r]*rays.max_len[j];
+			lo.x = std::min(lo.x, std::min(ox[r], ex));
+			lo.y = std::min(lo.y, std::min(oy[r], ey));
+			hi.x = std::max(hi.x, std::max(ox[r], ex));
+			hi.y = std::max(hi.y, std::max(oy[r], ey));
+		}
+
+		// sorted, so that ties are broken by the smallest index
+		cand.clear();
+		query_aabb(lo, hi, cand);
+		std::sort(cand.begin(), cand.end());
+
+#if defined(CHARANIM_AVX2_KERNEL)
+		if (simd) {
+			cast_8_avx2(ox, oy, dx, dy, sgs, cand, best, seg);
+		}
+		else {
+			cast_8_scalar(ox, oy, dx, dy, sgs, cand, best, seg);
+		}
+#else
+		cast_8_scalar(ox, oy, dx, dy, sgs, cand, best, seg);
+#endif
+
+		for (size_t r = 0; r < k; ++r) {
+			rays.hit_dist[first_ray + r] = best[r];
+			rays.hit_segment[first_ray + r] = seg[r];
+		}
+	}
+	}
+}
+
+const vector<segment>& spatial_index::get_segments() const {
+	return sgs;
+}
+
+float spatial_index::get_dimX() const {
+	return dimX;
+}
+
+float spatial_index::get_dimY() const {
+	return dimY;
+}
+
+} // -- namespace charanim
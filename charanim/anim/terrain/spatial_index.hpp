@@ -0,0 +1,163 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+#include <vector>
+
+// charanim includes
+#include <anim/definitions.hpp>
+#include <anim/terrain/ray_batch.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Spatial index over the segments of a terrain.
+ *
+ * A uniform grid of buckets: each bucket keeps the indices of the
+ * segments whose bounding box overlaps it. There are about as many
+ * buckets as segments, so that the cost of the queries depends on the
+ * amount of segments near the query, not on the total amount of
+ * segments.
+ *
+ * The indices returned by the queries are positions in the vector of
+ * segments passed to @ref init.
+ */
+class spatial_index {
+	private:
+		/// The segments indexed.
+		std::vector<segment> sgs;
+
+		/// Continuous dimension in the x-axis
+		float dimX;
+		/// Continuous dimension in the y-axis
+		float dimY;
+
+		/// Length of the side of the buckets.
+		float cell_size;
+		/// Number of buckets in the x-axis.
+		int cellsX;
+		/// Number of buckets in the y-axis.
+		int cellsY;
+		/**
+		 * @brief First position in @ref ids of every bucket.
+		 *
+		 * The segments of bucket @e b are those in the positions
+		 * [first[b], first[b+1]) of @ref ids.
+		 */
+		std::vector<size_t> first;
+		/// Indices of the segments of the buckets, one bucket after another.
+		std::vector<size_t> ids;
+
+	private:
+
+		/// Returns the bucket of coordinate @e v, clamped to [0, n).
+		int bucket_of(float v, int n) const;
+		/**
+		 * @brief Returns the range of buckets overlapped by a box.
+		 * @param[in] lo Bottom-left corner of the box.
+		 * @param[in] hi Top-right corner of the box.
+		 * @param[out] x0 First bucket in the x-axis.
+		 * @param[out] y0 First bucket in the y-axis.
+		 * @param[out] x1 Last bucket in the x-axis.
+		 * @param[out] y1 Last bucket in the y-axis.
+		 */
+		void bucket_range
+		(const vec2& lo, const vec2& hi, int& x0, int& y0, int& x1, int& y1) const;
+
+	public:
+		/// Default constructor.
+		spatial_index();
+		/// Destructor.
+		~spatial_index();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Builds the index.
+		 * @param dimX Continuous dimension in the x-axis.
+		 * @param dimY Continuous dimension in the y-axis.
+		 * @param segs Segments to be indexed.
+		 */
+		void init(float dimX, float dimY, const std::vector<segment>& segs);
+
+		/// Clears the memory occupied by this index.
+		void clear();
+
+		// GETTERS
+
+		/**
+		 * @brief Finds the segments whose bounding box overlaps a box.
+		 *
+		 * Every segment is reported once.
+		 * @param[in] lo Bottom-left corner of the box.
+		 * @param[in] hi Top-right corner of the box.
+		 * @param[out] segs Indices of the segments found, appended.
+		 */
+		void query_aabb
+		(const vec2& lo, const vec2& hi, std::vector<size_t>& segs) const;
+
+		/**
+		 * @brief Finds the closest segment to a point.
+		 *
+		 * If several segments are equally close, the one with the
+		 * smallest index is returned.
+		 * @param[in] p Query point.
+		 * @param[out] d Distance between @e p and the segment found.
+		 * @return Returns the index of the segment, or -1 if there
+		 * are no segments.
+		 */
+		int nearest_segment(const vec2& p, float& d) const;
+
+		/**
+		 * @brief Does segment @e ab get closer than @e R to any segment?
+		 *
+		 * With @e R = 0, returns whether @e ab crosses or touches any
+		 * segment.
+		 */
+		bool segment_intersects(const vec2& a, const vec2& b, float R = 0.0f) const;
+
+		/**
+		 * @brief Casts the rays of a batch against the segments.
+		 *
+		 * Fills @ref ray_batch::hit_dist and @ref ray_batch::hit_segment.
+		 * Every group of 8 consecutive rays is tested against the segments
+		 * near the group, with AVX2 instructions if the processor supports
+		 * them. Segments parallel to a ray are not hit by it. If several
+		 * segments are hit at the same distance, the one with the smallest
+		 * index is reported.
+		 * @param rays Batch of rays.
+		 * @param simd Use AVX2 instructions, if supported.
+		 */
+		void raycast(ray_batch& rays, bool simd = true) const;
+
+		/// Returns the segments indexed.
+		const std::vector<segment>& get_segments() const;
+
+		/// Returns the continuous dimension in the x-axis
+		float get_dimX() const;
+		/// Returns the continuous dimension in the y-axis
+		float get_dimY() const;
+};
+
+} // -- namespace charanim
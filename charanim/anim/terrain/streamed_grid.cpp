@@ -0,0 +1,567 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/streamed_grid.hpp>
+
+// C includes
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// C++ includes
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <queue>
+#include <cmath>
+using namespace std;
+
+// charanim includes
+#include <anim/terrain/grid_search.hpp>
+#include <anim/utils/utils.hpp>
+
+namespace charanim {
+
+#define vec2_out(c) "(" << c.x << "," << c.y << ")"
+
+// PRIVATE
+
+void streamed_grid::loader_loop() {
+	const size_t rc = header.region_cells;
+
+	unique_lock<mutex> L(lock);
+	while (true) {
+		work_cv.wait(L, [this]() { return stop_loader or queue.size() > 0; });
+		if (stop_loader) {
+			break;
+		}
+		const size_t r = queue.front();
+		queue.pop_front();
+		regions[r].state = region_state::loading;
+
+		// read the region without holding the lock
+		L.unlock();
+		vector<float> tile;
+		vector<segment> segs;
+		timing::time_point begin = timing::now();
+		bool ok = read_region(r, tile, segs);
+		timing::time_point end = timing::now();
+		L.lock();
+
+		if (not ok) {
+			// the region is blocked
+			tile.assign(rc*rc, 0.0f);
+			segs.clear();
+		}
+		regions[r].tile.swap(tile);
+		regions[r].segments.swap(segs);
+		regions[r].state = region_state::loaded;
+
+		++stats.loads;
+		++stats.resident;
+		stats.peak_resident = std::max(stats.peak_resident, stats.resident);
+		stats.load_time += timing::elapsed_milliseconds(begin, end);
+		done_cv.notify_all();
+	}
+}
+
+bool streamed_grid::read_region
+(size_t r, vector<float>& tile, vector<segment>& segs) const
+{
+	const binary_map::region_entry& E = table[r];
+	const size_t rc = header.region_cells;
+
+	tile.resize(rc*rc);
+	const ssize_t tile_bytes = rc*rc*sizeof(float);
+	if (pread(fd, &tile[0], tile_bytes, E.tile_offset) != tile_bytes) {
+		cerr << "streamed_grid::read_region - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not read the cells of region " << r << endl;
+		return false;
+	}
+
+	vector<float> xy(4*E.n_segments);
+	const ssize_t seg_bytes = xy.size()*sizeof(float);
+	if (seg_bytes > 0 and pread(fd, &xy[0], seg_bytes, E.segments_offset) != seg_bytes) {
+		cerr << "streamed_grid::read_region - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not read the segments of region " << r << endl;
+		return false;
+	}
+	segs.resize(E.n_segments);
+	for (size_t i = 0; i < segs.size(); ++i) {
+		segs[i].first = vec2(xy[4*i], xy[4*i + 1]);
+		segs[i].second = vec2(xy[4*i + 2], xy[4*i + 3]);
+	}
+	return true;
+}
+
+void streamed_grid::request(size_t r, bool urgent) {
+	region& R = regions[r];
+	if (R.state == region_state::unloaded) {
+		R.state = region_state::queued;
+		if (urgent) {
+			queue.push_front(r);
+		}
+		else {
+			queue.push_back(r);
+		}
+		work_cv.notify_one();
+	}
+	else if (R.state == region_state::queued and urgent) {
+		queue.erase(std::find(queue.begin(), queue.end(), r));
+		queue.push_front(r);
+	}
+}
+
+const float *streamed_grid::acquire(size_t r) {
+	unique_lock<mutex> L(lock);
+	regions[r].last_use = tick;
+	if (regions[r].state != region_state::loaded) {
+		request(r, true);
+
+		timing::time_point begin = timing::now();
+		done_cv.wait(L, [&]() { return regions[r].state == region_state::loaded; });
+		timing::time_point end = timing::now();
+
+		++stats.blocking_loads;
+		stats.wait_time += timing::elapsed_milliseconds(begin, end);
+	}
+	return &regions[r].tile[0];
+}
+
+void streamed_grid::evict() {
+	lock_guard<mutex> L(lock);
+	while (stats.resident > budget) {
+		// least recently used region in memory not requested by the
+		// last update
+		size_t lru = regions.size();
+		for (size_t r = 0; r < regions.size(); ++r) {
+			if (regions[r].state == region_state::loaded and
+				regions[r].last_request != tick and
+				(lru == regions.size() or regions[r].last_use < regions[lru].last_use))
+			{
+				lru = r;
+			}
+		}
+		if (lru == regions.size()) {
+			// all regions in memory are needed: exceed the budget
+			break;
+		}
+
+		region& R = regions[lru];
+		vector<float>().swap(R.tile);
+		vector<segment>().swap(R.segments);
+		R.state = region_state::unloaded;
+		++stats.unloads;
+		--stats.resident;
+	}
+}
+
+size_t streamed_grid::region_of(size_t x, size_t y) const {
+	const size_t rc = header.region_cells;
+	return (y/rc)*header.regionsX + x/rc;
+}
+
+// PUBLIC
+
+streamed_grid::streamed_grid() {
+	fd = -1;
+	memset(&header, 0, sizeof(header));
+	lenX = lenY = 0.0f;
+	budget = 64;
+	tick = 0;
+	memset(&stats, 0, sizeof(stats));
+	stop_loader = false;
+}
+
+streamed_grid::~streamed_grid() {
+	close();
+}
+
+// MODIFIERS
+
+bool streamed_grid::open(const string& filename) {
+	close();
+
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		cerr << "streamed_grid::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not open file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		cerr << "streamed_grid::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not read the size of file: '" << filename << "'" << endl;
+		close();
+		return false;
+	}
+	const uint64_t size = static_cast<uint64_t>(st.st_size);
+
+	// is the range [o, o + n) inside the file?
+	auto in_file =
+	[&](uint64_t o, uint64_t n) -> bool {
+		return o <= size and n <= size - o;
+	};
+	// Is an array of n elements of the given size at offset o inside
+	// the file? n is compared first so that n*size can not overflow.
+	auto array_in_file =
+	[&](uint64_t o, uint64_t n, uint64_t elem) -> bool {
+		return n <= size/elem and in_file(o, n*elem);
+	};
+
+	const ssize_t header_bytes = sizeof(header);
+	if (pread(fd, &header, sizeof(header), 0) != header_bytes or
+		memcmp(header.magic, binary_map::region_magic, sizeof(header.magic)) != 0 or
+		header.version != binary_map::version or
+		header.byte_order != binary_map::byte_order)
+	{
+		cerr << "streamed_grid::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    File '" << filename << "' is not a region map" << endl;
+		close();
+		return false;
+	}
+
+	// the regions cover the grid, and their table and the
+	// tiles of rc x rc cells fit in the file
+	const uint64_t rc = header.region_cells;
+	const uint64_t rX = header.regionsX;
+	const uint64_t rY = header.regionsY;
+	const bool valid =
+		header.resX > 0 and header.resY > 0 and
+		rc > 0 and rc <= size/rc and
+		rX >= header.resX/rc + (header.resX%rc != 0) and
+		rY >= header.resY/rc + (header.resY%rc != 0) and
+		rY > 0 and rX <= size/rY and
+		array_in_file(header.table_offset, rX*rY, sizeof(binary_map::region_entry));
+	if (not valid) {
+		cerr << "streamed_grid::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Region map '" << filename << "' is truncated or corrupt" << endl;
+		close();
+		return false;
+	}
+
+	const size_t n = rX*rY;
+	table.resize(n);
+	const ssize_t table_bytes = n*sizeof(binary_map::region_entry);
+	if (pread(fd, &table[0], table_bytes, header.table_offset) != table_bytes) {
+		cerr << "streamed_grid::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Region map '" << filename << "' is truncated" << endl;
+		close();
+		return false;
+	}
+	// the cells and the segments of every region are in the file
+	for (size_t r = 0; r < n; ++r) {
+		const binary_map::region_entry& E = table[r];
+		if (not array_in_file(E.tile_offset, rc*rc, sizeof(float)) or
+			not array_in_file(E.segments_offset, E.n_segments, 4*sizeof(float)))
+		{
+			cerr << "streamed_grid::open - Error (" << __LINE__ << "):" << endl;
+			cerr << "    Region " << r << " of region map '" << filename
+				 << "' is truncated or corrupt" << endl;
+			close();
+			return false;
+		}
+	}
+
+	regions = vector<region>(n);
+	for (region& R : regions) {
+		R.state = region_state::unloaded;
+		R.last_request = 0;
+		R.last_use = 0;
+	}
+	lenX = header.dimX/header.resX;
+	lenY = header.dimY/header.resY;
+	tick = 0;
+	memset(&stats, 0, sizeof(stats));
+
+	stop_loader = false;
+	loader = thread(&streamed_grid::loader_loop, this);
+	return true;
+}
+
+void streamed_grid::close() {
+	if (loader.joinable()) {
+		{
+		lock_guard<mutex> L(lock);
+		stop_loader = true;
+		}
+		work_cv.notify_all();
+		loader.join();
+	}
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+	queue.clear();
+	regions.clear();
+	table.clear();
+	memset(&header, 0, sizeof(header));
+}
+
+void streamed_grid::update(const vector<vec2>& focus, float radius) {
+	const float sideX = header.region_cells*lenX;
+	const float sideY = header.region_cells*lenY;
+	auto clamp =
+	[](float v, size_t n) -> size_t {
+		return static_cast<size_t>(std::max(0.0f, std::min(float(n - 1), v)));
+	};
+
+	{
+	lock_guard<mutex> L(lock);
+	++tick;
+	for (const vec2& p : focus) {
+		const size_t x0 = clamp(std::floor((p.x - radius)/sideX), header.regionsX);
+		const size_t x1 = clamp(std::floor((p.x + radius)/sideX), header.regionsX);
+		const size_t y0 = clamp(std::floor((p.y - radius)/sideY), header.regionsY);
+		const size_t y1 = clamp(std::floor((p.y + radius)/sideY), header.regionsY);
+		for (size_t y = y0; y <= y1; ++y) {
+			for (size_t x = x0; x <= x1; ++x) {
+				const size_t r = y*header.regionsX + x;
+				if (regions[r].state == region_state::unloaded) {
+					++stats.requests;
+				}
+				regions[r].last_request = tick;
+				regions[r].last_use = tick;
+				request(r, false);
+			}
+		}
+	}
+
+	// cancel the requests no longer needed
+	for (auto it = queue.begin(); it != queue.end(); ) {
+		if (regions[*it].last_request != tick) {
+			regions[*it].state = region_state::unloaded;
+			++stats.cancelled;
+			it = queue.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	}
+
+	evict();
+}
+
+void streamed_grid::wait_loads() {
+	unique_lock<mutex> L(lock);
+	done_cv.wait(L,
+		[this]() {
+			for (const region& R : regions) {
+				if (R.last_request == tick and R.state != region_state::loaded) {
+					return false;
+				}
+			}
+			return true;
+		}
+	);
+}
+
+// SETTERS
+
+void streamed_grid::set_budget(size_t max_regions) {
+	budget = max_regions;
+	evict();
+}
+
+// GETTERS
+
+float streamed_grid::get_value(const vec2& p) {
+	if (p.x < 0.0f or p.y < 0.0f) {
+		return 0.0f;
+	}
+	const size_t x = static_cast<size_t>(p.x/lenX);
+	const size_t y = static_cast<size_t>(p.y/lenY);
+	if (x >= header.resX or y >= header.resY) {
+		return 0.0f;
+	}
+
+	const size_t rc = header.region_cells;
+	const float v = acquire(region_of(x,y))[(y%rc)*rc + x%rc];
+	evict();
+	return v;
+}
+
+const vector<segment>& streamed_grid::get_segments(const vec2& p) {
+	const size_t x = static_cast<size_t>(std::max(0.0f, p.x/lenX));
+	const size_t y = static_cast<size_t>(std::max(0.0f, p.y/lenY));
+	const size_t r = region_of(
+		std::min(x, size_t(header.resX - 1)), std::min(y, size_t(header.resY - 1))
+	);
+	acquire(r);
+	return regions[r].segments;
+}
+
+bool streamed_grid::find_path
+(const vec2& source, const vec2& sink, float R, vector<vec2>& path)
+{
+	const int resX = static_cast<int>(header.resX);
+	const int resY = static_cast<int>(header.resY);
+	const size_t rc = header.region_cells;
+
+	// Values of the cells of the regions used by the search. No region
+	// is unloaded during the search, so the pointers stay valid. The
+	// search may use at most 'budget' regions: the cells of the regions
+	// beyond it are blocked and the search fails.
+	vector<const float *> tiles(regions.size(), nullptr);
+	size_t n_tiles = 0;
+	bool over_budget = false;
+	auto value =
+	[&](int x, int y) -> float {
+		const size_t r = region_of(x,y);
+		if (tiles[r] == nullptr) {
+			if (n_tiles == budget) {
+				over_budget = true;
+				return 0.0f;
+			}
+			tiles[r] = acquire(r);
+			++n_tiles;
+		}
+		return tiles[r][(y%rc)*rc + x%rc];
+	};
+
+	const int sx = static_cast<int>(source.x/lenX);
+	const int sy = static_cast<int>(source.y/lenY);
+	const int gx = static_cast<int>(sink.x/lenX);
+	const int gy = static_cast<int>(sink.y/lenY);
+	const bool start_ok =
+		sx >= 0 and sx < resX and sy >= 0 and sy < resY and value(sx,sy) > R;
+	const bool goal_ok =
+		gx >= 0 and gx < resX and gy >= 0 and gy < resY and value(gx,gy) > R;
+	if (over_budget) {
+		cerr << "streamed_grid::find_path - Error (" << __LINE__ << "):" << endl;
+		cerr << "    The search needs more than " << budget << " regions" << endl;
+		evict();
+		return false;
+	}
+	if (not start_ok) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't start at " << vec2_out(source) << endl;
+		return false;
+	}
+	if (not goal_ok) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't finish at " << vec2_out(sink) << endl;
+		return false;
+	}
+
+	const size_t start = size_t(sy)*resX + sx;
+	const size_t goal = size_t(gy)*resX + gx;
+
+	grid_search::euclidean_cost cost;
+	grid_search::euclidean_heuristic h{gx, gy, 1.0};
+	grid_search::hashed_storage S;
+	S.init(0);
+
+	typedef pair<double,size_t> pq_elem;
+	priority_queue<pq_elem, vector<pq_elem>, greater<pq_elem> > OPEN;
+	S.set(start, 0.0, start);
+	OPEN.push(make_pair(h(sx, sy, start), start));
+
+	bool found = false;
+	while (OPEN.size() > 0 and not over_budget) {
+		const size_t cur = OPEN.top().second;
+		OPEN.pop();
+		if (S.is_closed(cur)) {
+			continue;
+		}
+		S.close(cur);
+		if (cur == goal) {
+			found = true;
+			break;
+		}
+
+		const int cx = static_cast<int>(cur%resX);
+		const int cy = static_cast<int>(cur/resX);
+		const double g = S.get_cost(cur);
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				const int nx = cx + dx;
+				const int ny = cy + dy;
+				if ((dx == 0 and dy == 0) or
+					nx < 0 or nx >= resX or ny < 0 or ny >= resY or
+					value(nx,ny) < R)
+				{
+					continue;
+				}
+				const size_t n = size_t(ny)*resX + nx;
+				const double c = g + cost(dx, dy, n);
+				if (c < S.get_cost(n)) {
+					S.set(n, c, cur);
+					OPEN.push(make_pair(c + h(nx, ny, n), n));
+				}
+			}
+		}
+	}
+
+	if (found) {
+		vector<vec2> rev;
+		for (size_t c = goal; c != start; c = S.get_parent(c)) {
+			rev.push_back(vec2(lenX*(c%resX) + lenX/2.0f, lenY*(c/resX) + lenY/2.0f));
+		}
+		rev.push_back(vec2(lenX*sx + lenX/2.0f, lenY*sy + lenY/2.0f));
+		path.insert(path.end(), rev.rbegin(), rev.rend());
+	}
+	else if (over_budget) {
+		cerr << "streamed_grid::find_path - Error (" << __LINE__ << "):" << endl;
+		cerr << "    The search needs more than " << budget << " regions" << endl;
+	}
+	else {
+		cerr << "Error: no path for a particle of radius " << R
+			 << " from " << vec2_out(source) << " to " << vec2_out(sink)
+			 << endl;
+	}
+
+	evict();
+	return found;
+}
+
+streamed_grid::statistics streamed_grid::get_statistics() {
+	lock_guard<mutex> L(lock);
+	return stats;
+}
+
+size_t streamed_grid::get_region_bytes() const {
+	return header.region_cells*header.region_cells*sizeof(float);
+}
+
+size_t streamed_grid::n_regions() const {
+	return regions.size();
+}
+
+size_t streamed_grid::get_resX() const {
+	return header.resX;
+}
+
+size_t streamed_grid::get_resY() const {
+	return header.resY;
+}
+
+float streamed_grid::get_dimX() const {
+	return header.dimX;
+}
+
+float streamed_grid::get_dimY() const {
+	return header.dimY;
+}
+
+} // -- namespace charanim
@@ -0,0 +1,272 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+// charanim includes
+#include <anim/definitions.hpp>
+#include <anim/terrain/binary_map.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Regular grid streamed from a region map.
+ *
+ * The cells of the grid are split into square regions stored in a
+ * region map (see @ref binary_map and @ref terrain::write_region_map).
+ * Only some regions are kept in memory: those around a set of points of
+ * interest (the agents, the camera, ...) given to @ref update, up to a
+ * maximum number of regions (see @ref set_budget). The regions around the
+ * points of interest are always kept, even if they exceed the maximum.
+ *
+ * Regions are loaded by a background thread. Queries that need a region
+ * not loaded yet wait until it is loaded.
+ *
+ * The functions of this class must be called from the same thread.
+ */
+class streamed_grid {
+	public:
+		/// Statistics of the streaming.
+		struct statistics {
+			/// Number of regions requested by @ref update.
+			size_t requests;
+			/// Number of regions loaded.
+			size_t loads;
+			/// Number of regions unloaded.
+			size_t unloads;
+			/// Number of requests cancelled before loading the region.
+			size_t cancelled;
+			/// Number of regions a query had to wait for.
+			size_t blocking_loads;
+			/// Time spent by the queries waiting for regions (ms).
+			double wait_time;
+			/// Time spent reading regions (ms).
+			double load_time;
+			/// Number of regions in memory.
+			size_t resident;
+			/// Maximum number of regions in memory at the same time.
+			size_t peak_resident;
+		};
+
+	private:
+		/// States of a region.
+		enum class region_state : int8_t {
+			/// Not in memory.
+			unloaded,
+			/// Waiting to be loaded.
+			queued,
+			/// Being loaded.
+			loading,
+			/// In memory.
+			loaded
+		};
+
+		/// A region of the grid.
+		struct region {
+			/// State of the region.
+			region_state state;
+			/// Values of the cells, if loaded.
+			std::vector<float> tile;
+			/// Segments near the region, if loaded.
+			std::vector<segment> segments;
+			/// Last call to @ref update that requested this region.
+			uint64_t last_request;
+			/// Last call to @ref update before the region was used.
+			uint64_t last_use;
+		};
+
+		/// File descriptor of the region map.
+		int fd;
+		/// Header of the region map.
+		binary_map::region_header header;
+		/// Table of regions of the region map.
+		std::vector<binary_map::region_entry> table;
+		/// Regions of the grid.
+		std::vector<region> regions;
+
+		/// Length of every cell in the x-axis.
+		float lenX;
+		/// Length of every cell in the y-axis.
+		float lenY;
+
+		/// Maximum number of regions in memory.
+		size_t budget;
+		/// Number of calls to @ref update.
+		uint64_t tick;
+		/// Statistics of the streaming.
+		statistics stats;
+
+		/// Thread loading the regions.
+		std::thread loader;
+		/// Lock on the states of the regions, the queue and the statistics.
+		std::mutex lock;
+		/// Signals new requests to the loader.
+		std::condition_variable work_cv;
+		/// Signals loaded regions.
+		std::condition_variable done_cv;
+		/// Regions waiting to be loaded, the most urgent first.
+		std::deque<size_t> queue;
+		/// Should the loader stop?
+		bool stop_loader;
+
+	private:
+		/// Loads the regions in the queue until @ref stop_loader is set.
+		void loader_loop();
+
+		/**
+		 * @brief Reads a region from the file.
+		 * @param[in] r Region.
+		 * @param[out] tile Values of the cells.
+		 * @param[out] segs Segments.
+		 * @return Returns false if the region could not be read.
+		 */
+		bool read_region
+		(size_t r, std::vector<float>& tile, std::vector<segment>& segs) const;
+
+		/**
+		 * @brief Queues region @e r if it is not in memory.
+		 *
+		 * Must be called with @ref lock held.
+		 * @param r Region.
+		 * @param urgent Put the region at the front of the queue.
+		 */
+		void request(size_t r, bool urgent);
+
+		/**
+		 * @brief Returns the values of the cells of region @e r.
+		 *
+		 * Waits until the region is loaded.
+		 */
+		const float *acquire(size_t r);
+
+		/**
+		 * @brief Unloads regions until there are at most @ref budget.
+		 *
+		 * The least recently used regions are unloaded first. The regions
+		 * requested by the last call to @ref update are never unloaded:
+		 * if they do not fit in the budget it is exceeded until the next
+		 * call to @ref update.
+		 */
+		void evict();
+
+		/// Returns the region of cell (x,y).
+		size_t region_of(size_t x, size_t y) const;
+
+	public:
+		/// Default constructor.
+		streamed_grid();
+		/// Destructor.
+		~streamed_grid();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Opens a region map.
+		 *
+		 * No region is loaded. The header and the table of regions are
+		 * checked against the size of the file.
+		 * @return Returns true on success.
+		 */
+		bool open(const std::string& filename);
+
+		/// Unloads all regions and closes the region map.
+		void close();
+
+		/**
+		 * @brief Requests the regions around the points of interest.
+		 *
+		 * The regions within distance @e radius of any of the points in
+		 * @e focus are loaded in the background. The regions not requested
+		 * are unloaded when there are more than allowed by the budget.
+		 * @param focus Points of interest.
+		 * @param radius Distance around each point.
+		 */
+		void update(const std::vector<vec2>& focus, float radius);
+
+		/// Waits until the regions requested are loaded.
+		void wait_loads();
+
+		// SETTERS
+
+		/// Sets the maximum number of regions in memory.
+		void set_budget(size_t max_regions);
+
+		// GETTERS
+
+		/**
+		 * @brief Returns the value of the cell of point @e p.
+		 *
+		 * Waits for its region if it is not loaded. Points out of the map
+		 * have value 0.
+		 */
+		float get_value(const vec2& p);
+
+		/**
+		 * @brief Returns the segments near the region of point @e p.
+		 *
+		 * Waits for the region if it is not loaded. The reference is
+		 * valid until the next call to a non-constant function.
+		 */
+		const std::vector<segment>& get_segments(const vec2& p);
+
+		/**
+		 * @brief Finds a path between two points.
+		 *
+		 * A* search on the cells of the grid, 8-connected. Waits for
+		 * the regions the search enters that are not loaded. The search
+		 * fails if it needs more regions than allowed by the budget.
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Centres of the cells of the path.
+		 * @return Returns false if no path was found.
+		 */
+		bool find_path
+		(const vec2& source, const vec2& sink, float R, std::vector<vec2>& path);
+
+		/// Returns the statistics of the streaming.
+		statistics get_statistics();
+
+		/// Returns the number of bytes of a region in memory (cells only).
+		size_t get_region_bytes() const;
+		/// Returns the number of regions.
+		size_t n_regions() const;
+		/// Returns the number of cells in the x-axis.
+		size_t get_resX() const;
+		/// Returns the number of cells in the y-axis.
+		size_t get_resY() const;
+		/// Returns the continuous dimension in the x-axis.
+		float get_dimX() const;
+		/// Returns the continuous dimension in the y-axis.
+		float get_dimY() const;
+};
+
+} // -- namespace charanim
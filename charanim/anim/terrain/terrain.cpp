@@ -22,71 +22,183 @@
 #include <anim/terrain/terrain.hpp>
 
 // C++ includes
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <fstream>
+#include <cstring>
+#include <tuple>
 using namespace std;
 
-namespace charanim {
+// charanim includes
+#include <anim/terrain/simplify_segments.hpp>
+#include <anim/terrain/grid_traversal.hpp>
 
-// PRIVATE
+namespace charanim {
 
-// PUBLIC
+// default tolerance of the simplification of the segments
+#define SIMPLIFY_TOLERANCE 1e-3f
 
-terrain::terrain() {
-	dimX = dimY = 0.0f;
-	rg = nullptr;
-}
+// PRIVATE
 
-terrain::~terrain() {
-	clear();
+vector<segment> terrain::outer_walls() const {
+	return vector<segment>{
+		segment(vec2(-1,-1), vec2(dimX, -1)),
+		segment(vec2(-1,-1), vec2(-1, dimY)),
+		segment(vec2(dimX,-1), vec2(dimX, dimY)),
+		segment(vec2(-1,dimY), vec2(dimX, dimY))
+	};
 }
 
-// MODIFIERS
+void terrain::enclose() {
+	removed_segments = 0;
+	if (simplify_tolerance > 0.0f) {
+		removed_segments = simplify_segments(sgs, simplify_tolerance);
+	}
 
-void terrain::clear() {
-	sgs.clear();
-	if (rg != nullptr) {
-		rg->clear();
-		delete rg;
-		rg = nullptr;
+	// edges of the polygons
+	for (const vector<vec2>& poly : polygons) {
+		for (size_t i = 0; i < poly.size(); ++i) {
+			sgs.push_back(segment(poly[i], poly[(i + 1)%poly.size()]));
+		}
 	}
-}
 
-// SETTERS
+	// make walls of the quadrilateral
+	segment wall1(vec2(0,0), vec2(dimX-1,0));
+	segment wall2(vec2(0,0), vec2(0, dimY-1));
+	segment wall3(vec2(dimX-1,0), vec2(dimX-1, dimY-1));
+	segment wall4(vec2(0,dimY-1), vec2(dimX-1, dimY-1));
 
-// GETTERS
+	sgs.push_back(wall1);
+	sgs.push_back(wall2);
+	sgs.push_back(wall3);
+	sgs.push_back(wall4);
 
-const std::vector<segment>& terrain::get_segments() const {
-	return sgs;
+	si.init(dimX, dimY, sgs);
 }
 
-regular_grid *terrain::get_regular_grid() {
-	return rg;
-}
+bool terrain::read_binary_map(const string& filename) {
+	if (not map_file.open(filename)) {
+		return false;
+	}
+	const char *data = map_file.get_data();
+	const uint64_t size = map_file.get_size();
 
-const regular_grid *terrain::get_regular_grid() const {
-	return rg;
-}
+	// is the range [o, o + n) inside the file?
+	auto in_file =
+	[&](uint64_t o, uint64_t n) -> bool {
+		return o <= size and n <= size - o;
+	};
 
-// I/O
+	const binary_map::header *H =
+		reinterpret_cast<const binary_map::header *>(data);
 
-bool terrain::read_map(const string& filename) {
-	clear();
+	if (size < sizeof(binary_map::header) or
+		memcmp(H->magic, binary_map::magic, sizeof(binary_map::magic)) != 0)
+	{
+		cerr << "terrain::read_binary_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    File '" << filename << "' is not a binary map" << endl;
+		map_file.close();
+		return false;
+	}
+	if (H->version != binary_map::version or
+		H->byte_order != binary_map::byte_order)
+	{
+		cerr << "terrain::read_binary_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Unsupported version or byte order of binary map '"
+			 << filename << "'" << endl;
+		map_file.close();
+		return false;
+	}
 
-	ifstream fin;
-	fin.open(filename.c_str());
-	if (not fin.is_open()) {
-		cerr << "terrain::read_map - Error (" << __LINE__ << "):" << endl;
-		cerr << "    Could not read map file: '" << filename << "'" << endl;
+	// Is an array of n elements of the given size at offset o inside
+	// the file? n is compared first so that n*size can not overflow.
+	auto array_in_file =
+	[&](uint64_t o, uint64_t n, uint64_t elem) -> bool {
+		return n <= size/elem and in_file(o, n*elem);
+	};
+
+	if (H->type > static_cast<uint32_t>(path_finder_type::medial_axis)) {
+		cerr << "terrain::read_binary_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Invalid type of path finder " << H->type
+			 << " in binary map '" << filename << "'" << endl;
+		map_file.close();
 		return false;
 	}
 
-	path_finder_type pf_type = path_finder_type::none;
+	bool valid =
+		array_in_file(H->segments_offset, H->n_segments, 4*sizeof(float)) and
+		H->segments_offset%sizeof(float) == 0;
+	if (H->cells_offset != 0) {
+		// resX*resY cells must fit in the file
+		const bool fits = H->resY > 0 and H->resX <= size/H->resY;
+		const uint64_t N = (fits ? H->resX*H->resY : 0);
+		valid = valid and fits and
+			array_in_file(H->grid_segments_offset, H->n_grid_segments, 4*sizeof(float)) and
+			array_in_file(H->cells_offset, N, sizeof(float)) and
+			array_in_file(H->labels_offset, N, sizeof(int32_t)) and
+			H->grid_segments_offset%sizeof(float) == 0 and
+			H->cells_offset%sizeof(float) == 0 and
+			H->labels_offset%sizeof(int32_t) == 0;
 
-	bool res_read = false;
-	size_t resX, resY;
-	resX = resY = 0;
+		// every label is a segment of the grid, or -1
+		const int32_t *L = reinterpret_cast<const int32_t *>(data + H->labels_offset);
+		const int64_t n_labels = static_cast<int64_t>(H->n_grid_segments);
+		for (uint64_t i = 0; valid and i < N; ++i) {
+			valid = -1 <= L[i] and L[i] < n_labels;
+		}
+	}
+	const uint64_t *starts =
+		reinterpret_cast<const uint64_t *>(data + H->polygon_starts_offset);
+	if (H->n_polygons > 0) {
+		valid = valid and
+			H->n_polygons < size/sizeof(uint64_t) and
+			array_in_file(H->polygon_starts_offset, H->n_polygons + 1, sizeof(uint64_t)) and
+			H->polygon_starts_offset%sizeof(uint64_t) == 0;
+		// every polygon has at least 3 vertices, and
+		// the vertices of the last one are in the file
+		for (uint64_t p = 0; valid and p < H->n_polygons; ++p) {
+			valid = starts[p] <= starts[p + 1] and starts[p + 1] - starts[p] >= 3;
+		}
+		valid = valid and
+			array_in_file(H->polygon_vertices_offset, starts[H->n_polygons], 2*sizeof(float)) and
+			H->polygon_vertices_offset%sizeof(float) == 0;
+	}
+	if (not valid) {
+		cerr << "terrain::read_binary_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Binary map '" << filename << "' is truncated or corrupt" << endl;
+		map_file.close();
+		return false;
+	}
+
+	pf_type = static_cast<path_finder_type>(H->type);
+	resX = H->resX;
+	resY = H->resY;
+	dimX = H->dimX;
+	dimY = H->dimY;
+	wall_thickness = H->wall_thickness;
 
+	const float *S = reinterpret_cast<const float *>(data + H->segments_offset);
+	sgs.resize(H->n_segments);
+	for (size_t i = 0; i < sgs.size(); ++i) {
+		sgs[i].first = vec2(S[4*i], S[4*i + 1]);
+		sgs[i].second = vec2(S[4*i + 2], S[4*i + 3]);
+	}
+
+	const float *V = reinterpret_cast<const float *>(data + H->polygon_vertices_offset);
+	polygons.resize(H->n_polygons);
+	for (size_t p = 0; p < polygons.size(); ++p) {
+		for (uint64_t v = starts[p]; v < starts[p + 1]; ++v) {
+			polygons[p].push_back(vec2(V[2*v], V[2*v + 1]));
+		}
+	}
+
+	map_header = H;
+	si.init(dimX, dimY, sgs);
+	return make_path_finder(pf_type);
+}
+
+bool terrain::read_text_map(ifstream& fin) {
 	string keyword;
 
 	while (fin >> keyword) {
@@ -95,27 +207,63 @@ bool terrain::read_map(const string& filename) {
 			if (keyword == "regular_grid") {
 				pf_type = path_finder_type::regular_grid;
 			}
+			else if (keyword == "navmesh") {
+				pf_type = path_finder_type::navmesh;
+			}
+			else if (keyword == "visibility_graph") {
+				pf_type = path_finder_type::visibility_graph;
+			}
+			else if (keyword == "medial_axis") {
+				pf_type = path_finder_type::medial_axis;
+			}
 			else {
-				cerr << "terrain::read_map - Error (" << __LINE__ << "):" << endl;
+				cerr << "terrain::read_text_map - Error (" << __LINE__ << "):" << endl;
 				cerr << "    Invalid type '" << keyword << "'" << endl;
 				return false;
 			}
 		}
 		else if (keyword == "resolution") {
 			fin >> resX >> resY;
-			res_read = true;
 		}
 		else if (keyword == "dimensions") {
 			fin >> dimX >> dimY;
 		}
+		else if (keyword == "wall_thickness") {
+			fin >> wall_thickness;
+		}
+		else if (keyword == "simplify_tolerance") {
+			fin >> simplify_tolerance;
+		}
 		else if (keyword == "wall") {
 			segment s;
 			fin >> s.first.x  >> s.first.y
 				>> s.second.x >> s.second.y;
 			sgs.push_back(s);
 		}
+		else if (keyword == "polygon") {
+			long long n;
+			if (not (fin >> n) or n < 3) {
+				cerr << "terrain::read_text_map - Error (" << __LINE__ << "):" << endl;
+				cerr << "    A polygon needs at least 3 vertices" << endl;
+				return false;
+			}
+			// the vertices are read one by one: the number
+			// of vertices may be wrong, and arbitrarily large
+			vector<vec2> poly;
+			for (long long i = 0; i < n; ++i) {
+				vec2 v;
+				if (not (fin >> v.x >> v.y)) {
+					cerr << "terrain::read_text_map - Error (" << __LINE__ << "):" << endl;
+					cerr << "    Could not read vertex " << i << " of a polygon of "
+						 << n << " vertices" << endl;
+					return false;
+				}
+				poly.push_back(v);
+			}
+			polygons.push_back(poly);
+		}
 		else {
-			cerr << "terrain::read_map - Error (" << __LINE__ << "):" << endl;
+			cerr << "terrain::read_text_map - Error (" << __LINE__ << "):" << endl;
 			cerr << "    Unrecognized keywork '" << keyword << "'" << endl;
 			return false;
 		}
@@ -123,24 +271,99 @@ bool terrain::read_map(const string& filename) {
 	fin.close();
 
 	if (pf_type == path_finder_type::none) {
-		cerr << "terrain::read_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "terrain::read_text_map - Error (" << __LINE__ << "):" << endl;
 		cerr << "    Path finder type not found" << endl;
 		cerr << "    Include a line with the following format:" << endl;
 		cerr << "        type TYPE" << endl;
 		cerr << "    where TYPE is one of the following:" << endl;
 		cerr << "        regular_grid" << endl;
+		cerr << "        navmesh" << endl;
+		cerr << "        visibility_graph" << endl;
+		cerr << "        medial_axis" << endl;
 		return false;
 	}
 
-	// make walls of the quadrilateral
-	segment wall1(vec2(0,0), vec2(dimX-1,0));
-	segment wall2(vec2(0,0), vec2(0, dimY-1));
-	segment wall3(vec2(dimX-1,0), vec2(dimX-1, dimY-1));
-	segment wall4(vec2(0,dimY-1), vec2(dimX-1, dimY-1));
+	enclose();
+	return true;
+}
+
+// PUBLIC
+
+terrain::terrain() {
+	dimX = dimY = 0.0f;
+	resX = resY = 0;
+	wall_thickness = 0.0f;
+	simplify_tolerance = SIMPLIFY_TOLERANCE;
+	removed_segments = 0;
+	pf_type = path_finder_type::none;
+	rg = nullptr;
+	nm = nullptr;
+	vg = nullptr;
+	ma = nullptr;
+	map_header = nullptr;
+}
+
+terrain::~terrain() {
+	clear();
+}
+
+// MODIFIERS
+
+void terrain::init(
+	path_finder_type type, size_t cellsx, size_t cellsy,
+	float dx, float dy, const vector<segment>& segs
+)
+{
+	clear();
+	pf_type = type;
+	resX = cellsx;
+	resY = cellsy;
+	dimX = dx;
+	dimY = dy;
+	sgs = segs;
+	enclose();
+}
 
-	if (pf_type == path_finder_type::regular_grid) {
-		if (not res_read) {
-			cerr << "terrain::read_map - Error (" << __LINE__ << "):" << endl;
+void terrain::clear() {
+	sgs.clear();
+	polygons.clear();
+	si.clear();
+	resX = resY = 0;
+	wall_thickness = 0.0f;
+	simplify_tolerance = SIMPLIFY_TOLERANCE;
+	removed_segments = 0;
+	pf_type = path_finder_type::none;
+	if (ma != nullptr) {
+		ma->clear();
+		delete ma;
+		ma = nullptr;
+	}
+	if (rg != nullptr) {
+		rg->clear();
+		delete rg;
+		rg = nullptr;
+	}
+	if (nm != nullptr) {
+		nm->clear();
+		delete nm;
+		nm = nullptr;
+	}
+	if (vg != nullptr) {
+		vg->clear();
+		delete vg;
+		vg = nullptr;
+	}
+	// the regular grid may be using the mapped file
+	map_header = nullptr;
+	map_file.close();
+	map_filename.clear();
+	watcher.close();
+}
+
+bool terrain::make_path_finder(path_finder_type type) {
+	if (type == path_finder_type::regular_grid and rg == nullptr) {
+		if (resX == 0 or resY == 0) {
+			cerr << "terrain::make_path_finder - Error (" << __LINE__ << "):" << endl;
 			cerr << "    Resolution not found" << endl;
 			cerr << "    Include a line with the following format:" << endl;
 			cerr << "        resolution RX RY" << endl;
@@ -150,20 +373,672 @@ bool terrain::read_map(const string& filename) {
 		}
 
 		rg = new regular_grid();
+		rg->set_wall_thickness(wall_thickness);
+
+		if (map_header != nullptr and map_header->cells_offset != 0) {
+			// use the grid section of the binary map
+			char *data = map_file.get_data();
+			const float *S = reinterpret_cast<const float *>
+				(data + map_header->grid_segments_offset);
+
+			vector<segment> grid_segments(map_header->n_grid_segments);
+			for (size_t i = 0; i < grid_segments.size(); ++i) {
+				grid_segments[i].first = vec2(S[4*i], S[4*i + 1]);
+				grid_segments[i].second = vec2(S[4*i + 2], S[4*i + 3]);
+			}
+
+			rg->init(
+				resX, resY, dimX, dimY,
+				reinterpret_cast<float *>(data + map_header->cells_offset),
+				reinterpret_cast<int32_t *>(data + map_header->labels_offset),
+				grid_segments, map_header->max_dist
+			);
+			return true;
+		}
+
 		rg->init(resX, resY, dimX, dimY);
-		rg->init(sgs);
-		rg->expand_function_distance(segment(vec2(-1,-1), vec2(dimX, -1)));
-		rg->expand_function_distance(segment(vec2(-1,-1), vec2(-1, dimY)));
-		rg->expand_function_distance(segment(vec2(dimX,-1), vec2(dimX, dimY)));
-		rg->expand_function_distance(segment(vec2(-1,dimY), vec2(dimX, dimY)));
+		rg->init(si);
+		for (const segment& s : outer_walls()) {
+			rg->expand_function_distance(s);
+		}
+		for (const vector<vec2>& poly : polygons) {
+			rg->fill_polygon(poly);
+		}
 
 		rg->make_final_state();
 	}
+	else if (type == path_finder_type::navmesh and nm == nullptr) {
+		nm = new navmesh();
+		nm->init(dimX, dimY, sgs);
+	}
+	else if (type == path_finder_type::visibility_graph and vg == nullptr) {
+		vg = new visibility_graph();
+		vg->init(&si);
+	}
+	else if (type == path_finder_type::medial_axis and ma == nullptr) {
+		if (not make_path_finder(path_finder_type::regular_grid)) {
+			return false;
+		}
+		ma = new medial_axis();
+		ma->init(rg);
+	}
+	return true;
+}
 
-	sgs.push_back(wall1);
-	sgs.push_back(wall2);
-	sgs.push_back(wall3);
-	sgs.push_back(wall4);
+bool terrain::watch_map() {
+	if (map_filename.empty()) {
+		cerr << "terrain::watch_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Only text maps read from a file can be watched" << endl;
+		return false;
+	}
+	return watcher.watch(map_filename);
+}
+
+bool terrain::reload_map(bitmask& changed) {
+	if (map_filename.empty()) {
+		cerr << "terrain::reload_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Only text maps read from a file can be reloaded" << endl;
+		return false;
+	}
+
+	ifstream fin;
+	fin.open(map_filename.c_str());
+	if (not fin.is_open()) {
+		cerr << "terrain::reload_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not read map file: '" << map_filename << "'" << endl;
+		return false;
+	}
+	terrain next;
+	if (not next.read_text_map(fin)) {
+		return false;
+	}
+
+	if (next.resX != resX or next.resY != resY or
+		next.dimX != dimX or next.dimY != dimY or
+		next.wall_thickness != wall_thickness)
+	{
+		// the path finder is built on the map read, and this
+		// terrain is replaced only if it succeeds
+		if (not next.make_path_finder(next.pf_type)) {
+			return false;
+		}
+		const string filename = map_filename;
+		const bool watching = watcher.is_watching();
+		clear();
+		sgs.swap(next.sgs);
+		polygons.swap(next.polygons);
+		std::swap(si, next.si);
+		dimX = next.dimX;
+		dimY = next.dimY;
+		resX = next.resX;
+		resY = next.resY;
+		wall_thickness = next.wall_thickness;
+		simplify_tolerance = next.simplify_tolerance;
+		removed_segments = next.removed_segments;
+		pf_type = next.pf_type;
+		std::swap(rg, next.rg);
+		std::swap(nm, next.nm);
+		std::swap(vg, next.vg);
+		std::swap(ma, next.ma);
+		if (vg != nullptr) {
+			// it was built on the spatial index of 'next'
+			vg->clear();
+			vg->init(&si);
+		}
+		map_filename = filename;
+		if (watching) {
+			watch_map();
+		}
+		changed.init(resX, resY);
+		for (size_t y = 0; y < resY; ++y) {
+			for (size_t x = 0; x < resX; ++x) {
+				changed.set(x, y);
+			}
+		}
+		return true;
+	}
+
+	// segments removed and added
+	auto segment_less =
+	[](const segment& a, const segment& b) {
+		return make_tuple(a.first.x, a.first.y, a.second.x, a.second.y) <
+			   make_tuple(b.first.x, b.first.y, b.second.x, b.second.y);
+	};
+	vector<segment> old_sgs = sgs;
+	vector<segment> new_sgs = next.sgs;
+	std::sort(old_sgs.begin(), old_sgs.end(), segment_less);
+	std::sort(new_sgs.begin(), new_sgs.end(), segment_less);
+	vector<segment> removed, added;
+	std::set_difference(
+		old_sgs.begin(), old_sgs.end(), new_sgs.begin(), new_sgs.end(),
+		back_inserter(removed), segment_less
+	);
+	std::set_difference(
+		new_sgs.begin(), new_sgs.end(), old_sgs.begin(), old_sgs.end(),
+		back_inserter(added), segment_less
+	);
+
+	const vector<vector<vec2> > old_polygons = polygons;
+	sgs = next.sgs;
+	polygons = next.polygons;
+	simplify_tolerance = next.simplify_tolerance;
+	removed_segments = next.removed_segments;
+	pf_type = next.pf_type;
+	si.init(dimX, dimY, sgs);
+
+	// cells covered by the segments removed and added, whatever the
+	// path finder is
+	changed.init(resX, resY);
+	if (resX > 0 and resY > 0) {
+		const float lenX = dimX/resX;
+		const float lenY = dimY/resY;
+		auto mark =
+		[&](const vector<segment>& segs) {
+			for (const segment& s : segs) {
+				grid_traversal::for_each_cell_capsule(
+					s.first, s.second, 0.5f*wall_thickness, lenX, lenY,
+					static_cast<int>(resX), static_cast<int>(resY),
+					[&](int x, int y) { changed.set(x, y); }
+				);
+			}
+		};
+		mark(removed);
+		mark(added);
+	}
+
+	// and the cells whose value changed in the regular grid
+	if (rg != nullptr) {
+		const size_t N = resX*resY;
+		const vector<float> before(rg->get_grid(), rg->get_grid() + N);
+
+		// the distances are updated without the signs of the polygons
+		for (const vector<vec2>& poly : old_polygons) {
+			rg->clear_polygon(poly);
+		}
+		rg->update_segments(si, outer_walls(), removed, added);
+		for (const vector<vec2>& poly : polygons) {
+			rg->fill_polygon(poly);
+		}
+		rg->make_final_state();
+
+		const float *cells = rg->get_grid();
+		for (size_t i = 0; i < N; ++i) {
+			if (cells[i] != before[i]) {
+				changed.set(i%resX, i/resX);
+			}
+		}
+	}
+	if (nm != nullptr) {
+		nm->clear();
+		nm->init(dimX, dimY, sgs);
+	}
+	if (vg != nullptr) {
+		vg->clear();
+		vg->init(&si);
+	}
+	if (ma != nullptr) {
+		ma->init(rg);
+	}
+	return make_path_finder(pf_type);
+}
+
+// SETTERS
+
+void terrain::set_path_finder_type(path_finder_type type) {
+	pf_type = type;
+}
+
+// GETTERS
+
+const std::vector<segment>& terrain::get_segments() const {
+	return sgs;
+}
+
+const vector<vector<vec2> >& terrain::get_polygons() const {
+	return polygons;
+}
+
+bool terrain::map_modified() {
+	return watcher.modified();
+}
+
+bool terrain::path_touches
+(const vector<vec2>& path, float R, const bitmask& cells) const
+{
+	if (path.size() == 0 or resX == 0 or resY == 0) {
+		return false;
+	}
+	const float lenX = dimX/resX;
+	const float lenY = dimY/resY;
+	for (size_t i = 0; i < path.size(); ++i) {
+		const vec2& p = path[i];
+		const vec2& q = path[std::min(i + 1, path.size() - 1)];
+		const bool untouched = grid_traversal::for_each_cell_capsule(
+			p, q, R, lenX, lenY, static_cast<int>(resX), static_cast<int>(resY),
+			[&](int x, int y) -> bool { return not cells.get(x, y); }
+		);
+		if (not untouched) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const spatial_index& terrain::get_spatial_index() const {
+	return si;
+}
+
+size_t terrain::get_n_removed_segments() const {
+	return removed_segments;
+}
+
+float terrain::get_dimX() const {
+	return dimX;
+}
+
+float terrain::get_dimY() const {
+	return dimY;
+}
+
+path_finder_type terrain::get_path_finder_type() const {
+	return pf_type;
+}
+
+regular_grid *terrain::get_regular_grid() {
+	return rg;
+}
+
+const regular_grid *terrain::get_regular_grid() const {
+	return rg;
+}
+
+navmesh *terrain::get_navmesh() {
+	return nm;
+}
+
+const navmesh *terrain::get_navmesh() const {
+	return nm;
+}
+
+visibility_graph *terrain::get_visibility_graph() {
+	return vg;
+}
+
+const visibility_graph *terrain::get_visibility_graph() const {
+	return vg;
+}
+
+medial_axis *terrain::get_medial_axis() {
+	return ma;
+}
+
+const medial_axis *terrain::get_medial_axis() const {
+	return ma;
+}
+
+void terrain::find_path(
+	const vec2& source, const vec2& sink,
+	float R,
+	vector<vec2>& path,
+	vector<vec2>& smoothed_path
+)
+{
+	if (pf_type == path_finder_type::regular_grid and rg != nullptr) {
+		rg->find_path(source, sink, R, path, smoothed_path);
+	}
+	else if (pf_type == path_finder_type::navmesh and nm != nullptr) {
+		nm->find_path(source, sink, R, path, smoothed_path);
+	}
+	else if (pf_type == path_finder_type::visibility_graph and vg != nullptr) {
+		vg->find_path(source, sink, R, path, smoothed_path);
+	}
+	else if (pf_type == path_finder_type::medial_axis and ma != nullptr) {
+		ma->find_path(source, sink, R, path, smoothed_path);
+	}
+	else {
+		cerr << "terrain::find_path - Error (" << __LINE__ << "):" << endl;
+		cerr << "    The path finder has not been built" << endl;
+	}
+}
+
+// I/O
+
+bool terrain::read_map(const string& filename) {
+	clear();
+
+	ifstream fin;
+	fin.open(filename.c_str());
+	if (not fin.is_open()) {
+		cerr << "terrain::read_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not read map file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	char magic[sizeof(binary_map::magic)];
+	if (fin.read(magic, sizeof(magic)) and
+		memcmp(magic, binary_map::magic, sizeof(magic)) == 0)
+	{
+		fin.close();
+		return read_binary_map(filename);
+	}
+	fin.clear();
+	fin.seekg(0);
+
+	if (not read_text_map(fin)) {
+		return false;
+	}
+	map_filename = filename;
+	return make_path_finder(pf_type);
+}
+
+bool terrain::write_map(const string& filename) const {
+	ofstream fout;
+	fout.open(filename.c_str());
+	if (not fout.is_open()) {
+		cerr << "terrain::write_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not open file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	fout << "type ";
+	switch (pf_type) {
+		case path_finder_type::navmesh: fout << "navmesh"; break;
+		case path_finder_type::visibility_graph: fout << "visibility_graph"; break;
+		case path_finder_type::medial_axis: fout << "medial_axis"; break;
+		default: fout << "regular_grid";
+	}
+	fout << endl;
+	fout << "resolution " << resX << " " << resY << endl;
+	fout << "dimensions " << dimX << " " << dimY << endl;
+	if (wall_thickness > 0.0f) {
+		fout << "wall_thickness " << wall_thickness << endl;
+	}
+	if (simplify_tolerance != SIMPLIFY_TOLERANCE) {
+		fout << "simplify_tolerance " << simplify_tolerance << endl;
+	}
+
+	// the walls are followed by the edges of the polygons and
+	// by the four walls added in 'enclose'
+	size_t n_edges = 4;
+	for (const vector<vec2>& poly : polygons) {
+		n_edges += poly.size();
+	}
+	fout.precision(9);
+	const size_t n = (sgs.size() >= n_edges ? sgs.size() - n_edges : 0);
+	for (size_t i = 0; i < n; ++i) {
+		const segment& s = sgs[i];
+		fout << "wall "
+			 << s.first.x << " " << s.first.y << " "
+			 << s.second.x << " " << s.second.y << "\n";
+	}
+	for (const vector<vec2>& poly : polygons) {
+		fout << "polygon " << poly.size();
+		for (const vec2& v : poly) {
+			fout << " " << v.x << " " << v.y;
+		}
+		fout << "\n";
+	}
+
+	if (not fout) {
+		cerr << "terrain::write_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not write file: '" << filename << "'" << endl;
+		return false;
+	}
+	fout.close();
+	return true;
+}
+
+bool terrain::write_binary_map(const string& filename, bool with_grid) const {
+	if (with_grid and rg == nullptr) {
+		cerr << "terrain::write_binary_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    The regular grid has not been built" << endl;
+		return false;
+	}
+
+	ofstream fout;
+	fout.open(filename.c_str(), ios::binary);
+	if (not fout.is_open()) {
+		cerr << "terrain::write_binary_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not open file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	binary_map::header H;
+	memset(&H, 0, sizeof(H));
+	memcpy(H.magic, binary_map::magic, sizeof(binary_map::magic));
+	H.version = binary_map::version;
+	H.byte_order = binary_map::byte_order;
+	H.type = static_cast<uint32_t>(pf_type);
+	H.wall_thickness = wall_thickness;
+	H.resX = resX;
+	H.resY = resY;
+	H.dimX = dimX;
+	H.dimY = dimY;
+
+	const uint64_t N = resX*resY;
+	H.n_segments = sgs.size();
+	H.segments_offset = binary_map::align(sizeof(binary_map::header));
+	uint64_t end = H.segments_offset + 4*sizeof(float)*H.n_segments;
+	if (with_grid) {
+		H.max_dist = rg->get_max_dist();
+		H.n_grid_segments = rg->get_segments().size();
+		H.grid_segments_offset = binary_map::align(end);
+		end = H.grid_segments_offset + 4*sizeof(float)*H.n_grid_segments;
+		H.cells_offset = binary_map::align(end);
+		end = H.cells_offset + N*sizeof(float);
+		H.labels_offset = binary_map::align(end);
+		end = H.labels_offset + N*sizeof(int32_t);
+	}
+
+	// index of the first vertex of every polygon
+	vector<uint64_t> starts(1, 0);
+	for (const vector<vec2>& poly : polygons) {
+		starts.push_back(starts.back() + poly.size());
+	}
+	H.n_polygons = polygons.size();
+	if (H.n_polygons > 0) {
+		H.polygon_starts_offset = binary_map::align(end);
+		end = H.polygon_starts_offset + starts.size()*sizeof(uint64_t);
+		H.polygon_vertices_offset = binary_map::align(end);
+	}
+
+	// writes the segments starting at offset 'o' (the gaps
+	// between sections are filled with zeros)
+	auto write_segments =
+	[&](const vector<segment>& segs, uint64_t o) {
+		fout.seekp(o);
+		for (const segment& s : segs) {
+			const float xy[4] = {s.first.x, s.first.y, s.second.x, s.second.y};
+			fout.write(reinterpret_cast<const char *>(xy), sizeof(xy));
+		}
+	};
+
+	fout.write(reinterpret_cast<const char *>(&H), sizeof(H));
+	write_segments(sgs, H.segments_offset);
+	if (with_grid) {
+		write_segments(rg->get_segments(), H.grid_segments_offset);
+		fout.seekp(H.cells_offset);
+		fout.write(reinterpret_cast<const char *>(rg->get_grid()), N*sizeof(float));
+		fout.seekp(H.labels_offset);
+		fout.write(reinterpret_cast<const char *>(rg->get_labels()), N*sizeof(int32_t));
+	}
+	if (H.n_polygons > 0) {
+		fout.seekp(H.polygon_starts_offset);
+		fout.write(reinterpret_cast<const char *>(&starts[0]), starts.size()*sizeof(uint64_t));
+		fout.seekp(H.polygon_vertices_offset);
+		for (const vector<vec2>& poly : polygons) {
+			for (const vec2& v : poly) {
+				const float xy[2] = {v.x, v.y};
+				fout.write(reinterpret_cast<const char *>(xy), sizeof(xy));
+			}
+		}
+	}
+
+	if (not fout) {
+		cerr << "terrain::write_binary_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not write file: '" << filename << "'" << endl;
+		return false;
+	}
+	fout.close();
+	return true;
+}
+
+bool terrain::write_region_map(const string& filename, size_t region_cells) const {
+	if (resX == 0 or resY == 0 or region_cells == 0) {
+		cerr << "terrain::write_region_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    The resolution and the size of the regions" << endl;
+		cerr << "    must be larger than 0" << endl;
+		return false;
+	}
+
+	ofstream fout;
+	fout.open(filename.c_str(), ios::binary);
+	if (not fout.is_open()) {
+		cerr << "terrain::write_region_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not open file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	const size_t rc = region_cells;
+	const float lenX = dimX/resX;
+	const float lenY = dimY/resY;
+
+	binary_map::region_header H;
+	memset(&H, 0, sizeof(H));
+	memcpy(H.magic, binary_map::region_magic, sizeof(binary_map::region_magic));
+	H.version = binary_map::version;
+	H.byte_order = binary_map::byte_order;
+	H.resX = resX;
+	H.resY = resY;
+	H.dimX = dimX;
+	H.dimY = dimY;
+	H.region_cells = rc;
+	H.regionsX = (resX + rc - 1)/rc;
+	H.regionsY = (resY + rc - 1)/rc;
+	H.table_offset = binary_map::align(sizeof(binary_map::region_header));
+
+	const size_t n_regions = H.regionsX*H.regionsY;
+
+	// The segments of every region: those rasterised into its cells.
+	// The box of the region is enlarged so that none is missed.
+	vector<vector<size_t> > region_segments(n_regions);
+	const vec2 margin(lenX + wall_thickness, lenY + wall_thickness);
+	for (size_t ry = 0; ry < H.regionsY; ++ry) {
+		for (size_t rx = 0; rx < H.regionsX; ++rx) {
+			const vec2 lo(rx*rc*lenX, ry*rc*lenY);
+			const vec2 hi((rx + 1)*rc*lenX, (ry + 1)*rc*lenY);
+			vector<size_t>& ids = region_segments[ry*H.regionsX + rx];
+			si.query_aabb(lo - margin, hi + margin, ids);
+			std::sort(ids.begin(), ids.end());
+		}
+	}
+
+	vector<binary_map::region_entry> table(n_regions);
+	uint64_t end = H.table_offset + n_regions*sizeof(binary_map::region_entry);
+	for (size_t r = 0; r < n_regions; ++r) {
+		table[r].n_segments = region_segments[r].size();
+		table[r].segments_offset = binary_map::align(end);
+		end = table[r].segments_offset + 4*sizeof(float)*table[r].n_segments;
+		table[r].tile_offset = binary_map::align(end);
+		end = table[r].tile_offset + rc*rc*sizeof(float);
+	}
+
+	fout.write(reinterpret_cast<const char *>(&H), sizeof(H));
+	fout.seekp(H.table_offset);
+	fout.write(reinterpret_cast<const char *>(&table[0]),
+			   n_regions*sizeof(binary_map::region_entry));
+
+	// the distance to the walls enclosing the terrain
+	// is also taken into account in the regular grid
+	vector<segment> all_segments = sgs;
+	for (const segment& s : outer_walls()) {
+		all_segments.push_back(s);
+	}
+	spatial_index all;
+	all.init(dimX, dimY, all_segments);
+
+	vector<float> tile(rc*rc);
+	for (size_t r = 0; r < n_regions; ++r) {
+		const int x0 = static_cast<int>((r%H.regionsX)*rc);
+		const int y0 = static_cast<int>((r/H.regionsX)*rc);
+
+		fout.seekp(table[r].segments_offset);
+		for (size_t i : region_segments[r]) {
+			const segment& s = sgs[i];
+			const float xy[4] = {s.first.x, s.first.y, s.second.x, s.second.y};
+			fout.write(reinterpret_cast<const char *>(xy), sizeof(xy));
+		}
+
+		// distance from the centre of every cell to the closest segment
+		const int _rc = static_cast<int>(rc);
+		#pragma omp parallel for
+		for (int y = 0; y < _rc; ++y) {
+			for (int x = 0; x < _rc; ++x) {
+				const size_t gx = x0 + x;
+				const size_t gy = y0 + y;
+				float d = 0.0f;
+				if (gx < resX and gy < resY) {
+					all.nearest_segment(vec2(lenX*gx + lenX/2.0f, lenY*gy + lenY/2.0f), d);
+				}
+				tile[y*rc + x] = d;
+			}
+		}
+
+		// the cells of the segments have value 0 (see
+		// regular_grid::rasterise_segment)
+		auto set_cell =
+		[&](int x, int y) {
+			if (x0 <= x and x < x0 + _rc and y0 <= y and y < y0 + _rc) {
+				tile[(y - y0)*rc + (x - x0)] = 0.0f;
+			}
+		};
+		auto lattice =
+		[&](const vec2& v) {
+			latticePoint p(static_cast<int>(v.x/lenX), static_cast<int>(v.y/lenY));
+			p.x() = std::min(std::max(p.x(), 0), static_cast<int>(resX) - 1);
+			p.y() = std::min(std::max(p.y(), 0), static_cast<int>(resY) - 1);
+			return p;
+		};
+		for (size_t i : region_segments[r]) {
+			const segment& s = sgs[i];
+			if (wall_thickness > 0.0f) {
+				grid_traversal::for_each_cell_capsule(
+					s.first, s.second, 0.5f*wall_thickness, lenX, lenY,
+					static_cast<int>(resX), static_cast<int>(resY),
+					set_cell
+				);
+			}
+			else {
+				grid_traversal::for_each_cell(lattice(s.first), lattice(s.second), set_cell);
+			}
+		}
+
+		// the cells inside the polygons are negative (see
+		// regular_grid::fill_polygon)
+		for (const vector<vec2>& poly : polygons) {
+			grid_traversal::for_each_cell_polygon(
+				poly, lenX, lenY, static_cast<int>(resX), static_cast<int>(resY),
+				[&](int x, int y) {
+					if (x0 <= x and x < x0 + _rc and y0 <= y and y < y0 + _rc) {
+						float& v = tile[(y - y0)*rc + (x - x0)];
+						if (v > 0.0f) {
+							v = -v;
+						}
+					}
+				}
+			);
+		}
+
+		fout.seekp(table[r].tile_offset);
+		fout.write(reinterpret_cast<const char *>(&tile[0]), rc*rc*sizeof(float));
+	}
+
+	if (not fout) {
+		cerr << "terrain::write_region_map - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not write file: '" << filename << "'" << endl;
+		return false;
+	}
+	fout.close();
 	return true;
 }
 
@@ -23,12 +23,21 @@
 
 // C++ includes
 #include <utility>
+#include <fstream>
 #include <string>
 #include <vector>
 
 // anim includes
 #include <anim/definitions.hpp>
+#include <anim/utils/mapped_file.hpp>
+#include <anim/utils/file_watcher.hpp>
+#include <anim/utils/bitmask.hpp>
+#include <anim/terrain/binary_map.hpp>
+#include <anim/terrain/spatial_index.hpp>
 #include <anim/terrain/regular_grid.hpp>
+#include <anim/terrain/navmesh.hpp>
+#include <anim/terrain/visibility_graph.hpp>
+#include <anim/terrain/medial_axis.hpp>
 
 namespace charanim {
 
@@ -37,7 +46,13 @@ enum class path_finder_type : int8_t {
 	/// Null type
 	none = 0,
 	/// Regular grid, see @ref regular_grid.
-	regular_grid
+	regular_grid,
+	/// Navigation mesh, see @ref navmesh.
+	navmesh,
+	/// Visibility graph, see @ref visibility_graph.
+	visibility_graph,
+	/// Medial axis of a regular grid, see @ref medial_axis.
+	medial_axis
 };
 
 /**
@@ -47,14 +62,114 @@ class terrain {
 	private:
 		/// The segments of the terrain.
 		std::vector<segment> sgs;
+		/**
+		 * @brief The polygonal obstacles of the terrain.
+		 *
+		 * Solid obstacles: their edges are also in @ref sgs, and the
+		 * cells of the regular grid inside them have negative values
+		 * (see @ref regular_grid::fill_polygon).
+		 */
+		std::vector<std::vector<vec2> > polygons;
+		/**
+		 * @brief Spatial index over the segments of the terrain.
+		 *
+		 * Built in @ref read_map.
+		 */
+		spatial_index si;
 
 		/// Dimension in the x-axis.
 		float dimX;
 		/// Dimension in the y-axis.
 		float dimY;
 
+		/// Number of cells in the x-axis (for grid-based path finders).
+		size_t resX;
+		/// Number of cells in the y-axis (for grid-based path finders).
+		size_t resY;
+		/// Thickness of the walls rasterised in the regular grid.
+		float wall_thickness;
+		/**
+		 * @brief Tolerance of the simplification of the segments.
+		 *
+		 * See @ref simplify_segments. 0 to keep the segments as they
+		 * are read.
+		 */
+		float simplify_tolerance;
+		/// Number of segments removed by the simplification.
+		size_t removed_segments;
+
+		/// Type of path finder used in @ref find_path.
+		path_finder_type pf_type;
+
 		/// Underlying data structure for path finding.
 		regular_grid *rg;
+		/// Underlying data structure for path finding.
+		navmesh *nm;
+		/// Underlying data structure for path finding.
+		visibility_graph *vg;
+		/**
+		 * @brief Underlying data structure for path finding.
+		 *
+		 * Built from @ref rg.
+		 */
+		medial_axis *ma;
+
+		/// Binary map file, mapped into memory (see @ref read_map).
+		mapped_file map_file;
+		/**
+		 * @brief Header of the binary map in @ref map_file.
+		 *
+		 * Null if the map was not read from a binary map.
+		 */
+		const binary_map::header *map_header;
+
+		/// Text map file read in @ref read_map, empty if none.
+		std::string map_filename;
+		/// Watches @ref map_filename (see @ref watch_map).
+		file_watcher watcher;
+
+	private:
+
+		/**
+		 * @brief Returns the segments enclosing the terrain from the
+		 * outside.
+		 *
+		 * The values of the cells of the regular grid also take into
+		 * account the distance to these segments.
+		 */
+		std::vector<segment> outer_walls() const;
+
+		/**
+		 * @brief Simplifies the segments, adds the edges of the polygons
+		 * and the walls of the quadrilateral enclosing the terrain to
+		 * @ref sgs, and builds the spatial index.
+		 *
+		 * The path finders, the physics and the renderer all use the
+		 * simplified segments. The edges of the polygons are not
+		 * simplified.
+		 */
+		void enclose();
+
+		/**
+		 * @brief Reads a text map.
+		 *
+		 * Reads the keywords of the map (see @ref read_map) and encloses
+		 * the terrain (see @ref enclose). No path finder is built.
+		 * @param fin Stream of the map file.
+		 * @return Returns true on success.
+		 */
+		bool read_text_map(std::ifstream& fin);
+
+		/**
+		 * @brief Reads a binary map.
+		 *
+		 * The file is mapped into memory. The segments are copied into
+		 * @ref sgs. The grid section, if any, is used by the regular grid
+		 * without copying it.
+		 * @param filename File with a binary map (see @ref binary_map).
+		 * @return Returns true on success.
+		 */
+		bool read_binary_map(const std::string& filename);
 
 	public:
 		/// Default constructor.
@@ -67,10 +182,91 @@ class terrain {
 		/// Clears the underlying structure for path finding.
 		void clear();
 
+		/**
+		 * @brief Initialises this terrain with the given segments.
+		 *
+		 * The current representation of this terrain is cleared. The
+		 * segments are simplified and the walls enclosing the terrain
+		 * are added to them, as in @ref read_map, but no path finder is
+		 * built (see @ref make_path_finder).
+		 * @param type Path finder used in @ref find_path.
+		 * @param cellsx Number of cells in the x-axis.
+		 * @param cellsy Number of cells in the y-axis.
+		 * @param dx Dimension in the x-axis.
+		 * @param dy Dimension in the y-axis.
+		 * @param segs Segments of the terrain (see @ref map_generator).
+		 */
+		void init(
+			path_finder_type type, size_t cellsx, size_t cellsy,
+			float dx, float dy, const std::vector<segment>& segs
+		);
+
+		/**
+		 * @brief Builds the data structure of a path finder.
+		 *
+		 * Builds the structure for @e type using the segments of this
+		 * terrain, if it was not built yet. This function is called by
+		 * @ref read_map, but can also be used to build other path finders
+		 * on the same map (for example, to compare them).
+		 *
+		 * The medial axis needs the regular grid, which is also built.
+		 *
+		 * If the map was read from a binary map with a grid section the
+		 * regular grid uses it instead of being built.
+		 * @param type Path finder to be built.
+		 * @return Returns true on success.
+		 */
+		bool make_path_finder(path_finder_type type);
+
+		/**
+		 * @brief Starts watching the map file for modifications.
+		 *
+		 * Only text maps read with @ref read_map can be watched. See
+		 * @ref map_modified and @ref reload_map.
+		 * @return Returns true on success.
+		 */
+		bool watch_map();
+
+		/**
+		 * @brief Reads the map file again and applies the changes.
+		 *
+		 * The new segments are compared to the current ones, and only
+		 * the segments added and removed are applied to the regular grid
+		 * (see @ref regular_grid::update_segments). The other path finders
+		 * built are rebuilt. If the file is not a valid map, this terrain
+		 * is not modified.
+		 *
+		 * If the resolution, the dimensions or the thickness of the walls
+		 * changed, the path finders are built from scratch on the new
+		 * map, and replace the current ones only if they are built: the
+		 * pointers to the path finders are then no longer valid.
+		 * @param[out] changed Cells covered by the segments removed or
+		 * added, and the cells of the regular grid whose value changed
+		 * (all of them if the map was read from scratch). Use
+		 * @ref path_touches to find the paths to be invalidated.
+		 * @return Returns true on success.
+		 */
+		bool reload_map(bitmask& changed);
+
 		// SETTERS
 
+		/**
+		 * @brief Sets the path finder used in @ref find_path.
+		 *
+		 * The path finder must have been built with @ref make_path_finder.
+		 */
+		void set_path_finder_type(path_finder_type type);
+
 		// GETTERS
 
+		/**
+		 * @brief Has the map file been modified?
+		 *
+		 * True if the file watched (see @ref watch_map) was written since
+		 * the last call. Does not block.
+		 */
+		bool map_modified();
+
 		/**
 		 * @brief Returns the segments of this terrain.
 		 *
@@ -81,22 +277,148 @@ class terrain {
 		 * @return Returns a constant reference to @ref sgs.
 		 */
 		const std::vector<segment>& get_segments() const;
+		/**
+		 * @brief Returns the polygonal obstacles of this terrain.
+		 *
+		 * Their edges are among the segments (see @ref get_segments).
+		 */
+		const std::vector<std::vector<vec2> >& get_polygons() const;
+
+		/**
+		 * @brief Does a path touch any of the cells given?
+		 *
+		 * A cell is touched if it has a point at distance at most @e R
+		 * from the polyline of the path (see
+		 * @ref grid_traversal::for_each_cell_capsule).
+		 * @param path Path, for example, one found with @ref find_path.
+		 * @param R Radius of the agent following the path.
+		 * @param cells Cells of the regular grid (see @ref reload_map).
+		 */
+		bool path_touches
+		(const std::vector<vec2>& path, float R, const bitmask& cells) const;
+		/**
+		 * @brief Returns the spatial index over the segments.
+		 *
+		 * Use it to find the segments near a point or crossed by a
+		 * segment without scanning all of them.
+		 */
+		const spatial_index& get_spatial_index() const;
+		/**
+		 * @brief Returns the number of segments removed when reading
+		 * the map.
+		 *
+		 * Collinear pieces of walls are merged, and walls of length
+		 * zero are removed (see @ref simplify_segments).
+		 */
+		size_t get_n_removed_segments() const;
+
+		/// Returns the continuous dimension in the x-axis.
+		float get_dimX() const;
+		/// Returns the continuous dimension in the y-axis.
+		float get_dimY() const;
+
+		/// Returns the type of path finder used in @ref find_path.
+		path_finder_type get_path_finder_type() const;
 
 		/// Returns the underlying path finder.
 		regular_grid *get_regular_grid();
 		/// Returns the underlying path finder.
 		const regular_grid *get_regular_grid() const;
 
+		/// Returns the underlying path finder.
+		navmesh *get_navmesh();
+		/// Returns the underlying path finder.
+		const navmesh *get_navmesh() const;
+
+		/// Returns the underlying path finder.
+		visibility_graph *get_visibility_graph();
+		/// Returns the underlying path finder.
+		const visibility_graph *get_visibility_graph() const;
+
+		/// Returns the underlying path finder.
+		medial_axis *get_medial_axis();
+		/// Returns the underlying path finder.
+		const medial_axis *get_medial_axis() const;
+
+		/**
+		 * @brief Fins a path between two points.
+		 *
+		 * Uses the path finder specified in the map file (see
+		 * @ref read_map), or the one set with @ref set_path_finder_type.
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Non-refined path.
+		 * @param[out] smooth_path Refined path.
+		 */
+		void find_path(
+			const vec2& source, const vec2& sink,
+			float R,
+			std::vector<vec2>& path,
+			std::vector<vec2>& smoothed_path
+		);
+
 		// I/O
 
 		/**
 		 * @brief Reads map from a file.
 		 *
 		 * The current representation of this terrain is cleared.
+		 *
+		 * The file is either a text file with keywords or a binary map
+		 * (see @ref binary_map and @ref write_binary_map). The segments
+		 * of text files are simplified (see @ref simplify_tolerance);
+		 * those of binary maps are used as they were written.
+		 *
+		 * Text files contain lines with these keywords:
+		 * - type TYPE
+		 * - resolution RX RY
+		 * - dimensions DX DY
+		 * - wall_thickness W
+		 * - simplify_tolerance E
+		 * - wall X1 Y1 X2 Y2
+		 * - polygon N X1 Y1 ... XN YN: a solid obstacle with @e N
+		 * vertices (see @ref polygons).
 		 * @param filename File describing the map.
 		 * @return Returns true on success.
 		 */
 		bool read_map(const std::string& filename);
+
+		/**
+		 * @brief Writes this map into a text file.
+		 *
+		 * The file can be read with @ref read_map. The walls enclosing
+		 * the terrain are not written.
+		 * @param filename Map file.
+		 * @return Returns true on success.
+		 */
+		bool write_map(const std::string& filename) const;
+
+		/**
+		 * @brief Writes this map into a binary file.
+		 *
+		 * The file can be read with @ref read_map.
+		 * @param filename Binary map file.
+		 * @param with_grid Write the state of the regular grid so that
+		 * it does not need to be built when reading the map. The regular
+		 * grid must have been built.
+		 * @return Returns true on success.
+		 */
+		bool write_binary_map(const std::string& filename, bool with_grid) const;
+
+		/**
+		 * @brief Writes this map into a region map.
+		 *
+		 * The cells of the regular grid of this map are split into square
+		 * regions that can be loaded independently (see
+		 * @ref streamed_grid). The values of the cells are computed one
+		 * region at a time, so the regular grid need not be built. They
+		 * are equal to the values of the cells of the regular grid.
+		 * @param filename Region map file (see @ref binary_map).
+		 * @param region_cells Number of cells of the side of every region.
+		 * @return Returns true on success.
+		 */
+		bool write_region_map(const std::string& filename, size_t region_cells) const;
 };
 
 } // -- namespace charanim
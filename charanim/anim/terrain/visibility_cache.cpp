@@ -0,0 +1,432 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/visibility_cache.hpp>
+
+// C++ includes
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+// charanim includes
+#include <anim/terrain/binary_map.hpp>
+
+namespace charanim {
+
+// number of rows of the matrix computed at the same time
+#define BATCH_ROWS 64
+
+// hash of a block of bits
+static inline
+uint64_t block_hash(const uint64_t *b) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (size_t k = 0; k < visibility_cache::block_words; ++k) {
+		h = (h ^ b[k])*0x100000001b3ULL;
+	}
+	return h;
+}
+
+// PRIVATE
+
+void visibility_cache::build(const regular_grid *rg) {
+	const size_t m = samples.size();
+	const float lenX = rg->get_dimX()/rg->get_resX();
+	const float lenY = rg->get_dimY()/rg->get_resY();
+	const float *cells = rg->get_grid();
+
+	// samples where an agent can't stand see nothing
+	vector<char> free_sample(m, 0);
+	for (size_t i = 0; i < m; ++i) {
+		const size_t cx = min(static_cast<size_t>(samples[i].x/lenX), resX - 1);
+		const size_t cy = min(static_cast<size_t>(samples[i].y/lenY), resY - 1);
+		free_sample[i] = (cells[cy*resX + cx] > R);
+	}
+
+	blocks_per_row = max(size_t(1), (m + block_bits - 1)/block_bits);
+	index_store.assign(m*blocks_per_row, 0);
+	// the first block of the pool is the empty block
+	pool_store.assign(block_words, 0);
+	n_blocks = 1;
+	index = index_store.data();
+	pool = pool_store.data();
+
+	// blocks of the pool by their hash
+	unordered_map<uint64_t, uint32_t> block_of;
+	const size_t row_words = blocks_per_row*block_words;
+	const float max_dist2 = max_dist*max_dist;
+	vector<uint64_t> dense;
+
+	for (size_t b0 = 0; b0 < m; b0 += BATCH_ROWS) {
+		const size_t b1 = min(m, b0 + BATCH_ROWS);
+		dense.assign((b1 - b0)*row_words, 0);
+
+		const int first = static_cast<int>(b0);
+		const int last = static_cast<int>(b1);
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int _i = first; _i < last; ++_i) {
+			const size_t i = static_cast<size_t>(_i);
+			if (not free_sample[i]) {
+				continue;
+			}
+			uint64_t *row = &dense[(i - b0)*row_words];
+
+			// rows of previous batches are already compressed
+			for (size_t j = 0; j < b0; ++j) {
+				if (visible(j, i)) {
+					row[j/64] |= uint64_t(1) << (j%64);
+				}
+			}
+			for (size_t j = b0; j < m; ++j) {
+				if (not free_sample[j]) {
+					continue;
+				}
+				// cast always from the smallest index so that
+				// the matrix is symmetric
+				const vec2& p = samples[min(i, j)];
+				const vec2& q = samples[max(i, j)];
+				const vec2 d = q - p;
+				const float L2 = d.x*d.x + d.y*d.y;
+				if (L2 > max_dist2) {
+					continue;
+				}
+				bool vis = true;
+				if (L2 > 0.0f) {
+					const float L = std::sqrt(L2);
+					vis = rg->raycast(p, d*(1.0f/L), L, R) >= L;
+				}
+				if (vis) {
+					row[j/64] |= uint64_t(1) << (j%64);
+				}
+			}
+		}
+
+		// store the blocks of the batch in the pool
+		for (size_t i = b0; i < b1; ++i) {
+			for (size_t k = 0; k < blocks_per_row; ++k) {
+				const uint64_t *blk = &dense[(i - b0)*row_words + k*block_words];
+				bool empty = true;
+				for (size_t w = 0; w < block_words and empty; ++w) {
+					empty = (blk[w] == 0);
+				}
+				if (empty) {
+					continue;
+				}
+
+				const uint64_t h = block_hash(blk);
+				auto it = block_of.find(h);
+				if (it != block_of.end() and
+					memcmp(&pool_store[it->second*block_words], blk,
+						   block_words*sizeof(uint64_t)) == 0)
+				{
+					index_store[i*blocks_per_row + k] = it->second;
+					continue;
+				}
+				pool_store.insert(pool_store.end(), blk, blk + block_words);
+				block_of[h] = static_cast<uint32_t>(n_blocks);
+				index_store[i*blocks_per_row + k] = static_cast<uint32_t>(n_blocks);
+				++n_blocks;
+			}
+		}
+		pool = pool_store.data();
+	}
+}
+
+// PUBLIC
+
+visibility_cache::visibility_cache() {
+	index = nullptr;
+	pool = nullptr;
+	blocks_per_row = n_blocks = 0;
+	resX = resY = 0;
+	dimX = dimY = 0.0f;
+	stride = samplesX = samplesY = 0;
+	R = max_dist = 0.0f;
+}
+
+visibility_cache::~visibility_cache() {
+	clear();
+}
+
+// MODIFIERS
+
+void visibility_cache::init
+(const regular_grid *rg, size_t _stride, float _R, float _max_dist)
+{
+	clear();
+	resX = rg->get_resX();
+	resY = rg->get_resY();
+	dimX = rg->get_dimX();
+	dimY = rg->get_dimY();
+	stride = max(size_t(1), _stride);
+	R = _R;
+	max_dist = _max_dist;
+
+	const float lenX = dimX/resX;
+	const float lenY = dimY/resY;
+	samplesX = (resX + stride - 1)/stride;
+	samplesY = (resY + stride - 1)/stride;
+	samples.resize(samplesX*samplesY);
+	for (size_t sy = 0; sy < samplesY; ++sy) {
+		const size_t cy = min(sy*stride + stride/2, resY - 1);
+		for (size_t sx = 0; sx < samplesX; ++sx) {
+			const size_t cx = min(sx*stride + stride/2, resX - 1);
+			samples[sy*samplesX + sx] = vec2((cx + 0.5f)*lenX, (cy + 0.5f)*lenY);
+		}
+	}
+	build(rg);
+}
+
+void visibility_cache::init(
+	const regular_grid *rg, const vector<vec2>& points,
+	float _R, float _max_dist
+)
+{
+	clear();
+	resX = rg->get_resX();
+	resY = rg->get_resY();
+	dimX = rg->get_dimX();
+	dimY = rg->get_dimY();
+	R = _R;
+	max_dist = _max_dist;
+	samples = points;
+	build(rg);
+}
+
+void visibility_cache::clear() {
+	samples.clear();
+	index_store.clear();
+	pool_store.clear();
+	file.close();
+	index = nullptr;
+	pool = nullptr;
+	blocks_per_row = n_blocks = 0;
+	stride = samplesX = samplesY = 0;
+}
+
+// GETTERS
+
+int visibility_cache::sample_of(const vec2& p) const {
+	if (stride == 0 or p.x < 0.0f or p.y < 0.0f or p.x >= dimX or p.y >= dimY) {
+		return -1;
+	}
+	const size_t cx = min(static_cast<size_t>(p.x/(dimX/resX)), resX - 1);
+	const size_t cy = min(static_cast<size_t>(p.y/(dimY/resY)), resY - 1);
+	return static_cast<int>((cy/stride)*samplesX + cx/stride);
+}
+
+bool visibility_cache::visible(const vec2& a, const vec2& b) const {
+	const int i = sample_of(a);
+	const int j = sample_of(b);
+	if (i == -1 or j == -1 or
+		static_cast<size_t>(i) >= samples.size() or
+		static_cast<size_t>(j) >= samples.size())
+	{
+		return false;
+	}
+	return visible(static_cast<size_t>(i), static_cast<size_t>(j));
+}
+
+size_t visibility_cache::n_samples() const {
+	return samples.size();
+}
+
+const vec2& visibility_cache::get_sample(size_t i) const {
+	return samples[i];
+}
+
+float visibility_cache::get_radius() const {
+	return R;
+}
+
+size_t visibility_cache::get_stride() const {
+	return stride;
+}
+
+float visibility_cache::get_max_dist() const {
+	return max_dist;
+}
+
+size_t visibility_cache::get_n_blocks() const {
+	return n_blocks;
+}
+
+size_t visibility_cache::get_bytes() const {
+	return samples.size()*blocks_per_row*sizeof(uint32_t) +
+		   n_blocks*block_words*sizeof(uint64_t);
+}
+
+size_t visibility_cache::get_dense_bytes() const {
+	return samples.size()*((samples.size() + 63)/64)*sizeof(uint64_t);
+}
+
+// I/O
+
+bool visibility_cache::write(const string& filename) const {
+	ofstream fout;
+	fout.open(filename.c_str(), ios::binary);
+	if (not fout.is_open()) {
+		cerr << "visibility_cache::write - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not open file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	binary_map::visibility_header H;
+	memset(&H, 0, sizeof(H));
+	memcpy(H.magic, binary_map::visibility_magic, sizeof(binary_map::visibility_magic));
+	H.version = binary_map::version;
+	H.byte_order = binary_map::byte_order;
+	H.resX = resX;
+	H.resY = resY;
+	H.dimX = dimX;
+	H.dimY = dimY;
+	H.R = R;
+	H.max_dist = max_dist;
+	H.stride = stride;
+	H.n_samples = samples.size();
+	H.n_blocks = n_blocks;
+
+	const uint64_t index_size = samples.size()*blocks_per_row*sizeof(uint32_t);
+	H.samples_offset = binary_map::align(sizeof(H));
+	H.index_offset = binary_map::align(H.samples_offset + 2*sizeof(float)*H.n_samples);
+	H.pool_offset = binary_map::align(H.index_offset + index_size);
+
+	fout.write(reinterpret_cast<const char *>(&H), sizeof(H));
+	fout.seekp(H.samples_offset);
+	for (const vec2& p : samples) {
+		const float xy[2] = {p.x, p.y};
+		fout.write(reinterpret_cast<const char *>(xy), sizeof(xy));
+	}
+	fout.seekp(H.index_offset);
+	fout.write(reinterpret_cast<const char *>(index), index_size);
+	fout.seekp(H.pool_offset);
+	fout.write(reinterpret_cast<const char *>(pool), n_blocks*block_words*sizeof(uint64_t));
+
+	if (not fout) {
+		cerr << "visibility_cache::write - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not write file: '" << filename << "'" << endl;
+		return false;
+	}
+	fout.close();
+	return true;
+}
+
+bool visibility_cache::read(const string& filename, const regular_grid *rg) {
+	clear();
+	if (not file.open(filename)) {
+		return false;
+	}
+	const char *data = file.get_data();
+	const uint64_t size = file.get_size();
+
+	// is the range [o, o + n) inside the file?
+	auto in_file =
+	[&](uint64_t o, uint64_t n) -> bool {
+		return o <= size and n <= size - o;
+	};
+	// is the array of n elements of 'elem' bytes at o inside the file?
+	auto array_in_file =
+	[&](uint64_t o, uint64_t n, uint64_t elem) -> bool {
+		return n <= size/elem and in_file(o, n*elem);
+	};
+
+	const binary_map::visibility_header *H =
+		reinterpret_cast<const binary_map::visibility_header *>(data);
+
+	if (size < sizeof(binary_map::visibility_header) or
+		memcmp(H->magic, binary_map::visibility_magic, sizeof(H->magic)) != 0 or
+		H->version != binary_map::version or
+		H->byte_order != binary_map::byte_order)
+	{
+		cerr << "visibility_cache::read - Error (" << __LINE__ << "):" << endl;
+		cerr << "    File '" << filename << "' is not a visibility cache" << endl;
+		file.close();
+		return false;
+	}
+	if (H->resX != rg->get_resX() or H->resY != rg->get_resY() or
+		H->dimX != rg->get_dimX() or H->dimY != rg->get_dimY())
+	{
+		cerr << "visibility_cache::read - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Visibility cache '" << filename << "' was built on another grid" << endl;
+		file.close();
+		return false;
+	}
+
+	const uint64_t bpr = max(uint64_t(1), (H->n_samples + block_bits - 1)/block_bits);
+	// n_samples*bpr entries of the index must fit in the file
+	const bool fits = H->n_samples == 0 or bpr <= size/H->n_samples;
+	const uint64_t n_entries = (fits ? H->n_samples*bpr : 0);
+	bool valid =
+		fits and
+		array_in_file(H->samples_offset, H->n_samples, 2*sizeof(float)) and
+		array_in_file(H->index_offset, n_entries, sizeof(uint32_t)) and
+		array_in_file(H->pool_offset, H->n_blocks, block_words*sizeof(uint64_t)) and
+		H->index_offset%sizeof(uint32_t) == 0 and
+		H->pool_offset%sizeof(uint64_t) == 0;
+
+	// the samples of a cache built with a stride are its cells
+	if (H->stride > 0) {
+		const uint64_t sX = (H->resX + H->stride - 1)/H->stride;
+		const uint64_t sY = (H->resY + H->stride - 1)/H->stride;
+		valid = valid and H->n_samples == sX*sY;
+	}
+
+	// every entry of the index is a block of the pool
+	const uint32_t *I = reinterpret_cast<const uint32_t *>(data + H->index_offset);
+	for (uint64_t e = 0; valid and e < n_entries; ++e) {
+		valid = I[e] < H->n_blocks;
+	}
+	if (not valid) {
+		cerr << "visibility_cache::read - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Visibility cache '" << filename << "' is truncated or corrupt" << endl;
+		file.close();
+		return false;
+	}
+
+	resX = H->resX;
+	resY = H->resY;
+	dimX = H->dimX;
+	dimY = H->dimY;
+	R = H->R;
+	max_dist = H->max_dist;
+	stride = H->stride;
+	if (stride > 0) {
+		samplesX = (resX + stride - 1)/stride;
+		samplesY = (resY + stride - 1)/stride;
+	}
+
+	const float *S = reinterpret_cast<const float *>(data + H->samples_offset);
+	samples.resize(H->n_samples);
+	for (size_t i = 0; i < samples.size(); ++i) {
+		samples[i] = vec2(S[2*i], S[2*i + 1]);
+	}
+	blocks_per_row = bpr;
+	n_blocks = H->n_blocks;
+	index = I;
+	pool = reinterpret_cast<const uint64_t *>(data + H->pool_offset);
+	return true;
+}
+
+} // -- namespace charanim
@@ -0,0 +1,225 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// charanim includes
+#include <anim/definitions.hpp>
+#include <anim/utils/mapped_file.hpp>
+#include <anim/terrain/regular_grid.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Precomputed visibility between sample points of a grid.
+ *
+ * Answers "can an agent of radius @e R walk in a straight line from
+ * sample @e i to sample @e j" in constant time, without casting a ray
+ * through the grid (see @ref regular_grid::raycast). The samples are
+ * either the centres of every @e stride-th cell of the grid in both
+ * axes, or a given set of points (waypoints, portals between regions,
+ * ...).
+ *
+ * The visibility matrix is stored by rows, every row split into blocks
+ * of @ref block_bits bits. Equal blocks are stored once in a pool: rows
+ * of nearby samples are similar, and most blocks of a row are empty
+ * (samples far away, or beyond the maximum distance). The matrix is
+ * symmetric.
+ *
+ * Memory and accuracy are traded with the distance between samples
+ * (@e stride), and with the maximum distance between visible samples
+ * (@e max_dist): samples farther apart are never visible.
+ *
+ * The cache can be written to a file and mapped into memory (see
+ * @ref binary_map).
+ */
+class visibility_cache {
+	public:
+		/// Number of bits of a block.
+		static const size_t block_bits = 512;
+		/// Number of 64-bit words of a block.
+		static const size_t block_words = block_bits/64;
+
+	private:
+		/// Sample points.
+		std::vector<vec2> samples;
+		/**
+		 * @brief Block of every piece of every row.
+		 *
+		 * The @e k-th block of row @e i is the block of the pool
+		 * index[i*blocks_per_row + k].
+		 */
+		const uint32_t *index;
+		/// Blocks of bits, @ref block_words words each.
+		const uint64_t *pool;
+		/// Number of blocks of each row.
+		size_t blocks_per_row;
+		/// Number of blocks in the pool.
+		size_t n_blocks;
+
+		/// Storage of @ref index when built.
+		std::vector<uint32_t> index_store;
+		/// Storage of @ref pool when built.
+		std::vector<uint64_t> pool_store;
+		/// File of the cache when read.
+		mapped_file file;
+
+		/// Number of cells in the x-axis of the grid.
+		size_t resX;
+		/// Number of cells in the y-axis of the grid.
+		size_t resY;
+		/// Dimension in the x-axis.
+		float dimX;
+		/// Dimension in the y-axis.
+		float dimY;
+		/// Distance in cells between samples, 0 if they were given.
+		size_t stride;
+		/// Number of samples in the x-axis (if @ref stride > 0).
+		size_t samplesX;
+		/// Number of samples in the y-axis (if @ref stride > 0).
+		size_t samplesY;
+		/// Radius of the agents.
+		float R;
+		/// Maximum distance between visible samples.
+		float max_dist;
+
+	private:
+		/**
+		 * @brief Computes the visibility matrix.
+		 *
+		 * The rows are computed in parallel, in batches. Pairs of
+		 * samples of earlier batches are looked up instead of cast.
+		 * @param rg Regular grid of the terrain.
+		 */
+		void build(const regular_grid *rg);
+
+	public:
+		/// Default constructor.
+		visibility_cache();
+		/// Destructor.
+		~visibility_cache();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Builds the cache with the cells of a grid as samples.
+		 *
+		 * The samples are the centres of the cells (k*stride + stride/2)
+		 * in both axes.
+		 * @param rg Regular grid of the terrain.
+		 * @param stride Distance in cells between samples.
+		 * @param R Radius of the agents.
+		 * @param max_dist Maximum distance between visible samples.
+		 */
+		void init(const regular_grid *rg, size_t stride, float R, float max_dist);
+		/**
+		 * @brief Builds the cache with the given samples.
+		 * @param rg Regular grid of the terrain.
+		 * @param points Sample points.
+		 * @param R Radius of the agents.
+		 * @param max_dist Maximum distance between visible samples.
+		 */
+		void init(
+			const regular_grid *rg, const std::vector<vec2>& points,
+			float R, float max_dist
+		);
+
+		/// Clears the memory occupied by this cache.
+		void clear();
+
+		// GETTERS
+
+		/**
+		 * @brief Can an agent see sample @e j from sample @e i?
+		 *
+		 * Equivalently, can it walk straight from one to the other.
+		 */
+		inline bool visible(size_t i, size_t j) const {
+			const uint32_t b = index[i*blocks_per_row + j/block_bits];
+			const uint64_t w = pool[b*block_words + (j%block_bits)/64];
+			return (w >> (j%64)) & 1;
+		}
+
+		/**
+		 * @brief Returns the sample closest to @e p.
+		 *
+		 * Only if the samples are the cells of the grid.
+		 * @return Returns -1 if the samples were given, or if @e p is out
+		 * of the grid.
+		 */
+		int sample_of(const vec2& p) const;
+
+		/**
+		 * @brief Can an agent see point @e b from point @e a?
+		 *
+		 * Approximated with the visibility between the samples closest
+		 * to the points (see @ref sample_of). The error is at most the
+		 * distance between samples.
+		 */
+		bool visible(const vec2& a, const vec2& b) const;
+
+		/// Returns the number of samples.
+		size_t n_samples() const;
+		/// Returns the @e i-th sample.
+		const vec2& get_sample(size_t i) const;
+		/// Returns the radius of the agents.
+		float get_radius() const;
+		/// Returns the distance in cells between samples.
+		size_t get_stride() const;
+		/// Returns the maximum distance between visible samples.
+		float get_max_dist() const;
+
+		/// Returns the number of blocks of the pool.
+		size_t get_n_blocks() const;
+		/// Returns the amount of bytes used by the matrix.
+		size_t get_bytes() const;
+		/// Returns the amount of bytes of the matrix without compression.
+		size_t get_dense_bytes() const;
+
+		// I/O
+
+		/**
+		 * @brief Writes this cache into a file.
+		 * @param filename Visibility cache file (see @ref binary_map).
+		 * @return Returns true on success.
+		 */
+		bool write(const std::string& filename) const;
+
+		/**
+		 * @brief Reads a cache from a file.
+		 *
+		 * The file is mapped into memory: the matrix is not copied. The
+		 * index is checked once: every entry must be a block of the pool.
+		 * @param filename Visibility cache file.
+		 * @param rg Regular grid of the terrain. The cache must have
+		 * been built on a grid with the same resolution and dimensions.
+		 * @return Returns true on success.
+		 */
+		bool read(const std::string& filename, const regular_grid *rg);
+};
+
+} // -- namespace charanim
@@ -0,0 +1,299 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/terrain/visibility_graph.hpp>
+
+// C++ includes
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <cmath>
+using namespace std;
+
+// physim includes
+#include <physim/math/vec2.hpp>
+
+namespace charanim {
+
+#define MAX_DINF numeric_limits<double>::max()
+#define vec2_out(c) "(" << c.x << "," << c.y << ")"
+
+// default size of the radius classes
+#define DEFAULT_RADIUS_STEP 0.25f
+// maximum angle between consecutive nodes around an endpoint
+#define NODE_ANGLE_STEP (M_PI/4.0)
+
+// PRIVATE
+
+bool visibility_graph::is_free(const vec2& a, const vec2& b, float R) const {
+	return not index->segment_intersects(a, b, R);
+}
+
+void visibility_graph::make_graph(float R, graph& G) const {
+	G.R = R;
+	G.nodes.clear();
+	G.adj.clear();
+
+	// group the endpoints of the segments by position, and keep
+	// the angle of the segments leaving from each endpoint
+	struct endpoint {
+		long long kx, ky;
+		vec2 p;
+		double angle;
+		inline bool operator< (const endpoint& e) const {
+			if (kx != e.kx) return kx < e.kx;
+			if (ky != e.ky) return ky < e.ky;
+			return angle < e.angle;
+		}
+	};
+	vector<endpoint> endpoints;
+	for (const segment& s : index->get_segments()) {
+		const vec2& a = s.first;
+		const vec2& b = s.second;
+		if (physim::math::dist(a,b) == 0.0f) {
+			continue;
+		}
+		endpoints.push_back(endpoint{
+			std::llround(a.x*1e3), std::llround(a.y*1e3), a,
+			std::atan2(double(b.y) - a.y, double(b.x) - a.x)
+		});
+		endpoints.push_back(endpoint{
+			std::llround(b.x*1e3), std::llround(b.y*1e3), b,
+			std::atan2(double(a.y) - b.y, double(a.x) - b.x)
+		});
+	}
+	std::sort(endpoints.begin(), endpoints.end());
+
+	// Place nodes around every endpoint, in the reflex angles left
+	// between consecutive segments. Consecutive nodes are at most
+	// NODE_ANGLE_STEP radians apart, and at a distance from the
+	// endpoint such that the chord between them keeps a distance R.
+	const float RR = 1.01f*R/std::cos(NODE_ANGLE_STEP/2.0);
+	size_t i = 0;
+	while (i < endpoints.size()) {
+		size_t j = i;
+		while (j < endpoints.size() and
+			   endpoints[j].kx == endpoints[i].kx and
+			   endpoints[j].ky == endpoints[i].ky)
+		{
+			++j;
+		}
+
+		const vec2& p = endpoints[i].p;
+		for (size_t k = i; k < j; ++k) {
+			double a1 = endpoints[k].angle;
+			double a2 = (k + 1 < j ? endpoints[k + 1].angle : endpoints[i].angle + 2*M_PI);
+			double gap = a2 - a1;
+			if (gap <= M_PI + 1e-6) {
+				continue;
+			}
+
+			size_t steps = static_cast<size_t>(std::ceil((gap - M_PI)/NODE_ANGLE_STEP));
+			for (size_t s = 0; s <= steps; ++s) {
+				double alpha = a1 + M_PI/2.0 + s*(gap - M_PI)/steps;
+				vec2 n = p + vec2(std::cos(alpha), std::sin(alpha))*RR;
+				if (0.0f < n.x and n.x < index->get_dimX() and
+					0.0f < n.y and n.y < index->get_dimY() and
+					is_free(n, n, R))
+				{
+					G.nodes.push_back(n);
+				}
+			}
+		}
+		i = j;
+	}
+
+	// connect the nodes that see each other
+	const size_t N = G.nodes.size();
+	vector<vector<size_t> > visible(N);
+
+	#pragma omp parallel for schedule(dynamic)
+	for (size_t u = 0; u < N; ++u) {
+		for (size_t v = u + 1; v < N; ++v) {
+			if (is_free(G.nodes[u], G.nodes[v], R)) {
+				visible[u].push_back(v);
+			}
+		}
+	}
+
+	G.adj = vector<vector<pair<size_t,float> > >(N);
+	for (size_t u = 0; u < N; ++u) {
+		for (size_t v : visible[u]) {
+			float d = physim::math::dist(G.nodes[u], G.nodes[v]);
+			G.adj[u].push_back(make_pair(v, d));
+			G.adj[v].push_back(make_pair(u, d));
+		}
+	}
+}
+
+// PUBLIC
+
+visibility_graph::visibility_graph() {
+	index = nullptr;
+	radius_step = DEFAULT_RADIUS_STEP;
+}
+
+visibility_graph::~visibility_graph() {
+	clear();
+}
+
+// MODIFIERS
+
+void visibility_graph::init(const spatial_index *idx) {
+	clear();
+	index = idx;
+}
+
+void visibility_graph::clear() {
+	index = nullptr;
+	cache.clear();
+}
+
+// SETTERS
+
+void visibility_graph::set_radius_step(float s) {
+	radius_step = s;
+	cache.clear();
+}
+
+// GETTERS
+
+const visibility_graph::graph& visibility_graph::get_graph(float R) {
+	int k = static_cast<int>(std::ceil(R/radius_step));
+	auto it = cache.find(k);
+	if (it == cache.end()) {
+		graph& G = cache[k];
+		make_graph(k*radius_step, G);
+		return G;
+	}
+	return it->second;
+}
+
+void visibility_graph::find_path(
+	const vec2& source, const vec2& sink,
+	float R,
+	vector<vec2>& path,
+	vector<vec2>& smoothed_path
+)
+{
+	if (not is_free(source, source, R)) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't start at " << vec2_out(source) << endl;
+		return;
+	}
+	if (not is_free(sink, sink, R)) {
+		cerr << "Error: a particle of radius " << R
+			 << " can't finish at " << vec2_out(sink) << endl;
+		return;
+	}
+
+	if (is_free(source, sink, R)) {
+		path.push_back(source);
+		path.push_back(sink);
+		smoothed_path = path;
+		return;
+	}
+
+	const graph& G = get_graph(R);
+	const size_t N = G.nodes.size();
+
+	// the source and the sink are nodes N and N + 1,
+	// connected to the nodes they can see
+	vector<float> from_sink(N, -1.0f);
+	#pragma omp parallel for
+	for (size_t u = 0; u < N; ++u) {
+		if (is_free(G.nodes[u], sink, R)) {
+			from_sink[u] = physim::math::dist(G.nodes[u], sink);
+		}
+	}
+
+	vector<double> cost_so_far(N + 2, MAX_DINF);
+	vector<size_t> parent(N + 2, N + 2);
+	vector<bool> closed(N + 2, false);
+
+	typedef pair<double,size_t> pq_elem;
+	priority_queue<pq_elem, vector<pq_elem>, greater<pq_elem> > OPEN;
+
+	auto relax =
+	[&](size_t u, size_t v, double d, const vec2& pv) {
+		double c = cost_so_far[u] + d;
+		if (c < cost_so_far[v]) {
+			cost_so_far[v] = c;
+			parent[v] = u;
+			OPEN.push(make_pair(c + physim::math::dist(pv, sink), v));
+		}
+	};
+
+	cost_so_far[N] = 0.0;
+	for (size_t u = 0; u < N; ++u) {
+		if (is_free(source, G.nodes[u], R)) {
+			relax(N, u, physim::math::dist(source, G.nodes[u]), G.nodes[u]);
+		}
+	}
+
+	while (OPEN.size() > 0) {
+		size_t u = OPEN.top().second;
+		OPEN.pop();
+		if (closed[u]) {
+			continue;
+		}
+		closed[u] = true;
+		if (u == N + 1) {
+			break;
+		}
+
+		if (from_sink[u] >= 0.0f) {
+			relax(u, N + 1, from_sink[u], sink);
+		}
+		for (const pair<size_t,float>& e : G.adj[u]) {
+			if (not closed[e.first]) {
+				relax(u, e.first, e.second, G.nodes[e.first]);
+			}
+		}
+	}
+
+	if (not closed[N + 1]) {
+		cerr << "Error: no path for a particle of radius " << R
+			 << " from " << vec2_out(source) << " to " << vec2_out(sink)
+			 << endl;
+		return;
+	}
+
+	// make path from sink to source and reverse
+	vector<vec2> rev;
+	rev.push_back(sink);
+	for (size_t u = parent[N + 1]; u != N; u = parent[u]) {
+		rev.push_back(G.nodes[u]);
+	}
+	rev.push_back(source);
+	path.insert(path.end(), rev.rbegin(), rev.rend());
+	smoothed_path.insert(smoothed_path.end(), rev.rbegin(), rev.rend());
+}
+
+float visibility_graph::get_dimX() const {
+	return index->get_dimX();
+}
+float visibility_graph::get_dimY() const {
+	return index->get_dimY();
+}
+
+} // -- namespace charanim
@@ -0,0 +1,146 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <map>
+
+// charanim includes
+#include <anim/definitions.hpp>
+#include <anim/terrain/spatial_index.hpp>
+
+namespace charanim {
+
+/**
+ * @brief Visibility graph for path finding.
+ *
+ * The nodes of the graph are placed around the endpoints of the segments
+ * of the terrain, at a distance slightly larger than the radius of the
+ * agent. Two nodes are connected if an agent can move in a straight line
+ * from one to the other without getting closer than its radius to any
+ * segment. Paths found in this graph are (almost) optimal and need not
+ * be smoothed.
+ *
+ * Since the graph depends on the radius of the agent, graphs are built
+ * on demand and cached per radius class: a radius @e R belongs to class
+ * \f$k = \lceil R/s \rceil\f$, where @e s is the radius step (see
+ * @ref set_radius_step), and the graph of class @e k is built for radius
+ * \f$k \cdot s\f$.
+ *
+ * Intersection tests are sped up with the spatial index of the terrain
+ * (see @ref spatial_index).
+ */
+class visibility_graph {
+	public:
+		/// The visibility graph for a radius class.
+		struct graph {
+			/// Radius for which the graph was built.
+			float R;
+			/// Position of the nodes.
+			std::vector<vec2> nodes;
+			/// Adjacency list: (neighbour, length of the edge).
+			std::vector<std::vector<std::pair<size_t,float> > > adj;
+		};
+
+	private:
+		/// Spatial index over the segments of the terrain.
+		const spatial_index *index;
+
+		/// Size of the radius classes.
+		float radius_step;
+		/// Graphs built so far, indexed by radius class.
+		std::map<int, graph> cache;
+
+	private:
+		/**
+		 * @brief Returns true if a disk of radius @e R can sweep from
+		 * @e a to @e b without touching any segment.
+		 */
+		bool is_free(const vec2& a, const vec2& b, float R) const;
+
+		/// Builds the graph for radius @e R.
+		void make_graph(float R, graph& G) const;
+
+	public:
+		/// Default constructor.
+		visibility_graph();
+		/// Destructor.
+		~visibility_graph();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Initialises the structure.
+		 *
+		 * Graphs are built on demand in @ref find_path.
+		 * @param index Spatial index over the segments of the terrain,
+		 * including the walls enclosing it. It must stay valid as long
+		 * as this structure is used.
+		 */
+		void init(const spatial_index *index);
+
+		/// Clears the memory occupied by this structure.
+		void clear();
+
+		// SETTERS
+
+		/**
+		 * @brief Sets the size of the radius classes.
+		 *
+		 * Clears the graphs built so far.
+		 */
+		void set_radius_step(float s);
+
+		// GETTERS
+
+		/**
+		 * @brief Returns the graph for agents of radius @e R.
+		 *
+		 * Builds it if needed.
+		 */
+		const graph& get_graph(float R);
+
+		/**
+		 * @brief Fins a path between two points.
+		 * @param[in] source Starting point.
+		 * @param[in] sink Goal point.
+		 * @param[in] R Minimum distance between the path and fixed obstacles.
+		 * @param[out] path Path found: sequence of nodes of the graph.
+		 * @param[out] smooth_path Same as @e path.
+		 */
+		void find_path(
+			const vec2& source, const vec2& sink,
+			float R,
+			std::vector<vec2>& path,
+			std::vector<vec2>& smoothed_path
+		);
+
+		/// Returns the continuous dimension in the x-axis
+		float get_dimX() const;
+		/// Returns the continuous dimension in the y-axis
+		float get_dimY() const;
+};
+
+} // -- namespace charanim
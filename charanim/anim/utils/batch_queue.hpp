@@ -0,0 +1,114 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <atomic>
+#include <vector>
+
+namespace charanim {
+
+/**
+ * @brief Lock-free queue of batches of messages.
+ *
+ * Many threads can push batches concurrently and one thread takes all
+ * the batches at once. The batches are kept in a linked stack whose top
+ * is changed with atomic operations: pushing is a compare-and-swap loop
+ * and taking is a single exchange, so there is no ABA problem.
+ *
+ * The batches are taken in reverse order of arrival: the order of the
+ * messages is not preserved.
+ */
+template<typename T>
+class batch_queue {
+	public:
+		/// A batch of messages.
+		struct batch {
+			/// The messages.
+			std::vector<T> msgs;
+			/// Next batch in the stack.
+			batch *next;
+		};
+
+	private:
+		/// Last batch pushed.
+		std::atomic<batch *> head;
+
+	public:
+		/// Default constructor.
+		batch_queue() : head(nullptr) { }
+		/// Destructor.
+		~batch_queue() {
+			clear();
+		}
+
+		// MODIFIERS
+
+		/**
+		 * @brief Pushes a batch of messages.
+		 *
+		 * The contents of @e msgs are moved into the queue: @e msgs is
+		 * left empty.
+		 */
+		void push(std::vector<T>& msgs) {
+			batch *b = new batch();
+			b->msgs.swap(msgs);
+			b->next = head.load(std::memory_order_relaxed);
+			while (not head.compare_exchange_weak
+				   (b->next, b, std::memory_order_release, std::memory_order_relaxed))
+			{ }
+		}
+
+		/**
+		 * @brief Takes all the batches in the queue.
+		 *
+		 * The caller owns the batches returned and must free them with
+		 * @ref free_batches.
+		 * @return Returns a linked list of batches, or nullptr.
+		 */
+		batch *take_all() {
+			return head.exchange(nullptr, std::memory_order_acquire);
+		}
+
+		/// Frees a list of batches returned by @ref take_all.
+		static void free_batches(batch *b) {
+			while (b != nullptr) {
+				batch *next = b->next;
+				delete b;
+				b = next;
+			}
+		}
+
+		/// Removes all the batches.
+		void clear() {
+			free_batches(take_all());
+		}
+
+		// GETTERS
+
+		/// Returns whether the queue is empty.
+		bool empty() const {
+			return head.load(std::memory_order_acquire) == nullptr;
+		}
+};
+
+} // -- namespace charanim
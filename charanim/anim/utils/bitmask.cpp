@@ -0,0 +1,65 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/utils/bitmask.hpp>
+
+namespace charanim {
+
+// PUBLIC
+
+bitmask::bitmask() {
+	width = height = stride = 0;
+}
+
+bitmask::~bitmask() {
+	clear();
+}
+
+// MODIFIERS
+
+void bitmask::init(size_t w, size_t h) {
+	width = w;
+	height = h;
+	// one padding bit at each side of the row
+	stride = (width + 2 + 63)/64;
+	words.assign((height + 2)*stride, 0);
+}
+
+void bitmask::clear() {
+	width = height = stride = 0;
+	words.clear();
+}
+
+// GETTERS
+
+size_t bitmask::get_width() const {
+	return width;
+}
+
+size_t bitmask::get_height() const {
+	return height;
+}
+
+size_t bitmask::get_bytes() const {
+	return words.size()*sizeof(uint64_t);
+}
+
+} // -- namespace charanim
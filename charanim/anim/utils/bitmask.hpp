@@ -0,0 +1,125 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace charanim {
+
+/**
+ * @brief Grid of bits, packed by rows.
+ *
+ * Every row is stored in consecutive 64-bit words. The rows are padded
+ * with one bit at each side, and the grid with one row at the top and
+ * one at the bottom, all of them unset. Then, the 8 neighbours of any
+ * cell can be obtained with a few shifts and bitwise operations without
+ * checking the boundaries of the grid.
+ */
+class bitmask {
+	private:
+		/// Bits of the grid.
+		std::vector<uint64_t> words;
+		/// Number of cells in the x-axis.
+		size_t width;
+		/// Number of cells in the y-axis.
+		size_t height;
+		/// Number of words of every (padded) row.
+		size_t stride;
+
+	private:
+		/**
+		 * @brief Returns the bits of cells (x-1,y), (x,y), (x+1,y).
+		 *
+		 * In the three least significant bits, in this order.
+		 */
+		inline uint32_t three_bits(int x, int y) const {
+			// the padding makes cell (x-1,y) be the bit at
+			// position x of the row y+1 of the storage
+			const uint64_t *row = &words[(y + 1)*stride];
+			const size_t w = static_cast<size_t>(x) >> 6;
+			const size_t o = static_cast<size_t>(x) & 63;
+			uint64_t v = row[w] >> o;
+			if (o > 61) {
+				v |= row[w + 1] << (64 - o);
+			}
+			return static_cast<uint32_t>(v & 0x7);
+		}
+
+	public:
+		/// Default constructor.
+		bitmask();
+		/// Destructor.
+		~bitmask();
+
+		// MODIFIERS
+
+		/// Initialises a grid of @e w x @e h cells, all unset.
+		void init(size_t w, size_t h);
+		/// Clears the memory occupied by this grid.
+		void clear();
+
+		/// Sets the bit of cell (x,y).
+		inline void set(size_t x, size_t y) {
+			const size_t b = x + 1;
+			words[(y + 1)*stride + (b >> 6)] |= (uint64_t(1) << (b & 63));
+		}
+		/// Unsets the bit of cell (x,y).
+		inline void unset(size_t x, size_t y) {
+			const size_t b = x + 1;
+			words[(y + 1)*stride + (b >> 6)] &= ~(uint64_t(1) << (b & 63));
+		}
+
+		// GETTERS
+
+		/// Returns the bit of cell (x,y).
+		inline bool get(size_t x, size_t y) const {
+			const size_t b = x + 1;
+			return (words[(y + 1)*stride + (b >> 6)] >> (b & 63)) & 1;
+		}
+
+		/**
+		 * @brief Returns the bits of the 8 neighbours of cell (x,y).
+		 *
+		 * The neighbours are, from the least significant bit to the most
+		 * significant bit: (x-1,y-1), (x,y-1), (x+1,y-1), (x-1,y),
+		 * (x+1,y), (x-1,y+1), (x,y+1), (x+1,y+1). The neighbours outside
+		 * the grid are unset.
+		 */
+		inline uint32_t neighbours(int x, int y) const {
+			const uint32_t above = three_bits(x, y - 1);
+			const uint32_t middle = three_bits(x, y);
+			const uint32_t below = three_bits(x, y + 1);
+			return above | ((middle & 0x1) << 3) | ((middle & 0x4) << 2) | (below << 5);
+		}
+
+		/// Returns the number of cells in the x-axis.
+		size_t get_width() const;
+		/// Returns the number of cells in the y-axis.
+		size_t get_height() const;
+		/// Returns the amount of bytes used.
+		size_t get_bytes() const;
+};
+
+} // -- namespace charanim
@@ -0,0 +1,110 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/utils/file_watcher.hpp>
+
+// C includes
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// C++ includes
+#include <iostream>
+using namespace std;
+
+namespace charanim {
+
+// events that modify the contents of the file
+#define WATCHED_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+// PUBLIC
+
+file_watcher::file_watcher() {
+	fd = -1;
+	wd = -1;
+}
+
+file_watcher::~file_watcher() {
+	close();
+}
+
+// MODIFIERS
+
+bool file_watcher::watch(const string& filename) {
+	close();
+
+	const size_t slash = filename.find_last_of('/');
+	const string dir =
+		(slash == string::npos ? "." : filename.substr(0, slash + 1));
+	name = (slash == string::npos ? filename : filename.substr(slash + 1));
+
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) {
+		cerr << "file_watcher::watch - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not initialise inotify" << endl;
+		return false;
+	}
+
+	wd = inotify_add_watch(fd, dir.c_str(), WATCHED_EVENTS);
+	if (wd == -1) {
+		cerr << "file_watcher::watch - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not watch directory: '" << dir << "'" << endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void file_watcher::close() {
+	if (fd != -1) {
+		::close(fd);
+	}
+	fd = -1;
+	wd = -1;
+	name.clear();
+}
+
+bool file_watcher::modified() {
+	if (fd == -1) {
+		return false;
+	}
+
+	bool mod = false;
+	alignas(inotify_event) char buf[4096];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		for (ssize_t i = 0; i < n; ) {
+			const inotify_event *e = reinterpret_cast<const inotify_event *>(buf + i);
+			if (e->len > 0 and name == e->name) {
+				mod = true;
+			}
+			i += sizeof(inotify_event) + e->len;
+		}
+	}
+	return mod;
+}
+
+// GETTERS
+
+bool file_watcher::is_watching() const {
+	return fd != -1;
+}
+
+} // -- namespace charanim
@@ -0,0 +1,80 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <string>
+
+namespace charanim {
+
+/**
+ * @brief Watches a file for modifications (inotify).
+ *
+ * The directory of the file is watched rather than the file itself:
+ * editors usually save a file by writing a new one and renaming it,
+ * which would remove the watch on the old one. The notifications are
+ * read without blocking, so @ref modified can be called every frame.
+ */
+class file_watcher {
+	private:
+		/// File descriptor of the inotify instance, -1 if none.
+		int fd;
+		/// Watch descriptor of the directory.
+		int wd;
+		/// Name of the file watched, without the directory.
+		std::string name;
+
+	public:
+		/// Default constructor.
+		file_watcher();
+		/// Destructor.
+		~file_watcher();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Starts watching a file.
+		 *
+		 * Stops watching the file watched previously, if any.
+		 * @return Returns false if the file can't be watched.
+		 */
+		bool watch(const std::string& filename);
+
+		/// Stops watching the file.
+		void close();
+
+		/**
+		 * @brief Has the file been modified since the last call?
+		 *
+		 * Reads all the pending notifications. The file is modified when
+		 * it is closed after being written, or when another file is moved
+		 * onto it.
+		 */
+		bool modified();
+
+		// GETTERS
+
+		/// Is a file being watched?
+		bool is_watching() const;
+};
+
+} // -- namespace charanim
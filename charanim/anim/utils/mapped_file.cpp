@@ -0,0 +1,104 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#include <anim/utils/mapped_file.hpp>
+
+// C includes
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// C++ includes
+#include <iostream>
+using namespace std;
+
+namespace charanim {
+
+// PUBLIC
+
+mapped_file::mapped_file() {
+	data = nullptr;
+	size = 0;
+}
+
+mapped_file::~mapped_file() {
+	close();
+}
+
+// MODIFIERS
+
+bool mapped_file::open(const string& filename) {
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		cerr << "mapped_file::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not open file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 or st.st_size == 0) {
+		cerr << "mapped_file::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not get the size of file: '" << filename << "'" << endl;
+		::close(fd);
+		return false;
+	}
+
+	size_t s = static_cast<size_t>(st.st_size);
+	void *m = mmap(nullptr, s, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after closing the descriptor
+	::close(fd);
+	if (m == MAP_FAILED) {
+		cerr << "mapped_file::open - Error (" << __LINE__ << "):" << endl;
+		cerr << "    Could not map file: '" << filename << "'" << endl;
+		return false;
+	}
+
+	data = static_cast<char *>(m);
+	size = s;
+	return true;
+}
+
+void mapped_file::close() {
+	if (data != nullptr) {
+		munmap(data, size);
+		data = nullptr;
+		size = 0;
+	}
+}
+
+// GETTERS
+
+bool mapped_file::is_open() const {
+	return data != nullptr;
+}
+
+char *mapped_file::get_data() const {
+	return data;
+}
+
+size_t mapped_file::get_size() const {
+	return size;
+}
+
+} // -- namespace charanim
@@ -0,0 +1,74 @@
+/*********************************************************************
+ * charanim - Character Animation Project
+ * Copyright (C) 2018 Lluís Alemany Puig
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * 
+ * Contact: Lluís Alemany Puig (lluis.alemany.puig@gmail.com)
+ * 
+ ********************************************************************/
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+#include <string>
+
+namespace charanim {
+
+/**
+ * @brief A file mapped into memory.
+ *
+ * The mapping is private: the contents can be modified, but the
+ * modifications are not written to the file. Pages are read from the
+ * file only when they are accessed, and copied only when they are
+ * modified.
+ */
+class mapped_file {
+	private:
+		/// First byte of the mapping.
+		char *data;
+		/// Size in bytes of the file.
+		size_t size;
+
+	public:
+		/// Default constructor.
+		mapped_file();
+		/// Destructor.
+		~mapped_file();
+
+		// MODIFIERS
+
+		/**
+		 * @brief Maps a file into memory.
+		 *
+		 * Closes the file mapped previously, if any.
+		 * @return Returns false if the file could not be mapped.
+		 */
+		bool open(const std::string& filename);
+
+		/// Unmaps the file.
+		void close();
+
+		// GETTERS
+
+		/// Is a file mapped?
+		bool is_open() const;
+		/// Returns the first byte of the mapping.
+		char *get_data() const;
+		/// Returns the size in bytes of the file.
+		size_t get_size() const;
+};
+
+} // -- namespace charanim